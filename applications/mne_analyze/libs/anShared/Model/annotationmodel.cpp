@@ -42,6 +42,8 @@
 #include <mne/mne.h>
 #include <iomanip>
 #include <iostream>
+#include <algorithm>
+#include <numeric>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -86,6 +88,7 @@ AnnotationModel::AnnotationModel(QObject* parent)
 , m_iLastTypeAdded(0)
 , m_fFreq(600)
 , m_sFilterEventType("All")
+, m_bFilteredSorted(true)
 {
     qInfo() << "[AnnotationModel::AnnotationModel] CONSTRUCTOR";
     initModel();
@@ -105,6 +108,7 @@ AnnotationModel::AnnotationModel(QSharedPointer<FiffRawViewModel> pFiffModel,
 , m_iLastTypeAdded(0)
 , m_fFreq(600)
 , m_sFilterEventType("All")
+, m_bFilteredSorted(true)
 , m_pFiffModel(pFiffModel)
 {
     initModel();
@@ -126,6 +130,7 @@ AnnotationModel::AnnotationModel(const QString &sFilePath,
 , m_iLastTypeAdded(0)
 , m_fFreq(600)
 , m_sFilterEventType("All")
+, m_bFilteredSorted(true)
 
 {
     initModel();
@@ -162,42 +167,16 @@ bool AnnotationModel::insertRows(int position,
         return false;
     }
 
-    if(m_dataSamples.isEmpty()) {
-        m_dataSamples.insert(0, m_iSamplePos);
-        m_dataTypes.insert(0, m_iType);
-        m_dataIsUserEvent.insert(0, 1);
-        m_dataGroup.insert(0, m_iSelectedGroup);
-    }
-    else {
-        for (int i = 0; i < span; ++i) {
-            for(int t = 0; t<m_dataSamples.size(); t++) {
-                if(m_dataSamples[t] >= m_iSamplePos) {
-                    m_dataSamples.insert(t, m_iSamplePos);
-
-                    if(m_sFilterEventType == "All")
-                        m_dataTypes.insert(t, m_iType);
-                    else
-                        m_dataTypes.insert(t, m_sFilterEventType.toInt());
-
-                    m_dataIsUserEvent.insert(t, 1);
-                    m_dataGroup.insert(t, m_iSelectedGroup);
-                    break;
-                }
-
-                if(t == m_dataSamples.size()-1) {
-                    m_dataSamples.append(m_iSamplePos);
+    int iType = (m_sFilterEventType == "All") ? m_iType : m_sFilterEventType.toInt();
 
-                    if(m_sFilterEventType == "All")
-                        m_dataTypes.append(m_iType);
-                    else
-                        m_dataTypes.append(m_sFilterEventType.toInt());
+    for (int i = 0; i < span; ++i) {
+        //The events are sorted by sample, find the insert position by bisection
+        int t = std::lower_bound(m_dataSamples.constBegin(), m_dataSamples.constEnd(), m_iSamplePos) - m_dataSamples.constBegin();
 
-                    m_dataIsUserEvent.append(1);
-                    m_dataGroup.append(m_iSelectedGroup);
-                    break;
-                }
-            }
-        }
+        m_dataSamples.insert(t, m_iSamplePos);
+        m_dataTypes.insert(t, iType);
+        m_dataIsUserEvent.insert(t, 1);
+        m_dataGroup.insert(t, m_iSelectedGroup);
     }
 
     beginInsertRows(QModelIndex(), position, position+span-1);
@@ -219,6 +198,29 @@ void AnnotationModel::setSamplePos(int iSamplePos)
 
 //=============================================================================================================
 
+void AnnotationModel::insertEvents(const QVector<int>& vecSamples)
+{
+    if (m_iSelectedGroup == ALLGROUPS || vecSamples.isEmpty()){
+        return;
+    }
+
+    int iType = (m_sFilterEventType == "All") ? m_iType : m_sFilterEventType.toInt();
+
+    beginResetModel();
+
+    m_dataSamples.append(vecSamples);
+    m_dataTypes.insert(m_dataTypes.size(), vecSamples.size(), iType);
+    m_dataIsUserEvent.insert(m_dataIsUserEvent.size(), vecSamples.size(), 1);
+    m_dataGroup.insert(m_dataGroup.size(), vecSamples.size(), m_iSelectedGroup);
+
+    sortEvents();
+    updateFilteredEvents();
+
+    endResetModel();
+}
+
+//=============================================================================================================
+
 int AnnotationModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
@@ -355,6 +357,9 @@ bool AnnotationModel::setData(const QModelIndex &index,
         }
     }
 
+    //Restore the sample order in case a sample was edited
+    sortEvents();
+
     //Update filtered event data
     setEventFilterType(m_sFilterEventType);
 
@@ -367,28 +372,9 @@ void AnnotationModel::setEventFilterType(const QString eventType)
 {
     m_sFilterEventType = eventType;
 
-    //Clear filtered event data
-    m_dataSamplesFiltered.clear();
-    m_dataTypesFiltered.clear();
-    m_dataIsUserEventFiltered.clear();
-    m_dataGroupFiltered.clear();
+    updateFilteredEvents();
 
-    //Fill filtered event data depending on the user defined event filter type
-    if(eventType == "All") {
-        m_dataSamplesFiltered = m_dataSamples;
-        m_dataTypesFiltered = m_dataTypes;
-        m_dataIsUserEventFiltered = m_dataIsUserEvent;
-        m_dataGroupFiltered = m_dataGroup;
-    }
-    else {
-        for(int i = 0; i<m_dataSamples.size(); i++) {
-            if(m_dataTypes[i] == eventType.toInt()) {
-                m_dataSamplesFiltered.append(m_dataSamples[i]);
-                m_dataTypesFiltered.append(m_dataTypes[i]);
-                m_dataIsUserEventFiltered.append(m_dataIsUserEvent[i]);
-                m_dataGroupFiltered.append(m_dataGroup[i]);
-            }
-        }
+    if(eventType != "All") {
         m_iLastTypeAdded = eventType.toInt();
     }
 
@@ -451,6 +437,7 @@ bool AnnotationModel::removeRows(int position,
             m_dataSamples.removeAt(position);
             m_dataTypes.removeAt(position);
             m_dataIsUserEvent.removeAt(position);
+            m_dataGroup.removeAt(position);
         }
     } 
 
@@ -518,6 +505,27 @@ int AnnotationModel::getAnnotation(int iIndex) const
 
 //=============================================================================================================
 
+QPair<int,int> AnnotationModel::getAnnotationRange(int iFirstSample,
+                                                   int iLastSample) const
+{
+    //The selected events are not ordered by sample, neither are the filtered events while one of them is dragged
+    if (m_iSelectedCheckState || !m_bFilteredSorted){
+        return QPair<int,int>(0, getNumberOfAnnotations());
+    }
+
+    QVector<int>::const_iterator itBegin = std::lower_bound(m_dataSamplesFiltered.constBegin(),
+                                                            m_dataSamplesFiltered.constEnd(),
+                                                            iFirstSample);
+    QVector<int>::const_iterator itEnd = std::upper_bound(itBegin,
+                                                          m_dataSamplesFiltered.constEnd(),
+                                                          iLastSample);
+
+    return QPair<int,int>(itBegin - m_dataSamplesFiltered.constBegin(),
+                          itEnd - m_dataSamplesFiltered.constBegin());
+}
+
+//=============================================================================================================
+
 void AnnotationModel::addNewAnnotationType(const QString &eventType,
                                            const QColor &typeColor)
 {
@@ -632,6 +640,7 @@ void AnnotationModel::updateFilteredSample(int iIndex,
                                            int iSample)
 {
     m_dataSamplesFiltered[iIndex] = iSample + m_iFirstSample;
+    m_bFilteredSorted = false;
 }
 
 //=============================================================================================================
@@ -639,6 +648,7 @@ void AnnotationModel::updateFilteredSample(int iIndex,
 void AnnotationModel::updateFilteredSample(int iSample)
 {
     m_dataSamplesFiltered[m_iSelectedAnn] = iSample + m_iFirstSample;
+    m_bFilteredSorted = false;
 }
 
 //=============================================================================================================
@@ -731,6 +741,7 @@ void AnnotationModel::switchGroup(int iGroupIndex)
     m_dataSamplesFiltered = m_mAnnotationHub[iGroupIndex]->dataSamples_Filtered;
     m_dataTypesFiltered = m_mAnnotationHub[iGroupIndex]->dataTypes_Filtered;
     m_dataIsUserEventFiltered = m_mAnnotationHub[iGroupIndex]->dataIsUserEvent_Filtered;
+    m_bFilteredSorted = std::is_sorted(m_dataSamplesFiltered.constBegin(), m_dataSamplesFiltered.constEnd());
 
     m_iSelectedGroup = m_mAnnotationHub[iGroupIndex]->groupNumber;
     m_bIsUserMade = m_mAnnotationHub[iGroupIndex]->isUserMade;
@@ -793,15 +804,12 @@ void AnnotationModel::loadAllGroups()
         m_dataSamples.append(e->dataSamples);
         m_dataTypes.append(e->dataTypes);
         m_dataIsUserEvent.append(e->dataIsUserEvent);
-
-        m_dataSamplesFiltered.append(e->dataSamples_Filtered);
-        m_dataTypesFiltered.append(e->dataTypes_Filtered);
-        m_dataIsUserEventFiltered = e->dataIsUserEvent_Filtered;
-
-        for(int i = 0; i < e->dataSamples.size(); i++){
-            m_dataGroup.append(e->groupNumber);
-        }
+        m_dataGroup.insert(m_dataGroup.size(), e->dataSamples.size(), e->groupNumber);
     }
+
+    //Each group is sorted on its own, merge them into one sorted list
+    sortEvents();
+    updateFilteredEvents();
 }
 
 //=============================================================================================================
@@ -1013,10 +1021,11 @@ void AnnotationModel::initFromFile(const QString& sFilePath)
         Eigen::MatrixXi eventList;
         MNELIB::MNE::read_events_from_ascii(file, eventList);
 
-        for(int i = 0; i < eventList.size(); i++){
-            setSamplePos(eventList(i,0));
-            insertRow(0, QModelIndex());
+        QVector<int> vecSamples(eventList.rows());
+        for(int i = 0; i < eventList.rows(); i++){
+            vecSamples[i] = eventList(i,0);
         }
+        insertEvents(vecSamples);
 
     } else if(fileInfo.exists() && (fileInfo.completeSuffix() == "fif")){
         QFile file(sFilePath);
@@ -1040,6 +1049,78 @@ void AnnotationModel::applyOffset(int iFirstSampleOffset)
         }
     }
 
+    sortEvents();
+
     //Update data to be diplayed
     setEventFilterType(m_sFilterEventType);
 }
+
+//=============================================================================================================
+
+void AnnotationModel::sortEvents()
+{
+    if (std::is_sorted(m_dataSamples.constBegin(), m_dataSamples.constEnd())){
+        return;
+    }
+
+    //Sort an index permutation so the parallel vectors stay aligned. Events at the same sample keep their order.
+    int iNumEvents = m_dataSamples.size();
+    QVector<int> vecOrder(iNumEvents);
+    std::iota(vecOrder.begin(), vecOrder.end(), 0);
+
+    const QVector<int>& vecSamples = m_dataSamples;
+    std::stable_sort(vecOrder.begin(), vecOrder.end(), [&vecSamples](int a, int b) {
+        return vecSamples.at(a) < vecSamples.at(b);
+    });
+
+    QVector<int> dataSamples(iNumEvents), dataTypes(iNumEvents), dataIsUserEvent(iNumEvents), dataGroup(iNumEvents);
+
+    for (int i = 0; i < iNumEvents; i++){
+        dataSamples[i] = m_dataSamples.at(vecOrder.at(i));
+        dataTypes[i] = m_dataTypes.at(vecOrder.at(i));
+        dataIsUserEvent[i] = m_dataIsUserEvent.at(vecOrder.at(i));
+        dataGroup[i] = m_dataGroup.at(vecOrder.at(i));
+    }
+
+    m_dataSamples.swap(dataSamples);
+    m_dataTypes.swap(dataTypes);
+    m_dataIsUserEvent.swap(dataIsUserEvent);
+    m_dataGroup.swap(dataGroup);
+}
+
+//=============================================================================================================
+
+void AnnotationModel::updateFilteredEvents()
+{
+    //Fill filtered event data depending on the user defined event filter type. The order of the events is kept.
+    if(m_sFilterEventType == "All") {
+        m_dataSamplesFiltered = m_dataSamples;
+        m_dataTypesFiltered = m_dataTypes;
+        m_dataIsUserEventFiltered = m_dataIsUserEvent;
+        m_dataGroupFiltered = m_dataGroup;
+    } else {
+        int iType = m_sFilterEventType.toInt();
+        int iCount = std::count(m_dataTypes.constBegin(), m_dataTypes.constEnd(), iType);
+
+        m_dataSamplesFiltered.clear();
+        m_dataTypesFiltered.clear();
+        m_dataIsUserEventFiltered.clear();
+        m_dataGroupFiltered.clear();
+
+        m_dataSamplesFiltered.reserve(iCount);
+        m_dataTypesFiltered.reserve(iCount);
+        m_dataIsUserEventFiltered.reserve(iCount);
+        m_dataGroupFiltered.reserve(iCount);
+
+        for(int i = 0; i < m_dataSamples.size(); i++) {
+            if(m_dataTypes.at(i) == iType) {
+                m_dataSamplesFiltered.append(m_dataSamples.at(i));
+                m_dataTypesFiltered.append(m_dataTypes.at(i));
+                m_dataIsUserEventFiltered.append(m_dataIsUserEvent.at(i));
+                m_dataGroupFiltered.append(m_dataGroup.at(i));
+            }
+        }
+    }
+
+    m_bFilteredSorted = true;
+}
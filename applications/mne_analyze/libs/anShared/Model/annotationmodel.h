@@ -235,6 +235,15 @@ public:
      */
     void setSamplePos(int iSamplePos);
 
+    //=========================================================================================================
+    /**
+     * Adds the events at the given samples to the current group in one go. The type is chosen as for insertRows.
+     * This sorts and filters the events once instead of once per event.
+     *
+     * @param [in] vecSamples   samples of the events to be added
+     */
+    void insertEvents(const QVector<int>& vecSamples);
+
     //=========================================================================================================
     /**
      * Sets current filter setting sto only display selected annotation type
@@ -295,6 +304,19 @@ public:
      */
     int getAnnotation(int iIndex) const;
 
+    //=========================================================================================================
+    /**
+     * Returns the indices of the annotations to be displayed whose samples lie within the given range. The events
+     * are kept sorted by sample, so the range is found by bisection.
+     *
+     * @param [in] iFirstSample     first sample of the range (inclusive)
+     * @param [in] iLastSample      last sample of the range (inclusive)
+     *
+     * @return First and one past the last index, to be used with getAnnotation
+     */
+    QPair<int, int> getAnnotationRange(int iFirstSample,
+                                       int iLastSample) const;
+
     //=========================================================================================================
     /**
      * Returns map of the colors assigned to each of the annotation types
@@ -687,6 +709,18 @@ private:
      */
     void initFromFile(const QString& sFilePath);
 
+    //=========================================================================================================
+    /**
+     * Sorts the events of the currently loaded event group by sample, keeping the parallel vectors aligned
+     */
+    void sortEvents();
+
+    //=========================================================================================================
+    /**
+     * Fills the filtered event data from the event data based on the current filter type
+     */
+    void updateFilteredEvents();
+
     QStringList                         m_eventTypeList;                /** <List of the possible event types */
 
     QMap<int,EventGroup*>               m_mAnnotationHub;               /** <Map of the EventGroups, which holds groups of events */
@@ -704,6 +738,7 @@ private:
     QVector<int>                        m_dataTypesFiltered;           /**< Types of the events to be displayed of the currently loaded event group */
     QVector<int>                        m_dataIsUserEventFiltered;     /**< Whether the events to be displayed in the currently loaded event group are user-made */
     QVector<int>                        m_dataGroupFiltered;
+    bool                                m_bFilteredSorted;             /**< Whether the filtered samples are sorted. Dragging an event can break the order until the next update */
 
     bool                                m_bIsUserMade;                  /**< Whether the current loaded group is user made */
 
@@ -0,0 +1,384 @@
+//=============================================================================================================
+/**
+ * @file     fiffrawblockcache.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    FiffRawBlockCache class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiffrawblockcache.h"
+
+#include <fiff/fiff_stream.h>
+
+#include <rtprocessing/filter.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtConcurrent/QtConcurrent>
+#include <QMutexLocker>
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace ANSHAREDLIB;
+using namespace FIFFLIB;
+using namespace RTPROCESSINGLIB;
+using namespace DISPLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawBlockCache::FiffRawBlockCache(const FiffRawData& raw,
+                                     QIODevice* pDevice,
+                                     qint32 iSamplesPerBlock,
+                                     qint64 iMemoryBudget)
+: m_pDevice(pDevice)
+, m_raw(raw)
+, m_iSamplesPerBlock(std::max(1, iSamplesPerBlock))
+, m_iNumBlocks(0)
+, m_iMemoryBudget(iMemoryBudget)
+, m_iMemoryUsed(0)
+, m_iUseCounter(0)
+, m_iFilterId(1)
+{
+    // Read through our own stream so that the background reads do not move the device of other users of the file
+    m_raw.file = FiffStream::SPtr(new FiffStream(m_pDevice.data()));
+
+    m_iNumBlocks = std::max(0, (m_raw.last_samp - m_raw.first_samp + 1) / m_iSamplesPerBlock);
+}
+
+//=============================================================================================================
+
+FiffRawBlockCache::~FiffRawBlockCache()
+{
+    waitForDone();
+}
+
+//=============================================================================================================
+
+void FiffRawBlockCache::setFilter(const FilterKernel& filterKernel,
+                                  const RowVectorXi& vecPicks)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_filterKernel = filterKernel;
+    m_vecFilterPicks = vecPicks;
+    ++m_iFilterId;
+
+    // The unfiltered blocks stay valid, drop the filtered ones of the previous filter
+    QMutableHashIterator<BlockKey, CacheEntry> it(m_hashBlocks);
+    while(it.hasNext()) {
+        it.next();
+        if(it.key().second != 0) {
+            m_iMemoryUsed -= it.value().iSize;
+            it.remove();
+        }
+    }
+}
+
+//=============================================================================================================
+
+void FiffRawBlockCache::setMemoryBudget(qint64 iMemoryBudget)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_iMemoryBudget = iMemoryBudget;
+    evict();
+}
+
+//=============================================================================================================
+
+QList<FiffRawBlockCache::Block> FiffRawBlockCache::getBlocks(int iFirstBlock,
+                                                             int iNumBlocks,
+                                                             bool bFiltered)
+{
+    QList<Block> lBlocks;
+    QList<int> lMissing;
+    QList<QFuture<Block> > lFutures;
+
+    m_mutex.lock();
+
+    #ifdef WASMBUILD
+    RTPROCESSINGLIB::FilterKernel filterKernel = m_filterKernel;
+    RowVectorXi vecPicks = m_vecFilterPicks;
+    #endif
+    int iFilterId = bFiltered ? m_iFilterId : 0;
+
+    for(int i = iFirstBlock; i < iFirstBlock + iNumBlocks; ++i) {
+        Block block;
+        BlockKey key(i, iFilterId);
+
+        if(i < 0 || i >= m_iNumBlocks) {
+            qWarning() << "[FiffRawBlockCache::getBlocks] Block" << i << "is out of range.";
+        } else if(!lookup(key, block)) {
+            lMissing.append(lBlocks.size());
+            #ifndef WASMBUILD
+            lFutures.append(requestBlock(key));
+            #endif
+        }
+
+        lBlocks.append(block);
+    }
+
+    m_mutex.unlock();
+
+    // In WASM mode there are no worker threads, load the missing blocks here
+    for(int i = 0; i < lMissing.size(); ++i) {
+        #ifdef WASMBUILD
+        lBlocks[lMissing.at(i)] = loadBlock(BlockKey(iFirstBlock + lMissing.at(i), iFilterId), filterKernel, vecPicks);
+        #else
+        lBlocks[lMissing.at(i)] = lFutures.at(i).result();
+        #endif
+    }
+
+    return lBlocks;
+}
+
+//=============================================================================================================
+
+void FiffRawBlockCache::prefetch(int iFirstBlock,
+                                 int iNumBlocks,
+                                 bool bFiltered)
+{
+    #ifdef WASMBUILD
+    Q_UNUSED(iFirstBlock);
+    Q_UNUSED(iNumBlocks);
+    Q_UNUSED(bFiltered);
+    #else
+    QMutexLocker locker(&m_mutex);
+
+    int iFilterId = bFiltered ? m_iFilterId : 0;
+    int iFrom = std::max(0, iFirstBlock);
+    int iTo = std::min(m_iNumBlocks, iFirstBlock + iNumBlocks);
+
+    for(int i = iFrom; i < iTo; ++i) {
+        BlockKey key(i, iFilterId);
+        if(!m_hashBlocks.contains(key)) {
+            requestBlock(key);
+        }
+    }
+    #endif
+}
+
+//=============================================================================================================
+
+void FiffRawBlockCache::waitForDone()
+{
+    m_threadPool.waitForDone();
+}
+
+//=============================================================================================================
+
+QFuture<FiffRawBlockCache::Block> FiffRawBlockCache::requestBlock(const BlockKey& key)
+{
+    if(m_hashPending.contains(key)) {
+        return m_hashPending.value(key);
+    }
+
+    // Capture the filter by value, a later setFilter must not change a running load
+    RTPROCESSINGLIB::FilterKernel filterKernel = m_filterKernel;
+    RowVectorXi vecPicks = m_vecFilterPicks;
+
+    QFuture<Block> future = QtConcurrent::run(&m_threadPool, [this, key, filterKernel, vecPicks]() {
+        Block block = loadBlock(key, filterKernel, vecPicks);
+
+        // The entry was inserted while m_mutex was held by the caller, so it is present by now
+        QMutexLocker locker(&m_mutex);
+        m_hashPending.remove(key);
+
+        return block;
+    });
+
+    m_hashPending.insert(key, future);
+
+    return future;
+}
+
+//=============================================================================================================
+
+FiffRawBlockCache::Block FiffRawBlockCache::loadBlock(const BlockKey& key,
+                                                      const FilterKernel& filterKernel,
+                                                      const RowVectorXi& vecPicks)
+{
+    if(key.second == 0) {
+        return rawBlock(key.first);
+    }
+
+    // Take enough neighbouring blocks to cover half the filter length on both sides. The workers never wait for
+    // each other's futures, a neighbour which is not cached yet is read here.
+    int iHalfOrder = filterKernel.getFilterOrder() / 2;
+    int iNeighbours = (iHalfOrder + m_iSamplesPerBlock - 1) / m_iSamplesPerBlock;
+    int iFrom = std::max(0, key.first - iNeighbours);
+    int iTo = std::min(m_iNumBlocks - 1, key.first + iNeighbours);
+
+    QList<Block> lSegment;
+    for(int i = iFrom; i <= iTo; ++i) {
+        lSegment.append(rawBlock(i));
+        if(!lSegment.last().pData) {
+            return Block();
+        }
+    }
+
+    const Block& center = lSegment.at(key.first - iFrom);
+    MatrixXd matSegment(center.pData->first.rows(), lSegment.size() * m_iSamplesPerBlock);
+    for(int i = 0; i < lSegment.size(); ++i) {
+        matSegment.middleCols(i * m_iSamplesPerBlock, m_iSamplesPerBlock) = lSegment.at(i).pData->first;
+    }
+
+    // The segment is filtered as a whole and the delay is removed, so the block can be cut out at its own position
+    matSegment = RTPROCESSINGLIB::filterData(matSegment,
+                                             filterKernel,
+                                             vecPicks,
+                                             false);
+
+    Block block;
+    block.pData = QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(MatrixXd(matSegment.middleCols((key.first - iFrom) * m_iSamplesPerBlock, m_iSamplesPerBlock)),
+                                                                               center.pData->second));
+    block.pPyramid = MinMaxPyramid::SPtr::create();
+    block.pPyramid->build(block.pData->first);
+
+    insertBlock(key, block);
+
+    return block;
+}
+
+//=============================================================================================================
+
+FiffRawBlockCache::Block FiffRawBlockCache::rawBlock(int iBlock)
+{
+    Block block;
+    BlockKey key(iBlock, 0);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if(lookup(key, block)) {
+            return block;
+        }
+    }
+
+    MatrixXd matData, matTimes;
+    qint32 iFirst = blockFirstSample(iBlock);
+    bool bSuccess = false;
+
+    {
+        // read_raw_segment moves the device, only one read at a time
+        QMutexLocker locker(&m_ioMutex);
+        bSuccess = m_raw.read_raw_segment(matData, matTimes, iFirst, iFirst + m_iSamplesPerBlock - 1);
+    }
+
+    if(!bSuccess) {
+        qWarning() << "[FiffRawBlockCache::rawBlock] Could not read samples" << iFirst << "to" << iFirst + m_iSamplesPerBlock - 1;
+        return block;
+    }
+
+    block.pData = QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData, matTimes));
+    block.pPyramid = MinMaxPyramid::SPtr::create();
+    block.pPyramid->build(block.pData->first);
+
+    insertBlock(key, block);
+
+    return block;
+}
+
+//=============================================================================================================
+
+bool FiffRawBlockCache::lookup(const BlockKey& key,
+                               Block& block)
+{
+    QHash<BlockKey, CacheEntry>::iterator it = m_hashBlocks.find(key);
+
+    if(it == m_hashBlocks.end()) {
+        return false;
+    }
+
+    it.value().iLastUsed = ++m_iUseCounter;
+    block = it.value().block;
+
+    return true;
+}
+
+//=============================================================================================================
+
+void FiffRawBlockCache::insertBlock(const BlockKey& key,
+                                    const Block& block)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // Drop blocks which were filtered with an outdated filter
+    if(key.second != 0 && key.second != m_iFilterId) {
+        return;
+    }
+
+    CacheEntry entry;
+    entry.block = block;
+    entry.iLastUsed = ++m_iUseCounter;
+    entry.iSize = (block.pData->first.size() + block.pData->second.size()) * qint64(sizeof(double));
+
+    for(int i = 0; i < block.pPyramid->numLevels(); ++i) {
+        entry.iSize += 2 * qint64(sizeof(float)) * block.pPyramid->numRows() * block.pPyramid->numBins(i);
+    }
+
+    if(m_hashBlocks.contains(key)) {
+        m_iMemoryUsed -= m_hashBlocks.value(key).iSize;
+    }
+
+    m_hashBlocks.insert(key, entry);
+    m_iMemoryUsed += entry.iSize;
+
+    evict();
+}
+
+//=============================================================================================================
+
+void FiffRawBlockCache::evict()
+{
+    // Blocks which are still displayed are shared with the model and only released here
+    while(m_iMemoryUsed > m_iMemoryBudget && m_hashBlocks.size() > 1) {
+        QHash<BlockKey, CacheEntry>::iterator itOldest = m_hashBlocks.begin();
+
+        for(QHash<BlockKey, CacheEntry>::iterator it = m_hashBlocks.begin(); it != m_hashBlocks.end(); ++it) {
+            if(it.value().iLastUsed < itOldest.value().iLastUsed) {
+                itOldest = it;
+            }
+        }
+
+        m_iMemoryUsed -= itOldest.value().iSize;
+        m_hashBlocks.erase(itOldest);
+    }
+}
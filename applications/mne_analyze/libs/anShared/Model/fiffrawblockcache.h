@@ -0,0 +1,306 @@
+//=============================================================================================================
+/**
+ * @file     fiffrawblockcache.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    FiffRawBlockCache class declaration.
+ *
+ */
+
+#ifndef ANSHAREDLIB_FIFFRAWBLOCKCACHE_H
+#define ANSHAREDLIB_FIFFRAWBLOCKCACHE_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../anshared_global.h"
+
+#include <fiff/fiff_raw_data.h>
+
+#include <rtprocessing/helpers/filterkernel.h>
+
+#include <disp/viewers/helpers/minmaxpyramid.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QPair>
+#include <QHash>
+#include <QList>
+#include <QFuture>
+#include <QMutex>
+#include <QThreadPool>
+#include <QIODevice>
+
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE ANSHAREDLIB
+//=============================================================================================================
+
+namespace ANSHAREDLIB {
+
+//=============================================================================================================
+/**
+ * Cache of the raw data blocks of a fiff file, keyed by block index and filter. The blocks are read and filtered on
+ * a worker pool and evicted in least recently used order once the memory budget is exceeded. Unfiltered blocks stay
+ * valid when the filter changes, so that new filtered blocks are computed from them without reading the file again.
+ *
+ * The cache reads through its own QIODevice, so background reads do not interfere with other users of the file.
+ *
+ * @brief Prefetching LRU block cache for raw fiff data.
+ */
+class ANSHAREDSHARED_EXPORT FiffRawBlockCache
+{
+public:
+    typedef QSharedPointer<FiffRawBlockCache> SPtr;              /**< Shared pointer type for FiffRawBlockCache. */
+    typedef QSharedPointer<const FiffRawBlockCache> ConstSPtr;   /**< Const shared pointer type for FiffRawBlockCache. */
+
+    /**
+     * A cached block
+     */
+    struct Block {
+        QSharedPointer<QPair<Eigen::MatrixXd, Eigen::MatrixXd> >  pData;      /**< The data and times of the block. Null if the block could not be loaded. */
+        DISPLIB::MinMaxPyramid::SPtr                             pPyramid;   /**< The min/max pyramid of the data. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Constructs a FiffRawBlockCache object.
+     *
+     * @param[in] raw                   The raw data to read from. Its stream is replaced by one on pDevice.
+     * @param[in] pDevice               The device to read the file from. The cache takes ownership.
+     * @param[in] iSamplesPerBlock      The number of samples per block.
+     * @param[in] iMemoryBudget         The memory budget in bytes. Default is 512 MB.
+     */
+    FiffRawBlockCache(const FIFFLIB::FiffRawData& raw,
+                      QIODevice* pDevice,
+                      qint32 iSamplesPerBlock,
+                      qint64 iMemoryBudget = 512 * 1024 * 1024);
+
+    //=========================================================================================================
+    /**
+     * Destructs the FiffRawBlockCache. Waits for all pending loads.
+     */
+    ~FiffRawBlockCache();
+
+    //=========================================================================================================
+    /**
+     * Sets the filter for the filtered blocks. Cached filtered blocks of the previous filter are dropped, the
+     * unfiltered blocks are kept.
+     *
+     * @param[in] filterKernel  The filter kernel.
+     * @param[in] vecPicks      The indices of the channels to filter.
+     */
+    void setFilter(const RTPROCESSINGLIB::FilterKernel& filterKernel,
+                   const Eigen::RowVectorXi& vecPicks);
+
+    //=========================================================================================================
+    /**
+     * Sets the memory budget. Evicts blocks if it is exceeded.
+     *
+     * @param[in] iMemoryBudget     The memory budget in bytes.
+     */
+    void setMemoryBudget(qint64 iMemoryBudget);
+
+    //=========================================================================================================
+    /**
+     * Returns the requested blocks. Missing blocks are loaded in parallel and the call blocks until all of them
+     * are available.
+     *
+     * @param[in] iFirstBlock   The index of the first block.
+     * @param[in] iNumBlocks    The number of blocks.
+     * @param[in] bFiltered     Whether to return the filtered blocks.
+     *
+     * @return The blocks.
+     */
+    QList<Block> getBlocks(int iFirstBlock,
+                           int iNumBlocks,
+                           bool bFiltered);
+
+    //=========================================================================================================
+    /**
+     * Starts loading the given blocks in the background if they are neither cached nor pending. Blocks outside of
+     * the file are ignored.
+     *
+     * @param[in] iFirstBlock   The index of the first block.
+     * @param[in] iNumBlocks    The number of blocks.
+     * @param[in] bFiltered     Whether to load the filtered blocks.
+     */
+    void prefetch(int iFirstBlock,
+                  int iNumBlocks,
+                  bool bFiltered);
+
+    //=========================================================================================================
+    /**
+     * Waits for all pending loads.
+     */
+    void waitForDone();
+
+    //=========================================================================================================
+    /**
+     * @return The number of samples per block.
+     */
+    inline qint32 samplesPerBlock() const;
+
+    //=========================================================================================================
+    /**
+     * @return The number of complete blocks in the file. Samples after the last complete block are not cached.
+     */
+    inline int numBlocks() const;
+
+    //=========================================================================================================
+    /**
+     * @param[in] iSample   The absolute sample.
+     *
+     * @return The index of the block which contains the given sample.
+     */
+    inline int blockIndex(qint32 iSample) const;
+
+    //=========================================================================================================
+    /**
+     * @param[in] iBlock    The block index.
+     *
+     * @return The absolute first sample of the block.
+     */
+    inline qint32 blockFirstSample(int iBlock) const;
+
+private:
+    typedef QPair<int,int> BlockKey;            /**< Block index and filter id. Filter id 0 denotes the unfiltered data. */
+
+    /**
+     * A block with its bookkeeping
+     */
+    struct CacheEntry {
+        Block   block;                          /**< The block. */
+        qint64  iSize;                          /**< The memory used by the block in bytes. */
+        quint64 iLastUsed;                      /**< The value of the use counter at the last access. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Starts loading the block in the background. m_mutex must be locked.
+     */
+    QFuture<Block> requestBlock(const BlockKey& key);
+
+    //=========================================================================================================
+    /**
+     * Loads the block. For filtered blocks the unfiltered blocks covering the filter length are taken from the
+     * cache or read and then filtered. Runs in the worker threads.
+     */
+    Block loadBlock(const BlockKey& key,
+                    const RTPROCESSINGLIB::FilterKernel& filterKernel,
+                    const Eigen::RowVectorXi& vecPicks);
+
+    //=========================================================================================================
+    /**
+     * Returns the unfiltered block from the cache or reads it from the file.
+     */
+    Block rawBlock(int iBlock);
+
+    //=========================================================================================================
+    /**
+     * Looks up the block and marks it as used. m_mutex must be locked.
+     */
+    bool lookup(const BlockKey& key,
+                Block& block);
+
+    //=========================================================================================================
+    /**
+     * Inserts the block unless it belongs to an outdated filter and evicts blocks if the budget is exceeded.
+     */
+    void insertBlock(const BlockKey& key,
+                     const Block& block);
+
+    //=========================================================================================================
+    /**
+     * Evicts the least recently used blocks until the memory budget is met. m_mutex must be locked.
+     */
+    void evict();
+
+    QSharedPointer<QIODevice>           m_pDevice;              /**< The device the cache reads from. */
+    FIFFLIB::FiffRawData                m_raw;                  /**< The raw data, reading from m_pDevice. */
+
+    qint32                              m_iSamplesPerBlock;     /**< Number of samples per block. */
+    int                                 m_iNumBlocks;           /**< Number of blocks in the file. */
+    qint64                              m_iMemoryBudget;        /**< Memory budget in bytes. */
+    qint64                              m_iMemoryUsed;          /**< Memory used by the cached blocks in bytes. */
+    quint64                             m_iUseCounter;          /**< Counter stamped on every access, for the LRU order. */
+
+    int                                 m_iFilterId;            /**< Id of the current filter. */
+    RTPROCESSINGLIB::FilterKernel       m_filterKernel;         /**< The current filter kernel. */
+    Eigen::RowVectorXi                  m_vecFilterPicks;       /**< The channels to filter. */
+
+    QHash<BlockKey, CacheEntry>         m_hashBlocks;           /**< The cached blocks. */
+    QHash<BlockKey, QFuture<Block> >    m_hashPending;          /**< The blocks which are currently loaded. */
+
+    QMutex                              m_mutex;                /**< Guards the cache and the filter. */
+    QMutex                              m_ioMutex;              /**< Serializes the reads from m_pDevice. */
+    QThreadPool                         m_threadPool;           /**< The worker pool. Declared last so it is destroyed first. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline qint32 FiffRawBlockCache::samplesPerBlock() const
+{
+    return m_iSamplesPerBlock;
+}
+
+//=============================================================================================================
+
+inline int FiffRawBlockCache::numBlocks() const
+{
+    return m_iNumBlocks;
+}
+
+//=============================================================================================================
+
+inline int FiffRawBlockCache::blockIndex(qint32 iSample) const
+{
+    return (iSample - m_raw.first_samp) / m_iSamplesPerBlock;
+}
+
+//=============================================================================================================
+
+inline qint32 FiffRawBlockCache::blockFirstSample(int iBlock) const
+{
+    return m_raw.first_samp + iBlock * m_iSamplesPerBlock;
+}
+
+} // namespace ANSHAREDLIB
+
+#endif // ANSHAREDLIB_FIFFRAWBLOCKCACHE_H
@@ -56,7 +56,6 @@
 // QT INCLUDES
 //=============================================================================================================
 
-#include <QtConcurrent/QtConcurrent>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QBrush>
@@ -74,6 +73,7 @@ using namespace ANSHAREDLIB;
 using namespace FIFFLIB;
 using namespace UTILSLIB;
 using namespace RTPROCESSINGLIB;
+using namespace DISPLIB;
 
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
@@ -103,23 +103,15 @@ FiffRawViewModel::FiffRawViewModel(const QString &sFilePath,
 , m_iPreloadBufferSize(std::max(2, iPreloadBufferSize))
 , m_iTotalBlockCount(m_iVisibleWindowSize + 2 * m_iPreloadBufferSize)
 , m_iFiffCursorBegin(-1)
+, m_iFirstBlock(-1)
 , m_bStartOfFileReached(true)
 , m_bEndOfFileReached(false)
-, m_blockLoadFutureWatcher()
-, m_bCurrentlyLoading(false)
-, m_pRtFilter(FilterOverlapAdd::SPtr::create())
 , m_bPerformFiltering(false)
 , m_iDistanceTimerSpacer(1000)
 , m_iScrollPos(0)
 , m_bDispAnnotation(true)
 //, m_pAnnotationModel(QSharedPointer<AnnotationModel>::create())
 {
-    // connect data reloading: this will be run concurrently
-    connect(&m_blockLoadFutureWatcher, &QFutureWatcher<int>::finished,
-            [this]() {
-                postBlockLoad(m_blockLoadFutureWatcher.future().result());
-            });
-
     if(byteLoadedData.isEmpty()) {
         m_file.setFileName(sFilePath);
         initFiffData(m_file);
@@ -159,15 +151,30 @@ void FiffRawViewModel::initFiffData(QIODevice& p_IODevice)
     // load FiffInfo
     m_pFiffInfo = FiffInfo::SPtr(new FiffInfo(m_pFiffIO->m_qlistRaw[0]->info));
 
-    // build datastructure that is to be filled with data from the file
-    MatrixXd data, times;
+    // The block cache reads through its own device so that it does not interfere with other users of the FiffIO
+    QIODevice* pCacheDevice = Q_NULLPTR;
+
+    if(QFile* pFile = qobject_cast<QFile*>(&p_IODevice)) {
+        pCacheDevice = new QFile(pFile->fileName());
+    } else if(QBuffer* pBuffer = qobject_cast<QBuffer*>(&p_IODevice)) {
+        QBuffer* pCacheBuffer = new QBuffer();
+        pCacheBuffer->setData(pBuffer->data());
+        pCacheDevice = pCacheBuffer;
+    } else {
+        qWarning() << "[FiffRawViewModel::initFiffData] Only files and buffers are supported";
+        return;
+    }
 
     // Fiff file is not empty, set cursor somewhere into Fiff file
     m_iFiffCursorBegin = m_pFiffIO->m_qlistRaw[0]->first_samp;
     m_iSamplesPerBlock = m_pFiffInfo->sfreq;
+    m_iFirstBlock = 0;
+    m_pBlockCache = FiffRawBlockCache::SPtr::create(*m_pFiffIO->m_qlistRaw[0],
+                                                    pCacheDevice,
+                                                    m_iSamplesPerBlock);
     reloadAllData();
 
-    qInfo() << "[FiffRawViewModel::initFiffData] Loaded" << m_lData.size() << "blocks with size"<<data.rows()<<"x"<<m_iSamplesPerBlock;
+    qInfo() << "[FiffRawViewModel::initFiffData] Loaded" << m_lData.size() << "blocks with size"<<m_pFiffInfo->nchan<<"x"<<m_iSamplesPerBlock;
 
     // need to close the file manually
     p_IODevice.close();
@@ -207,9 +214,9 @@ QVariant FiffRawViewModel::data(const QModelIndex &index,
 
                     // wrap in ChannelData container and then wrap into QVariant
                     if(m_bPerformFiltering) {
-                        result.setValue(ChannelData(m_lFilteredData, index.row()));
+                        result.setValue(ChannelData(m_lFilteredData, m_lFilteredPyramids, index.row()));
                     } else {
-                        result.setValue(ChannelData(m_lData, index.row()));
+                        result.setValue(ChannelData(m_lData, m_lPyramids, index.row()));
                     }
 
                     m_dataMutex.unlock();
@@ -447,6 +454,18 @@ int FiffRawViewModel::getTimeListSize() const
 
 //=============================================================================================================
 
+QPair<int,int> FiffRawViewModel::getTimeMarkRange(int iFirstSample,
+                                                  int iLastSample) const
+{
+    if(m_pAnnotationModel){
+        return m_pAnnotationModel->getAnnotationRange(iFirstSample, iLastSample);
+    } else {
+        return QPair<int,int>(0, 0);
+    }
+}
+
+//=============================================================================================================
+
 int FiffRawViewModel::getSampleScrollPos() const
 {
     return m_iScrollPos;
@@ -491,6 +510,10 @@ void FiffRawViewModel::setFilter(const FilterKernel& filterData)
 {
     m_filterKernel = filterData;
 
+    if(m_pBlockCache) {
+        m_pBlockCache->setFilter(m_filterKernel, m_lFilterChannelList);
+    }
+
     if(m_bPerformFiltering) {
         reloadAllData();
     }
@@ -537,6 +560,10 @@ void FiffRawViewModel::setFilterChannelType(const QString& channelType)
         }
     }
 
+    if(m_pBlockCache) {
+        m_pBlockCache->setFilter(m_filterKernel, m_lFilterChannelList);
+    }
+
     if(m_bPerformFiltering) {
         reloadAllData();
     }
@@ -560,90 +587,32 @@ QSharedPointer<FIFFLIB::FiffIO> FiffRawViewModel::getFiffIO() const
 
 void FiffRawViewModel::updateHorizontalScrollPosition(qint32 newScrollPosition)
 {
-    // check if we are currently loading something in the background. This is a rudimentary solution.
-    if (m_bCurrentlyLoading) {
-        qInfo() << "[FiffRawViewModel::updateScrollPosition] Background operation still pending, try again later...";
+    m_iScrollPos = newScrollPosition;
+
+    if(!m_pBlockCache) {
         return;
     }
 
-    m_iScrollPos = newScrollPosition;
-
     // Convert scroll position to fiff sample space via m_dDx
-    qint32 targetCursor = (newScrollPosition / m_dDx) + absoluteFirstSample() ;
-
-    if (targetCursor < m_iFiffCursorBegin + (m_iPreloadBufferSize - 1) * m_iSamplesPerBlock
-        && !m_bStartOfFileReached) {
-        // Calculate the amount of data we need to load
-        qint32 sampleDist = (m_iFiffCursorBegin + (m_iPreloadBufferSize - 1) * m_iSamplesPerBlock) - targetCursor;
-
-        // Calculate the needed blocks based on the amount of samples to load
-        qint32 blockDist = (qint32) ceil(((double) sampleDist) / ((double) m_iSamplesPerBlock));
-
-        if (blockDist >= m_iTotalBlockCount) {
-            // we must "jump" to the new cursor ...
-            m_iFiffCursorBegin = std::max(absoluteFirstSample(), m_iFiffCursorBegin - (blockDist * m_iSamplesPerBlock));
-
-            // and load all the data anew
-            reloadAllData();
-        } else {
-            // there are some blocks in the intersection of the old and the new window that can stay in the buffer:
-            // simply load earlier blocks
-            //startBackgroundOperation(&FiffRawViewModel::loadEarlierBlocks, blockDist);
-            postBlockLoad(loadEarlierBlocks(blockDist));
-        }
-    } else if (targetCursor + (m_iVisibleWindowSize * m_iSamplesPerBlock) >= m_iFiffCursorBegin + ((m_iPreloadBufferSize + 1) + m_iVisibleWindowSize) * m_iSamplesPerBlock
-               && !m_bEndOfFileReached) {
-        // Calculate the amount of data we need to load
-        qint32 sampleDist = targetCursor + (m_iVisibleWindowSize * m_iSamplesPerBlock) - (m_iFiffCursorBegin + ((m_iPreloadBufferSize + 1) + m_iVisibleWindowSize) * m_iSamplesPerBlock);
-
-        // Calculate the needed blocks based on the amount of samples to load
-        qint32 blockDist = (qint32) ceil(((double) sampleDist) / ((double) m_iSamplesPerBlock));
+    qint32 targetCursor = (newScrollPosition / m_dDx) + absoluteFirstSample();
 
-        if (blockDist >= m_iTotalBlockCount) {
-            // we must "jump" to the new cursor ...
-            int iResidual = absoluteLastSample() % m_iSamplesPerBlock;
-            m_iFiffCursorBegin = std::min(absoluteLastSample() - (m_iTotalBlockCount * m_iSamplesPerBlock + iResidual), m_iFiffCursorBegin + (blockDist * m_iSamplesPerBlock));
+    // Keep m_iPreloadBufferSize blocks before the visible window
+    int iFirstBlock = m_pBlockCache->blockIndex(targetCursor) - m_iPreloadBufferSize;
+    iFirstBlock = std::max(0, std::min(iFirstBlock, m_pBlockCache->numBlocks() - m_iTotalBlockCount));
 
-            // and load all the data anew
-            reloadAllData();
-        } else {
-            // there are some blocks in the intersection of the old and the new window that can stay in the buffer:
-            // simply load later blocks
-            //startBackgroundOperation(&FiffRawViewModel::loadLaterBlocks, blockDist);
-            postBlockLoad(loadLaterBlocks(blockDist));
-        }
+    if(iFirstBlock == m_iFirstBlock) {
+        return;
     }
-}
 
-//=============================================================================================================
+    int iVelocity = iFirstBlock - m_iFirstBlock;
 
-bool FiffRawViewModel::filterDataBlock(MatrixXd& matData,
-                                       bool bFilterEnd,
-                                       bool bKeepOverhead)
-{
-    if(!m_bPerformFiltering) {
-        return false;
-    }
-
-    if(m_lFilterChannelList.cols() == 0) {
-        qWarning() << "[FiffRawViewModel::filterDataBlock] No channels to filter specified.";
-        return false;
+    // The blocks were usually prefetched, so this only blocks when the user jumps or scrolls faster than we read
+    if(setBlocks(iFirstBlock)) {
+        emit newBlocksLoaded();
+        emit dataChanged(createIndex(0,0), createIndex(rowCount(), columnCount()));
     }
 
-    // In WASM mode do not use multithreading for filtering
-    bool bUseThread = true;
-    #ifdef WASMBUILD
-    bUseThread = false;
-    #endif
-
-    matData = m_pRtFilter->calculate(matData,
-                                     m_filterKernel,
-                                     m_lFilterChannelList,
-                                     bFilterEnd,
-                                     bUseThread,
-                                     bKeepOverhead);
-
-    return true;
+    prefetchBlocks(iVelocity);
 }
 
 //=============================================================================================================
@@ -656,342 +625,80 @@ void FiffRawViewModel::updateEndStartFlags()
 
 //=============================================================================================================
 
-void FiffRawViewModel::startBackgroundOperation(int (FiffRawViewModel::*loadFunction)(int), int iBlocksToLoad)
-{
-    m_bCurrentlyLoading = true;
-    QFuture<int> future = QtConcurrent::run(this, loadFunction, iBlocksToLoad);
-    m_blockLoadFutureWatcher.setFuture(future);
-}
-
-//=============================================================================================================
-
-int FiffRawViewModel::loadEarlierBlocks(qint32 numBlocks)
+void FiffRawViewModel::reloadAllData()
 {
-    // check if start of file was reached:
-    int leftSamples = (m_iFiffCursorBegin - numBlocks * m_iSamplesPerBlock) - absoluteFirstSample();
-
-    if (leftSamples <= 0) {
-        qInfo() << "[FiffRawViewModel::loadEarlierBlocks] Reached start of file !";
-        // see how many blocks we still can load
-        int maxNumBlocks = (m_iFiffCursorBegin - absoluteFirstSample()) / m_iSamplesPerBlock;
-        qInfo() << "[FiffRawViewModel::loadEarlierBlocks] Loading " << maxNumBlocks << " earlier blocks instead of requested " << numBlocks;
-        if (maxNumBlocks != 0) {
-            numBlocks = maxNumBlocks;
-        } else {
-            // nothing to be done, cant load any more blocks
-            // return 0, meaning that this was a loading of earlier blocks
-            return 0;
-        }
-    }
-
-    // we expect m_lNewData and m_lFilteredNewData to be empty:
-    if (m_lNewData.empty() == false ||
-        m_lFilteredNewData.empty() == false) {
-        qWarning() << "[FiffRawViewModel::loadEarlierBlocks] Warning! Temporary data storage non empty !";
-        return -1;
-    }
-
-    // build data structures to be filled from file
-    MatrixXd matData, matTimes;
-
-    // initialize start and end indices
-    int start = m_iFiffCursorBegin - (numBlocks * m_iSamplesPerBlock);
-    int end = m_iFiffCursorBegin - 1;
-
-    // Update m_iFiffCursorBegin before we account for the filter delay
-    if(start <= absoluteFirstSample()) {
-        m_iFiffCursorBegin = absoluteFirstSample();
-    } else {
-        m_iFiffCursorBegin = start;
-    }
-
-    // When filtering load more data than we need in order to allow arbiritary filter lengths
-    int iFilterDelay = 0;
-    bool bBeforeStartReached = false;
-
-    if(m_bPerformFiltering) {
-        iFilterDelay = m_filterKernel.getFilterOrder()/2;
-        end += m_filterKernel.getFilterOrder()/2;
-
-        // Check if we have reached the beginning/end of the file
-        if(start-iFilterDelay >= absoluteFirstSample()) {
-            start -= m_filterKernel.getFilterOrder()/2;
-        } else {
-            // Add another filter delay because we need enough data to sucessfully filter with arbiritary filter lengths
-            end += m_filterKernel.getFilterOrder()/2;
-            iFilterDelay = 0;
-            bBeforeStartReached = true;
-        }
-    }
-
-    // Read the raw data
-    if(m_pFiffIO->m_qlistRaw[0]->read_raw_segment(matData, matTimes, start, end)) {
-        // qDebug() << "[FiffRawViewModel::loadFiffData] Successfully read a block ";
-    } else {
-        qWarning() << "[FiffRawViewModel::loadEarlierBlocks] Could not read block ";
-        return -1;
-    }
-
-    for(int i = 0; i < numBlocks; ++i) {
-        m_lNewData.push_front(QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData.block(0, i*m_iSamplesPerBlock+iFilterDelay, matData.rows(), m_iSamplesPerBlock),
-                                                                                           matTimes.block(0, i*m_iSamplesPerBlock+iFilterDelay, matTimes.rows(), m_iSamplesPerBlock))));
+    if(!m_pBlockCache) {
+        return;
     }
 
-    // Filter data if activated, otherwise set to raw data
-    if(m_bPerformFiltering) {
-        bool bFilterSuccess = false;
-        if(bBeforeStartReached) {
-            iFilterDelay = m_filterKernel.getFilterOrder()/4;
-            bFilterSuccess = filterDataBlock(matData, true, true);
-        } else {
-            bFilterSuccess = filterDataBlock(matData, true);
-        }
-
-        if(!bFilterSuccess) {
-            m_lFilteredNewData = m_lNewData;
-            return 0;
-        }
-
-        for(int i = 0; i < numBlocks; ++i) {
-            m_lFilteredNewData.push_front(QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData.block(0, (i*m_iSamplesPerBlock)+(2*iFilterDelay), matData.rows(), m_iSamplesPerBlock),
-                                                                                                       matTimes.block(0, (i*m_iSamplesPerBlock)+(2*iFilterDelay), matTimes.rows(), m_iSamplesPerBlock))));
-        }
-    } else {
-        m_lFilteredNewData = m_lNewData;
-    }
+    setBlocks(m_iFirstBlock);
+    prefetchBlocks(0);
 
-    // return 0, meaning that this was a loading of earlier blocks
-    return 0;
+    emit dataChanged(createIndex(0,0), createIndex(rowCount(), columnCount()));
 }
 
 //=============================================================================================================
 
-int FiffRawViewModel::loadLaterBlocks(qint32 numBlocks)
+bool FiffRawViewModel::setBlocks(int iFirstBlock)
 {
-    // check if end of file is reached:
-    int leftSamples = absoluteLastSample() - (m_iFiffCursorBegin + (m_iTotalBlockCount + numBlocks) * m_iSamplesPerBlock);
-    if (leftSamples < 0) {
-        qInfo() << "[FiffRawViewModel::loadLaterBlocks] Reached end of file !";
-        // see how many blocks we still can load
-        int maxNumBlocks = (absoluteLastSample() - (m_iFiffCursorBegin + m_iTotalBlockCount * m_iSamplesPerBlock)) / m_iSamplesPerBlock;
-        //qInfo() << "[FiffRawViewModel::loadLaterBlocks] Loading " << maxNumBlocks << " later blocks instead of requested " << numBlocks;
-        if (maxNumBlocks != 0) {
-            numBlocks = maxNumBlocks;
-        } else {
-            // nothing to be done, cant load any more blocks
-            // return 1, meaning that this was a loading of later blocks
-            return 1;
-        }
-    }
-
-    // we expect m_lNewData and m_lFilteredNewData to be empty:
-    if (m_lNewData.empty() == false ||
-        m_lFilteredNewData.empty() == false) {
-        qWarning() << "[FiffRawViewModel::loadEarlierBlocks] Warning! Temporary data storage non empty !";
-        return -1;
-    }
-
-    // build data structures to be filled from file
-    MatrixXd matData, matTimes;
-
-    // initialize start and end indices
-    int start = m_iFiffCursorBegin + (m_iTotalBlockCount * m_iSamplesPerBlock);
-    int end = start + (m_iSamplesPerBlock * numBlocks) - 1;
+    int iNumBlocks = std::min(m_iTotalBlockCount, m_pBlockCache->numBlocks());
+    iFirstBlock = std::max(0, std::min(iFirstBlock, m_pBlockCache->numBlocks() - iNumBlocks));
 
-    // adjust fiff cursor
-    m_iFiffCursorBegin += numBlocks * m_iSamplesPerBlock;
+    QList<FiffRawBlockCache::Block> lBlocks = m_pBlockCache->getBlocks(iFirstBlock, iNumBlocks, false);
+    QList<FiffRawBlockCache::Block> lFilteredBlocks = useFilteredBlocks() ? m_pBlockCache->getBlocks(iFirstBlock, iNumBlocks, true)
+                                                                          : lBlocks;
 
-    // Account for filter delay of current filter kernel
-    int iFilterDelay = 0;
+    std::list<QSharedPointer<QPair<MatrixXd, MatrixXd> > > lData, lFilteredData;
+    std::list<MinMaxPyramid::SPtr> lPyramids, lFilteredPyramids;
 
-    if(m_bPerformFiltering) {
-        iFilterDelay = m_filterKernel.getFilterOrder()/2;
-
-        // Check if we have reached the beginning/end of the file
-        if(start-iFilterDelay > absoluteFirstSample()) {
-            start -= m_filterKernel.getFilterOrder()/2;
-        } else {
-            iFilterDelay = 0;
+    for(int i = 0; i < iNumBlocks; ++i) {
+        if(!lBlocks.at(i).pData || !lFilteredBlocks.at(i).pData) {
+            qWarning() << "[FiffRawViewModel::setBlocks] Could not load block" << iFirstBlock + i;
+            return false;
         }
 
-        if(end+iFilterDelay < m_pFiffIO->m_qlistRaw[0]->last_samp) {
-            end += m_filterKernel.getFilterOrder()/2;
-        } else {
-            iFilterDelay = 0;
-        }
+        lData.push_back(lBlocks.at(i).pData);
+        lPyramids.push_back(lBlocks.at(i).pPyramid);
+        lFilteredData.push_back(lFilteredBlocks.at(i).pData);
+        lFilteredPyramids.push_back(lFilteredBlocks.at(i).pPyramid);
     }
 
-    // read data
-    if(m_pFiffIO->m_qlistRaw[0]->read_raw_segment(matData, matTimes, start, end)) {
-        // qDebug() << "[FiffRawViewModel::loadFiffData] Successfully read a block ";
-    } else {
-        qWarning() << "[FiffRawViewModel::loadLaterBlocks] Could not read block ";
-        return -1;
-    }
+    m_dataMutex.lock();
+    m_lData.swap(lData);
+    m_lPyramids.swap(lPyramids);
+    m_lFilteredData.swap(lFilteredData);
+    m_lFilteredPyramids.swap(lFilteredPyramids);
+    m_dataMutex.unlock();
 
-    for(int i = 0; i < numBlocks; ++i) {
-        m_lNewData.push_back(QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData.block(0, i*m_iSamplesPerBlock+iFilterDelay, matData.rows(), m_iSamplesPerBlock),
-                                                                                          matTimes.block(0, i*m_iSamplesPerBlock+iFilterDelay, matTimes.rows(), m_iSamplesPerBlock))));
-    }
+    m_iFirstBlock = iFirstBlock;
+    m_iFiffCursorBegin = m_pBlockCache->blockFirstSample(iFirstBlock);
 
-    // Filter data if activated, otherwise set to raw data
-    if(m_bPerformFiltering) {
-        if(!filterDataBlock(matData, true)) {
-            m_lFilteredNewData = m_lNewData;
-            return 1;
-        }
-
-        for(int i = 0; i < numBlocks; ++i) {
-            m_lFilteredNewData.push_back(QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData.block(0, i*m_iSamplesPerBlock+(2*iFilterDelay), matData.rows(), m_iSamplesPerBlock),
-                                                                                                      matTimes.block(0, i*m_iSamplesPerBlock+(2*iFilterDelay), matTimes.rows(), m_iSamplesPerBlock))));
-        }
-    } else {
-        m_lFilteredNewData = m_lNewData;
-    }
+    updateEndStartFlags();
 
-    // return 1, meaning that this was a loading of later blocks
-    return 1;
+    return true;
 }
 
 //=============================================================================================================
 
-void FiffRawViewModel::postBlockLoad(int result)
+void FiffRawViewModel::prefetchBlocks(int iVelocity)
 {
-    switch(result){
-        case -1:
-            qWarning() << "[FiffRawViewModel::postBlockLoad] QFuture returned an error: " << result;
-            break;
-        case 0:
-        {
-            // insertion of earlier blocks
-            int iNewBlocks = m_lNewData.size();
+    // Look further ahead in the scroll direction the faster the user scrolls
+    int iAhead = m_iPreloadBufferSize + 2 * std::abs(iVelocity);
+    int iFrom = m_iFirstBlock - (iVelocity < 0 ? iAhead : m_iPreloadBufferSize);
+    int iTo = m_iFirstBlock + m_iTotalBlockCount + (iVelocity > 0 ? iAhead : m_iPreloadBufferSize);
 
-            m_dataMutex.lock();
-            for (int i = 0; i < iNewBlocks; ++i) {
-                //Raw data
-                m_lData.push_front(m_lNewData.front());
-                m_lData.pop_back(); // @TODO check if this really frees the associated memory
+    m_pBlockCache->prefetch(iFrom, iTo - iFrom, false);
 
-                //Filtered data
-                m_lFilteredData.push_front(m_lFilteredNewData.front());
-                m_lFilteredData.pop_back();
-
-                //Pop new data, which is now stored in m_lData and m_lFilteredData
-                m_lNewData.pop_front();
-                m_lFilteredNewData.pop_front();
-            }
-            m_dataMutex.unlock();
-
-            emit newBlocksLoaded();
-
-            break;
-        }
-        case 1:
-        {
-            // insertion of later blocks
-            int iNewBlocks = m_lNewData.size();
-
-            m_dataMutex.lock();
-            for (int i = 0; i < iNewBlocks; ++i) {
-                //Raw data
-                m_lData.push_back(m_lNewData.front());
-                m_lData.pop_front();
-
-                //Filtered data
-                m_lFilteredData.push_back(m_lFilteredNewData.front());
-                m_lFilteredData.pop_front();
-
-                //Pop new data, which is now stored in m_lData and m_lFilteredData
-                m_lNewData.pop_front();
-                m_lFilteredNewData.pop_front();
-            }
-            m_dataMutex.unlock();
-
-            emit newBlocksLoaded();
-
-            break;
-        }
-        default:
-            qWarning() << "[FiffRawViewModel::postBlockLoad] FATAL Non-intended return value: " << result;
+    if(useFilteredBlocks()) {
+        m_pBlockCache->prefetch(iFrom, iTo - iFrom, true);
     }
-
-    updateEndStartFlags();
-    m_bCurrentlyLoading = false;
-
-    emit dataChanged(createIndex(0,0), createIndex(rowCount(), columnCount()));
 }
 
 //=============================================================================================================
 
-void FiffRawViewModel::reloadAllData()
+bool FiffRawViewModel::useFilteredBlocks() const
 {
-    m_lData.clear();
-    m_lFilteredData.clear();
-
-    MatrixXd matData, matTimes;
-
-    int start = m_iFiffCursorBegin;
-
-    // for some reason the read_raw_segment function works with inclusive upper bound
-    int end = start + (m_iSamplesPerBlock * m_iTotalBlockCount) - 1;
-
-    // When filtering load more data than we need in order to allow arbiritary filter lengths
-    int iFilterDelay = 0;
-    bool bBeforeStartReached = false;
-
-    if(m_bPerformFiltering) {
-        iFilterDelay = m_filterKernel.getFilterOrder()/2;
-        end += m_filterKernel.getFilterOrder()/2;
-
-        // Check if we have reached the beginning of the file
-        if(start-iFilterDelay >= m_pFiffIO->m_qlistRaw[0]->first_samp) {
-            start -= m_filterKernel.getFilterOrder()/2;
-        } else {
-            // Add another filter delay because we need enough data to sucessfully filter with arbiritary filter lengths
-            end += m_filterKernel.getFilterOrder()/2;
-            iFilterDelay = 0;
-            bBeforeStartReached = true;
-        }
-    }
-
-    // read in all blocks
-    if(m_pFiffIO->m_qlistRaw[0]->read_raw_segment(matData, matTimes, start, end)) {
-        // qDebug() << "[FiffRawmodel::loadFiffData] Successfully read a block ";
-    } else {
-        qWarning() << "[FiffRawViewModel::loadFiffData] Could not read samples " << start << " to " << end;
-        return;
-    }
-
-    // append a matrix pair for each block
-    for(int i = 0; i < m_iTotalBlockCount; ++i) {
-        m_lData.push_back(QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData.block(0, i*m_iSamplesPerBlock+iFilterDelay, matData.rows(), m_iSamplesPerBlock),
-                                                                                       matTimes.block(0, i*m_iSamplesPerBlock+iFilterDelay, matTimes.rows(), m_iSamplesPerBlock))));
-    }
-
-    // Filter data if activated, otherwise set to raw data
-    if(m_bPerformFiltering) {
-        bool bFilterSuccess = false;
-        if(bBeforeStartReached) {
-            iFilterDelay = m_filterKernel.getFilterOrder()/4;
-            bFilterSuccess = filterDataBlock(matData, true, true);
-        } else {
-            bFilterSuccess = filterDataBlock(matData, true);
-        }
-
-        if(!bFilterSuccess) {
-            m_lFilteredData = m_lData;
-            return;
-        }
-
-        for(int i = 0; i < m_iTotalBlockCount; ++i) {
-            m_lFilteredData.push_back(QSharedPointer<QPair<MatrixXd, MatrixXd> >::create(qMakePair(matData.block(0, (i*m_iSamplesPerBlock)+(2*iFilterDelay), matData.rows(), m_iSamplesPerBlock),
-                                                                                                   matTimes.block(0, (i*m_iSamplesPerBlock)+(2*iFilterDelay), matTimes.rows(), m_iSamplesPerBlock))));
-        }
-    } else {
-        m_lFilteredData = m_lData;
-    }
-
-    emit dataChanged(createIndex(0,0), createIndex(rowCount(), columnCount()));
+    return m_bPerformFiltering && m_lFilterChannelList.cols() > 0;
 }
 
 //=============================================================================================================
@@ -45,17 +45,19 @@
 #include "../anshared_global.h"
 #include "../Utils/types.h"
 #include "abstractmodel.h"
+#include "fiffrawblockcache.h"
 
 #include <fiff/fiff_io.h>
 
 #include <rtprocessing/helpers/filterkernel.h>
 
+#include <disp/viewers/helpers/minmaxpyramid.h>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QSharedPointer>
-#include <QFutureWatcher>
 #include <QMutex>
 #include <QBuffer>
 #include <QFile>
@@ -74,10 +76,6 @@ namespace FIFFLIB {
     class FiffChInfo;
 }
 
-namespace RTPROCESSINGLIB {
-    class FilterOverlapAdd;
-}
-
 //=============================================================================================================
 // DEFINE NAMESPACE ANSHAREDLIB
 //=============================================================================================================
@@ -400,6 +398,18 @@ public:
      */
     int getTimeListSize() const;
 
+    //=========================================================================================================
+    /**
+     * Get the indices of the annotations within the given sample range
+     *
+     * @param[in] iFirstSample  first sample of the range (inclusive)
+     * @param[in] iLastSample   last sample of the range (inclusive)
+     *
+     * @return first and one past the last index to be used with getTimeMarks
+     */
+    QPair<int,int> getTimeMarkRange(int iFirstSample,
+                                    int iLastSample) const;
+
     //=========================================================================================================
     /**
      * Get where in the viewer we are scrolling
@@ -505,20 +515,6 @@ public:
     void setAnnotationModel(QSharedPointer<ANSHAREDLIB::AnnotationModel> pModel);
 
 private:
-    //=========================================================================================================
-    /**
-     * Calculates the filtered version of one single datablock
-     *
-     * @param [in]   matData         The data block to be filtered.
-     * @param [in]   bFilterEnd      Whether to perform the overlap add in the beginning or end of the data.
-     * @param [in]   bKeepOverhead   Whether to keep the overhead.
-     *
-     * @return Returns true if filtering was performed, otherwise returns false
-     */
-    bool filterDataBlock(MatrixXd& matData,
-                         bool bFilterEnd,
-                         bool bKeepOverhead = false);
-
     //=========================================================================================================
     /**
      * This is a helper method thats is meant to correctly set the endOfFile / startOfFile flags whenever needed
@@ -527,47 +523,41 @@ private:
 
     //=========================================================================================================
     /**
-     * This is helper function, its main purpose is to avoid code redundancy.
-     *
-     * @param[in] loadFunction The function that will be run in the background. Should be either loadEarlierBlocks or loadLaterBlocks.
-     * @param[in] numBlocks The Number of blocks to load.
+     * Replicates the behavior of initFiffData to accomodate changes in number of samples shown
      */
-    void startBackgroundOperation(int (FiffRawViewModel::*loadFunction)(int), int iBlocksToLoad);
+    void reloadAllData();
 
     //=========================================================================================================
     /**
-     * This is run concurrently
+     * Takes the blocks of the window starting at the given block from the block cache. Blocks which are not cached
+     * yet are loaded in parallel.
      *
-     * @param[in] iCursorRequested Cursor that points to the requested sample
-     */
-    int loadEarlierBlocks(qint32 numBlocks);
-
-    //=========================================================================================================
-    /**
-     * This is run concurrently
+     * @param[in] iFirstBlock   The index of the first block of the window. It is clamped to the file.
      *
-     * @param[in] iCursorRequested Cursor that points to the requested sample
+     * @return Returns true if all blocks could be loaded, otherwise returns false.
      */
-    int loadLaterBlocks(qint32 numBlocks);
+    bool setBlocks(int iFirstBlock);
 
     //=========================================================================================================
     /**
-     * This is run by the FutureWatcher when its finished
+     * Starts loading the blocks around the current window in the background. More blocks are requested in the
+     * scroll direction the faster the user scrolls.
      *
-     * @param[in] result Code value for the result
+     * @param[in] iVelocity     The number of blocks the window moved with the last scroll step. The sign gives the direction.
      */
-    void postBlockLoad(int result);
+    void prefetchBlocks(int iVelocity);
 
     //=========================================================================================================
     /**
-     * Replicates the behavior of initFiffData to accomodate changes in number of samples shown
+     * @return Whether the filtered blocks are displayed.
      */
-    void reloadAllData();
+    bool useFilteredBlocks() const;
 
     std::list<QSharedPointer<QPair<MatrixXd, MatrixXd> > > m_lData;             /**< Data */
-    std::list<QSharedPointer<QPair<MatrixXd, MatrixXd> > > m_lNewData;          /**< Data that is to be appended or prepended */
     std::list<QSharedPointer<QPair<MatrixXd, MatrixXd> > > m_lFilteredData;     /**< Filtered data */
-    std::list<QSharedPointer<QPair<MatrixXd, MatrixXd> > > m_lFilteredNewData;  /**< Filtered data that is to be appended or prepended */
+
+    std::list<DISPLIB::MinMaxPyramid::SPtr> m_lPyramids;                        /**< Min/max pyramids of m_lData */
+    std::list<DISPLIB::MinMaxPyramid::SPtr> m_lFilteredPyramids;                /**< Min/max pyramids of m_lFilteredData */
 
     // Display stuff
     double      m_dDx;              /**< pixel difference to the next sample. */
@@ -580,12 +570,12 @@ private:
 
     // management
     qint32 m_iFiffCursorBegin;      /**< This always points to the very first sample that is currently held (in the earliest block) */
+    int m_iFirstBlock;              /**< Index of the earliest block that is currently held */
     bool m_bStartOfFileReached;     /**< Flag for having reached the start of the file */
     bool m_bEndOfFileReached;       /**< Flag for having reached the end of the file */
 
     // concurrent reloading
-    QFutureWatcher<int> m_blockLoadFutureWatcher;   /**< QFutureWatcher for watching process of reloading fiff data. */
-    bool m_bCurrentlyLoading;                       /**< Flag to indicate whether or not a background operation is going on. */
+    FiffRawBlockCache::SPtr m_pBlockCache;          /**< Cache which reads, filters and prefetches the blocks. */
     mutable QMutex m_dataMutex;                     /**< Using mutable is not a pretty solution */
 
     // data stuff
@@ -596,7 +586,6 @@ private:
     // Filter stuff
     qint32                                      m_iMaxFilterLength;                         /**< Max order of the current filters */
     QString                                     m_sFilterChannelType;                       /**< Kind of channel which is to be filtered */
-    QSharedPointer<RTPROCESSINGLIB::FilterOverlapAdd>     m_pRtFilter;                                /**< The filter object. */
     Eigen::RowVectorXi                          m_lFilterChannelList;                       /**< The indices of the channels to be filtered.*/
     bool                                        m_bPerformFiltering;                        /**< Flag whether to activate/deactivate filtering. */
     RTPROCESSINGLIB::FilterKernel               m_filterKernel;                             /**< List of currently active filters. */
@@ -810,6 +799,7 @@ public:
                 qint32 numBlocks,
                 qint32 rowNumber)
     : m_lData()
+    , m_lPyramids()
     , m_iRowNumber(rowNumber)
     , m_iNumSamples(0)
     {
@@ -830,9 +820,20 @@ public:
 
     }
 
+    ChannelData(const std::list<QSharedPointer<QPair<MatrixXd, MatrixXd>>> data,
+                const std::list<DISPLIB::MinMaxPyramid::SPtr> pyramids,
+                unsigned long rowNumber)
+    : ChannelData(data.begin(), data.size(), rowNumber)
+    {
+        // only use the pyramids if there is one for each block
+        if(pyramids.size() == m_lData.size()) {
+            m_lPyramids = pyramids;
+        }
+    }
+
     // we need a public copy constructor in order to register this as QMetaType
     ChannelData(const ChannelData& other)
-    : ChannelData(other.m_lData, other.m_iRowNumber)
+    : ChannelData(other.m_lData, other.m_lPyramids, other.m_iRowNumber)
     {
 
     }
@@ -840,6 +841,7 @@ public:
     // we need a public default constructor in order to register this as QMetaType
     ChannelData()
     : m_lData()
+    , m_lPyramids()
     , m_iRowNumber(-1)
     , m_iNumSamples(0)
     {
@@ -882,6 +884,12 @@ public:
         return m_iRowNumber;
     }
 
+    // the min/max pyramids of the blocks, one per block, or an empty list if none were built
+    const std::list<DISPLIB::MinMaxPyramid::SPtr>& getPyramids() const
+    {
+        return m_lPyramids;
+    }
+
     ChannelIterator begin() const
     {
         ChannelIterator begin(this, 0);
@@ -898,6 +906,7 @@ private:
     // hold a list of smartpointers to the data that was in the model when the respective instance of ChannelData was created.
     // This prevents that pointers into the Eigen-matrices will become invalid when the background thread returns and changes the matrices.
     std::list<QSharedPointer<QPair<MatrixXd, MatrixXd> > > m_lData;
+    std::list<DISPLIB::MinMaxPyramid::SPtr> m_lPyramids;
     qint32 m_iRowNumber;
     qint64 m_iNumSamples;
 };
@@ -91,6 +91,7 @@ SOURCES += \
     Management/statusbar.cpp \
     Model/bemdatamodel.cpp \
     Model/fiffrawviewmodel.cpp \
+    Model/fiffrawblockcache.cpp \
     Model/annotationmodel.cpp \
     Model/averagingdatamodel.cpp \
 
@@ -108,6 +109,7 @@ HEADERS += \
     Utils/types.h \
     Model/bemdatamodel.h \
     Model/fiffrawviewmodel.h \
+    Model/fiffrawblockcache.h \
     Model/annotationmodel.h \
     Model/averagingdatamodel.h \
 
@@ -653,21 +653,35 @@ QMap<double,QList<int>> AnnotationSettingsView::detectTriggerCalculations(const
         return map;
     }
 
+    //Only read the trigger channel and stream the file block wise through the detector
+    Eigen::RowVectorXi vecSel(1);
+    vecSel << iCurrentTriggerChIndex;
+
+    RTPROCESSINGLIB::TriggerDetector triggerDetector(QList<int>() << 0,
+                                                     dThreshold,
+                                                     false,
+                                                     100);
+
     Eigen::MatrixXd mSampleData, mSampleTimes;
+    int iBlockSize = std::max(1, static_cast<int>(fiffInfo.sfreq * 60));
+
+    for(int iFrom = fiffRaw.first_samp; iFrom <= fiffRaw.last_samp; iFrom += iBlockSize) {
+        int iTo = std::min(iFrom + iBlockSize - 1, static_cast<int>(fiffRaw.last_samp));
+
+        if(!fiffRaw.read_raw_segment(mSampleData, mSampleTimes, iFrom, iTo, vecSel)) {
+            qWarning() << "[AnnotationSettingsView::detectTriggerCalculations] Could not read samples" << iFrom << "to" << iTo;
+            break;
+        }
 
-    fiffRaw.read_raw_segment(mSampleData,
-                               mSampleTimes);
+        triggerDetector.detect(mSampleData, iFrom - fiffRaw.first_samp);
+    }
 
-    QList<QPair<int,double>> detectedTriggerSamples = RTPROCESSINGLIB::detectTriggerFlanksMax(mSampleData,
-                                                                                              iCurrentTriggerChIndex,
-                                                                                              0,
-                                                                                              dThreshold,
-                                                                                              0);
+    Eigen::Ref<const Eigen::MatrixXi> matEvents = triggerDetector.events();
 
     QMap<double,QList<int>> mEventsinTypes;
 
-    for(QPair<int,double> pair : detectedTriggerSamples){
-        mEventsinTypes[pair.second].append(pair.first);
+    for(int i = 0; i < matEvents.rows(); ++i){
+        mEventsinTypes[matEvents(i,2)].append(matEvents(i,0));
     }
 
     return mEventsinTypes;
@@ -727,10 +741,13 @@ void AnnotationSettingsView::createGroupsFromTriggers()
         if ((m_pUi->m_listWidget_groupListWidget->findItems(m_pTriggerDetectView->getSelectedStimChannel()+ "_" + QString::number(static_cast<int>(keyList[i])), Qt::MatchExactly).isEmpty())){
             newStimGroup(m_pTriggerDetectView->getSelectedStimChannel(), static_cast<int>(keyList[i]), colors[i % 10]);
             groupChanged();
+
+            QVector<int> vecSamples;
+            vecSamples.reserve(mEventGroupMap[keyList[i]].size());
             for (int j : mEventGroupMap[keyList[i]]){
-                m_pAnnModel->setSamplePos(j + iFirstSample);
-                m_pAnnModel->insertRow(0, QModelIndex());
+                vecSamples.append(j + iFirstSample);
             }
+            m_pAnnModel->insertEvents(vecSamples);
         }
     }
 
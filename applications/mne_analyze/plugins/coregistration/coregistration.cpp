@@ -256,6 +256,7 @@ void CoRegistration::onChangeSelectedBem(const QString &sText)
             // update current selected Bem
             pBemDataModel = qSharedPointerCast<BemDataModel>(bemDataModel);
             m_pBem = QSharedPointer<MNEBem>(pBemDataModel->getBem());
+            m_pSurfacePoints.clear();
             m_sCurrentSelectedBem = sText;
 
             // send event to 3DView etc.
@@ -523,12 +524,17 @@ void CoRegistration::onFitICP()
 
     triggerLoadingStart("Performing ICP ...");
 
+    // the search tree over the head surface is only built once per selected Bem
+    if(!m_pSurfacePoints) {
+        m_pSurfacePoints = MNEProjectToSurface::SPtr::create((*m_pBem)[0]);
+    }
+
     // start icp
     m_Future = QtConcurrent::run(this,
                                  &CoRegistration::computeICP,
                                  m_transHeadMri,
                                  m_digSetHead,
-                                 *m_pBem.data());
+                                 m_pSurfacePoints);
 
     m_FutureWatcher.setFuture(m_Future);
 
@@ -556,7 +562,7 @@ void CoRegistration::setIcpProperties()
 
 FiffCoordTrans CoRegistration::computeICP(FiffCoordTrans transInit,
                                           FiffDigPointSet digSetHead,
-                                          MNEBem bemHead)
+                                          MNEProjectToSurface::SPtr pSurfacePoints)
 {
     // get values from members
     m_ParameterMutex.lock();
@@ -574,10 +580,6 @@ FiffCoordTrans CoRegistration::computeICP(FiffCoordTrans transInit,
 
     float fRMSE = 0.0;
 
-    // init surface points
-    MNEBemSurface::SPtr bemSurface = MNEBemSurface::SPtr::create(bemHead[0]);
-    MNEProjectToSurface::SPtr mneSurfacePoints = MNEProjectToSurface::SPtr::create(*bemSurface);
-
     // get selected digitizers
     QList<int> lPickHSP = m_pCoregSettingsView->getDigitizerCheckState();
     FiffDigPointSet digSetHSP = digSetHead.pickTypes(lPickHSP);
@@ -618,7 +620,7 @@ FiffCoordTrans CoRegistration::computeICP(FiffCoordTrans transInit,
     MatrixXf matHspClean;
     VectorXi vecTake;
 
-    if(!RTPROCESSINGLIB::discard3DPointOutliers(mneSurfacePoints,
+    if(!RTPROCESSINGLIB::discard3DPointOutliers(pSurfacePoints,
                                                 matHsp,
                                                 transInit,
                                                 vecTake,
@@ -635,7 +637,7 @@ FiffCoordTrans CoRegistration::computeICP(FiffCoordTrans transInit,
     }
 
     // icp
-    RTPROCESSINGLIB::performIcp(mneSurfacePoints,
+    RTPROCESSINGLIB::performIcp(pSurfacePoints,
                                 matHspClean,
                                 transInit,
                                 fRMSE,
@@ -767,6 +769,7 @@ void CoRegistration::deleteModels()
             // empty bem and string
             m_pCoregSettingsView->addSelectionBem("Select Bem");
             m_pBem->clear();
+            m_pSurfacePoints.clear();
             m_sCurrentSelectedBem = "";
         } else {
             // update new bem list
@@ -70,6 +70,7 @@ namespace DISPLIB {
 
 namespace MNELIB {
     class MNEBem;
+    class MNEProjectToSurface;
 }
 
 namespace FIFFLIB {
@@ -204,13 +205,13 @@ private:
      *
      * @param[in] transInit     The finitial coordinate transformation matrix.
      * @param[in] digSetHSP     The digitizer set containing the Head Shap Points, HPI coils, etc..
-     * @param[in] bemHead       The head surface.
+     * @param[in] pSurfacePoints    The head surface, prepared for closest point queries.
      *
      * @return The resulting coordinate transformation from head to mri space.
      */
     FIFFLIB::FiffCoordTrans computeICP(FIFFLIB::FiffCoordTrans transInit,
                                        FIFFLIB::FiffDigPointSet digSetHSP,
-                                       MNELIB::MNEBem bemHead);
+                                       QSharedPointer<MNELIB::MNEProjectToSurface> pSurfacePoints);
 
     //=========================================================================================================
     /**
@@ -293,6 +294,7 @@ private:
 
     QVector<QSharedPointer<ANSHAREDLIB::AbstractModel>>     m_vecBemDataModels;     /**< Vector with all available Bem Models */
     QSharedPointer<MNELIB::MNEBem>                          m_pBem;                 /**< The currently selected Bem model */
+    QSharedPointer<MNELIB::MNEProjectToSurface>             m_pSurfacePoints;       /**< The head surface of m_pBem with its triangle search tree, built on the first ICP fit */
     QString                                                 m_sCurrentSelectedBem;  /**< The name of the currently selected Bem */
     FIFFLIB::FiffDigPointSet                                m_digSetHead;           /**< The currently selected digitizer set */
     FIFFLIB::FiffDigPointSet                                m_digFidMri;            /**< The currently selected mri fiducials */
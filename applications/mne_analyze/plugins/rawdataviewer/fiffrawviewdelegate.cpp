@@ -237,6 +237,31 @@ void FiffRawViewDelegate::createPlotPath(const QStyleOptionViewItem &option,
 
     QPointF qSamplePosition;
 
+    //When zoomed out, draw the min/max envelope of the matching pyramid level. This bounds the number of points by
+    //the widget width instead of the number of samples and does not alias like plain downsampling.
+    const std::list<DISPLIB::MinMaxPyramid::SPtr>& lPyramids = data.getPyramids();
+    int iLevel = (lPyramids.empty() || dDx <= 0.0) ? -1 : lPyramids.front()->levelForSamplesPerPixel(1.0 / dDx);
+
+    if(iLevel >= 0) {
+        int iRow = data.getRowNumber();
+        double dX = path.currentPosition().x();
+
+        for(const DISPLIB::MinMaxPyramid::SPtr& pPyramid : lPyramids) {
+            const float* pMin = pPyramid->minRow(iLevel, iRow);
+            const float* pMax = pPyramid->maxRow(iLevel, iRow);
+            int iBinWidth = pPyramid->binWidth(iLevel);
+
+            for(int b = 0; b < pPyramid->numBins(iLevel); ++b) {
+                path.lineTo(dX, y_base - pMax[b] * dScaleY);
+                path.lineTo(dX, y_base - pMin[b] * dScaleY);
+
+                dX += dDx * std::min(iBinWidth, pPyramid->numSamples() - b * iBinWidth);
+            }
+        }
+
+        return;
+    }
+
     //Deactivate downsampling for now due to aliasing effects
 //    int iPaintStep = (int)(1.0/dDx) - 1;
 //    if (iPaintStep < 2){
@@ -330,7 +355,10 @@ void FiffRawViewDelegate::createMarksPath(const QModelIndex &index,
     //QMap<int, QColor> typeColor = t_pAnnModel->getTypeColors();
     QMap<int, QColor> groupColor = t_pAnnModel->getGroupColors();
 
-    for(int i = 0; i < t_pModel->getTimeListSize(); i++) {
+    //Only visit the annotations within the loaded samples
+    QPair<int,int> range = t_pModel->getTimeMarkRange(iStart + 1, iStart + static_cast<int>(data.size()) - 1);
+
+    for(int i = range.first; i < range.second; i++) {
         unsigned int uiTime = t_pModel->getTimeMarks(i);
         if ((t_pModel->getTimeMarks(i) > iStart) && (uiTime < (iStart + data.size()))) {
 //            int type = t_pAnnModel->data(t_pAnnModel->index(i,2)).toInt();
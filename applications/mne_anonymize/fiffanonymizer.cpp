@@ -49,6 +49,7 @@
 
 #include <QStack>
 #include <QFileInfo>
+#include <QCryptographicHash>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -70,11 +71,13 @@ using namespace MNEANONYMIZE;
 
 FiffAnonymizer::FiffAnonymizer()
 : m_pTag(FIFFLIB::FiffTag::SPtr::create())
+, m_iPassThroughChunkSize(4*1024*1024)
 , m_bFileInSet(false)
 , m_bFileOutSet(false)
 , m_bVerboseMode(false)
 , m_bBruteMode(false)
 , m_bMNEEnvironmentMode(false)
+, m_bInPlaceMode(false)
 , m_dMaxValidFiffVerion(1.3)
 , m_sDefaultString("mne_anonymize")
 , m_sDefaultShortString("mne-cpp")
@@ -119,11 +122,13 @@ FiffAnonymizer::FiffAnonymizer()
 
 FiffAnonymizer::FiffAnonymizer(const FiffAnonymizer& obj)
 : m_pTag(FIFFLIB::FiffTag::SPtr::create())
+, m_iPassThroughChunkSize(obj.m_iPassThroughChunkSize)
 , m_bFileInSet(obj.m_bFileInSet)
 , m_bFileOutSet(obj.m_bFileOutSet)
 , m_bVerboseMode(obj.m_bVerboseMode)
 , m_bBruteMode(obj.m_bBruteMode)
 , m_bMNEEnvironmentMode(obj.m_bMNEEnvironmentMode)
+, m_bInPlaceMode(obj.m_bInPlaceMode)
 , m_dMaxValidFiffVerion(obj.m_dMaxValidFiffVerion)
 , m_sDefaultString(obj.m_sDefaultString)
 , m_sDefaultShortString(obj.m_sDefaultShortString)
@@ -166,11 +171,13 @@ FiffAnonymizer::FiffAnonymizer(const FiffAnonymizer& obj)
 
 FiffAnonymizer::FiffAnonymizer(FiffAnonymizer &&obj)
 : m_pTag(FIFFLIB::FiffTag::SPtr::create())
+, m_iPassThroughChunkSize(obj.m_iPassThroughChunkSize)
 , m_bFileInSet(obj.m_bFileInSet)
 , m_bFileOutSet(obj.m_bFileOutSet)
 , m_bVerboseMode(obj.m_bVerboseMode)
 , m_bBruteMode(obj.m_bBruteMode)
 , m_bMNEEnvironmentMode(obj.m_bMNEEnvironmentMode)
+, m_bInPlaceMode(obj.m_bInPlaceMode)
 , m_dMaxValidFiffVerion(obj.m_dMaxValidFiffVerion)
 , m_sDefaultString(obj.m_sDefaultString)
 , m_sDefaultShortString(obj.m_sDefaultShortString)
@@ -219,6 +226,11 @@ int FiffAnonymizer::anonymizeFile()
         return 1;
     }
 
+    if(m_bInPlaceMode)
+    {
+        return anonymizeFileInPlace();
+    }
+
     if(!m_bFileOutSet)
     {
         qCritical() << "Output file has not been specified.";
@@ -235,11 +247,21 @@ int FiffAnonymizer::anonymizeFile()
     processHeaderTags();
 
 
+    // Only the tags which might be censored are decoded, all others are copied as raw byte ranges
     while( (m_pTag->next != -1) && (!m_pInStream->device()->atEnd()))
     {
-        readTag();
-        censorTag();
-        writeTag();
+        FIFFLIB::fiff_int_t iDataSize = readTagInfo();
+
+        if(tagNeedsDecoding())
+        {
+            readTagData(iDataSize);
+            censorTag();
+            writeTag();
+        } else if(copyTagData(iDataSize)) {
+            qCritical() << "Unexpected end of the input file: " << m_fFileIn.fileName();
+            closeInOutStreams();
+            return 1;
+        }
     }
 
     closeInOutStreams();
@@ -251,6 +273,132 @@ int FiffAnonymizer::anonymizeFile()
 
 //=============================================================================================================
 
+int FiffAnonymizer::anonymizeFileInPlace()
+{
+    printIfVerbose("Max. Valid Fiff version: " + QString::number(m_dMaxValidFiffVerion));
+    printIfVerbose("Current date: " + QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss.zzz t"));
+    printIfVerbose(" ");
+
+    // Make sure the file is a supported FIFF file before anything gets written to it
+    m_pInStream = FIFFLIB::FiffStream::SPtr(new FIFFLIB::FiffStream(&m_fFileIn));
+    if(!m_pInStream->device()->open(QIODevice::ReadOnly))
+    {
+        qCritical() << "Problem opening the input file: " << m_fFileIn.fileName();
+        return 1;
+    }
+
+    bool bValidFile = false;
+    FIFFLIB::fiff_int_t iFirstDataSize = readTagInfo();
+
+    if(m_pInStream->status() == QDataStream::Ok
+       && m_pTag->kind == FIFF_FILE_ID
+       && iFirstDataSize >= static_cast<FIFFLIB::fiff_int_t>(5 * sizeof(FIFFLIB::fiff_int_t))
+       && iFirstDataSize <= m_fFileIn.size() - m_pInStream->device()->pos())
+    {
+        readTagData(iFirstDataSize);
+        bValidFile = (m_pInStream->status() == QDataStream::Ok) && checkValidFiffFormatVersion();
+    }
+
+    m_pInStream->close();
+
+    if(bValidFile)
+    {
+        printIfVerbose("Input file compatible with this version.");
+    } else {
+        qCritical() << "The input file is not a valid FIFF file or its version is not supported. The file is not modified: " << m_fFileIn.fileName();
+        return 1;
+    }
+
+    if(m_pInStream->device()->open(QIODevice::ReadWrite))
+    {
+        printIfVerbose("Input file opened correctly for in-place anonymization: " + m_fFileIn.fileName());
+    } else {
+        qCritical() << "Problem opening the input file for writing: " << m_fFileIn.fileName();
+        return 1;
+    }
+
+    QCryptographicHash hashWritten(QCryptographicHash::Sha1);
+    QList<QPair<qint64, qint64> > lPatches;     // position and size of the patched tag data
+    QByteArray originalData;
+
+    m_pBlockTypeList->clear();
+    m_pTag->next = FIFFV_NEXT_SEQ;
+
+    while( (m_pTag->next != -1) && (!m_pInStream->device()->atEnd()))
+    {
+        FIFFLIB::fiff_int_t iDataSize = readTagInfo();
+        qint64 iDataPos = m_pInStream->device()->pos();
+
+        if(tagNeedsDecoding())
+        {
+            originalData.resize(iDataSize);
+            if(m_pInStream->readRawData(originalData.data(), iDataSize) != iDataSize)
+            {
+                qCritical() << "Unexpected end of the input file: " << m_fFileIn.fileName();
+                m_pInStream->close();
+                return 1;
+            }
+
+            m_pTag->resize(iDataSize);
+            memcpy(m_pTag->data(), originalData.constData(), static_cast<size_t>(iDataSize));
+            FIFFLIB::FiffTag::convert_tag_data(m_pTag,FIFFV_BIG_ENDIAN,FIFFV_NATIVE_ENDIAN);
+            updateBlockTypeList();
+
+            censorTag();
+            FIFFLIB::FiffTag::convert_tag_data(m_pTag,FIFFV_NATIVE_ENDIAN,FIFFV_BIG_ENDIAN);
+
+            // The tag keeps its size, which keeps all tag positions and the tag directory valid
+            QByteArray patchedData(m_pTag->left(iDataSize));
+            patchedData.append(QByteArray(iDataSize - patchedData.size(), '\0'));
+
+            if(patchedData != originalData)
+            {
+                m_pInStream->device()->seek(iDataPos);
+                m_pInStream->writeRawData(patchedData.constData(), iDataSize);
+                hashWritten.addData(patchedData);
+                lPatches.append(qMakePair(iDataPos, static_cast<qint64>(iDataSize)));
+            }
+        }
+
+        if(m_pTag->next > 0)
+        {
+            m_pInStream->device()->seek(m_pTag->next);
+        } else {
+            m_pInStream->device()->seek(iDataPos + iDataSize);
+        }
+    }
+
+    m_pInStream->close();
+
+    // Verify the patched ranges as they ended up in the file
+    QCryptographicHash hashRead(QCryptographicHash::Sha1);
+    if(!m_fFileIn.open(QIODevice::ReadOnly))
+    {
+        qCritical() << "Problem opening the input file for verification: " << m_fFileIn.fileName();
+        return 1;
+    }
+    for(const QPair<qint64, qint64>& patch : lPatches)
+    {
+        m_fFileIn.seek(patch.first);
+        hashRead.addData(m_fFileIn.read(patch.second));
+    }
+    m_fFileIn.close();
+
+    if(hashRead.result() != hashWritten.result())
+    {
+        qCritical() << "Verification of the anonymized tags failed: " << m_fFileIn.fileName();
+        return 1;
+    }
+
+    printIfVerbose(QString::number(lPatches.size()) + " tags anonymized in place and verified. Checksum: " + QString(hashWritten.result().toHex()));
+
+    emit outFileReady();
+
+    return 0;
+}
+
+//=============================================================================================================
+
 void FiffAnonymizer::censorTag()
 {
     switch (m_pTag->kind)
@@ -594,6 +742,105 @@ void FiffAnonymizer::writeTag()
 
 //=============================================================================================================
 
+FIFFLIB::fiff_int_t FiffAnonymizer::readTagInfo()
+{
+    FIFFLIB::fiff_int_t iDataSize;
+
+    *m_pInStream >> m_pTag->kind;
+    *m_pInStream >> m_pTag->type;
+    *m_pInStream >> iDataSize;
+    *m_pInStream >> m_pTag->next;
+
+    return iDataSize;
+}
+
+//=============================================================================================================
+
+void FiffAnonymizer::readTagData(FIFFLIB::fiff_int_t iDataSize)
+{
+    m_pTag->resize(iDataSize);
+    m_pInStream->read_tag_data(m_pTag);
+    updateBlockTypeList();
+}
+
+//=============================================================================================================
+
+int FiffAnonymizer::copyTagData(FIFFLIB::fiff_int_t iDataSize)
+{
+    //make output tag list linear
+    FIFFLIB::fiff_int_t iNext = m_pTag->next > 0 ? FIFFV_NEXT_SEQ : m_pTag->next;
+
+    *m_pOutStream << static_cast<qint32>(m_pTag->kind);
+    *m_pOutStream << static_cast<qint32>(m_pTag->type);
+    *m_pOutStream << static_cast<qint32>(iDataSize);
+    *m_pOutStream << static_cast<qint32>(iNext);
+
+    qint64 iRemaining = iDataSize;
+    m_passThroughBuffer.resize(static_cast<int>(qMin(iRemaining, m_iPassThroughChunkSize)));
+
+    while(iRemaining > 0)
+    {
+        int iChunkSize = static_cast<int>(qMin(iRemaining, m_iPassThroughChunkSize));
+        if(m_pInStream->readRawData(m_passThroughBuffer.data(), iChunkSize) != iChunkSize)
+        {
+            return 1;
+        }
+        m_pOutStream->writeRawData(m_passThroughBuffer.constData(), iChunkSize);
+        iRemaining -= iChunkSize;
+    }
+
+    if(m_pTag->next > 0)
+    {
+        m_pInStream->device()->seek(m_pTag->next);
+    }
+
+    return 0;
+}
+
+//=============================================================================================================
+
+bool FiffAnonymizer::tagNeedsDecoding() const
+{
+    switch (m_pTag->kind)
+    {
+    case FIFF_BLOCK_START:
+    case FIFF_BLOCK_END:
+    case FIFF_FILE_ID:
+    case FIFF_BLOCK_ID:
+    case FIFF_PARENT_FILE_ID:
+    case FIFF_PARENT_BLOCK_ID:
+    case FIFF_REF_FILE_ID:
+    case FIFF_REF_BLOCK_ID:
+    case FIFF_MEAS_DATE:
+    case FIFF_COMMENT:
+    case FIFF_EXPERIMENTER:
+    case FIFF_SUBJ_ID:
+    case FIFF_SUBJ_FIRST_NAME:
+    case FIFF_SUBJ_MIDDLE_NAME:
+    case FIFF_SUBJ_LAST_NAME:
+    case FIFF_SUBJ_BIRTH_DAY:
+    case FIFF_SUBJ_SEX:
+    case FIFF_SUBJ_HAND:
+    case FIFF_SUBJ_WEIGHT:
+    case FIFF_SUBJ_HEIGHT:
+    case FIFF_SUBJ_COMMENT:
+    case FIFF_SUBJ_HIS_ID:
+    case FIFF_PROJ_ID:
+    case FIFF_PROJ_NAME:
+    case FIFF_PROJ_AIM:
+    case FIFF_PROJ_PERSONS:
+    case FIFF_PROJ_COMMENT:
+    case FIFF_MRI_PIXEL_DATA:
+    case FIFF_MNE_ENV_WORKING_DIR:
+    case FIFF_MNE_ENV_COMMAND_LINE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//=============================================================================================================
+
 void FiffAnonymizer::processHeaderTags()
 {
     readTag();
@@ -743,6 +990,20 @@ bool FiffAnonymizer::getMNEEnvironmentMode()
 
 //=============================================================================================================
 
+void FiffAnonymizer::setInPlaceMode(bool bFlag)
+{
+    m_bInPlaceMode = bFlag;
+}
+
+//=============================================================================================================
+
+bool FiffAnonymizer::getInPlaceMode() const
+{
+    return m_bInPlaceMode;
+}
+
+//=============================================================================================================
+
 void FiffAnonymizer::setBruteMode(bool bFlag)
 {
     m_bBruteMode = bFlag;
@@ -575,6 +575,17 @@ public slots:
      */
     void setMNEEnvironmentMode(bool bFlag);
 
+    //=========================================================================================================
+    /**
+     * Sets the FiffAnonymizer object's in-place mode. If set to TRUE, anonymizeFile() does not write an output file.
+     * Instead, only the sensitive tags are patched in the input file itself. The replacement values keep the
+     * size of the original tag data: longer strings are truncated, shorter ones are padded with zeros. The patched
+     * tags are verified with a checksum after writing.
+     *
+     * @param [in] bFlag    Bool argument whether to anonymize the input file in place.
+     */
+    void setInPlaceMode(bool bFlag);
+
 public:
     //=========================================================================================================
     /**
@@ -669,7 +680,26 @@ public:
      */
     bool getMNEEnvironmentMode();
 
+    //=========================================================================================================
+    /**
+     * Check if the in-place mode has been set.
+     */
+    bool getInPlaceMode() const;
+
 private:
+    //=========================================================================================================
+    /**
+     * @brief Anonymize the input file in place.
+     *
+     * @details Follows the tags of the input file reading only their headers. The sensitive tags are decoded and
+     * censored as in anonymizeFile(), converted back and written over the original tag data, fitted to its size.
+     * All other tags, as well as the tag directory, stay untouched. The written data is verified by comparing the
+     * checksum of the patched ranges after closing the file against the checksum of the data written.
+     *
+     * @return 0 if the file was anonymized and verified, 1 otherwise.
+     */
+    int anonymizeFileInPlace();
+
     //=========================================================================================================
     /**
      * Updates a stack (m_pBlockTyeList points to it) with the type of block the input stream is in.
@@ -779,6 +809,43 @@ private:
      */
     void writeTag();
 
+    //=========================================================================================================
+    /**
+     * Reads only the header (kind, type, size and next) of the next tag into m_pTag. The stream is left at the
+     * beginning of the tag data.
+     *
+     * @return The size of the tag data in bytes.
+     */
+    FIFFLIB::fiff_int_t readTagInfo();
+
+    //=========================================================================================================
+    /**
+     * Reads the data of the tag whose header has been read with readTagInfo and updates the block type list.
+     *
+     * @param [in] iDataSize    Size of the tag data in bytes.
+     */
+    void readTagData(FIFFLIB::fiff_int_t iDataSize);
+
+    //=========================================================================================================
+    /**
+     * Copies the tag whose header has been read with readTagInfo to the output file without decoding its data.
+     * The data is copied as an opaque byte range, in chunks of m_iPassThroughChunkSize bytes.
+     *
+     * @param [in] iDataSize    Size of the tag data in bytes.
+     *
+     * @return 0 if the tag was copied, 1 if the input file ended before the tag data did.
+     */
+    int copyTagData(FIFFLIB::fiff_int_t iDataSize);
+
+    //=========================================================================================================
+    /**
+     * Checks whether the tag in m_pTag has to be decoded, i.e. whether censorTag() might change it or the
+     * block type list depends on it. All other tags are passed through. Keep in sync with censorTag().
+     *
+     * @return true if the tag data has to be decoded.
+     */
+    bool tagNeedsDecoding() const;
+
     //=========================================================================================================
 
     FIFFLIB::FiffStream::SPtr m_pInStream;  /**< Pointer to FiffStream object for reading.*/
@@ -789,6 +856,9 @@ private:
 
     QSharedPointer<QStack<int32_t> > m_pBlockTypeList;          /**< Pointer to Stack storing info related to the blocks of tags in the file.*/
 
+    QByteArray m_passThroughBuffer;             /**< Buffer used to copy the data of tags which are passed through.*/
+    const qint64 m_iPassThroughChunkSize;       /**< Maximal number of bytes copied at once when passing a tag through.*/
+
     QFile m_fFileIn;                    /**< Input file.*/
     QFile m_fFileOut;                   /**< Output file.*/
 
@@ -798,6 +868,7 @@ private:
     bool m_bVerboseMode;                /**< Verbosity mode enabler.*/
     bool m_bBruteMode;                  /**< Advanced anonymization. Anonymize also weight, height and some other fields.*/
     bool m_bMNEEnvironmentMode;         /**< User's request to anonymize info related to the MNE toolbox.*/
+    bool m_bInPlaceMode;                /**< User's request to patch the sensitive tags in the input file itself.*/
     const double m_dMaxValidFiffVerion; /**< Maximum version of the Fiff file standard compatible with this application.*/
 
     QString m_sDefaultString;           /**< String to be used as substitution of other strings in a fiff file */
@@ -51,6 +51,8 @@
 #include <QRandomGenerator>
 #include <QDir>
 #include <QFileInfo>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -74,7 +76,10 @@ SettingsControllerCl::SettingsControllerCl()
 : m_pAnonymizer(FiffAnonymizer::SPtr(new FiffAnonymizer))
 , m_sAppName(qApp->applicationName())
 , m_sAppVer(qApp->applicationVersion())
+, m_iNumJobs(4)
 , m_bGuiMode(false)
+, m_bBatchMode(false)
+, m_bInPlaceMode(false)
 , m_bDeleteInputFileAfter(false)
 , m_bDeleteInputFileConfirmation(true)
 , m_bHisIdSpecified(false)
@@ -93,7 +98,10 @@ SettingsControllerCl::SettingsControllerCl(const QStringList& arguments)
 : m_pAnonymizer(FiffAnonymizer::SPtr(new FiffAnonymizer))
 , m_sAppName(qApp->applicationName())
 , m_sAppVer(qApp->applicationVersion())
+, m_iNumJobs(4)
 , m_bGuiMode(false)
+, m_bBatchMode(false)
+, m_bInPlaceMode(false)
 , m_bDeleteInputFileAfter(false)
 , m_bDeleteInputFileConfirmation(true)
 , m_bHisIdSpecified(false)
@@ -184,6 +192,23 @@ void SettingsControllerCl::initParser()
                                   QCoreApplication::translate("main","outfile"));
     m_parser.addOption(outFileOpt);
 
+    QCommandLineOption inDirOpt(QStringList() << "id" << "in_dir",
+                                QCoreApplication::translate("main","Batch mode. Anonymize all fiff files (*.fif) in the directory <indir> in parallel. "
+                                                                   "Files whose name ends with '_anonymized' are skipped."),
+                                QCoreApplication::translate("main","indir"));
+    m_parser.addOption(inDirOpt);
+
+    QCommandLineOption outDirOpt(QStringList() << "od" << "out_dir",
+                                 QCoreApplication::translate("main","Output directory in batch mode. ‘_anonymized’ will be attached to the input file names. "
+                                                                    "Default: the input directory."),
+                                 QCoreApplication::translate("main","outdir"));
+    m_parser.addOption(outDirOpt);
+
+    QCommandLineOption jobsOpt(QStringList() << "j" << "jobs",
+                               QCoreApplication::translate("main","Maximal number of files read and written at the same time in batch mode. Default: 4"),
+                               QCoreApplication::translate("main","number"));
+    m_parser.addOption(jobsOpt);
+
     QCommandLineOption verboseOpt(QStringList() << "v" << "verbose",
                                   QCoreApplication::translate("main","Prints out more information, about each specific anonymized field. Default: false"));
     m_parser.addOption(verboseOpt);
@@ -201,6 +226,12 @@ void SettingsControllerCl::initParser()
                                               QCoreApplication::translate("main","Avoid confirming the deletion of the input fiff file. Default: false"));
     m_parser.addOption(deleteInFileConfirmOpt);
 
+    QCommandLineOption inPlaceOpt(QStringList() << "ip" << "in_place",
+                                  QCoreApplication::translate("main","Anonymize the input file in place. Only the sensitive tags are rewritten, keeping their size: "
+                                                                     "longer values are truncated and shorter ones are padded with zeros. The input file is modified. "
+                                                                     "Cannot be combined with the out and out_dir options. Default: false"));
+    m_parser.addOption(inPlaceOpt);
+
     QCommandLineOption bruteOpt(QStringList() << "b" << "brute",
                                 QCoreApplication::translate("main","Anonymize additional subject’s information like weight, height, sex and handedness, and project’s data,"
                                                             " subject's data. See help above. Default: false"));
@@ -270,6 +301,11 @@ int SettingsControllerCl::parseInputs(const QStringList& arguments)
         m_pAnonymizer->setVerboseMode(false);
     }
 
+    if(m_parser.isSet("jobs"))
+    {
+        m_iNumJobs = qMax(1, m_parser.value("jobs").toInt());
+    }
+
     if(m_parser.isSet("brute"))
     {
         m_pAnonymizer->setBruteMode(true);
@@ -356,6 +392,21 @@ int SettingsControllerCl::parseInputs(const QStringList& arguments)
 
 int SettingsControllerCl::parseInOutFiles()
 {
+    if(m_parser.isSet("in_place"))
+    {
+        if(m_parser.isSet("out") || m_parser.isSet("out_dir"))
+        {
+            qCritical() << "The option in_place cannot be combined with out or out_dir.";
+            return 1;
+        }
+        m_bInPlaceMode = true;
+        m_pAnonymizer->setInPlaceMode(true);
+    }
+
+    if(m_parser.isSet("in_dir"))
+    {
+        return parseInOutDirs();
+    }
 
     if(m_parser.isSet("in"))
     {
@@ -379,6 +430,12 @@ int SettingsControllerCl::parseInOutFiles()
         }
     }
 
+    if(m_bInPlaceMode)
+    {
+        m_fiOutFile = m_fiInFile;
+        return 0;
+    }
+
     if(m_parser.isSet("out"))
     {
         m_fiOutFile.setFile(m_parser.value("out"));
@@ -420,15 +477,70 @@ int SettingsControllerCl::parseInOutFiles()
 
 //=============================================================================================================
 
+int SettingsControllerCl::parseInOutDirs()
+{
+    if(m_parser.isSet("in") || m_parser.isSet("out"))
+    {
+        qCritical() << "The options in and out cannot be combined with in_dir.";
+        return 1;
+    }
+
+    QDir dirIn(m_parser.value("in_dir"));
+    if(!dirIn.exists())
+    {
+        qCritical() << "Input directory does not exist: " << dirIn.absolutePath();
+        return 1;
+    }
+
+    const QFileInfoList lFiles(dirIn.entryInfoList(QStringList() << "*.fif", QDir::Files, QDir::Name));
+    for(const QFileInfo& fiFile : lFiles)
+    {
+        if(!fiFile.baseName().endsWith("_anonymized"))
+        {
+            m_lInFiles.append(fiFile);
+        }
+    }
+
+    if(m_lInFiles.isEmpty())
+    {
+        qCritical() << "No fiff files found in the input directory: " << dirIn.absolutePath();
+        return 1;
+    }
+
+    m_dirOut = dirIn;
+    if(m_parser.isSet("out_dir"))
+    {
+        m_dirOut.setPath(m_parser.value("out_dir"));
+        if(!m_dirOut.exists() && !m_dirOut.mkpath("."))
+        {
+            qCritical() << "Unable to create the output directory: " << m_dirOut.absolutePath();
+            return 1;
+        }
+    }
+
+    m_bBatchMode = true;
+    return 0;
+}
+
+//=============================================================================================================
+
 int SettingsControllerCl::execute()
 {
+    if(m_bBatchMode)
+    {
+        return executeBatch();
+    }
+
     if(m_pAnonymizer->anonymizeFile())
     {
         qCritical() << "Error. Program ends now.";
         return 1;
     }
 
-    if(checkDeleteInputFile())
+    if(m_bInPlaceMode && m_bDeleteInputFileAfter)
+    {
+        qWarning() << "The input file is not deleted in in-place mode.";
+    } else if(checkDeleteInputFile())
     {
         deleteInputFile();
     }
@@ -450,6 +562,62 @@ int SettingsControllerCl::execute()
 
 //=============================================================================================================
 
+int SettingsControllerCl::executeBatch()
+{
+    if(m_bDeleteInputFileAfter)
+    {
+        qWarning() << "The input files are not deleted in batch mode.";
+    }
+
+    // The pool bounds the number of files which are read and written at the same time. The anonymizers are
+    // created and destroyed in this thread, the pool threads only run them.
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_iNumJobs);
+
+    QList<FiffAnonymizer::SPtr> lAnonymizers;
+    QList<QFuture<int> > lFutures;
+
+    for(const QFileInfo& fiInFile : m_lInFiles)
+    {
+        FiffAnonymizer::SPtr pAnonymizer(new FiffAnonymizer(*m_pAnonymizer));
+        QString sFileOut(m_dirOut.filePath(fiInFile.baseName() + "_anonymized." + fiInFile.completeSuffix()));
+
+        if(pAnonymizer->setInFile(fiInFile.absoluteFilePath()) || (!m_bInPlaceMode && pAnonymizer->setOutFile(sFileOut)))
+        {
+            qCritical() << "Error while setting the files for: " << fiInFile.fileName();
+            return 1;
+        }
+
+        lAnonymizers.append(pAnonymizer);
+        lFutures.append(QtConcurrent::run(&pool, [pAnonymizer]() {
+            return pAnonymizer->anonymizeFile();
+        }));
+    }
+
+    int iNumFailed = 0;
+    for(int i = 0; i < lFutures.size(); ++i)
+    {
+        if(lFutures[i].result())
+        {
+            qCritical() << "Error during the anonymization of: " << m_lInFiles.at(i).fileName();
+            ++iNumFailed;
+        } else if(!m_bSilentMode) {
+            std::printf("\n%s", QString("MNE Anonymize finished correctly: " + m_lInFiles.at(i).fileName() + " -> " + (m_bInPlaceMode ? m_lInFiles.at(i).fileName() : QFileInfo(lAnonymizers.at(i)->getFileNameOut()).fileName())).toUtf8().data());
+        }
+    }
+
+    if(!m_bSilentMode)
+    {
+        std::printf("\n%s\n", QString("MNE Anonymize batch finished: " + QString::number(m_lInFiles.size() - iNumFailed) + " of " + QString::number(m_lInFiles.size()) + " files anonymized.").toUtf8().data());
+    }
+
+    printFooterIfVerbose();
+
+    return iNumFailed > 0 ? 1 : 0;
+}
+
+//=============================================================================================================
+
 bool SettingsControllerCl::checkDeleteInputFile()
 {
     if(m_bDeleteInputFileAfter) //false by default
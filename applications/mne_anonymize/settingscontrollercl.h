@@ -53,6 +53,7 @@
 #include <QSharedPointer>
 #include <QCommandLineParser>
 #include <QFileInfo>
+#include <QDir>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -166,6 +167,24 @@ private:
      */
     int parseInOutFiles();
 
+    //=========================================================================================================
+    /**
+     * Processes the batch mode options. Collects the fiff files in the input directory and sets up the output
+     * directory.
+     *
+     * @return Returns 0 if parsing was successful, 1 otherwise.
+     */
+    int parseInOutDirs();
+
+    //=========================================================================================================
+    /**
+     * Anonymizes all the files collected by parseInOutDirs in parallel. Each file is processed by its own copy of
+     * the configured FiffAnonymizer, at most m_iNumJobs files are read and written at the same time.
+     *
+     * @return Returns 0 if all files were anonymized, 1 otherwise.
+     */
+    int executeBatch();
+
     //=========================================================================================================
     /**
      * The user might request throught the flag "--delete_input_file_after" to have the input file deleted. If the
@@ -245,8 +264,14 @@ protected:
     QFileInfo m_fiInFile;               /**< Input File info obj.*/
     QFileInfo m_fiOutFile;              /**< Output File info obj.*/
 
+    QFileInfoList m_lInFiles;           /**< Input files in batch mode.*/
+    QDir m_dirOut;                      /**< Output directory in batch mode.*/
+    int m_iNumJobs;                     /**< Maximal number of files processed at the same time in batch mode.*/
+
 protected:
     bool m_bGuiMode;                        /**< Object running in GUI mode.*/
+    bool m_bBatchMode;                      /**< Anonymize all files in a directory.*/
+    bool m_bInPlaceMode;                    /**< Patch the sensitive tags in the input file instead of writing an output file.*/
     bool m_bDeleteInputFileAfter;           /**< User's request to delete the input file after anonymization.*/
     bool m_bDeleteInputFileConfirmation;    /**< User's request to avoid confirmation prompt for input file deletion.*/
     bool m_bHisIdSpecified;                 /**< User specified a "his_id" field to be used if that info is present in the input file.*/
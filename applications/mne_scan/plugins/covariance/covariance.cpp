@@ -81,6 +81,7 @@ using namespace Eigen;
 
 Covariance::Covariance()
 : m_iEstimationSamples(2000)
+, m_bExponentialForgetting(false)
 , m_pCircularBuffer(CircularBuffer_Matrix_double::SPtr::create(40))
 {
 }
@@ -108,6 +109,7 @@ void Covariance::init()
     // Load Settings
     QSettings settings("MNECPP");
     m_iEstimationSamples = settings.value(QString("MNESCAN/%1/estimationSamples").arg(this->getName()), 5000).toInt();
+    m_bExponentialForgetting = settings.value(QString("MNESCAN/%1/exponentialForgetting").arg(this->getName()), false).toBool();
 
     // Input
     m_pCovarianceInput = PluginInputData<RealTimeMultiSampleArray>::create(this, "CovarianceIn", "Covariance input data");
@@ -151,6 +153,7 @@ void Covariance::unload()
     // Save Settings
     QSettings settings("MNECPP");
     settings.setValue(QString("MNESCAN/%1/estimationSamples").arg(this->getName()), m_iEstimationSamples);
+    settings.setValue(QString("MNESCAN/%1/exponentialForgetting").arg(this->getName()), m_bExponentialForgetting);
 }
 
 //=============================================================================================================
@@ -258,6 +261,7 @@ void Covariance::run()
     int iEstimationSamples = m_iEstimationSamples;
     m_mutex.unlock();
     RTPROCESSINGLIB::RtCov rtCov(m_pFiffInfo);
+    rtCov.setExponentialForgetting(m_bExponentialForgetting);
 
     // Start processing data
     while(!isInterruptionRequested()) {
@@ -154,6 +154,7 @@ protected:
 private:
     QMutex      m_mutex;
     qint32      m_iEstimationSamples;
+    bool        m_bExponentialForgetting;   /**< Whether to continuously update the covariance with exponential forgetting instead of estimating it block-wise. */
 
     UTILSLIB::CircularBuffer_Matrix_double::SPtr        m_pCircularBuffer;              /**< Matrix data circular buffer */
 
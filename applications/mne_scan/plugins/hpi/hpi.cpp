@@ -47,6 +47,7 @@
 #include <scMeas/realtimemultisamplearray.h>
 #include <scMeas/realtimehpiresult.h>
 #include <inverse/hpiFit/hpifit.h>
+#include <inverse/hpiFit/hpidemodulator.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -492,23 +493,90 @@ void Hpi::run()
     int iNumberOfFitsPerSecond = m_iNumberOfFitsPerSecond;
     m_mutex.unlock();
 
+    // The merged window is used for the frequency ordering and single fits, continuous fits are done on the
+    // running amplitudes of the demodulator. Its window is independent of the fit rate.
     MatrixXd matDataMerged(m_pFiffInfo->chs.size(), int(m_pFiffInfo->sfreq/iNumberOfFitsPerSecond));
+    HPIDemodulator demodulator(m_pFiffInfo->sfreq,
+                               QVector<int>(),
+                               m_pFiffInfo->chs.size(),
+                               0.2,
+                               HPIDemodulator::Exponential);
+    int iSamplesSinceFit = 0;
+    bool bWasContinousHpi = false;
+
+    // Checks the fit result and publishes it
+    auto publishFit = [&]() {
+        //Check if the error meets distance requirement
+        if(fitResult.errorDistances.size() > 0) {
+            dMeanErrorDist = std::accumulate(fitResult.errorDistances.begin(), fitResult.errorDistances.end(), .0) / fitResult.errorDistances.size();
+
+            emit errorsChanged(fitResult.errorDistances, dMeanErrorDist);
+
+            m_mutex.lock();
+            dErrorMax = m_dAllowedMeanErrorDist;
+            m_mutex.unlock();
+            if(dMeanErrorDist < dErrorMax) {
+                //If fit was good, set newly calculated transformation matrix to fiff info
+                emit devHeadTransAvailable(fitResult.devHeadTrans);
+
+                // check for large head movement
+                dMovement = transDevHeadRef.translationTo(fitResult.devHeadTrans.trans);
+                dRotation = transDevHeadRef.angleTo(fitResult.devHeadTrans.trans);
+
+                emit movementResultsChanged(dMovement,dRotation);
+
+                fitResult.fHeadMovementDistance = dMovement;
+                fitResult.fHeadMovementAngle = dRotation;
+                fitResult.bIsLargeHeadMovement = false;
+
+                m_mutex.lock();
+                dAllowedMovement = m_dAllowedMovement;
+                dAllowedRotation = m_dAllowedRotation;
+                m_mutex.unlock();
+                if(dMovement > dAllowedMovement || dRotation > dAllowedRotation) {
+                    fitResult.bIsLargeHeadMovement = true;
+                    transDevHeadRef = fitResult.devHeadTrans;
+                }
+                m_pHpiOutput->data()->setValue(fitResult);
+            }
+        }
+    };
 
     while(!isInterruptionRequested()) {
         m_mutex.lock();
         if(iNumberOfFitsPerSecond != m_iNumberOfFitsPerSecond) {
+            iNumberOfFitsPerSecond = m_iNumberOfFitsPerSecond;
             matDataMerged.resize(m_pFiffInfo->chs.size(), int(m_pFiffInfo->sfreq/iNumberOfFitsPerSecond));
             iDataIndexCounter = 0;
         }
+        bool bDoContinousHpi = m_bDoContinousHpi;
+        demodulator.setFrequencies(m_vCoilFreqs);
         m_mutex.unlock();
 
+        // The data stream has a gap while continuous fitting is off, start over when it is switched on again
+        if(bDoContinousHpi && !bWasContinousHpi) {
+            demodulator.reset();
+            iSamplesSinceFit = 0;
+        }
+        bWasContinousHpi = bDoContinousHpi;
+
         //pop matrix
         if(m_pCircularBuffer->pop(matData)) {
+            // Demodulate every block, the amplitudes are then available at any rate
+            if(bDoContinousHpi) {
+                demodulator.append(matData);
+                iSamplesSinceFit += matData.cols();
+            }
+
             if(iDataIndexCounter + matData.cols() < matDataMerged.cols()) {
                 matDataMerged.block(0, iDataIndexCounter, matData.rows(), matData.cols()) = matData;
                 iDataIndexCounter += matData.cols();
             } else {
+                matDataMerged.block(0, iDataIndexCounter, matData.rows(), matDataMerged.cols()-iDataIndexCounter) = matData.block(0, 0, matData.rows(), matDataMerged.cols()-iDataIndexCounter);
+                iDataIndexCounter = 0;
+
                 m_mutex.lock();
+                bool bDoWindowFit = m_bDoSingleHpi || m_bDoFreqOrder || !bDoContinousHpi;
                 if(m_bDoSingleHpi) {
                     m_bDoSingleHpi = false;
                     fitResult.devHeadTrans.clear();
@@ -516,73 +584,58 @@ void Hpi::run()
                 fitResult.sFilePathDigitzers = m_sFilePathDigitzers;
                 m_mutex.unlock();
 
-                matDataMerged.block(0, iDataIndexCounter, matData.rows(), matDataMerged.cols()-iDataIndexCounter) = matData.block(0, 0, matData.rows(), matDataMerged.cols()-iDataIndexCounter);
+                if(bDoWindowFit) {
+                    // Perform HPI fit
 
-                // Perform HPI fit
+                    m_mutex.lock();
+                    if(m_bDoFreqOrder) {
+                        // find correct frequencie order if requested
+                        HPI.findOrder(matDataMerged,
+                                      m_matCompProjectors,
+                                      fitResult.devHeadTrans,
+                                      m_vCoilFreqs,
+                                      fitResult.errorDistances,
+                                      fitResult.GoF,
+                                      fitResult.fittedCoils,
+                                      m_pFiffInfo);
+                        m_bDoFreqOrder = false;
+                    }
+                    m_mutex.unlock();
 
-                m_mutex.lock();
-                if(m_bDoFreqOrder) {
-                    // find correct frequencie order if requested
-                    HPI.findOrder(matDataMerged,
-                                  m_matCompProjectors,
-                                  fitResult.devHeadTrans,
-                                  m_vCoilFreqs,
-                                  fitResult.errorDistances,
-                                  fitResult.GoF,
-                                  fitResult.fittedCoils,
-                                  m_pFiffInfo);
-                    m_bDoFreqOrder = false;
+                    // Perform actual fitting
+                    m_mutex.lock();
+                    HPI.fitHPI(matDataMerged,
+                               m_matCompProjectors,
+                               fitResult.devHeadTrans,
+                               m_vCoilFreqs,
+                               fitResult.errorDistances,
+                               fitResult.GoF,
+                               fitResult.fittedCoils,
+                               m_pFiffInfo);
+                    m_mutex.unlock();
+
+                    publishFit();
+                    iSamplesSinceFit = 0;
+                    continue;
                 }
-                m_mutex.unlock();
+            }
 
-                // Perform actual fitting
+            // Continuous fits from the demodulated amplitudes
+            if(bDoContinousHpi && demodulator.isReady() && iSamplesSinceFit >= m_pFiffInfo->sfreq/iNumberOfFitsPerSecond) {
                 m_mutex.lock();
-                HPI.fitHPI(matDataMerged,
-                           m_matCompProjectors,
-                           fitResult.devHeadTrans,
-                           m_vCoilFreqs,
-                           fitResult.errorDistances,
-                           fitResult.GoF,
-                           fitResult.fittedCoils,
-                           m_pFiffInfo);
+                fitResult.sFilePathDigitzers = m_sFilePathDigitzers;
+                HPI.fitHPIFromAmplitudes(demodulator.getAmplitudes(),
+                                         m_matCompProjectors,
+                                         fitResult.devHeadTrans,
+                                         m_vCoilFreqs,
+                                         fitResult.errorDistances,
+                                         fitResult.GoF,
+                                         fitResult.fittedCoils,
+                                         m_pFiffInfo);
                 m_mutex.unlock();
 
-                //Check if the error meets distance requirement
-                if(fitResult.errorDistances.size() > 0) {
-                    dMeanErrorDist = std::accumulate(fitResult.errorDistances.begin(), fitResult.errorDistances.end(), .0) / fitResult.errorDistances.size();
-
-                    emit errorsChanged(fitResult.errorDistances, dMeanErrorDist);
-
-                    m_mutex.lock();
-                    dErrorMax = m_dAllowedMeanErrorDist;
-                    m_mutex.unlock();
-                    if(dMeanErrorDist < dErrorMax) {
-                        //If fit was good, set newly calculated transformation matrix to fiff info
-                        emit devHeadTransAvailable(fitResult.devHeadTrans);
-
-                        // check for large head movement
-                        dMovement = transDevHeadRef.translationTo(fitResult.devHeadTrans.trans);
-                        dRotation = transDevHeadRef.angleTo(fitResult.devHeadTrans.trans);
-
-                        emit movementResultsChanged(dMovement,dRotation);
-
-                        fitResult.fHeadMovementDistance = dMovement;
-                        fitResult.fHeadMovementAngle = dRotation;
-                        fitResult.bIsLargeHeadMovement = false;
-
-                        m_mutex.lock();
-                        dAllowedMovement = m_dAllowedMovement;
-                        dAllowedRotation = m_dAllowedRotation;
-                        m_mutex.unlock();
-                        if(dMovement > dAllowedMovement || dRotation > dAllowedRotation) {
-                            fitResult.bIsLargeHeadMovement = true;
-                            transDevHeadRef = fitResult.devHeadTrans;
-                        }
-                        m_pHpiOutput->data()->setValue(fitResult);
-                    }
-                }
-
-                iDataIndexCounter = 0;
+                publishFit();
+                iSamplesSinceFit = 0;
             }
         }
     }
@@ -97,8 +97,7 @@ NeuronalConnectivity::NeuronalConnectivity()
 , m_pActionShowYourWidget(Q_NULLPTR)
 {
     AbstractMetric::m_bStorageModeIsActive = true;
-    AbstractMetric::m_iNumberBinStart = 0;
-    AbstractMetric::m_iNumberBinAmount = 100;
+    m_connectivitySettings.setFrequencyBins(0, 100);
 
     //Init rt connectivity worker
     connect(m_pRtConnectivity.data(), &RtConnectivity::newConnectivityResultAvailable,
@@ -291,13 +290,18 @@ void NeuronalConnectivity::updateSource(SCMEASLIB::Measurement::SPtr pMeasuremen
         }
 
         //Pop data from buffer
-        if(m_connectivitySettings.size() >= m_iNumberAverages) {
+        if(!m_connectivitySettings.isStreamingModeActive() && m_connectivitySettings.size() >= m_iNumberAverages) {
             m_pRtConnectivity->restart();
             m_connectivitySettings.removeFirst(m_connectivitySettings.size()-m_iNumberAverages);
         }
 
         m_timer.restart();
         m_pRtConnectivity->append(m_connectivitySettings);
+
+        // The worker keeps the running sums in streaming mode. Only send new trials next time.
+        if(m_connectivitySettings.isStreamingModeActive()) {
+            m_connectivitySettings.clearTrialData();
+        }
     }
 }
 
@@ -360,13 +364,17 @@ void NeuronalConnectivity::updateRTMSA(SCMEASLIB::Measurement::SPtr pMeasurement
             }
 
             //Pop data from buffer
-            if(m_connectivitySettings.size() > m_iNumberAverages) {
+            if(!m_connectivitySettings.isStreamingModeActive() && m_connectivitySettings.size() > m_iNumberAverages) {
                 m_pRtConnectivity->restart();
                 m_connectivitySettings.removeFirst(m_connectivitySettings.size()-m_iNumberAverages);
             }
 
             m_timer.restart();
             m_pRtConnectivity->append(m_connectivitySettings);
+
+            if(m_connectivitySettings.isStreamingModeActive()) {
+                m_connectivitySettings.clearTrialData();
+            }
         }
     }
 }
@@ -443,7 +451,7 @@ void NeuronalConnectivity::updateRTEV(SCMEASLIB::Measurement::SPtr pMeasurement)
                     m_connectivitySettings.append(data);
 
                     //Pop data from buffer
-                    if(m_connectivitySettings.size() > m_iNumberAverages) {
+                    if(!m_connectivitySettings.isStreamingModeActive() && m_connectivitySettings.size() > m_iNumberAverages) {
                         m_pRtConnectivity->restart();
                         m_connectivitySettings.removeFirst(m_connectivitySettings.size()-m_iNumberAverages);
                     }
@@ -451,6 +459,10 @@ void NeuronalConnectivity::updateRTEV(SCMEASLIB::Measurement::SPtr pMeasurement)
                     m_timer.restart();
                     m_pRtConnectivity->append(m_connectivitySettings);
 
+                    if(m_connectivitySettings.isStreamingModeActive()) {
+                        m_connectivitySettings.clearTrialData();
+                    }
+
                     break;
                 }
             }
@@ -544,8 +556,11 @@ void NeuronalConnectivity::run()
 void NeuronalConnectivity::onNewConnectivityResultAvailable(const QList<Network>& connectivityResults,
                                                             const ConnectivitySettings& connectivitySettings)
 {
-    m_connectivitySettings = connectivitySettings;
-    m_connectivitySettings.setConnectivityMethods(m_sConnectivityMethods);
+    // In streaming mode the returned settings do not carry any data. Keep the trials which arrived in the meantime.
+    if(!m_connectivitySettings.isStreamingModeActive()) {
+        m_connectivitySettings = connectivitySettings;
+        m_connectivitySettings.setConnectivityMethods(m_sConnectivityMethods);
+    }
 
     for(int i = 0; i < connectivityResults.size(); ++i) {
         m_pCircularBuffer->push(connectivityResults.at(i));
@@ -562,6 +577,11 @@ void NeuronalConnectivity::onMetricChanged(const QString& sMetric)
 
     m_sConnectivityMethods = QStringList() << sMetric;
     m_connectivitySettings.setConnectivityMethods(m_sConnectivityMethods);
+
+    // The CSD based metrics are estimated from exponentially decayed running sums. The time domain metrics
+    // still need the sliding window over the stored trials.
+    m_connectivitySettings.setStreamingModeActive(sMetric != "COR" && sMetric != "XCOR");
+
     if(m_pRtConnectivity && this->isRunning()) {
         m_pRtConnectivity->restart();
         m_pRtConnectivity->append(m_connectivitySettings);
@@ -573,6 +593,10 @@ void NeuronalConnectivity::onMetricChanged(const QString& sMetric)
 void NeuronalConnectivity::onNumberTrialsChanged(int iNumberTrials)
 {
     m_iNumberAverages = iNumberTrials;
+
+    // A decay factor of 1 - 1/N results in an effective memory of N trials. The factor has to be positive and
+    // the debiased metrics need at least two trials, so the memory is at least two trials.
+    m_connectivitySettings.setDecayFactor(1.0 - 1.0 / qMax(2, iNumberTrials));
 }
 
 //=============================================================================================================
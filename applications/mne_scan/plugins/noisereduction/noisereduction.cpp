@@ -83,10 +83,7 @@ using namespace Eigen;
 //=============================================================================================================
 
 NoiseReduction::NoiseReduction()
-: m_bCompActivated(false)
-, m_bSpharaActive(false)
-, m_bProjActivated(false)
-, m_bFilterActivated(false)
+: m_bFilterActivated(false)
 , m_iMaxFilterLength(1)
 , m_iMaxFilterTapSize(-1)
 , m_sCurrentSystem("VectorView")
@@ -200,19 +197,6 @@ void NoiseReduction::update(SCMEASLIB::Measurement::SPtr pMeasurement)
         if(!m_pFiffInfo) {
             m_pFiffInfo = pRTMSA->info();
 
-            //Init the multiplication matrices
-            m_matSparseProjMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-            m_matSparseCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-            m_matSparseSpharaMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-            m_matSparseProjCompMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-            m_matSparseFull = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-
-            m_matSparseProjMult.setIdentity();
-            m_matSparseCompMult.setIdentity();
-            m_matSparseSpharaMult.setIdentity();
-            m_matSparseProjCompMult.setIdentity();
-            m_matSparseFull.setIdentity();
-
             //Init output
             m_pNoiseReductionOutput->data()->initFromFiffInfo(m_pFiffInfo);
             m_pNoiseReductionOutput->data()->setMultiArraySize(1);
@@ -314,7 +298,7 @@ void NoiseReduction::initPluginControlWidgets()
 void NoiseReduction::setSpharaActive(bool state)
 {
     m_mutex.lock();
-    m_bSpharaActive = state;
+    m_spatialOperator.setSpharaActive(state);
     m_mutex.unlock();
 }
 
@@ -349,39 +333,29 @@ void NoiseReduction::run()
         // Get the current data
         if(m_pCircularBuffer->pop(matData)) {
             m_mutex.lock();
-            //Do SSP's and compensators here
-            if(m_bCompActivated) {
-                if(m_bProjActivated) {
-                    //Comp + Proj
-                    matData = m_matSparseProjCompMult * matData;
-                } else {
-                    //Comp
-                    matData = m_matSparseCompMult * matData;
-                }
-            } else {
-                if(m_bProjActivated) {
-                    //Proj
-                    matData = m_matSparseProjMult * matData;
-                } else {
-                    //None - Raw
-                }
+            //Bad channels are masked in front of SPHARA, only rebuild the operator if they changed
+            if(m_lBadChannels != m_pFiffInfo->bads) {
+                updateBadChannels();
             }
 
-            //Do temporal filtering here
+            //Compensators and SSPs are applied before the temporal filter, bad channel masking and SPHARA
+            //after it. If compensators and SSPs do not mix filtered and unfiltered channels they commute with
+            //the filter, so all stages are applied as one composed operator to the filter output.
             if(m_bFilterActivated) {
-                matData = pRtFilter->calculate(matData,
-                                                          m_filterKernel,
-                                                          m_lFilterChannelList);
-            }
-
-            //Do SPHARA here
-            if(m_bSpharaActive) {
-                //Set bad channels to zero so they do not get smeared into
-                for(int i = 0; i < m_pFiffInfo->bads.size(); ++i) {
-                    matData.row(m_pFiffInfo->ch_names.indexOf(m_pFiffInfo->bads.at(i))).setZero();
+                if(m_spatialOperator.commutesWith(m_lFilterChannelList)) {
+                    matData = pRtFilter->calculate(matData,
+                                                   m_filterKernel,
+                                                   m_lFilterChannelList);
+                    m_spatialOperator.apply(matData);
+                } else {
+                    m_spatialOperator.applyPreFilter(matData);
+                    matData = pRtFilter->calculate(matData,
+                                                   m_filterKernel,
+                                                   m_lFilterChannelList);
+                    m_spatialOperator.applyPostFilter(matData);
                 }
-
-                matData = m_matSparseSpharaMult * matData;
+            } else {
+                m_spatialOperator.apply(matData);
             }
 
     //        //Common average
@@ -423,11 +397,11 @@ void NoiseReduction::updateProjection(const QList<FIFFLIB::FiffProj>& projs)
     //  Update the SSP projector
     if(m_pFiffInfo) {
         m_mutex.lock();
-        //If a minimum of one projector is active set m_bProjActivated to true so that this model applies the ssp to the incoming data
-        m_bProjActivated = false;
+        //If a minimum of one projector is active set bProjActivated to true so that this model applies the ssp to the incoming data
+        bool bProjActivated = false;
         for(qint32 i = 0; i < projs.size(); ++i) {
             if(projs[i].active) {
-                m_bProjActivated = true;
+                bProjActivated = true;
                 break;
             }
         }
@@ -443,34 +417,28 @@ void NoiseReduction::updateProjection(const QList<FIFFLIB::FiffProj>& projs)
             }
         }
 
-        // Make proj sparse
-        qint32 nchan = this->m_pFiffInfo->nchan;
-        qint32 i, k;
+        m_spatialOperator.setProjector(matProj);
+        m_spatialOperator.setProjectorActive(bProjActivated);
+        m_mutex.unlock();
+    }
+}
 
-        typedef Eigen::Triplet<double> T;
-        std::vector<T> tripletList;
-        tripletList.reserve(nchan);
+//=============================================================================================================
 
-        tripletList.clear();
-        tripletList.reserve(matProj.rows()*matProj.cols());
-        for(i = 0; i < matProj.rows(); ++i) {
-            for(k = 0; k < matProj.cols(); ++k) {
-                if(matProj(i,k) != 0) {
-                    tripletList.push_back(T(i, k, matProj(i,k)));
-                }
-            }
+void NoiseReduction::updateBadChannels()
+{
+    m_lBadChannels = m_pFiffInfo->bads;
+
+    VectorXi vecBadIdx(m_lBadChannels.size());
+    int iNumBads = 0;
+    for(int i = 0; i < m_lBadChannels.size(); ++i) {
+        int index = m_pFiffInfo->ch_names.indexOf(m_lBadChannels.at(i));
+        if(index >= 0) {
+            vecBadIdx[iNumBads++] = index;
         }
-
-        m_matSparseProjMult = SparseMatrix<double>(matProj.rows(),matProj.cols());
-        if(tripletList.size() > 0)
-            m_matSparseProjMult.setFromTriplets(tripletList.begin(), tripletList.end());
-
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
-
-        m_matSparseFull = m_matSparseProjMult * m_matSparseCompMult;
-        m_mutex.unlock();
     }
+
+    m_spatialOperator.setBadChannels(vecBadIdx.head(iNumBads));
 }
 
 //=============================================================================================================
@@ -480,51 +448,15 @@ void NoiseReduction::updateCompensator(int to)
     // Update the compensator
     if(m_pFiffInfo)
     {
-        if(to == 0) {
-            m_bCompActivated = false;
-        } else {
-            m_bCompActivated = true;
-        }
-
-//        qDebug()<<"to"<<to;
-//        qDebug()<<"from"<<from;
-//        qDebug()<<"m_bCompActivated"<<m_bCompActivated;
-
         FiffCtfComp newComp;
         this->m_pFiffInfo->make_compensator(0, to, newComp);//Do this always from 0 since we always read new raw data, we never actually perform a multiplication on already existing data
 
         this->m_pFiffInfo->set_current_comp(to);
-        MatrixXd matComp = newComp.data->data;
-
-        //
-        // Make proj sparse
-        //
-        qint32 nchan = this->m_pFiffInfo->nchan;
-        qint32 i, k;
-
-        typedef Eigen::Triplet<double> T;
-        std::vector<T> tripletList;
-        tripletList.reserve(nchan);
-
-        tripletList.clear();
-        tripletList.reserve(matComp.rows()*matComp.cols());
-        for(i = 0; i < matComp.rows(); ++i) {
-            for(k = 0; k < matComp.cols(); ++k) {
-                if(matComp(i,k) != 0) {
-                    tripletList.push_back(T(i, k, matComp(i,k)));
-                }
-            }
-        }
-
-        m_matSparseCompMult = SparseMatrix<double>(matComp.rows(),matComp.cols());
-        if(tripletList.size() > 0) {
-            m_matSparseCompMult.setFromTriplets(tripletList.begin(), tripletList.end());
-        }
-
-        //Create full multiplication matrix
-        m_matSparseProjCompMult = m_matSparseProjMult * m_matSparseCompMult;
 
-        m_matSparseFull = m_matSparseProjMult * m_matSparseCompMult;
+        m_mutex.lock();
+        m_spatialOperator.setCompensator(newComp.data->data);
+        m_spatialOperator.setCompensatorActive(to != 0);
+        m_mutex.unlock();
     }
 }
 
@@ -662,55 +594,7 @@ void NoiseReduction::createSpharaOperator()
 //    IOUtils::write_eigen_matrix(matSpharaMultFirst, QString(QCoreApplication::applicationDirPath() + "resources/mne_scan/plugins/noisereduction/SPHARA/matSpharaMultFirst.txt"));
 //    IOUtils::write_eigen_matrix(matSpharaMultSecond, QString(QCoreApplication::applicationDirPath() + "resources/mne_scan/plugins/noisereduction/SPHARA/matSpharaMultSecond.txt"));
 
-    //
-    // Make operators sparse
-    //
-    qint32 nchan = this->m_pFiffInfo->nchan;
-    qint32 i, k;
-
-    typedef Eigen::Triplet<double> T;
-    std::vector<T> tripletList;
-    tripletList.reserve(nchan);
-
-    //First operator
-    tripletList.clear();
-    tripletList.reserve(matSpharaMultFirst.rows()*matSpharaMultFirst.cols());
-    for(i = 0; i < matSpharaMultFirst.rows(); ++i) {
-        for(k = 0; k < matSpharaMultFirst.cols(); ++k) {
-            if(matSpharaMultFirst(i,k) != 0) {
-                tripletList.push_back(T(i, k, matSpharaMultFirst(i,k)));
-            }
-        }
-    }
-
-    SparseMatrix<double> matSparseSpharaMultFirst = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-
-    if(tripletList.size() > 0) {
-        matSparseSpharaMultFirst.setFromTriplets(tripletList.begin(), tripletList.end());
-    }
-
-    //Second operator
-    tripletList.clear();
-    tripletList.reserve(matSpharaMultSecond.rows()*matSpharaMultSecond.cols());
-
-    for(i = 0; i < matSpharaMultSecond.rows(); ++i) {
-        for(k = 0; k < matSpharaMultSecond.cols(); ++k) {
-            if(matSpharaMultSecond(i,k) != 0) {
-                tripletList.push_back(T(i, k, matSpharaMultSecond(i,k)));
-            }
-        }
-    }
-
-    SparseMatrix<double>matSparseSpharaMultSecond = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
-
-    if(tripletList.size() > 0) {
-        matSparseSpharaMultSecond.setFromTriplets(tripletList.begin(), tripletList.end());
-    }
-
-    //Create full multiplication matrix
-    m_matSparseSpharaMult = matSparseSpharaMultFirst * matSparseSpharaMultSecond;
-
-    m_matSparseFull = m_matSparseProjMult * m_matSparseCompMult;
+    m_spatialOperator.setSphara(matSpharaMultFirst * matSpharaMultSecond);
 
     m_mutex.unlock();
 }
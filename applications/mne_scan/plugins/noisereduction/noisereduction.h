@@ -47,6 +47,7 @@
 #include <fiff/fiff_proj.h>
 
 #include <rtprocessing/helpers/filterkernel.h>
+#include <rtprocessing/spatialoperator.h>
 
 #include <scShared/Plugins/abstractalgorithm.h>
 
@@ -173,6 +174,12 @@ protected:
      */
     void updateProjection(const QList<FIFFLIB::FiffProj>& projs);
 
+    //=========================================================================================================
+    /**
+     * Update the bad channel indices which are masked in front of SPHARA. Call with the mutex locked.
+     */
+    void updateBadChannels();
+
     //=========================================================================================================
     /**
      * Update the compensator
@@ -220,9 +227,6 @@ protected:
 private:
     QMutex                          m_mutex;                                    /**< The threads mutex.*/
 
-    bool                            m_bCompActivated;                           /**< Compensator activated */
-    bool                            m_bSpharaActive;                            /**< Flag whether thread is running.*/
-    bool                            m_bProjActivated;                           /**< Projections activated */
     bool                            m_bFilterActivated;                         /**< Projections activated */
 
     int                             m_iNBaseFctsFirst;                          /**< The number of grad/inner base functions to use for calculating the sphara opreator.*/
@@ -233,6 +237,8 @@ private:
     QString                         m_sCurrentSystem;                           /**< The current acquisition system (EEG, babyMEG, VectorView).*/
     QString                         m_sFilterChannelType;                       /**< Kind of channel which is to be filtered */
 
+    QStringList                     m_lBadChannels;                             /**< The bad channels the spatial operator was built for.*/
+
     RTPROCESSINGLIB::FilterKernel     m_filterKernel;                             /**< The currently active filter. */
 
     Eigen::VectorXi                 m_vecIndicesFirstVV;                        /**< The indices of the channels to pick for the first SPHARA oerpator in case of a VectorView system.*/
@@ -241,11 +247,7 @@ private:
     Eigen::VectorXi                 m_vecIndicesSecondBabyMEG;                  /**< The indices of the channels to pick for the second SPHARA oerpator in case of a BabyMEG system.*/
     Eigen::VectorXi                 m_vecIndicesFirstEEG;                       /**< The indices of the channels to pick for the second SPHARA operator in case of an EEG system.*/
 
-    Eigen::SparseMatrix<double>     m_matSparseSpharaMult;                      /**< The final sparse SPHARA operator .*/
-    Eigen::SparseMatrix<double>     m_matSparseProjCompMult;                    /**< The final sparse projection + compensator operator.*/
-    Eigen::SparseMatrix<double>     m_matSparseProjMult;                        /**< The final sparse SSP projector */
-    Eigen::SparseMatrix<double>     m_matSparseCompMult;                        /**< The final sparse compensator matrix */
-    Eigen::SparseMatrix<double>     m_matSparseFull;                            /**< The final sparse full multiplication matrix  */
+    RTPROCESSINGLIB::SpatialOperator  m_spatialOperator;                        /**< The composed compensator, SSP, bad channel and SPHARA operator.*/
 
     Eigen::MatrixXd                 m_matSpharaVVGradLoaded;                    /**< The loaded VectorView gradiometer basis functions.*/
     Eigen::MatrixXd                 m_matSpharaVVMagLoaded;                     /**< The loaded VectorView magnetometer basis functions.*/
@@ -393,6 +393,10 @@ void RtcMne::updateRTMSA(SCMEASLIB::Measurement::SPtr pMeasurement)
                 m_pFiffInfoInput = pRTMSA->info();
                 m_iNumAverages = 1;
                 m_bRawInput = true;
+
+                QMap<QString,double> mapReject;
+                mapReject.insert("eog", 150e-06);
+                m_artifactRejector.setup(*m_pFiffInfoInput, mapReject);
             }
             m_qMutex.unlock();
 
@@ -402,13 +406,8 @@ void RtcMne::updateRTMSA(SCMEASLIB::Measurement::SPtr pMeasurement)
 
             if(this->isRunning()) {
                 // Check for artifacts
-                QMap<QString,double> mapReject;
-                mapReject.insert("eog", 150e-06);
-
                 for(qint32 i = 0; i < pRTMSA->getMultiSampleArray().size(); ++i) {
-                    bool bArtifactDetected = MNEEpochDataList::checkForArtifact(pRTMSA->getMultiSampleArray()[i],
-                                                                                *m_pFiffInfoInput,
-                                                                                mapReject);
+                    bool bArtifactDetected = m_artifactRejector.check(pRTMSA->getMultiSampleArray()[i]);
 
                     if(!bArtifactDetected) {
                         // Please note that we do not need a copy here since this function will block until
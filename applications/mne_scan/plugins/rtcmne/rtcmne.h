@@ -49,6 +49,7 @@
 #include <fiff/fiff_evoked.h>
 
 #include <mne/mne_inverse_operator.h>
+#include <mne/mne_artifact_rejector.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -238,6 +239,7 @@ protected:
     QSharedPointer<FIFFLIB::FiffInfoBase>                                                   m_pFiffInfoForward;         /**< Fiff information of the forward solution. */
     QSharedPointer<FIFFLIB::FiffInfo>                                                       m_pFiffInfo;                /**< Fiff information. */
     QSharedPointer<FIFFLIB::FiffInfo>                                                       m_pFiffInfoInput;           /**< Fiff information of the evoked. */
+    MNELIB::MNEArtifactRejector                                                             m_artifactRejector;         /**< Rejects raw data blocks with EOG artifacts. */
 
     bool                            m_bEvokedInput;             /**< Flag whether an evoked input was received. */
     bool                            m_bRawInput;                /**< Flag whether a raw data input was received. */
@@ -116,8 +116,6 @@ int main(int argc, char *argv[])
     QApplication a(argc, argv);
 
     AbstractMetric::m_bStorageModeIsActive = false;
-//    AbstractMetric::m_iNumberBinStart = 8;
-//    AbstractMetric::m_iNumberBinAmount = 4;
 
     QCommandLineParser parser;
     parser.setApplicationDescription("Connectivity Comparison Example");
@@ -206,6 +204,7 @@ int main(int argc, char *argv[])
     fiff_int_t dest_comp = 0;
 
     ConnectivitySettings conSettings;
+//    conSettings.setFrequencyBins(8, 4);
 
     // Create sensor level data
     QFile t_fileRaw(sRaw);
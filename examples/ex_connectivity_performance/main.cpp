@@ -152,8 +152,8 @@ int main(int argc, char *argv[])
     int iStorageModeActive = 0;
 
     AbstractMetric::m_bStorageModeIsActive = iStorageModeActive;
-    AbstractMetric::m_iNumberBinStart = 8;
-    AbstractMetric::m_iNumberBinAmount = 4;
+    int iNumberBinStart = 8;
+    int iNumberBinAmount = 4;
 
     // Create sensor level data
     QElapsedTimer timer;
@@ -180,6 +180,7 @@ int main(int argc, char *argv[])
     ConnectivitySettings connectivitySettings;
     connectivitySettings.setSamplingFrequency(raw.info.sfreq);
     connectivitySettings.setWindowType("hanning");
+    connectivitySettings.setFrequencyBins(iNumberBinStart, iNumberBinAmount);
 
     QMap<int, QMap<int, MatrixXd > > matInputData;
 
@@ -226,7 +227,7 @@ int main(int argc, char *argv[])
                     m_iNumberSamples = lNumberSamples.at(j);
 
                     //Create new folder
-                    m_sCurrentDir = QString("/cluster/fusion/lesch/connectivity_performance_%1_%2_%3/%4/%5_%6_%7").arg(QHostInfo::localHostName()).arg(AbstractMetric::m_iNumberBinAmount).arg(iStorageModeActive).arg(sConnectivityMethodList.at(i)).arg(QString::number(lNumberChannels.at(k))).arg(QString::number(lNumberSamples.at(j))).arg(QString::number(lNumberTrials.at(l)));
+                    m_sCurrentDir = QString("/cluster/fusion/lesch/connectivity_performance_%1_%2_%3/%4/%5_%6_%7").arg(QHostInfo::localHostName()).arg(iNumberBinAmount).arg(iStorageModeActive).arg(sConnectivityMethodList.at(i)).arg(QString::number(lNumberChannels.at(k))).arg(QString::number(lNumberSamples.at(j))).arg(QString::number(lNumberTrials.at(l)));
                     QDir().mkpath(m_sCurrentDir);
 
                     //Write basic information to file
@@ -236,7 +237,7 @@ int main(int argc, char *argv[])
                     qWarning() << "iNumberSamples" << lNumberSamples.at(j);
                     qWarning() << "iNumberChannels" << lNumberChannels.at(k);
                     qWarning() << "iNumberTrials" << lNumberTrials.at(l);
-                    qWarning() << "iNumberCSDFreqBins" << AbstractMetric::m_iNumberBinAmount;
+                    qWarning() << "iNumberCSDFreqBins" << iNumberBinAmount;
                     qWarning() << "rows" << matData.rows();
                     qWarning() << "cols" << matData.cols();
                     qWarning() << "numberNodes" << connectivitySettings.getNodePositions().rows();
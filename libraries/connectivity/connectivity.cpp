@@ -42,6 +42,7 @@
 
 #include "connectivitysettings.h"
 #include "network/network.h"
+#include "network/networknode.h"
 #include "metrics/correlation.h"
 #include "metrics/crosscorrelation.h"
 #include "metrics/coherence.h"
@@ -51,12 +52,17 @@
 #include "metrics/weightedphaselagindex.h"
 #include "metrics/unbiasedsquaredphaselagindex.h"
 #include "metrics/debiasedsquaredweightedphaselagindex.h"
+#include "metrics/coherency.h"
+#include "metrics/abstractmetric.h"
+
+#include <utils/spectral.h>
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QDebug>
+#include <QHash>
 #include <QFutureSynchronizer>
 #include <QtConcurrent>
 
@@ -64,11 +70,15 @@
 // EIGEN INCLUDES
 //=============================================================================================================
 
+#include <unsupported/Eigen/FFT>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace CONNECTIVITYLIB;
+using namespace Eigen;
+using namespace UTILSLIB;
 
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
@@ -91,12 +101,96 @@ QList<Network> Connectivity::calculate(ConnectivitySettings& connectivitySetting
     QElapsedTimer timer;
     timer.start();
 
+    // All CSD based metrics are derived from the same per trial spectra. If more than one of them is requested,
+    // compute the spectra, CSD, derived terms and PSD in one pass per trial and finalize all metrics from the sums.
+    QStringList lCsdMethods = QStringList() << "WPLI" << "USPLI" << "PLI" << "COH" << "IMAGCOH" << "PLV" << "DSWPLI";
+    int iNumberCsdMethods = 0;
+
+    for(int i = 0; i < lCsdMethods.size(); ++i) {
+        if(lMethods.contains(lCsdMethods.at(i))) {
+            iNumberCsdMethods++;
+        }
+    }
+
+    bool bSinglePass = !connectivitySettings.isEmpty() && iNumberCsdMethods > 1;
+
+    // The cross correlation works on the same tapered spectra. Compute them once if they are shared.
+    bool bShareSpectra = !connectivitySettings.isEmpty() && lMethods.contains("XCOR") && iNumberCsdMethods > 0;
+
+    QHash<QString, Network> hashSinglePassResults;
+
+    if(bShareSpectra || bSinglePass) {
+        #ifdef EIGEN_FFTW_DEFAULT
+            fftw_make_planner_thread_safe();
+        #endif
+
+        int iNfft = connectivitySettings.getFFTSize();
+        QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(connectivitySettings.at(0).matData.cols(),
+                                                                    connectivitySettings.getWindowType());
+
+        if(bShareSpectra) {
+            std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
+                AbstractMetric::computeTaperedSpectra(inputData,
+                                                      iNfft,
+                                                      tapers);
+            };
+
+            QFuture<void> result = QtConcurrent::map(connectivitySettings.getTrialData(),
+                                                     computeLambda);
+            result.waitForFinished();
+        }
+
+        if(bSinglePass) {
+            if(AbstractMetric::m_bStorageModeIsActive == false && !connectivitySettings.isStreamingModeActive()) {
+                // Keep tapered spectra which might have been computed for the cross correlation
+                connectivitySettings.clearIntermediateData(false);
+            }
+
+            connectivitySettings.decayIntermediateSumData();
+
+            QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
+            QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(connectivitySettings.at(0).matData.rows());
+
+            QMutex mutex;
+
+            bool bStoreIntermediateData = AbstractMetric::m_bStorageModeIsActive || connectivitySettings.isStreamingModeActive();
+
+            std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
+                computeIntermediateData(inputData,
+                                        connectivitySettings.getIntermediateSumData(),
+                                        mutex,
+                                        lMethods,
+                                        vecPairPartners,
+                                        pairBins,
+                                        iNfft,
+                                        tapers,
+                                        bStoreIntermediateData);
+            };
+
+            QFuture<void> result = QtConcurrent::map(connectivitySettings.getTrialData(),
+                                                     computeLambda);
+            result.waitForFinished();
+
+            // Finalize right away since the other metrics might clear the sums
+            for(int i = 0; i < lCsdMethods.size(); ++i) {
+                if(lMethods.contains(lCsdMethods.at(i))) {
+                    hashSinglePassResults.insert(lCsdMethods.at(i), calculateFromSums(lCsdMethods.at(i),
+                                                                                      connectivitySettings,
+                                                                                      vecPairPartners,
+                                                                                      pairBins));
+                }
+            }
+        }
+    }
+
     if(lMethods.contains("WPLI")) {
-        results.append(WeightedPhaseLagIndex::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("WPLI")
+                                   : WeightedPhaseLagIndex::calculate(connectivitySettings));
     }
 
     if(lMethods.contains("USPLI")) {
-        results.append(UnbiasedSquaredPhaseLagIndex::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("USPLI")
+                                   : UnbiasedSquaredPhaseLagIndex::calculate(connectivitySettings));
     }
 
     if(lMethods.contains("COR")) {
@@ -108,27 +202,216 @@ QList<Network> Connectivity::calculate(ConnectivitySettings& connectivitySetting
     }
 
     if(lMethods.contains("PLI")) {
-        results.append(PhaseLagIndex::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("PLI")
+                                   : PhaseLagIndex::calculate(connectivitySettings));
     }
 
     if(lMethods.contains("COH")) {
-        results.append(Coherence::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("COH")
+                                   : Coherence::calculate(connectivitySettings));
     }
 
     if(lMethods.contains("IMAGCOH")) {
-        results.append(ImagCoherence::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("IMAGCOH")
+                                   : ImagCoherence::calculate(connectivitySettings));
     }
 
     if(lMethods.contains("PLV")) {
-        results.append(PhaseLockingValue::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("PLV")
+                                   : PhaseLockingValue::calculate(connectivitySettings));
     }
 
     if(lMethods.contains("DSWPLI")) {
-        results.append(DebiasedSquaredWeightedPhaseLagIndex::calculate(connectivitySettings));
+        results.append(bSinglePass ? hashSinglePassResults.value("DSWPLI")
+                                   : DebiasedSquaredWeightedPhaseLagIndex::calculate(connectivitySettings));
     }
 
     qWarning() << "Total" << timer.elapsed();
     qDebug() << "Connectivity::calculateMultiMethods - Calculated"<< lMethods <<"for" << connectivitySettings.size() << "trials in"<< timer.elapsed() << "msecs.";
 
+    // Do not keep the shared spectra to save memory
+    if((bShareSpectra || bSinglePass) && !AbstractMetric::m_bStorageModeIsActive && !connectivitySettings.isStreamingModeActive()) {
+        connectivitySettings.clearIntermediateData();
+    }
+
+    // In streaming mode the trials were folded into the running sums and are not needed anymore
+    if(connectivitySettings.isStreamingModeActive()) {
+        connectivitySettings.clearTrialData();
+    }
+
     return results;
 }
+
+//=============================================================================================================
+
+void Connectivity::computeIntermediateData(ConnectivitySettings::IntermediateTrialData& inputData,
+                                           ConnectivitySettings::IntermediateSumData& sumData,
+                                           QMutex& mutex,
+                                           const QStringList& lMethods,
+                                           const QVector<QVector<int> >& vecPairPartners,
+                                           const QPair<int,int>& pairBins,
+                                           int iNfft,
+                                           const QPair<MatrixXd, VectorXd>& tapers,
+                                           bool bStoreIntermediateData)
+{
+    int iNRows = vecPairPartners.size();
+
+    // Only compute what was not already computed for this trial, e.g. in storage mode
+    bool bComputeCsd = inputData.vecPairCsd.size() != iNRows;
+    bool bComputeNormalized = lMethods.contains("PLV") && inputData.vecPairCsdNormalized.size() != iNRows;
+    bool bComputeImagSign = (lMethods.contains("PLI") || lMethods.contains("USPLI")) && inputData.vecPairCsdImagSign.size() != iNRows;
+    bool bComputeImagAbs = (lMethods.contains("WPLI") || lMethods.contains("DSWPLI")) && inputData.vecPairCsdImagAbs.size() != iNRows;
+    bool bComputeImagSqrd = lMethods.contains("DSWPLI") && inputData.vecPairCsdImagSqrd.size() != iNRows;
+    bool bComputePsd = (lMethods.contains("COH") || lMethods.contains("IMAGCOH")) && inputData.matPsd.rows() != iNRows;
+
+    if(!bComputeCsd && !bComputeNormalized && !bComputeImagSign && !bComputeImagAbs && !bComputeImagSqrd && !bComputePsd) {
+        return;
+    }
+
+    // Calculate tapered spectra if not available already
+    bool bComputedSpectra = inputData.vecTapSpectra.size() != inputData.matData.rows();
+
+    AbstractMetric::computeTaperedSpectra(inputData, iNfft, tapers);
+
+    if(bComputePsd) {
+        AbstractMetric::computePsd(inputData, pairBins, iNfft, tapers);
+    }
+
+    if(bComputeCsd) {
+        AbstractMetric::computeCsd(inputData, vecPairPartners, pairBins, iNfft, tapers);
+    }
+
+    // Derive all requested terms from the CSD in one pass
+    if(bComputeNormalized) {
+        inputData.vecPairCsdNormalized.clear();
+    }
+    if(bComputeImagSign) {
+        inputData.vecPairCsdImagSign.clear();
+    }
+    if(bComputeImagAbs) {
+        inputData.vecPairCsdImagAbs.clear();
+    }
+    if(bComputeImagSqrd) {
+        inputData.vecPairCsdImagSqrd.clear();
+    }
+
+    if(bComputeNormalized || bComputeImagSign || bComputeImagAbs || bComputeImagSqrd) {
+        MatrixXd matCsdImag;
+
+        for (int i = 0; i < iNRows; ++i) {
+            const MatrixXcd& matCsd = inputData.vecPairCsd.at(i).second;
+
+            if(bComputeNormalized) {
+                inputData.vecPairCsdNormalized.append(QPair<int,MatrixXcd>(i,matCsd.cwiseQuotient(matCsd.cwiseAbs())));
+            }
+
+            matCsdImag = matCsd.imag();
+
+            if(bComputeImagSign) {
+                inputData.vecPairCsdImagSign.append(QPair<int,MatrixXd>(i,matCsdImag.cwiseSign()));
+            }
+            if(bComputeImagAbs) {
+                inputData.vecPairCsdImagAbs.append(QPair<int,MatrixXd>(i,matCsdImag.cwiseAbs()));
+            }
+            if(bComputeImagSqrd) {
+                inputData.vecPairCsdImagSqrd.append(QPair<int,MatrixXd>(i,matCsdImag.array().square()));
+            }
+        }
+    }
+
+    // Reduce everything which was newly computed for this trial at once
+    mutex.lock();
+
+    if(bComputePsd) {
+        if(sumData.matPsdSum.rows() == 0 || sumData.matPsdSum.cols() == 0) {
+            sumData.matPsdSum = inputData.dWeight * inputData.matPsd;
+        } else {
+            sumData.matPsdSum += inputData.dWeight * inputData.matPsd;
+        }
+    }
+    if(bComputeCsd) {
+        AbstractMetric::addWeighted(sumData.vecPairCsdSum, inputData.vecPairCsd, inputData.dWeight);
+    }
+    if(bComputeNormalized) {
+        AbstractMetric::addWeighted(sumData.vecPairCsdNormalizedSum, inputData.vecPairCsdNormalized, inputData.dWeight);
+    }
+    if(bComputeImagSign) {
+        AbstractMetric::addWeighted(sumData.vecPairCsdImagSignSum, inputData.vecPairCsdImagSign, inputData.dWeight);
+    }
+    if(bComputeImagAbs) {
+        AbstractMetric::addWeighted(sumData.vecPairCsdImagAbsSum, inputData.vecPairCsdImagAbs, inputData.dWeight);
+    }
+    if(bComputeImagSqrd) {
+        AbstractMetric::addWeighted(sumData.vecPairCsdImagSqrdSum, inputData.vecPairCsdImagSqrd, inputData.dWeight * inputData.dWeight);
+    }
+
+    mutex.unlock();
+
+    if(!bStoreIntermediateData) {
+        inputData.matPsd.resize(0,0);
+        inputData.vecPairCsd.clear();
+        inputData.vecPairCsdNormalized.clear();
+        inputData.vecPairCsdImagSign.clear();
+        inputData.vecPairCsdImagAbs.clear();
+        inputData.vecPairCsdImagSqrd.clear();
+
+        if(bComputedSpectra) {
+            inputData.vecTapSpectra.clear();
+        }
+    }
+}
+
+//=============================================================================================================
+
+Network Connectivity::calculateFromSums(const QString& sMethod,
+                                        ConnectivitySettings& connectivitySettings,
+                                        const QVector<QVector<int> >& vecPairPartners,
+                                        const QPair<int,int>& pairBins)
+{
+    Network finalNetwork(sMethod);
+
+    finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
+
+    //Create nodes
+    int iNRows = connectivitySettings.at(0).matData.rows();
+    RowVectorXf rowVert = RowVectorXf::Zero(3);
+
+    for(int i = 0; i < iNRows; ++i) {
+        rowVert = RowVectorXf::Zero(3);
+
+        if(connectivitySettings.getNodePositions().rows() != 0 && i < connectivitySettings.getNodePositions().rows()) {
+            rowVert(0) = connectivitySettings.getNodePositions().row(i)(0);
+            rowVert(1) = connectivitySettings.getNodePositions().row(i)(1);
+            rowVert(2) = connectivitySettings.getNodePositions().row(i)(2);
+        }
+
+        finalNetwork.append(NetworkNode::SPtr(new NetworkNode(i, rowVert)));
+    }
+
+    // Pass information about the FFT length. Use iNFreqs because we only use the half spectrum
+    int iNFreqs = int(floor(connectivitySettings.getFFTSize() / 2.0)) + 1;
+
+    finalNetwork.setFFTSize(iNFreqs);
+    finalNetwork.setFirstFreqBin(pairBins.first);
+    finalNetwork.setUsedFreqBins(pairBins.second);
+
+    if(sMethod == "PLV") {
+        PhaseLockingValue::computePLV(connectivitySettings, finalNetwork, vecPairPartners);
+    } else if(sMethod == "PLI") {
+        PhaseLagIndex::computePLI(connectivitySettings, finalNetwork, vecPairPartners);
+    } else if(sMethod == "USPLI") {
+        UnbiasedSquaredPhaseLagIndex::computeUSPLI(connectivitySettings, finalNetwork, vecPairPartners);
+    } else if(sMethod == "WPLI") {
+        WeightedPhaseLagIndex::computeWPLI(connectivitySettings, finalNetwork, vecPairPartners);
+    } else if(sMethod == "DSWPLI") {
+        DebiasedSquaredWeightedPhaseLagIndex::computeDSWPLI(connectivitySettings, finalNetwork, vecPairPartners);
+    } else if(sMethod == "COH") {
+        Coherency::computeCoherencyAbs(finalNetwork, connectivitySettings, vecPairPartners);
+    } else if(sMethod == "IMAGCOH") {
+        Coherency::computeCoherencyImag(finalNetwork, connectivitySettings, vecPairPartners);
+    } else {
+        qWarning() << "Connectivity::calculateFromSums - Unknown method" << sMethod;
+    }
+
+    return finalNetwork;
+}
@@ -40,12 +40,14 @@
 //=============================================================================================================
 
 #include "connectivity_global.h"
+#include "connectivitysettings.h"
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QMutex>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -67,7 +69,6 @@ namespace CONNECTIVITYLIB {
 // CONNECTIVITYLIB FORWARD DECLARATIONS
 //=============================================================================================================
 
-class ConnectivitySettings;
 class Network;
 
 //=============================================================================================================
@@ -98,6 +99,46 @@ public:
     static QList<Network> calculate(ConnectivitySettings& connectivitySettings);
 
 protected:
+    //=========================================================================================================
+    /**
+     * Computes all intermediate data of one trial needed by the requested CSD based metrics and adds it to the
+     * sums. This function gets called in parallel.
+     *
+     * @param[in] inputData                  The input data.
+     * @param[out] sumData                   The intermediate sum data.
+     * @param[in] mutex                      The mutex used to safely access sumData.
+     * @param[in] lMethods                   The requested connectivity methods.
+     * @param[in] vecPairPartners            The partners j > i per node i.
+     * @param[in] pairBins                   The first frequency bin and the number of bins.
+     * @param[in] iNfft                      The FFT length.
+     * @param[in] tapers                     The taper information.
+     * @param[in] bStoreIntermediateData     Whether to keep the intermediate trial data after adding it to the sums.
+     */
+    static void computeIntermediateData(ConnectivitySettings::IntermediateTrialData& inputData,
+                                        ConnectivitySettings::IntermediateSumData& sumData,
+                                        QMutex& mutex,
+                                        const QStringList& lMethods,
+                                        const QVector<QVector<int> >& vecPairPartners,
+                                        const QPair<int,int>& pairBins,
+                                        int iNfft,
+                                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers,
+                                        bool bStoreIntermediateData);
+
+    //=========================================================================================================
+    /**
+     * Creates the network of a CSD based metric from the intermediate sum data.
+     *
+     * @param[in] sMethod                    The connectivity method.
+     * @param[in] connectivitySettings       The input data and parameters.
+     * @param[in] vecPairPartners            The partners j > i per node i.
+     * @param[in] pairBins                   The first frequency bin and the number of bins.
+     *
+     * @return The connectivity information in form of a network structure.
+     */
+    static Network calculateFromSums(const QString& sMethod,
+                                     ConnectivitySettings& connectivitySettings,
+                                     const QVector<QVector<int> >& vecPairPartners,
+                                     const QPair<int,int>& pairBins);
 };
 
 //=============================================================================================================
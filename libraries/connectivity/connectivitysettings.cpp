@@ -49,6 +49,13 @@
 #include <QCommandLineParser>
 #include <QElapsedTimer>
 #include <QDebug>
+#include <QtMath>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -76,6 +83,11 @@ ConnectivitySettings::ConnectivitySettings()
 : m_fFreqResolution(1.0f)
 , m_fSFreq(1000.0f)
 , m_sWindowType("hanning")
+, m_iBinStart(-1)
+, m_iBinAmount(-1)
+, m_bStreamingModeIsActive(false)
+, m_dDecayFactor(0.9)
+, m_iNumberUndecayedTrials(0)
 {
     m_iNfft = int(m_fSFreq/m_fFreqResolution);
     qRegisterMetaType<CONNECTIVITYLIB::ConnectivitySettings>("CONNECTIVITYLIB::ConnectivitySettings");
@@ -92,12 +104,14 @@ void ConnectivitySettings::clearAllData()
 
 //*******************************************************************************************************
 
-void ConnectivitySettings::clearIntermediateData() 
+void ConnectivitySettings::clearIntermediateData(bool bClearTaperedSpectra)
 {
     for (int i = 0; i < m_trialData.size(); ++i) {
         m_trialData[i].matPsd.resize(0,0);
         m_trialData[i].vecPairCsd.clear();
-        m_trialData[i].vecTapSpectra.clear();
+        if(bClearTaperedSpectra) {
+            m_trialData[i].vecTapSpectra.clear();
+        }
         m_trialData[i].vecPairCsdNormalized.clear();
         m_trialData[i].vecPairCsdImagSign.clear();
         m_trialData[i].vecPairCsdImagAbs.clear();
@@ -110,6 +124,11 @@ void ConnectivitySettings::clearIntermediateData()
     m_intermediateSumData.vecPairCsdImagSignSum.clear();
     m_intermediateSumData.vecPairCsdImagAbsSum.clear();
     m_intermediateSumData.vecPairCsdImagSqrdSum.clear();
+    m_intermediateSumData.dWeightSum = 0.0;
+    m_intermediateSumData.dSquaredWeightSum = 0.0;
+
+    // The remaining trials need to be accounted for again once they are folded into the sums
+    m_iNumberUndecayedTrials = m_trialData.size();
 }
 
 //*******************************************************************************************************
@@ -128,14 +147,25 @@ void ConnectivitySettings::append(const MatrixXd& matInputData)
     ConnectivitySettings::IntermediateTrialData tempData;
     tempData.matData = matInputData;
 
-    m_trialData.append(tempData);
+    this->append(tempData);
 }
 
 //*******************************************************************************************************
 
 void ConnectivitySettings::append(const ConnectivitySettings::IntermediateTrialData& inputData)
 {
-    m_trialData.append(inputData);
+    if(m_bStreamingModeIsActive) {
+        // Age the trials which were not folded into the running sums yet
+        for(int i = 0; i < m_trialData.size(); ++i) {
+            m_trialData[i].dWeight *= m_dDecayFactor;
+        }
+
+        m_trialData.append(inputData);
+        m_trialData.last().dWeight = 1.0;
+        ++m_iNumberUndecayedTrials;
+    } else {
+        m_trialData.append(inputData);
+    }
 }
 
 //*******************************************************************************************************
@@ -339,6 +369,158 @@ const QString& ConnectivitySettings::getWindowType() const
 
 //*******************************************************************************************************
 
+void ConnectivitySettings::setFrequencyBins(int iBinStart, int iBinAmount)
+{
+    // The CSD matrices only hold the requested bins
+    clearIntermediateData(false);
+
+    m_lFrequencyBands.clear();
+    m_iBinStart = iBinStart;
+    m_iBinAmount = iBinAmount;
+}
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setFrequencyBands(const QList<QPair<float,float> >& lFrequencyBands)
+{
+    clearIntermediateData(false);
+
+    m_iBinStart = -1;
+    m_iBinAmount = -1;
+    m_lFrequencyBands = lFrequencyBands;
+}
+
+//*******************************************************************************************************
+
+const QList<QPair<float,float> >& ConnectivitySettings::getFrequencyBands() const
+{
+    return m_lFrequencyBands;
+}
+
+//*******************************************************************************************************
+
+QPair<int,int> ConnectivitySettings::getFrequencyBins() const
+{
+    int iNFreqs = int(floor(m_iNfft / 2.0)) + 1;
+    int iBinStart = m_iBinStart;
+    int iBinAmount = m_iBinAmount;
+
+    if(!m_lFrequencyBands.isEmpty() && m_fSFreq <= 0.0f) {
+        qWarning() << "ConnectivitySettings::getFrequencyBins - Frequency bands are set but the sampling frequency is not. Ignoring the frequency bands.";
+    }
+
+    if(!m_lFrequencyBands.isEmpty() && m_fSFreq > 0.0f) {
+        double dFreqResolution = double(m_fSFreq) / m_iNfft;
+        int iBinEnd = -1;
+        iBinStart = iNFreqs;
+
+        for(int i = 0; i < m_lFrequencyBands.size(); ++i) {
+            iBinStart = qMin(iBinStart, int(floor(m_lFrequencyBands.at(i).first / dFreqResolution)));
+            iBinEnd = qMax(iBinEnd, int(ceil(m_lFrequencyBands.at(i).second / dFreqResolution)));
+        }
+
+        iBinStart = qMax(iBinStart, 0);
+        iBinAmount = qMin(iBinEnd, iNFreqs - 1) - iBinStart + 1;
+    }
+
+    if(iBinStart < 0 ||
+       iBinAmount <= 0 ||
+       iBinStart + iBinAmount > iNFreqs) {
+        return QPair<int,int>(0, iNFreqs);
+    }
+
+    return QPair<int,int>(iBinStart, iBinAmount);
+}
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setNodePairs(const QList<QPair<int,int> >& lNodePairs)
+{
+    // The CSD matrices only hold rows for the requested pairs
+    clearIntermediateData(false);
+
+    m_lNodePairs = lNodePairs;
+}
+
+//*******************************************************************************************************
+
+const QList<QPair<int,int> >& ConnectivitySettings::getNodePairs() const
+{
+    return m_lNodePairs;
+}
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setSeedNodes(const QVector<int>& vecSeedNodes)
+{
+    clearIntermediateData(false);
+
+    m_vecSeedNodes = vecSeedNodes;
+}
+
+//*******************************************************************************************************
+
+const QVector<int>& ConnectivitySettings::getSeedNodes() const
+{
+    return m_vecSeedNodes;
+}
+
+//*******************************************************************************************************
+
+QVector<QVector<int> > ConnectivitySettings::getPairPartners(int iNumberNodes) const
+{
+    QVector<QVector<int> > vecPairPartners(iNumberNodes);
+    int i, j;
+
+    if(m_lNodePairs.isEmpty() && m_vecSeedNodes.isEmpty()) {
+        for(i = 0; i < iNumberNodes; ++i) {
+            vecPairPartners[i].reserve(iNumberNodes - i - 1);
+
+            for(j = i + 1; j < iNumberNodes; ++j) {
+                vecPairPartners[i].append(j);
+            }
+        }
+
+        return vecPairPartners;
+    }
+
+    QVector<bool> vecIsSeed(iNumberNodes, false);
+
+    for(i = 0; i < m_vecSeedNodes.size(); ++i) {
+        if(m_vecSeedNodes.at(i) >= 0 && m_vecSeedNodes.at(i) < iNumberNodes) {
+            vecIsSeed[m_vecSeedNodes.at(i)] = true;
+        }
+    }
+
+    for(i = 0; i < iNumberNodes; ++i) {
+        for(j = i + 1; j < iNumberNodes; ++j) {
+            if(vecIsSeed.at(i) || vecIsSeed.at(j)) {
+                vecPairPartners[i].append(j);
+            }
+        }
+    }
+
+    for(i = 0; i < m_lNodePairs.size(); ++i) {
+        int iFirst = qMin(m_lNodePairs.at(i).first, m_lNodePairs.at(i).second);
+        int iSecond = qMax(m_lNodePairs.at(i).first, m_lNodePairs.at(i).second);
+
+        if(iFirst < 0 || iSecond >= iNumberNodes || iFirst == iSecond) {
+            continue;
+        }
+
+        vecPairPartners[iFirst].append(iSecond);
+    }
+
+    for(i = 0; i < iNumberNodes; ++i) {
+        std::sort(vecPairPartners[i].begin(), vecPairPartners[i].end());
+        vecPairPartners[i].erase(std::unique(vecPairPartners[i].begin(), vecPairPartners[i].end()), vecPairPartners[i].end());
+    }
+
+    return vecPairPartners;
+}
+
+//*******************************************************************************************************
+
 void ConnectivitySettings::setNodePositions(const FiffInfo& fiffInfo,
                                             const RowVectorXi& picks)
 {
@@ -416,3 +598,118 @@ ConnectivitySettings::IntermediateSumData& ConnectivitySettings::getIntermediate
 {
     return m_intermediateSumData;
 }
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setStreamingModeActive(bool bStreamingModeIsActive)
+{
+    if(m_bStreamingModeIsActive == bStreamingModeIsActive) {
+        return;
+    }
+
+    clearAllData();
+
+    m_bStreamingModeIsActive = bStreamingModeIsActive;
+}
+
+//*******************************************************************************************************
+
+bool ConnectivitySettings::isStreamingModeActive() const
+{
+    return m_bStreamingModeIsActive;
+}
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setDecayFactor(double dDecayFactor)
+{
+    // A factor of 0 would zero the weight sums the metrics are normalized with
+    if(!(dDecayFactor > 0.0 && dDecayFactor <= 1.0)) {
+        qWarning() << "ConnectivitySettings::setDecayFactor - Decay factor" << dDecayFactor << "is not in (0,1]. Returning.";
+        return;
+    }
+
+    m_dDecayFactor = dDecayFactor;
+}
+
+//*******************************************************************************************************
+
+double ConnectivitySettings::getDecayFactor() const
+{
+    return m_dDecayFactor;
+}
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::decayIntermediateSumData()
+{
+    if(!m_bStreamingModeIsActive || m_iNumberUndecayedTrials <= 0) {
+        return;
+    }
+
+    // Every new trial ages the running sums once. The squared imaginary CSD enters the sums with squared
+    // weights, see DebiasedSquaredWeightedPhaseLagIndex, and therefore decays with the squared factor.
+    double dDecay = qPow(m_dDecayFactor, m_iNumberUndecayedTrials);
+    double dSquaredDecay = dDecay * dDecay;
+    int i;
+
+    if(dDecay != 1.0) {
+        m_intermediateSumData.matPsdSum *= dDecay;
+
+        for(i = 0; i < m_intermediateSumData.vecPairCsdSum.size(); ++i) {
+            m_intermediateSumData.vecPairCsdSum[i].second *= dDecay;
+        }
+        for(i = 0; i < m_intermediateSumData.vecPairCsdNormalizedSum.size(); ++i) {
+            m_intermediateSumData.vecPairCsdNormalizedSum[i].second *= dDecay;
+        }
+        for(i = 0; i < m_intermediateSumData.vecPairCsdImagSignSum.size(); ++i) {
+            m_intermediateSumData.vecPairCsdImagSignSum[i].second *= dDecay;
+        }
+        for(i = 0; i < m_intermediateSumData.vecPairCsdImagAbsSum.size(); ++i) {
+            m_intermediateSumData.vecPairCsdImagAbsSum[i].second *= dDecay;
+        }
+        for(i = 0; i < m_intermediateSumData.vecPairCsdImagSqrdSum.size(); ++i) {
+            m_intermediateSumData.vecPairCsdImagSqrdSum[i].second *= dSquaredDecay;
+        }
+    }
+
+    m_intermediateSumData.dWeightSum *= dDecay;
+    m_intermediateSumData.dSquaredWeightSum *= dSquaredDecay;
+
+    for(i = qMax(0, m_trialData.size() - m_iNumberUndecayedTrials); i < m_trialData.size(); ++i) {
+        m_intermediateSumData.dWeightSum += m_trialData.at(i).dWeight;
+        m_intermediateSumData.dSquaredWeightSum += m_trialData.at(i).dWeight * m_trialData.at(i).dWeight;
+    }
+
+    m_iNumberUndecayedTrials = 0;
+}
+
+//*******************************************************************************************************
+
+double ConnectivitySettings::getTrialWeightSum() const
+{
+    if(m_bStreamingModeIsActive) {
+        return m_intermediateSumData.dWeightSum;
+    }
+
+    return double(m_trialData.size());
+}
+
+//*******************************************************************************************************
+
+double ConnectivitySettings::getSquaredTrialWeightSum() const
+{
+    if(m_bStreamingModeIsActive) {
+        return m_intermediateSumData.dSquaredWeightSum;
+    }
+
+    return double(m_trialData.size());
+}
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::clearTrialData()
+{
+    m_trialData.clear();
+    m_iNumberUndecayedTrials = 0;
+}
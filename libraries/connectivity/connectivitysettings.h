@@ -49,6 +49,7 @@
 #include <QSharedPointer>
 #include <QStringList>
 #include <QVector>
+#include <QPair>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -104,6 +105,7 @@ public:
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSign;
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagAbs;
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSqrd;
+        double                                  dWeight = 1.0;          /**< The weight the trial enters the sums with. Only differs from 1 in streaming mode. */
     };
 
     struct IntermediateSumData {
@@ -113,6 +115,8 @@ public:
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSignSum;
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagAbsSum;
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSqrdSum;
+        double                                  dWeightSum = 0.0;           /**< The sum of all trial weights. Only used in streaming mode. */
+        double                                  dSquaredWeightSum = 0.0;    /**< The sum of all squared trial weights. Only used in streaming mode. */
     };
 
     //=========================================================================================================
@@ -123,7 +127,7 @@ public:
 
     void clearAllData();
 
-    void clearIntermediateData();
+    void clearIntermediateData(bool bClearTaperedSpectra = true);
 
     void append(const QList<Eigen::MatrixXd>& matInputData);
 
@@ -157,6 +161,84 @@ public:
 
     const QString& getWindowType() const;
 
+    //=========================================================================================================
+    /**
+     * Restricts the computation to a contiguous range of frequency bins of the half spectrum. Clears any
+     * previously set frequency bands.
+     *
+     * @param[in] iBinStart      The first bin. -1 selects the full spectrum.
+     * @param[in] iBinAmount     The number of bins. -1 selects the full spectrum.
+     */
+    void setFrequencyBins(int iBinStart, int iBinAmount);
+
+    //=========================================================================================================
+    /**
+     * Restricts the computation to the bins covering all given frequency bands. The bins are resolved against
+     * the sampling frequency and FFT length at computation time. Clears any previously set frequency bins.
+     * The bands are merged into one contiguous bin range from the lowest to the highest band edge, i.e. the bins
+     * between separate bands are computed as well and the network weights are averaged over the whole range.
+     * Compute one network per band if the bands need to be kept apart. Without a sampling frequency the bands are
+     * ignored.
+     *
+     * @param[in] lFrequencyBands     The frequency bands in Hz given as (lower, upper) pairs.
+     */
+    void setFrequencyBands(const QList<QPair<float,float> >& lFrequencyBands);
+
+    //=========================================================================================================
+    /**
+     * @return The frequency bands in Hz set via setFrequencyBands.
+     */
+    const QList<QPair<float,float> >& getFrequencyBands() const;
+
+    //=========================================================================================================
+    /**
+     * Resolves the requested frequency bins against the current FFT length. Falls back to the full half
+     * spectrum if nothing or an invalid range was requested.
+     *
+     * @return The first bin and the number of bins to compute.
+     */
+    QPair<int,int> getFrequencyBins() const;
+
+    //=========================================================================================================
+    /**
+     * Restricts the computation to the given node pairs. Pairs are undirected. Together with the seed nodes
+     * an empty selection means that all pairs are computed.
+     *
+     * @param[in] lNodePairs     The node pairs.
+     */
+    void setNodePairs(const QList<QPair<int,int> >& lNodePairs);
+
+    //=========================================================================================================
+    /**
+     * @return The node pairs set via setNodePairs.
+     */
+    const QList<QPair<int,int> >& getNodePairs() const;
+
+    //=========================================================================================================
+    /**
+     * Restricts the computation to the pairs between the given seed nodes and all other nodes.
+     *
+     * @param[in] vecSeedNodes     The seed nodes.
+     */
+    void setSeedNodes(const QVector<int>& vecSeedNodes);
+
+    //=========================================================================================================
+    /**
+     * @return The seed nodes set via setSeedNodes.
+     */
+    const QVector<int>& getSeedNodes() const;
+
+    //=========================================================================================================
+    /**
+     * Resolves the requested node pairs and seed nodes. Entry i holds the sorted partners j > i node i is
+     * paired with. The per node CSD matrices store one row per partner in this order.
+     *
+     * @param[in] iNumberNodes     The number of nodes.
+     *
+     * @return The partners per node.
+     */
+    QVector<QVector<int> > getPairPartners(int iNumberNodes) const;
+
     void setNodePositions(const FIFFLIB::FiffInfo& fiffInfo,
                           const Eigen::RowVectorXi& picks);
 
@@ -171,6 +253,64 @@ public:
 
     IntermediateSumData& getIntermediateSumData();
 
+    //=========================================================================================================
+    /**
+     * Sets the streaming mode. In streaming mode the CSD based metrics (COH, IMAGCOH, PLV, PLI, WPLI, USPLI
+     * and DSWPLI) only keep exponentially decayed running sums. Every appended trial is folded into the sums
+     * once and dropped afterwards, so memory does not grow with the number of trials. Toggling the mode clears
+     * all data.
+     *
+     * @param[in] bStreamingModeIsActive     Whether the streaming mode should be active.
+     */
+    void setStreamingModeActive(bool bStreamingModeIsActive);
+
+    //=========================================================================================================
+    /**
+     * @return Whether the streaming mode is active.
+     */
+    bool isStreamingModeActive() const;
+
+    //=========================================================================================================
+    /**
+     * Sets the factor the running sums are multiplied with for every new trial in streaming mode. A factor of
+     * 1 - 1/N corresponds to an effective memory of roughly N trials.
+     *
+     * @param[in] dDecayFactor     The decay factor in the range (0,1]. Other values are rejected.
+     */
+    void setDecayFactor(double dDecayFactor);
+
+    //=========================================================================================================
+    /**
+     * @return The decay factor used in streaming mode.
+     */
+    double getDecayFactor() const;
+
+    //=========================================================================================================
+    /**
+     * Decays the running sums once for every trial appended since the last call and adds the weights of those
+     * trials to the weight sums. Does nothing outside of streaming mode or if no new trials were appended.
+     */
+    void decayIntermediateSumData();
+
+    //=========================================================================================================
+    /**
+     * @return The sum of all trial weights, i.e. the number of trials outside of streaming mode.
+     */
+    double getTrialWeightSum() const;
+
+    //=========================================================================================================
+    /**
+     * @return The sum of all squared trial weights, i.e. the number of trials outside of streaming mode.
+     */
+    double getSquaredTrialWeightSum() const;
+
+    //=========================================================================================================
+    /**
+     * Removes all trials but keeps the intermediate sum data. Used in streaming mode once the trials were
+     * folded into the running sums.
+     */
+    void clearTrialData();
+
 protected:
     QStringList                     m_sConnectivityMethods;         /**< The connectivity methods. */
     QString                         m_sWindowType;                  /**< The window type used to compute tapered spectra. */
@@ -179,6 +319,17 @@ protected:
     int                             m_iNfft;                        /**< The FFT length. Also includes the negativ frequencies. Gets recalculated if the sFreq or spectrum resolution change. */
     float                           m_fFreqResolution;              /**< The spectrum's resolution. */
 
+    int                             m_iBinStart;                    /**< The first requested frequency bin. -1 for the full spectrum. */
+    int                             m_iBinAmount;                   /**< The number of requested frequency bins. -1 for the full spectrum. */
+    QList<QPair<float,float> >      m_lFrequencyBands;              /**< The requested frequency bands in Hz. Take precedence over the bin range. */
+
+    QList<QPair<int,int> >          m_lNodePairs;                   /**< The requested node pairs. */
+    QVector<int>                    m_vecSeedNodes;                 /**< The requested seed nodes. */
+
+    bool                            m_bStreamingModeIsActive;       /**< Whether only decayed running sums are kept. */
+    double                          m_dDecayFactor;                 /**< The decay factor applied to the running sums per new trial. */
+    int                             m_iNumberUndecayedTrials;       /**< The number of trials appended since the running sums were last decayed. */
+
     Eigen::MatrixX3f                m_matNodePositions;             /**< The node position in 3D space. */
 
     IntermediateSumData             m_intermediateSumData;          /**< The intermediate sum data holds data calculated over all trials as a whole. */
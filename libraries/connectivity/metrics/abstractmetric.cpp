@@ -46,19 +46,20 @@
 // EIGEN INCLUDES
 //=============================================================================================================
 
+#include <unsupported/Eigen/FFT>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace CONNECTIVITYLIB;
+using namespace Eigen;
 
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
 bool AbstractMetric::m_bStorageModeIsActive = false;
-int AbstractMetric::m_iNumberBinStart = -1;
-int AbstractMetric::m_iNumberBinAmount = -1;
 
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -68,3 +69,129 @@ AbstractMetric::AbstractMetric()
 {
 }
 
+//=============================================================================================================
+
+void AbstractMetric::computeTaperedSpectra(ConnectivitySettings::IntermediateTrialData& inputData,
+                                           int iNfft,
+                                           const QPair<MatrixXd, VectorXd>& tapers)
+{
+    int iNRows = inputData.matData.rows();
+
+    if(inputData.vecTapSpectra.size() == iNRows) {
+        return;
+    }
+
+    inputData.vecTapSpectra.clear();
+    inputData.vecTapSpectra.reserve(iNRows);
+
+    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+
+    RowVectorXd vecInputFFT, rowData;
+    RowVectorXcd vecTmpFreq;
+
+    MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
+
+    FFT<double> fft;
+    fft.SetFlag(fft.HalfSpectrum);
+
+    int i,j;
+
+    for (i = 0; i < iNRows; ++i) {
+        // Substract mean
+        rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
+
+        for(j = 0; j < tapers.first.rows(); j++) {
+            // Zero padd if necessary. The zero padding in Eigen's FFT is only working for column vectors.
+            if (rowData.cols() < iNfft) {
+                vecInputFFT.setZero(iNfft);
+                vecInputFFT.block(0,0,1,rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));
+            } else {
+                vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
+            }
+
+            // FFT for freq domain returning the half spectrum and multiply taper weights
+            fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
+            matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
+        }
+
+        inputData.vecTapSpectra.append(matTapSpectrum);
+    }
+}
+
+//=============================================================================================================
+
+void AbstractMetric::computePsd(ConnectivitySettings::IntermediateTrialData& inputData,
+                                const QPair<int,int>& pairBins,
+                                int iNfft,
+                                const QPair<MatrixXd, VectorXd>& tapers)
+{
+    int iNRows = inputData.vecTapSpectra.size();
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+
+    double denomPSD = tapers.second.cwiseAbs2().sum() / 2.0;
+
+    inputData.matPsd = MatrixXd(iNRows, pairBins.second);
+
+    for (int i = 0; i < iNRows; ++i) {
+        // Compute PSD (average over tapers if necessary)
+        inputData.matPsd.row(i) = inputData.vecTapSpectra.at(i).middleCols(pairBins.first, pairBins.second).cwiseAbs2().colwise().sum() / denomPSD;
+    }
+
+    // Divide first and last element by 2 due to half spectrum
+    if(pairBins.first == 0) {
+        inputData.matPsd.col(0) /= 2.0;
+    }
+
+    if(iNfft % 2 == 0 && pairBins.first + pairBins.second >= iNFreqs) {
+        inputData.matPsd.rightCols(1) /= 2.0;
+    }
+}
+
+//=============================================================================================================
+
+void AbstractMetric::computeCsd(ConnectivitySettings::IntermediateTrialData& inputData,
+                                const QVector<QVector<int> >& vecPairPartners,
+                                const QPair<int,int>& pairBins,
+                                int iNfft,
+                                const QPair<MatrixXd, VectorXd>& tapers)
+{
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+    int iBinStart = pairBins.first;
+    int iBinAmount = pairBins.second;
+
+    // Divide first and last element by 2 due to half spectrum
+    bool bHalveFirst = iBinStart == 0;
+    bool bHalveLast = iNfft % 2 == 0 && iBinStart + iBinAmount >= iNFreqs;
+
+    double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
+
+    inputData.vecPairCsd.clear();
+    inputData.vecPairCsd.reserve(vecPairPartners.size());
+
+    int i,k;
+
+    for (i = 0; i < vecPairPartners.size(); ++i) {
+        const QVector<int>& vecPartners = vecPairPartners.at(i);
+        MatrixXcd matCsd(vecPartners.size(), iBinAmount);
+
+        if(!vecPartners.isEmpty()) {
+            const MatrixXcd matTapSpectrumI = inputData.vecTapSpectra.at(i).middleCols(iBinStart, iBinAmount);
+
+            for (k = 0; k < vecPartners.size(); ++k) {
+                // Compute CSD (average over tapers if necessary)
+                matCsd.row(k) = matTapSpectrumI.cwiseProduct(inputData.vecTapSpectra.at(vecPartners.at(k)).middleCols(iBinStart, iBinAmount).conjugate()).colwise().sum() / denomCSD;
+            }
+
+            if(bHalveFirst) {
+                matCsd.col(0) /= 2.0;
+            }
+
+            if(bHalveLast) {
+                matCsd.rightCols(1) /= 2.0;
+            }
+        }
+
+        inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,matCsd));
+    }
+}
@@ -40,6 +40,7 @@
 //=============================================================================================================
 
 #include "../connectivity_global.h"
+#include "../connectivitysettings.h"
 
 //=============================================================================================================
 // QT INCLUDES
@@ -47,6 +48,7 @@
 
 #include <QSharedPointer>
 #include <QVector>
+#include <QPair>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -88,15 +90,90 @@ public:
     explicit AbstractMetric();
 
     static bool     m_bStorageModeIsActive;
-    static int      m_iNumberBinStart;
-    static int      m_iNumberBinAmount;
 
-protected:
+    //=========================================================================================================
+    /**
+     * Computes the tapered spectra (half spectrum) of all nodes of one trial if they are not available yet.
+     * The spectra can be shared between all frequency domain based metrics.
+     *
+     * @param[in, out] inputData      The trial data. The spectra are stored in vecTapSpectra.
+     * @param[in] iNfft               The FFT length.
+     * @param[in] tapers              The tapers and their weights.
+     */
+    static void computeTaperedSpectra(ConnectivitySettings::IntermediateTrialData& inputData,
+                                      int iNfft,
+                                      const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+
+    //=========================================================================================================
+    /**
+     * Computes the PSD of one trial for the requested frequency bins. Needs the tapered spectra.
+     *
+     * @param[in, out] inputData      The trial data. The PSD is stored in matPsd.
+     * @param[in] pairBins            The first frequency bin and the number of bins.
+     * @param[in] iNfft               The FFT length.
+     * @param[in] tapers              The tapers and their weights.
+     */
+    static void computePsd(ConnectivitySettings::IntermediateTrialData& inputData,
+                           const QPair<int,int>& pairBins,
+                           int iNfft,
+                           const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+
+    //=========================================================================================================
+    /**
+     * Computes the CSD of one trial for the requested node pairs and frequency bins. Entry i of vecPairCsd holds
+     * one row per partner of node i, in the order given by vecPairPartners.at(i). Needs the tapered spectra.
+     *
+     * @param[in, out] inputData      The trial data. The CSD is stored in vecPairCsd.
+     * @param[in] vecPairPartners     The partners j > i per node i.
+     * @param[in] pairBins            The first frequency bin and the number of bins.
+     * @param[in] iNfft               The FFT length.
+     * @param[in] tapers              The tapers and their weights.
+     */
+    static void computeCsd(ConnectivitySettings::IntermediateTrialData& inputData,
+                           const QVector<QVector<int> >& vecPairPartners,
+                           const QPair<int,int>& pairBins,
+                           int iNfft,
+                           const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+
+    //=========================================================================================================
+    /**
+     * Adds the weighted per-node matrices of one trial to the running sums. The caller needs to hold the
+     * mutex guarding the sums.
+     *
+     * @param[in, out] vecPairSum     The running sums. Initialized with the weighted trial data if empty.
+     * @param[in] vecPairTrial        The trial data.
+     * @param[in] dWeight             The weight the trial data enters the sums with.
+     */
+    template<typename T>
+    static void addWeighted(QVector<QPair<int,T> >& vecPairSum,
+                            const QVector<QPair<int,T> >& vecPairTrial,
+                            double dWeight);
 };
 
 //=============================================================================================================
 // INLINE DEFINITIONS
 //=============================================================================================================
+
+template<typename T>
+inline void AbstractMetric::addWeighted(QVector<QPair<int,T> >& vecPairSum,
+                                        const QVector<QPair<int,T> >& vecPairTrial,
+                                        double dWeight)
+{
+    if(vecPairSum.isEmpty()) {
+        vecPairSum = vecPairTrial;
+
+        if(dWeight != 1.0) {
+            for (int i = 0; i < vecPairSum.size(); ++i) {
+                vecPairSum[i].second *= dWeight;
+            }
+        }
+    } else {
+        for (int i = 0; i < vecPairSum.size(); ++i) {
+            vecPairSum[i].second += dWeight * vecPairTrial.at(i).second;
+        }
+    }
+}
+
 } // namespace CONNECTIVITYLIB
 
 #endif // ABSTRACTMETRIC_H
@@ -89,29 +89,24 @@ Network Coherence::calculate(ConnectivitySettings& connectivitySettings)
         return finalNetwork;
     }
 
-    if(AbstractMetric::m_bStorageModeIsActive == false) {
-        connectivitySettings.clearIntermediateData();
+    if(AbstractMetric::m_bStorageModeIsActive == false && !connectivitySettings.isStreamingModeActive()) {
+        // Keep tapered spectra which might have been computed once for all metrics
+        connectivitySettings.clearIntermediateData(false);
     }
 
+    connectivitySettings.decayIntermediateSumData();
+
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
 
-    // Check if start and bin amount need to be reset to full spectrum
+    // Only compute the requested frequency bins
     int iNfft = connectivitySettings.getFFTSize();
     int iNFreqs = int(floor(iNfft / 2.0)) + 1;
-
-    if(m_iNumberBinStart == -1 ||
-       m_iNumberBinAmount == -1 ||
-       m_iNumberBinStart > iNFreqs ||
-       m_iNumberBinAmount > iNFreqs ||
-       m_iNumberBinAmount + m_iNumberBinStart > iNFreqs) {
-        qDebug() << "Coherence::calculate - Resetting to full spectrum";
-        AbstractMetric::m_iNumberBinStart = 0;
-        AbstractMetric::m_iNumberBinAmount = iNFreqs;
-    }
+    QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
 
     // Pass information about the FFT length. Use iNFreqs because we only use the half spectrum
     finalNetwork.setFFTSize(iNFreqs);
-    finalNetwork.setUsedFreqBins(AbstractMetric::m_iNumberBinAmount);
+    finalNetwork.setFirstFreqBin(pairBins.first);
+    finalNetwork.setUsedFreqBins(pairBins.second);
 
     //Create nodes
     int rows = connectivitySettings.at(0).matData.rows();
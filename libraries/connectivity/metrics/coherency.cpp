@@ -106,20 +106,27 @@ void Coherency::calculateAbs(Network& finalNetwork,
 
     // Initialize vecPsdAvg and vecCsdAvg
     int iNRows = connectivitySettings.at(0).matData.rows();
-    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+
+    // Only compute the requested frequency bins and node pairs
+    QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
+    QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(iNRows);
 
     // Compute PSD/CSD for each trial
     QMutex mutex;
 
+    // Keep the intermediate trial data in streaming mode so that other metrics do not add the same trials twice
+    bool bStoreIntermediateData = m_bStorageModeIsActive || connectivitySettings.isStreamingModeActive();
+
     std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
         compute(inputData,
                 connectivitySettings.getIntermediateSumData().matPsdSum,
                 connectivitySettings.getIntermediateSumData().vecPairCsdSum,
                 mutex,
-                iNRows,
-                iNFreqs,
+                vecPairPartners,
+                pairBins,
                 iNfft,
-                tapers);
+                tapers,
+                bStoreIntermediateData);
     };
 
 //    iTime = timer.elapsed();
@@ -135,16 +142,9 @@ void Coherency::calculateAbs(Network& finalNetwork,
 //    timer.restart();
 
     // Compute CSD/sqrt(PSD_X * PSD_Y)
-    std::function<void(QPair<int,MatrixXcd>&)> computePSDCSDLambda = [&](QPair<int,MatrixXcd>& pairInput) {
-        computePSDCSDAbs(mutex,
-                         finalNetwork,
-                         pairInput,
-                         connectivitySettings.getIntermediateSumData().matPsdSum);
-    };
-
-    QFuture<void> resultCSDPSD = QtConcurrent::map(connectivitySettings.getIntermediateSumData().vecPairCsdSum,
-                                                   computePSDCSDLambda);
-    resultCSDPSD.waitForFinished();
+    computeCoherencyAbs(finalNetwork,
+                        connectivitySettings,
+                        vecPairPartners);
 
 //    iTime = timer.elapsed();
 //    qWarning() << "Compute" << iTime;
@@ -177,20 +177,26 @@ void Coherency::calculateImag(Network& finalNetwork,
 
     // Initialize vecPsdAvg and vecCsdAvg
     int iNRows = connectivitySettings.at(0).matData.rows();
-    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+
+    // Only compute the requested frequency bins and node pairs
+    QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
+    QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(iNRows);
 
     // Compute PSD/CSD for each trial
     QMutex mutex;
 
+    bool bStoreIntermediateData = m_bStorageModeIsActive || connectivitySettings.isStreamingModeActive();
+
     std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
         compute(inputData,
                 connectivitySettings.getIntermediateSumData().matPsdSum,
                 connectivitySettings.getIntermediateSumData().vecPairCsdSum,
                 mutex,
-                iNRows,
-                iNFreqs,
+                vecPairPartners,
+                pairBins,
                 iNfft,
-                tapers);
+                tapers,
+                bStoreIntermediateData);
     };
 
 //    iTime = timer.elapsed();
@@ -206,20 +212,57 @@ void Coherency::calculateImag(Network& finalNetwork,
 //    timer.restart();
 
     // Compute CSD/sqrt(PSD_X * PSD_Y)
+    computeCoherencyImag(finalNetwork,
+                         connectivitySettings,
+                         vecPairPartners);
+
+//    iTime = timer.elapsed();
+//    qWarning() << "Compute" << iTime;
+//    timer.restart();
+}
+
+//=============================================================================================================
+
+void Coherency::computeCoherencyAbs(Network& finalNetwork,
+                                    ConnectivitySettings &connectivitySettings,
+                                    const QVector<QVector<int> >& vecPairPartners)
+{
     std::function<void(QPair<int,MatrixXcd>&)> computePSDCSDLambda = [&](QPair<int,MatrixXcd>& pairInput) {
-        computePSDCSDImag(mutex,
-                          finalNetwork,
+        computePSDCSDAbs(finalNetwork,
+                         pairInput,
+                         connectivitySettings.getIntermediateSumData().matPsdSum,
+                         vecPairPartners.at(pairInput.first));
+    };
+
+    finalNetwork.initWeights(vecPairPartners.size(), finalNetwork.getUsedFreqBins());
+
+    QFuture<void> resultCSDPSD = QtConcurrent::map(connectivitySettings.getIntermediateSumData().vecPairCsdSum,
+                                                   computePSDCSDLambda);
+    resultCSDPSD.waitForFinished();
+
+    finalNetwork.updateWeights();
+}
+
+//=============================================================================================================
+
+void Coherency::computeCoherencyImag(Network& finalNetwork,
+                                     ConnectivitySettings &connectivitySettings,
+                                     const QVector<QVector<int> >& vecPairPartners)
+{
+    std::function<void(QPair<int,MatrixXcd>&)> computePSDCSDLambda = [&](QPair<int,MatrixXcd>& pairInput) {
+        computePSDCSDImag(finalNetwork,
                           pairInput,
-                          connectivitySettings.getIntermediateSumData().matPsdSum);
+                          connectivitySettings.getIntermediateSumData().matPsdSum,
+                          vecPairPartners.at(pairInput.first));
     };
 
+    finalNetwork.initWeights(vecPairPartners.size(), finalNetwork.getUsedFreqBins());
+
     QFuture<void> resultCSDPSD = QtConcurrent::map(connectivitySettings.getIntermediateSumData().vecPairCsdSum,
                                                    computePSDCSDLambda);
     resultCSDPSD.waitForFinished();
 
-//    iTime = timer.elapsed();
-//    qWarning() << "Compute" << iTime;
-//    timer.restart();
+    finalNetwork.updateWeights();
 }
 
 //=============================================================================================================
@@ -228,129 +271,59 @@ void Coherency::compute(ConnectivitySettings::IntermediateTrialData& inputData,
                         MatrixXd& matPsdSum,
                         QVector<QPair<int,MatrixXcd> >& vecPairCsdSum,
                         QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
+                        const QVector<QVector<int> >& vecPairPartners,
+                        const QPair<int,int>& pairBins,
                         int iNfft,
-                        const QPair<MatrixXd, VectorXd>& tapers)
+                        const QPair<MatrixXd, VectorXd>& tapers,
+                        bool bStoreIntermediateData)
 {
 //    QElapsedTimer timer;
 //    qint64 iTime = 0;
 //    timer.start();
 
-    if(inputData.vecPairCsd.size() == iNRows) {
+    int iNRows = vecPairPartners.size();
+
+    if(inputData.vecPairCsd.size() == iNRows && inputData.matPsd.rows() == iNRows) {
         //qDebug() << "Coherency::compute - vecPairCsd were already computed for this trial.";
         return;
     }
 
-    //qDebug() << "Coherency::compute - vecPairCsdSum and matPsdSum are computed for this trial.";
-
-    // Substract mean, compute tapered spectra and PSD
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    bool bNfftEven = false;
-    if (iNfft % 2 == 0){
-        bNfftEven = true;
-    }
-
-    FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
-
-    double denomPSD = tapers.second.cwiseAbs2().sum() / 2.0;
-
-    RowVectorXd vecInputFFT, rowData;
-    RowVectorXcd vecTmpFreq;
-
-    MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-    int i,j;
+    // The CSD might have already been computed and summed up by one of the phase based metrics
+    bool bComputePsd = inputData.matPsd.rows() != iNRows;
 
-    inputData.matPsd = MatrixXd(iNRows, m_iNumberBinAmount);
-
-    for (i = 0; i < iNRows; ++i) {
-        // Substract mean
-        rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
+    //qDebug() << "Coherency::compute - vecPairCsdSum and matPsdSum are computed for this trial.";
 
-        // Calculate tapered spectra if not available already
-        if(inputData.vecTapSpectra.size() != iNRows) {
-            for(j = 0; j < tapers.first.rows(); j++) {
-                // Zero padd if necessary. The zero padding in Eigen's FFT is only working for column vectors.
-                if (rowData.cols() < iNfft) {
-                    vecInputFFT.setZero(iNfft);
-                    vecInputFFT.block(0,0,1,rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));;
-                } else {
-                    vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                }
+    // Calculate tapered spectra if not available already
+    bool bComputedSpectra = inputData.vecTapSpectra.size() != inputData.matData.rows();
 
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
-            }
+    computeTaperedSpectra(inputData, iNfft, tapers);
 
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
+    // Compute PSD
+    if(bComputePsd) {
+        computePsd(inputData, pairBins, iNfft, tapers);
 
-        // Compute PSD (average over tapers if necessary).
-        inputData.matPsd.row(i) = inputData.vecTapSpectra.at(i).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(i).rows(),m_iNumberBinAmount).cwiseAbs2().colwise().sum() / denomPSD;
-
-        // Divide first and last element by 2 due to half spectrum
-        if(m_iNumberBinStart == 0) {
-            inputData.matPsd.row(i)(0) /= 2.0;
-        }
+        mutex.lock();
 
-        if(bNfftEven && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs) {
-            inputData.matPsd.row(i).tail(1) /= 2.0;
+        if(matPsdSum.rows() == 0 || matPsdSum.cols() == 0) {
+            matPsdSum = inputData.dWeight * inputData.matPsd;
+        } else {
+            matPsdSum += inputData.dWeight * inputData.matPsd;
         }
-    }
 
-    mutex.lock();
-
-    if(matPsdSum.rows() == 0 || matPsdSum.cols() == 0) {
-        matPsdSum = inputData.matPsd;
-    } else {
-        matPsdSum += inputData.matPsd;
+        mutex.unlock();
     }
 
-    mutex.unlock();
-
 //    iTime = timer.elapsed();
 //    qWarning() << QThread::currentThreadId() << "Coherency::compute timer - compute - Tapered spectra and PSD (summing):" << iTime;
 //    timer.restart();
 
     // Compute CSD
     if(inputData.vecPairCsd.size() != iNRows) {
-        inputData.vecPairCsd.clear();
-
-        //MatrixXcd matCsd = MatrixXcd(iNRows, iNFreqs);
-        MatrixXcd matCsd = MatrixXcd(iNRows, m_iNumberBinAmount);
-
-        double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
-
-        for (i = 0; i < iNRows; ++i) {
-            for (j = i; j < iNRows; ++j) {
-                // Compute CSD (average over tapers if necessary)
-                matCsd.row(j) = inputData.vecTapSpectra.at(i).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(i).rows(),m_iNumberBinAmount).cwiseProduct(inputData.vecTapSpectra.at(j).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(j).rows(),m_iNumberBinAmount).conjugate()).colwise().sum() / denomCSD;
-
-                // Divide first and last element by 2 due to half spectrum
-                if(m_iNumberBinStart == 0) {
-                    matCsd.row(j)(0) /= 2.0;
-                }
-
-                if(bNfftEven && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs) {
-                    matCsd.row(j).tail(1) /= 2.0;
-                }
-            }
-
-            inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,matCsd));
-        }
+        computeCsd(inputData, vecPairPartners, pairBins, iNfft, tapers);
 
         mutex.lock();
 
-        if(vecPairCsdSum.isEmpty()) {
-            vecPairCsdSum = inputData.vecPairCsd;
-        } else {
-            for (j = 0; j < vecPairCsdSum.size(); ++j) {
-                vecPairCsdSum[j].second += inputData.vecPairCsd.at(j).second;
-            }
-        }
+        addWeighted(vecPairCsdSum, inputData.vecPairCsd, inputData.dWeight);
 
         mutex.unlock();
     }
@@ -360,9 +333,12 @@ void Coherency::compute(ConnectivitySettings::IntermediateTrialData& inputData,
 //    timer.restart();
 
     //Do not store data to save memory
-    if(!m_bStorageModeIsActive) {
+    if(!bStoreIntermediateData) {
         inputData.vecPairCsd.clear();
-        inputData.vecTapSpectra.clear();
+
+        if(bComputedSpectra) {
+            inputData.vecTapSpectra.clear();
+        }
     }
 
 //    iTime = timer.elapsed();
@@ -372,67 +348,45 @@ void Coherency::compute(ConnectivitySettings::IntermediateTrialData& inputData,
 
 //=============================================================================================================
 
-void Coherency::computePSDCSDAbs(QMutex& mutex,
-                                 Network& finalNetwork,
+void Coherency::computePSDCSDAbs(Network& finalNetwork,
                                  const QPair<int,MatrixXcd>& pairInput,
-                                 const MatrixXd& matPsdSum)
+                                 const MatrixXd& matPsdSum,
+                                 const QVector<int>& vecPartners)
 {
-    MatrixXd matPSDtmp(matPsdSum.rows(), matPsdSum.cols());
-    RowVectorXd rowPsdSum = matPsdSum.row(pairInput.first);
+    int i = pairInput.first;
+    MatrixXd matPSDtmp(vecPartners.size(), matPsdSum.cols());
 
-    for(int j = 0; j < matPSDtmp.rows(); ++j) {
-        matPSDtmp.row(j) = rowPsdSum.cwiseProduct(matPsdSum.row(j));
+    for(int k = 0; k < vecPartners.size(); ++k) {
+        matPSDtmp.row(k) = matPsdSum.row(i).cwiseProduct(matPsdSum.row(vecPartners.at(k)));
     }
 
     // Average. Note that the number of trials cancel each other out.
     MatrixXcd matCohy = pairInput.second.cwiseQuotient(matPSDtmp.cwiseSqrt());
 
-    QSharedPointer<NetworkEdge> pEdge;
-    MatrixXd matWeight;
-    int j;
-    int i = pairInput.first;
-
-    for(j = i; j < matCohy.rows(); ++j) {
-        matWeight = matCohy.row(j).cwiseAbs().transpose();
-        pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-        mutex.lock();
-        finalNetwork.getNodeAt(i)->append(pEdge);
-        finalNetwork.getNodeAt(j)->append(pEdge);
-        finalNetwork.append(pEdge);
-        mutex.unlock();
+    // Every call writes its own node pairs, so no locking is needed
+    for(int k = 0; k < vecPartners.size(); ++k) {
+        finalNetwork.setWeights(i, vecPartners.at(k), matCohy.row(k).cwiseAbs().transpose());
     }
 }
 
 //=============================================================================================================
 
-void Coherency::computePSDCSDImag(QMutex& mutex,
-                                  Network& finalNetwork,
+void Coherency::computePSDCSDImag(Network& finalNetwork,
                                   const QPair<int,MatrixXcd>& pairInput,
-                                  const MatrixXd& matPsdSum)
+                                  const MatrixXd& matPsdSum,
+                                  const QVector<int>& vecPartners)
 {
-    MatrixXd matPSDtmp(matPsdSum.rows(), matPsdSum.cols());
-    RowVectorXd rowPsdSum = matPsdSum.row(pairInput.first);
+    int i = pairInput.first;
+    MatrixXd matPSDtmp(vecPartners.size(), matPsdSum.cols());
 
-    for(int j = 0; j < matPSDtmp.rows(); ++j) {
-        matPSDtmp.row(j) = rowPsdSum.cwiseProduct(matPsdSum.row(j));
+    for(int k = 0; k < vecPartners.size(); ++k) {
+        matPSDtmp.row(k) = matPsdSum.row(i).cwiseProduct(matPsdSum.row(vecPartners.at(k)));
     }
 
     MatrixXcd matCohy = pairInput.second.cwiseQuotient(matPSDtmp.cwiseSqrt());
 
-    QSharedPointer<NetworkEdge> pEdge;
-    MatrixXd matWeight;
-    int j;
-    int i = pairInput.first;
-
-    for(j = i; j < matCohy.rows(); ++j) {
-        matWeight = matCohy.row(j).imag().transpose();
-        pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-        mutex.lock();
-        finalNetwork.getNodeAt(i)->append(pEdge);
-        finalNetwork.getNodeAt(j)->append(pEdge);
-        finalNetwork.append(pEdge);
-        mutex.unlock();
+    // Every call writes its own node pairs, so no locking is needed
+    for(int k = 0; k < vecPartners.size(); ++k) {
+        finalNetwork.setWeights(i, vecPartners.at(k), matCohy.row(k).imag().transpose());
     }
 }
@@ -116,6 +116,30 @@ public:
     static void calculateImag(Network& finalNetwork,
                               ConnectivitySettings &connectivitySettings);
 
+    //=========================================================================================================
+    /**
+     * Computes the absolute value of coherency from the summed up CSD and PSD.
+     *
+     * @param[out]   finalNetwork          The resulting network.
+     * @param[in]    connectivitySettings  The input data and parameters.
+     * @param[in]    vecPairPartners       The partners j > i per node i.
+     */
+    static void computeCoherencyAbs(Network& finalNetwork,
+                                    ConnectivitySettings &connectivitySettings,
+                                    const QVector<QVector<int> >& vecPairPartners);
+
+    //=========================================================================================================
+    /**
+     * Computes the imaginary part of coherency from the summed up CSD and PSD.
+     *
+     * @param[out]   finalNetwork          The resulting network.
+     * @param[in]    connectivitySettings  The input data and parameters.
+     * @param[in]    vecPairPartners       The partners j > i per node i.
+     */
+    static void computeCoherencyImag(Network& finalNetwork,
+                                     ConnectivitySettings &connectivitySettings,
+                                     const QVector<QVector<int> >& vecPairPartners);
+
 private:
     //=========================================================================================================
     /**
@@ -125,32 +149,34 @@ private:
      * @param[out]   matPsdSum           The sum of all PSD matrices for each trial.
      * @param[out]   vecPairCsdSum       The sum of all CSD matrices for each trial.
      * @param[in]    mutex               The mutex used to safely access matPsdSum and vecPairCsdSum.
-     * @param[in]    iNRows              The number of rows.
-     * @param[in]    iNFreqs             The number of frequenciy bins.
+     * @param[in]    vecPairPartners     The partners j > i per node i.
+     * @param[in]    pairBins            The first frequency bin and the number of bins.
      * @param[in]    iNfft               The FFT length.
      * @param[in]    tapers              The taper information.
+     * @param[in]    bStoreIntermediateData Whether to keep the intermediate trial data after adding it to the sums.
      */
     static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
                         Eigen::MatrixXd& matPsdSum,
                         QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
                         QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
+                        const QVector<QVector<int> >& vecPairPartners,
+                        const QPair<int,int>& pairBins,
                         int iNfft,
-                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers,
+                        bool bStoreIntermediateData);
 
     //=========================================================================================================
     /**
      * Computes the PSD and CSD. This function gets called in parallel.
      */
-    static void computePSDCSDAbs(QMutex& mutex,
-                                 Network& finalNetwork,
+    static void computePSDCSDAbs(Network& finalNetwork,
                                  const QPair<int,Eigen::MatrixXcd>& pairInput,
-                                 const Eigen::MatrixXd& matPsdSum);
-    static void computePSDCSDImag(QMutex& mutex,
-                                  Network& finalNetwork,
+                                 const Eigen::MatrixXd& matPsdSum,
+                                 const QVector<int>& vecPartners);
+    static void computePSDCSDImag(Network& finalNetwork,
                                   const QPair<int,Eigen::MatrixXcd>& pairInput,
-                                  const Eigen::MatrixXd& matPsdSum);
+                                  const Eigen::MatrixXd& matPsdSum,
+                                  const QVector<int>& vecPartners);
 };
 
 //=============================================================================================================
@@ -95,8 +95,9 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
         return finalNetwork;
     }
 
-    if(AbstractMetric::m_bStorageModeIsActive == false) {
-        connectivitySettings.clearIntermediateData();
+    if(AbstractMetric::m_bStorageModeIsActive == false && !connectivitySettings.isStreamingModeActive()) {
+        // Keep tapered spectra which might have been computed once for all metrics
+        connectivitySettings.clearIntermediateData(false);
     }
 
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
@@ -123,6 +124,9 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
 
     QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, connectivitySettings.getWindowType());
 
+    // Only compute the requested node pairs
+    QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(rows);
+
     // Compute the cross correlation in parallel
     QMutex mutex;
     MatrixXd matDist;
@@ -131,6 +135,7 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
         compute(inputData,
                 matDist,
                 mutex,
+                vecPairPartners,
                 iNfft,
                 tapers);
     };
@@ -151,22 +156,22 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
 //    timer.restart();
 
     //Add edges to network
-    MatrixXd matWeight(1,1);
-    QSharedPointer<NetworkEdge> pEdge;
-    int j;
+    finalNetwork.initWeights(matDist.rows(), 1);
 
-    for(int i = 0; i < matDist.rows(); ++i) {
-        for(j = i; j < matDist.cols(); ++j) {
-            matWeight << matDist(i,j);
+    VectorXd vecWeight(1);
+    int j;
 
-            pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
+    for(int i = 0; i < vecPairPartners.size(); ++i) {
+        for(int k = 0; k < vecPairPartners.at(i).size(); ++k) {
+            j = vecPairPartners.at(i).at(k);
+            vecWeight << matDist(i,j);
 
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
+            finalNetwork.setWeights(i, j, vecWeight);
         }
     }
 
+    finalNetwork.updateWeights();
+
 //    iTime = timer.elapsed();
 //    qWarning() << "Compute" << iTime;
 //    timer.restart();
@@ -179,6 +184,7 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
 void CrossCorrelation::compute(ConnectivitySettings::IntermediateTrialData& inputData,
                                MatrixXd& matDist,
                                QMutex& mutex,
+                               const QVector<QVector<int> >& vecPairPartners,
                                int iNfft,
                                const QPair<MatrixXd, VectorXd>& tapers)
 {
@@ -186,44 +192,19 @@ void CrossCorrelation::compute(ConnectivitySettings::IntermediateTrialData& inpu
 //    qint64 iTime = 0;
 //    timer.start();
 
-    // Calculate tapered spectra if not available already
-    RowVectorXd vecInputFFT, rowData;
+    RowVectorXd vecInputFFT;
     RowVectorXcd vecResultFreq;
 
     FFT<double> fft;
     fft.SetFlag(fft.HalfSpectrum);
 
-    int i, j;
+    int i, j, k;
     int iNRows = inputData.matData.rows();
 
     // Calculate tapered spectra if not available already
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    if(inputData.vecTapSpectra.isEmpty()) {
-        int iNFreqs = int(floor(iNfft / 2.0)) + 1;
-        MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-        for (i = 0; i < iNRows; ++i) {
-            // Substract mean
-            rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
-
-            // Calculate tapered spectra
-            for(j = 0; j < tapers.first.rows(); j++) {
-                // Zero padd if necessary. The zero padding in Eigen's FFT is only working for column vectors.
-                if (rowData.cols() < iNfft) {
-                    vecInputFFT.setZero(iNfft);
-                    vecInputFFT.block(0,0,1,rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));;
-                } else {
-                    vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                }
-
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecResultFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecResultFreq * tapers.second(j);
-            }
-
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
-    }
+    bool bComputedSpectra = inputData.vecTapSpectra.size() != iNRows;
+
+    computeTaperedSpectra(inputData, iNfft, tapers);
 
 //    iTime = timer.elapsed();
 //    qDebug() << QThread::currentThreadId() << "CrossCorrelation::compute timer - Tapered spectra:" << iTime;
@@ -236,10 +217,11 @@ void CrossCorrelation::compute(ConnectivitySettings::IntermediateTrialData& inpu
     int idx = 0;
     double denom = tapers.second.sum();
 
-    for(i = 0; i < inputData.vecTapSpectra.size(); ++i) {
+    for(i = 0; i < vecPairPartners.size(); ++i) {
         vecResultFreq = inputData.vecTapSpectra.at(i).colwise().sum() / denom;
 
-        for(j = i; j < inputData.vecTapSpectra.size(); ++j) {
+        for(k = 0; k < vecPairPartners.at(i).size(); ++k) {
+            j = vecPairPartners.at(i).at(k);
             vecResultXCor = vecResultFreq.cwiseProduct(inputData.vecTapSpectra.at(j).colwise().sum() / denom);
 
             fft.inv(vecInputFFT, vecResultXCor, iNfft);
@@ -270,7 +252,7 @@ void CrossCorrelation::compute(ConnectivitySettings::IntermediateTrialData& inpu
 //    qDebug() << QThread::currentThreadId() << "CrossCorrelation::compute timer - Summing up matDist:" << iTime;
 //    timer.restart();
 
-    if(!m_bStorageModeIsActive) {
+    if(!m_bStorageModeIsActive && bComputedSpectra) {
         inputData.vecTapSpectra.clear();
     }
 }
@@ -110,12 +110,14 @@ protected:
      * @param[in]    inputData           The input data.
      * @param[out]   matDist             The sum of all edge weights.
      * @param[in]    mutex               The mutex used to safely access matDist.
+     * @param[in]    vecPairPartners     The partners j > i per node i.
      * @param[in]    iNfft               The FFT length.
      * @param[in]    tapers              The taper information.
      */
     static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
                         Eigen::MatrixXd& matDist,
                         QMutex& mutex,
+                        const QVector<QVector<int> >& vecPairPartners,
                         int iNfft,
                         const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
 };
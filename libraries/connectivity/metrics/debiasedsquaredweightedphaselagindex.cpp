@@ -95,10 +95,13 @@ Network DebiasedSquaredWeightedPhaseLagIndex::calculate(ConnectivitySettings& co
         return finalNetwork;
     }
 
-    if(AbstractMetric::m_bStorageModeIsActive == false) {
-        connectivitySettings.clearIntermediateData();
+    if(AbstractMetric::m_bStorageModeIsActive == false && !connectivitySettings.isStreamingModeActive()) {
+        // Keep tapered spectra which might have been computed once for all metrics
+        connectivitySettings.clearIntermediateData(false);
     }
 
+    connectivitySettings.decayIntermediateSumData();
+
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
 
     #ifdef EIGEN_FFTW_DEFAULT
@@ -132,33 +135,30 @@ Network DebiasedSquaredWeightedPhaseLagIndex::calculate(ConnectivitySettings& co
     int iNRows = connectivitySettings.at(0).matData.rows();
     int iNFreqs = int(floor(iNfft / 2.0)) + 1;
 
-    // Check if start and bin amount need to be reset to full spectrum
-    if(m_iNumberBinStart == -1 ||
-       m_iNumberBinAmount == -1 ||
-       m_iNumberBinStart > iNFreqs ||
-       m_iNumberBinAmount > iNFreqs ||
-       m_iNumberBinAmount + m_iNumberBinStart > iNFreqs) {
-        qDebug() << "DebiasedSquaredWeightedPhaseLagIndex::calculate - Resetting to full spectrum";
-        AbstractMetric::m_iNumberBinStart = 0;
-        AbstractMetric::m_iNumberBinAmount = iNFreqs;
-    }
+    // Only compute the requested frequency bins and node pairs
+    QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
+    QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(iNRows);
 
     // Pass information about the FFT length. Use iNFreqs because we only use the half spectrum
     finalNetwork.setFFTSize(iNFreqs);
-    finalNetwork.setUsedFreqBins(AbstractMetric::m_iNumberBinAmount);
+    finalNetwork.setFirstFreqBin(pairBins.first);
+    finalNetwork.setUsedFreqBins(pairBins.second);
 
     QMutex mutex;
 
+    bool bStoreIntermediateData = m_bStorageModeIsActive || connectivitySettings.isStreamingModeActive();
+
     std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
-        return compute(inputData,
-                       connectivitySettings.getIntermediateSumData().vecPairCsdSum,
-                       connectivitySettings.getIntermediateSumData().vecPairCsdImagAbsSum,
-                       connectivitySettings.getIntermediateSumData().vecPairCsdImagSqrdSum,
-                       mutex,
-                       iNRows,
-                       iNFreqs,
-                       iNfft,
-                       tapers);
+        compute(inputData,
+                connectivitySettings.getIntermediateSumData().vecPairCsdSum,
+                connectivitySettings.getIntermediateSumData().vecPairCsdImagAbsSum,
+                connectivitySettings.getIntermediateSumData().vecPairCsdImagSqrdSum,
+                mutex,
+                vecPairPartners,
+                pairBins,
+                iNfft,
+                tapers,
+                bStoreIntermediateData);
     };
 
 //    iTime = timer.elapsed();
@@ -176,7 +176,8 @@ Network DebiasedSquaredWeightedPhaseLagIndex::calculate(ConnectivitySettings& co
 
     // Compute DSWPLI
     computeDSWPLI(connectivitySettings,
-                  finalNetwork);
+                  finalNetwork,
+                  vecPairPartners);
 
 //    iTime = timer.elapsed();
 //    qWarning() << "Compute" << iTime;
@@ -192,11 +193,14 @@ void DebiasedSquaredWeightedPhaseLagIndex::compute(ConnectivitySettings::Interme
                                                    QVector<QPair<int,MatrixXd> >& vecPairCsdImagAbsSum,
                                                    QVector<QPair<int,MatrixXd> >& vecPairCsdImagSqrdSum,
                                                    QMutex& mutex,
-                                                   int iNRows,
-                                                   int iNFreqs,
+                                                   const QVector<QVector<int> >& vecPairPartners,
+                                                   const QPair<int,int>& pairBins,
                                                    int iNfft,
-                                                   const QPair<MatrixXd, VectorXd>& tapers)
+                                                   const QPair<MatrixXd, VectorXd>& tapers,
+                                                   bool bStoreIntermediateData)
 {
+    int iNRows = vecPairPartners.size();
+
     if(inputData.vecPairCsd.size() == iNRows &&
        inputData.vecPairCsdImagSqrd.size() == iNRows &&
        inputData.vecPairCsdImagAbs.size() == iNRows) {
@@ -204,86 +208,29 @@ void DebiasedSquaredWeightedPhaseLagIndex::compute(ConnectivitySettings::Interme
         return;
     }
 
-    int i,j;
+    int i;
 
     // Calculate tapered spectra if not available already
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    if(inputData.vecTapSpectra.isEmpty()) {
-        RowVectorXd vecInputFFT, rowData;
-        RowVectorXcd vecTmpFreq;
+    bool bComputedSpectra = inputData.vecTapSpectra.size() != inputData.matData.rows();
 
-        MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-        FFT<double> fft;
-        fft.SetFlag(fft.HalfSpectrum);
-
-        for (i = 0; i < iNRows; ++i) {
-            // Substract mean
-            rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
-
-            // Calculate tapered spectra if not available already
-            for(j = 0; j < tapers.first.rows(); j++) {
-                // Zero padd if necessary. The zero padding in Eigen's FFT is only working for column vectors.
-                if (rowData.cols() < iNfft) {
-                    vecInputFFT.setZero(iNfft);
-                    vecInputFFT.block(0,0,1,rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));;
-                } else {
-                    vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                }
-
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
-            }
-
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
-    }
+    computeTaperedSpectra(inputData, iNfft, tapers);
 
     // Compute CSD
     if(inputData.vecPairCsd.isEmpty()) {
-        MatrixXcd matCsd(iNRows, m_iNumberBinAmount);
-
-        bool bNfftEven = false;
-        if (iNfft % 2 == 0){
-            bNfftEven = true;
-        }
-
-        double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
+        computeCsd(inputData, vecPairPartners, pairBins, iNfft, tapers);
 
         for (i = 0; i < iNRows; ++i) {
-            for (j = i; j < iNRows; ++j) {
-                // Compute CSD (average over tapers if necessary)
-                matCsd.row(j) = inputData.vecTapSpectra.at(i).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(i).rows(),m_iNumberBinAmount).cwiseProduct(inputData.vecTapSpectra.at(j).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(j).rows(),m_iNumberBinAmount).conjugate()).colwise().sum() / denomCSD;
-
-                // Divide first and last element by 2 due to half spectrum
-                if(m_iNumberBinStart == 0) {
-                    matCsd.row(j)(0) /= 2.0;
-                }
-
-                if(bNfftEven && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs) {
-                    matCsd.row(j).tail(1) /= 2.0;
-                }
-            }
+            const MatrixXcd& matCsd = inputData.vecPairCsd.at(i).second;
 
-            inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,matCsd));
             inputData.vecPairCsdImagSqrd.append(QPair<int,MatrixXd>(i,matCsd.imag().array().square()));
             inputData.vecPairCsdImagAbs.append(QPair<int,MatrixXd>(i,matCsd.imag().cwiseAbs()));
         }
 
         mutex.lock();
 
-        if(vecPairCsdSum.isEmpty()) {
-            vecPairCsdSum = inputData.vecPairCsd;
-            vecPairCsdImagSqrdSum = inputData.vecPairCsdImagSqrd;
-            vecPairCsdImagAbsSum = inputData.vecPairCsdImagAbs;
-        } else {
-            for (int j = 0; j < vecPairCsdSum.size(); ++j) {
-                vecPairCsdSum[j].second += inputData.vecPairCsd.at(j).second;
-                vecPairCsdImagSqrdSum[j].second += inputData.vecPairCsdImagSqrd.at(j).second;
-                vecPairCsdImagAbsSum[j].second += inputData.vecPairCsdImagAbs.at(j).second;
-            }
-        }
+        addWeighted(vecPairCsdSum, inputData.vecPairCsd, inputData.dWeight);
+        addWeighted(vecPairCsdImagSqrdSum, inputData.vecPairCsdImagSqrd, inputData.dWeight * inputData.dWeight);
+        addWeighted(vecPairCsdImagAbsSum, inputData.vecPairCsdImagAbs, inputData.dWeight);
 
         mutex.unlock();
     } else {
@@ -294,13 +241,7 @@ void DebiasedSquaredWeightedPhaseLagIndex::compute(ConnectivitySettings::Interme
 
             mutex.lock();
 
-            if(vecPairCsdImagSqrdSum.isEmpty()) {
-                vecPairCsdImagSqrdSum = inputData.vecPairCsdImagSqrd;
-            } else {
-                for (int j = 0; j < vecPairCsdSum.size(); ++j) {
-                    vecPairCsdImagSqrdSum[j].second += inputData.vecPairCsdImagSqrd.at(j).second;
-                }
-            }
+            addWeighted(vecPairCsdImagSqrdSum, inputData.vecPairCsdImagSqrd, inputData.dWeight * inputData.dWeight);
 
             mutex.unlock();
         }
@@ -312,36 +253,34 @@ void DebiasedSquaredWeightedPhaseLagIndex::compute(ConnectivitySettings::Interme
 
             mutex.lock();
 
-            if(vecPairCsdImagAbsSum.isEmpty()) {
-                vecPairCsdImagAbsSum = inputData.vecPairCsdImagAbs;
-            } else {
-                for (int j = 0; j < vecPairCsdSum.size(); ++j) {
-                    vecPairCsdImagAbsSum[j].second += inputData.vecPairCsdImagAbs.at(j).second;
-                }
-            }
+            addWeighted(vecPairCsdImagAbsSum, inputData.vecPairCsdImagAbs, inputData.dWeight);
 
             mutex.unlock();
         }
     }
 
-    if(!m_bStorageModeIsActive) {
+    if(!bStoreIntermediateData) {
         inputData.vecPairCsd.clear();
-        inputData.vecTapSpectra.clear();
         inputData.vecPairCsdImagAbs.clear();
         inputData.vecPairCsdImagSqrd.clear();
+
+        if(bComputedSpectra) {
+            inputData.vecTapSpectra.clear();
+        }
     }
 }
 
 //=============================================================================================================
 
 void DebiasedSquaredWeightedPhaseLagIndex::computeDSWPLI(ConnectivitySettings &connectivitySettings,
-                                                         Network& finalNetwork)
+                                                         Network& finalNetwork,
+                                                         const QVector<QVector<int> >& vecPairPartners)
 {
     // Compute final DSWPLI and create Network
     MatrixXd matNom, matDenom;
-    MatrixXd matWeight;
-    QSharedPointer<NetworkEdge> pEdge;
-    int j;
+    int k;
+
+    finalNetwork.initWeights(connectivitySettings.at(0).matData.rows(), finalNetwork.getUsedFreqBins());
 
     for (int i = 0; i < connectivitySettings.at(0).matData.rows(); ++i) {
 
@@ -354,16 +293,12 @@ void DebiasedSquaredWeightedPhaseLagIndex::computeDSWPLI(ConnectivitySettings &c
         matDenom = (matDenom.array() == 0.).select(INFINITY, matDenom);
         matDenom = matNom.cwiseQuotient(matDenom);
 
-        for(j = i; j < connectivitySettings.at(0).matData.rows(); ++j) {
-            matWeight = matDenom.row(j).transpose();
-
-            pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
-
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
+        for(k = 0; k < vecPairPartners.at(i).size(); ++k) {
+            finalNetwork.setWeights(i, vecPairPartners.at(i).at(k), matDenom.row(k).transpose());
         }
 
     }
+
+    finalNetwork.updateWeights();
 }
 
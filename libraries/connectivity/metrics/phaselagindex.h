@@ -106,6 +106,18 @@ public:
      */
     static Network calculate(ConnectivitySettings& connectivitySettings);
 
+    //=========================================================================================================
+    /**
+     * Reduces the PLI computation to a final result.
+     *
+     * @param[out] connectivitySettings   The input data.
+     * @param[in]  finalNetwork           The final network.
+     * @param[in]  vecPairPartners        The partners j > i per node i.
+     */
+    static void computePLI(ConnectivitySettings &connectivitySettings,
+                          Network& finalNetwork,
+                          const QVector<QVector<int> >& vecPairPartners);
+
 protected:
     //=========================================================================================================
     /**
@@ -115,29 +127,21 @@ protected:
      * @param[out]vecPairCsdSum          The sum of all CSD matrices for each trial.
      * @param[out]vecPairCsdImagSignSum  The sum of all imag sign CSD matrices for each trial.
      * @param[in] mutex                  The mutex used to safely access vecPairCsdSum.
-     * @param[in] iNRows                 The number of rows.
-     * @param[in] iNFreqs                The number of frequenciy bins.
+     * @param[in] vecPairPartners        The partners j > i per node i.
+     * @param[in] pairBins               The first frequency bin and the number of bins.
      * @param[in] iNfft                  The FFT length.
      * @param[in] tapers                 The taper information.
+     * @param[in] bStoreIntermediateData Whether to keep the intermediate trial data after adding it to the sums.
      */
     static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
                         QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
                         QVector<QPair<int,Eigen::MatrixXd> >& vecPairCsdImagSignSum,
                         QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
+                        const QVector<QVector<int> >& vecPairPartners,
+                        const QPair<int,int>& pairBins,
                         int iNfft,
-                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
-
-    //=========================================================================================================
-    /**
-     * Reduces the PLI computation to a final result.
-     *
-     * @param[out] connectivitySettings   The input data.
-     * @param[in]  finalNetwork           The final network.
-     */
-    static void computePLI(ConnectivitySettings &connectivitySettings,
-                          Network& finalNetwork);
+                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers,
+                        bool bStoreIntermediateData);
 };
 
 //=============================================================================================================
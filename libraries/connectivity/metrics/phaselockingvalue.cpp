@@ -95,10 +95,13 @@ Network PhaseLockingValue::calculate(ConnectivitySettings& connectivitySettings)
         return finalNetwork;
     }
 
-    if(AbstractMetric::m_bStorageModeIsActive == false) {
-        connectivitySettings.clearIntermediateData();
+    if(AbstractMetric::m_bStorageModeIsActive == false && !connectivitySettings.isStreamingModeActive()) {
+        // Keep tapered spectra which might have been computed once for all metrics
+        connectivitySettings.clearIntermediateData(false);
     }
 
+    connectivitySettings.decayIntermediateSumData();
+
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
 
     #ifdef EIGEN_FFTW_DEFAULT
@@ -131,32 +134,29 @@ Network PhaseLockingValue::calculate(ConnectivitySettings& connectivitySettings)
     // Initialize
     int iNFreqs = int(floor(iNfft / 2.0)) + 1;
 
-    // Check if start and bin amount need to be reset to full spectrum
-    if(m_iNumberBinStart == -1 ||
-       m_iNumberBinAmount == -1 ||
-       m_iNumberBinStart > iNFreqs ||
-       m_iNumberBinAmount > iNFreqs ||
-       m_iNumberBinAmount + m_iNumberBinStart > iNFreqs) {
-        qDebug() << "PhaseLockingValue::calculate - Resetting to full spectrum";
-        AbstractMetric::m_iNumberBinStart = 0;
-        AbstractMetric::m_iNumberBinAmount = iNFreqs;
-    }
+    // Only compute the requested frequency bins and node pairs
+    QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
+    QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(iNRows);
 
     // Pass information about the FFT length. Use iNFreqs because we only use the half spectrum
     finalNetwork.setFFTSize(iNFreqs);
-    finalNetwork.setUsedFreqBins(AbstractMetric::m_iNumberBinAmount);
+    finalNetwork.setFirstFreqBin(pairBins.first);
+    finalNetwork.setUsedFreqBins(pairBins.second);
 
     QMutex mutex;
 
+    bool bStoreIntermediateData = m_bStorageModeIsActive || connectivitySettings.isStreamingModeActive();
+
     std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
         compute(inputData,
                 connectivitySettings.getIntermediateSumData().vecPairCsdSum,
                 connectivitySettings.getIntermediateSumData().vecPairCsdNormalizedSum,
                 mutex,
-                iNRows,
-                iNFreqs,
+                vecPairPartners,
+                pairBins,
                 iNfft,
-                tapers);
+                tapers,
+                bStoreIntermediateData);
     };
 
 //    iTime = timer.elapsed();
@@ -174,7 +174,8 @@ Network PhaseLockingValue::calculate(ConnectivitySettings& connectivitySettings)
 
     // Compute PLV
     computePLV(connectivitySettings,
-               finalNetwork);
+               finalNetwork,
+               vecPairPartners);
 
 //    iTime = timer.elapsed();
 //    qWarning() << "Compute" << iTime;
@@ -189,93 +190,40 @@ void PhaseLockingValue::compute(ConnectivitySettings::IntermediateTrialData& inp
                                 QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
                                 QVector<QPair<int,MatrixXcd> >& vecPairCsdNormalizedSum,
                                 QMutex& mutex,
-                                int iNRows,
-                                int iNFreqs,
+                                const QVector<QVector<int> >& vecPairPartners,
+                                const QPair<int,int>& pairBins,
                                 int iNfft,
-                                const QPair<MatrixXd, VectorXd>& tapers)
+                                const QPair<MatrixXd, VectorXd>& tapers,
+                                bool bStoreIntermediateData)
 {
+    int iNRows = vecPairPartners.size();
+
     if(inputData.vecPairCsdNormalized.size() == iNRows) {
         //qDebug() << "PhaseLockingValue::compute - vecPairCsdNormalized was already computed for this trial.";
         return;
     }
 
-    int i,j;
+    int i;
 
     // Calculate tapered spectra if not available already
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    if(inputData.vecTapSpectra.isEmpty()) {
-        RowVectorXd vecInputFFT, rowData;
-        RowVectorXcd vecTmpFreq;
-
-        MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-        FFT<double> fft;
-        fft.SetFlag(fft.HalfSpectrum);
+    bool bComputedSpectra = inputData.vecTapSpectra.size() != inputData.matData.rows();
 
-        for (i = 0; i < iNRows; ++i) {
-            // Substract mean
-            rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
-
-            // Calculate tapered spectra if not available already
-            for(j = 0; j < tapers.first.rows(); j++) {
-                // Zero padd if necessary. The zero padding in Eigen's FFT is only working for column vectors.
-                if (rowData.cols() < iNfft) {
-                    vecInputFFT.setZero(iNfft);
-                    vecInputFFT.block(0,0,1,rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));;
-                } else {
-                    vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                }
-
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
-            }
-
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
-    }
+    computeTaperedSpectra(inputData, iNfft, tapers);
 
     // Compute CSD
     if(inputData.vecPairCsd.isEmpty()) {
-        MatrixXcd matCsd = MatrixXcd(iNRows, m_iNumberBinAmount);
-
-        bool bNfftEven = false;
-        if (iNfft % 2 == 0){
-            bNfftEven = true;
-        }
-
-        double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
+        computeCsd(inputData, vecPairPartners, pairBins, iNfft, tapers);
 
         for (i = 0; i < iNRows; ++i) {
-            for (j = i; j < iNRows; ++j) {
-                // Compute CSD (average over tapers if necessary)
-                matCsd.row(j) = inputData.vecTapSpectra.at(i).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(i).rows(),m_iNumberBinAmount).cwiseProduct(inputData.vecTapSpectra.at(j).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(j).rows(),m_iNumberBinAmount).conjugate()).colwise().sum() / denomCSD;
-
-                // Divide first and last element by 2 due to half spectrum
-                if(m_iNumberBinStart == 0) {
-                    matCsd.row(j)(0) /= 2.0;
-                }
-
-                if(bNfftEven && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs) {
-                    matCsd.row(j).tail(1) /= 2.0;
-                }
-            }
+            const MatrixXcd& matCsd = inputData.vecPairCsd.at(i).second;
 
-            inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,matCsd));
             inputData.vecPairCsdNormalized.append(QPair<int,MatrixXcd>(i,matCsd.cwiseQuotient(matCsd.cwiseAbs())));
         }
 
         mutex.lock();
 
-        if(vecPairCsdSum.isEmpty()) {
-            vecPairCsdSum = inputData.vecPairCsd;
-            vecPairCsdNormalizedSum = inputData.vecPairCsdNormalized;
-        } else {
-            for (int j = 0; j < vecPairCsdSum.size(); ++j) {
-                vecPairCsdSum[j].second += inputData.vecPairCsd.at(j).second;
-                vecPairCsdNormalizedSum[j].second += inputData.vecPairCsdNormalized.at(j).second;
-            }
-        }
+        addWeighted(vecPairCsdSum, inputData.vecPairCsd, inputData.dWeight);
+        addWeighted(vecPairCsdNormalizedSum, inputData.vecPairCsdNormalized, inputData.dWeight);
 
         mutex.unlock();
     } else {
@@ -286,47 +234,41 @@ void PhaseLockingValue::compute(ConnectivitySettings::IntermediateTrialData& inp
 
             mutex.lock();
 
-            if(vecPairCsdNormalizedSum.isEmpty()) {
-                vecPairCsdNormalizedSum = inputData.vecPairCsdNormalized;
-            } else {
-                for (int j = 0; j < vecPairCsdNormalizedSum.size(); ++j) {
-                    vecPairCsdNormalizedSum[j].second += inputData.vecPairCsdNormalized.at(j).second;
-                }
-            }
+            addWeighted(vecPairCsdNormalizedSum, inputData.vecPairCsdNormalized, inputData.dWeight);
 
             mutex.unlock();
         }
     }
 
-    if(!m_bStorageModeIsActive) {
+    if(!bStoreIntermediateData) {
         inputData.vecPairCsd.clear();
-        inputData.vecTapSpectra.clear();
         inputData.vecPairCsdNormalized.clear();
+
+        if(bComputedSpectra) {
+            inputData.vecTapSpectra.clear();
+        }
     }
 }
 
 //=============================================================================================================
 
 void PhaseLockingValue::computePLV(ConnectivitySettings &connectivitySettings,
-                                   Network& finalNetwork)
+                                   Network& finalNetwork,
+                                   const QVector<QVector<int> >& vecPairPartners)
 {
     // Compute final PLV and create Network
     MatrixXd matNom;
-    MatrixXd matWeight;
-    QSharedPointer<NetworkEdge> pEdge;
-    int j;
-
-    for (int i = 0; i < connectivitySettings.at(0).matData.rows(); ++i) {
-        matNom = connectivitySettings.getIntermediateSumData().vecPairCsdNormalizedSum.at(i).second.cwiseAbs() / connectivitySettings.size();
+    int k;
 
-        for(j = i; j < connectivitySettings.at(0).matData.rows(); ++j) {
-            matWeight = matNom.row(j).transpose();
+    finalNetwork.initWeights(connectivitySettings.at(0).matData.rows(), finalNetwork.getUsedFreqBins());
 
-            pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
+    for (int i = 0; i < connectivitySettings.at(0).matData.rows(); ++i) {
+        matNom = connectivitySettings.getIntermediateSumData().vecPairCsdNormalizedSum.at(i).second.cwiseAbs() / connectivitySettings.getTrialWeightSum();
 
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
+        for(k = 0; k < vecPairPartners.at(i).size(); ++k) {
+            finalNetwork.setWeights(i, vecPairPartners.at(i).at(k), matNom.row(k).transpose());
         }
     }
+
+    finalNetwork.updateWeights();
 }
@@ -95,10 +95,13 @@ Network UnbiasedSquaredPhaseLagIndex::calculate(ConnectivitySettings& connectivi
         return finalNetwork;
     }
 
-    if(AbstractMetric::m_bStorageModeIsActive == false) {
-        connectivitySettings.clearIntermediateData();
+    if(AbstractMetric::m_bStorageModeIsActive == false && !connectivitySettings.isStreamingModeActive()) {
+        // Keep tapered spectra which might have been computed once for all metrics
+        connectivitySettings.clearIntermediateData(false);
     }
 
+    connectivitySettings.decayIntermediateSumData();
+
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
 
     #ifdef EIGEN_FFTW_DEFAULT
@@ -132,32 +135,29 @@ Network UnbiasedSquaredPhaseLagIndex::calculate(ConnectivitySettings& connectivi
     int iNRows = connectivitySettings.at(0).matData.rows();
     int iNFreqs = int(floor(iNfft / 2.0)) + 1;
 
-    // Check if start and bin amount need to be reset to full spectrum
-    if(m_iNumberBinStart == -1 ||
-       m_iNumberBinAmount == -1 ||
-       m_iNumberBinStart > iNFreqs ||
-       m_iNumberBinAmount > iNFreqs ||
-       m_iNumberBinAmount + m_iNumberBinStart > iNFreqs) {
-        qDebug() << "UnbiasedSquaredPhaseLagIndex::calculate - Resetting to full spectrum";
-        AbstractMetric::m_iNumberBinStart = 0;
-        AbstractMetric::m_iNumberBinAmount = iNFreqs;
-    }
+    // Only compute the requested frequency bins and node pairs
+    QPair<int,int> pairBins = connectivitySettings.getFrequencyBins();
+    QVector<QVector<int> > vecPairPartners = connectivitySettings.getPairPartners(iNRows);
 
     // Pass information about the FFT length. Use iNFreqs because we only use the half spectrum
     finalNetwork.setFFTSize(iNFreqs);
-    finalNetwork.setUsedFreqBins(AbstractMetric::m_iNumberBinAmount);
+    finalNetwork.setFirstFreqBin(pairBins.first);
+    finalNetwork.setUsedFreqBins(pairBins.second);
 
     QMutex mutex;
 
+    bool bStoreIntermediateData = m_bStorageModeIsActive || connectivitySettings.isStreamingModeActive();
+
     std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
         compute(inputData,
                 connectivitySettings.getIntermediateSumData().vecPairCsdSum,
                 connectivitySettings.getIntermediateSumData().vecPairCsdImagSignSum,
                 mutex,
-                iNRows,
-                iNFreqs,
+                vecPairPartners,
+                pairBins,
                 iNfft,
-                tapers);
+                tapers,
+                bStoreIntermediateData);
     };
 
 //    iTime = timer.elapsed();
@@ -175,7 +175,8 @@ Network UnbiasedSquaredPhaseLagIndex::calculate(ConnectivitySettings& connectivi
 
     // Compute USPLI
     computeUSPLI(connectivitySettings,
-                 finalNetwork);
+                 finalNetwork,
+                 vecPairPartners);
 
 //    iTime = timer.elapsed();
 //    qWarning() << "Compute" << iTime;
@@ -190,95 +191,40 @@ void UnbiasedSquaredPhaseLagIndex::compute(ConnectivitySettings::IntermediateTri
                                            QVector<QPair<int,MatrixXcd> >& vecPairCsdSum,
                                            QVector<QPair<int,MatrixXd> >& vecPairCsdImagSignSum,
                                            QMutex& mutex,
-                                           int iNRows,
-                                           int iNFreqs,
+                                           const QVector<QVector<int> >& vecPairPartners,
+                                           const QPair<int,int>& pairBins,
                                            int iNfft,
-                                           const QPair<MatrixXd, VectorXd>& tapers)
+                                           const QPair<MatrixXd, VectorXd>& tapers,
+                                           bool bStoreIntermediateData)
 {
+    int iNRows = vecPairPartners.size();
+
     if(inputData.vecPairCsdImagSign.size() == iNRows) {
         //qDebug() << "UnbiasedSquaredPhaseLagIndex::compute - vecPairCsdImagSign was already computed for this trial.";
         return;
     }
 
-    int i,j;
+    int i;
 
     // Calculate tapered spectra if not available already
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    if(inputData.vecTapSpectra.size() != iNRows) {
-        inputData.vecTapSpectra.clear();
+    bool bComputedSpectra = inputData.vecTapSpectra.size() != inputData.matData.rows();
 
-        RowVectorXd vecInputFFT, rowData;
-        RowVectorXcd vecTmpFreq;
-
-        MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-        FFT<double> fft;
-        fft.SetFlag(fft.HalfSpectrum);
-
-        for (i = 0; i < iNRows; ++i) {
-            // Substract mean
-            rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
-
-            // Calculate tapered spectra if not available already
-            for(j = 0; j < tapers.first.rows(); j++) {
-                // Zero padd if necessary. The zero padding in Eigen's FFT is only working for column vectors.
-                if (rowData.cols() < iNfft) {
-                    vecInputFFT.setZero(iNfft);
-                    vecInputFFT.block(0,0,1,rowData.cols()) = rowData.cwiseProduct(tapers.first.row(j));;
-                } else {
-                    vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                }
-
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
-            }
-
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
-    }
+    computeTaperedSpectra(inputData, iNfft, tapers);
 
     // Compute CSD
     if(inputData.vecPairCsd.isEmpty()) {
-        double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
-
-        bool bNfftEven = false;
-        if (iNfft % 2 == 0){
-            bNfftEven = true;
-        }
-
-        MatrixXcd matCsd = MatrixXcd(iNRows, m_iNumberBinAmount);
+        computeCsd(inputData, vecPairPartners, pairBins, iNfft, tapers);
 
         for (i = 0; i < iNRows; ++i) {
-            for (j = i; j < iNRows; ++j) {
-                // Compute CSD (average over tapers if necessary)
-                matCsd.row(j) = inputData.vecTapSpectra.at(i).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(i).rows(),m_iNumberBinAmount).cwiseProduct(inputData.vecTapSpectra.at(j).block(0,m_iNumberBinStart,inputData.vecTapSpectra.at(j).rows(),m_iNumberBinAmount).conjugate()).colwise().sum() / denomCSD;
-
-                // Divide first and last element by 2 due to half spectrum
-                if(m_iNumberBinStart == 0) {
-                    matCsd.row(j)(0) /= 2.0;
-                }
-
-                if(bNfftEven && m_iNumberBinStart + m_iNumberBinAmount >= iNFreqs) {
-                    matCsd.row(j).tail(1) /= 2.0;
-                }
-            }
+            const MatrixXcd& matCsd = inputData.vecPairCsd.at(i).second;
 
-            inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,matCsd));
             inputData.vecPairCsdImagSign.append(QPair<int,MatrixXd>(i,matCsd.imag().cwiseSign()));
         }
 
         mutex.lock();
 
-        if(vecPairCsdSum.isEmpty()) {
-            vecPairCsdSum = inputData.vecPairCsd;
-            vecPairCsdImagSignSum = inputData.vecPairCsdImagSign;
-        } else {
-            for (int j = 0; j < vecPairCsdSum.size(); ++j) {
-                vecPairCsdSum[j].second += inputData.vecPairCsd.at(j).second;
-                vecPairCsdImagSignSum[j].second += inputData.vecPairCsdImagSign.at(j).second;
-            }
-        }
+        addWeighted(vecPairCsdSum, inputData.vecPairCsd, inputData.dWeight);
+        addWeighted(vecPairCsdImagSignSum, inputData.vecPairCsdImagSign, inputData.dWeight);
 
         mutex.unlock();
     } else {
@@ -289,50 +235,47 @@ void UnbiasedSquaredPhaseLagIndex::compute(ConnectivitySettings::IntermediateTri
 
             mutex.lock();
 
-            if(vecPairCsdImagSignSum.isEmpty()) {
-                vecPairCsdImagSignSum = inputData.vecPairCsdImagSign;
-            } else {
-                for (int j = 0; j < vecPairCsdImagSignSum.size(); ++j) {
-                    vecPairCsdImagSignSum[j].second += inputData.vecPairCsdImagSign.at(j).second;
-                }
-            }
+            addWeighted(vecPairCsdImagSignSum, inputData.vecPairCsdImagSign, inputData.dWeight);
 
             mutex.unlock();
         }
     }
 
-    if(!m_bStorageModeIsActive) {
+    if(!bStoreIntermediateData) {
         inputData.vecPairCsd.clear();
-        inputData.vecTapSpectra.clear();
         inputData.vecPairCsdImagSign.clear();
+
+        if(bComputedSpectra) {
+            inputData.vecTapSpectra.clear();
+        }
     }
 }
 
 //=============================================================================================================
 
 void UnbiasedSquaredPhaseLagIndex::computeUSPLI(ConnectivitySettings &connectivitySettings,
-                               Network& finalNetwork)
+                               Network& finalNetwork,
+                               const QVector<QVector<int> >& vecPairPartners)
 {
     // Compute final DSWPLV and create Network
     MatrixXd matNom;
-    MatrixXd matWeight;
-    QSharedPointer<NetworkEdge> pEdge;
-    int j;
-    double dNTrials = double(connectivitySettings.size() - 1.0);
-
-    for (int i = 0; i < connectivitySettings.getIntermediateSumData().vecPairCsdImagSignSum.size(); ++i) {
-        matNom = connectivitySettings.getIntermediateSumData().vecPairCsdImagSignSum.at(i).second.cwiseAbs() / connectivitySettings.size();
-        matNom = (connectivitySettings.size() * matNom.array().square() - 1.0) / dNTrials;
+    int k;
+    // With unit trial weights this reduces to (N * PLI^2 - 1) / (N - 1)
+    double dWeightSum = connectivitySettings.getTrialWeightSum();
+    double dSquaredWeightSum = connectivitySettings.getSquaredTrialWeightSum();
+    double dDenom = dWeightSum * dWeightSum - dSquaredWeightSum;
 
-        for(j = i; j < matNom.rows(); ++j) {
-            matWeight = matNom.row(j).transpose();
+    finalNetwork.initWeights(connectivitySettings.at(0).matData.rows(), finalNetwork.getUsedFreqBins());
 
-            pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
+    for (int i = 0; i < connectivitySettings.getIntermediateSumData().vecPairCsdImagSignSum.size(); ++i) {
+        matNom = connectivitySettings.getIntermediateSumData().vecPairCsdImagSignSum.at(i).second.cwiseAbs();
+        matNom = (matNom.array().square() - dSquaredWeightSum) / dDenom;
 
-            finalNetwork.getNodeAt(i)->append(pEdge);
-            finalNetwork.getNodeAt(j)->append(pEdge);
-            finalNetwork.append(pEdge);
+        for(k = 0; k < vecPairPartners.at(i).size(); ++k) {
+            finalNetwork.setWeights(i, vecPairPartners.at(i).at(k), matNom.row(k).transpose());
         }
     }
+
+    finalNetwork.updateWeights();
 }
 
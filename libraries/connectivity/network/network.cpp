@@ -51,6 +51,7 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QMutexLocker>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -72,15 +73,59 @@ using namespace UTILSLIB;
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
+Network::Cache::Cache()
+: bAdjacencyValid(false)
+, bViewsValid(false)
+{
+}
+
+//=============================================================================================================
+
+Network::Cache::Cache(const Cache& other)
+{
+    QMutexLocker locker(&other.mutex);
+
+    matThresholdedAdjacency = other.matThresholdedAdjacency;
+    bAdjacencyValid = other.bAdjacencyValid;
+    lFullEdges = other.lFullEdges;
+    lThresholdedEdges = other.lThresholdedEdges;
+    lNodeViews = other.lNodeViews;
+    bViewsValid = other.bViewsValid;
+}
+
+//=============================================================================================================
+
+Network::Cache& Network::Cache::operator=(const Cache& other)
+{
+    if(this != &other) {
+        QMutexLocker locker(&other.mutex);
+        QMutexLocker lockerThis(&mutex);
+
+        matThresholdedAdjacency = other.matThresholdedAdjacency;
+        bAdjacencyValid = other.bAdjacencyValid;
+        lFullEdges = other.lFullEdges;
+        lThresholdedEdges = other.lThresholdedEdges;
+        lNodeViews = other.lNodeViews;
+        bViewsValid = other.bViewsValid;
+    }
+
+    return *this;
+}
+
+//=============================================================================================================
+
 Network::Network(const QString& sConnectivityMethod,
                  double dThreshold)
-: m_sConnectivityMethod(sConnectivityMethod)
+: m_iNumberNodes(0)
+, m_minMaxFreqBins(QPair<int,int>(-1,-1))
+, m_sConnectivityMethod(sConnectivityMethod)
 , m_minMaxFullWeights(QPair<double,double>(std::numeric_limits<double>::max(),0.0))
 , m_minMaxThresholdedWeights(QPair<double,double>(std::numeric_limits<double>::max(),0.0))
 , m_dThreshold(dThreshold)
 , m_fSFreq(0.0f)
-, m_iFFTSize(128)
 , m_iNumberFreqBins(0)
+, m_iFFTSize(128)
+, m_iFirstFreqBin(0)
 {
     qRegisterMetaType<CONNECTIVITYLIB::Network>("CONNECTIVITYLIB::Network");
     qRegisterMetaType<CONNECTIVITYLIB::Network::SPtr>("CONNECTIVITYLIB::Network::SPtr");
@@ -92,23 +137,24 @@ Network::Network(const QString& sConnectivityMethod,
 
 MatrixXd Network::getFullConnectivityMatrix(bool bGetMirroredVersion) const
 {
-    MatrixXd matDist(m_lNodes.size(), m_lNodes.size());
-    matDist.setZero();
+    const int iNumberNodes = getNumberNodes();
+
+    MatrixXd matDist = MatrixXd::Zero(iNumberNodes, iNumberNodes);
 
-    for(int i = 0; i < m_lFullEdges.size(); ++i) {
-        int row = m_lFullEdges.at(i)->getStartNodeID();
-        int col = m_lFullEdges.at(i)->getEndNodeID();
+    int iPair = 0;
 
-        if(row < matDist.rows() && col < matDist.cols()) {
-            matDist(row,col) = m_lFullEdges.at(i)->getWeight();
+    for(int i = 0; i < m_iNumberNodes; ++i) {
+        for(int j = i + 1; j < m_iNumberNodes; ++j, ++iPair) {
+            if(i < iNumberNodes && j < iNumberNodes) {
+                matDist(i,j) = m_vecWeights[iPair];
 
-            if(bGetMirroredVersion) {
-                matDist(col,row) = m_lFullEdges.at(i)->getWeight();
+                if(bGetMirroredVersion) {
+                    matDist(j,i) = m_vecWeights[iPair];
+                }
             }
         }
     }
 
-    //IOUtils::write_eigen_matrix(matDist,"eigen.txt");
     return matDist;
 }
 
@@ -116,78 +162,222 @@ MatrixXd Network::getFullConnectivityMatrix(bool bGetMirroredVersion) const
 
 MatrixXd Network::getThresholdedConnectivityMatrix(bool bGetMirroredVersion) const
 {
-    MatrixXd matDist(m_lNodes.size(), m_lNodes.size());
-    matDist.setZero();
+    updateAdjacency();
 
-    for(int i = 0; i < m_lThresholdedEdges.size(); ++i) {
-        int row = m_lThresholdedEdges.at(i)->getStartNodeID();
-        int col = m_lThresholdedEdges.at(i)->getEndNodeID();
+    const int iNumberNodes = getNumberNodes();
 
-        if(row < matDist.rows() && col < matDist.cols()) {
-            matDist(row,col) = m_lThresholdedEdges.at(i)->getWeight();
+    MatrixXd matDist = MatrixXd::Zero(iNumberNodes, iNumberNodes);
 
-            if(bGetMirroredVersion) {
-                matDist(col,row) = m_lThresholdedEdges.at(i)->getWeight();
+    for(int i = 0; i < m_cache.matThresholdedAdjacency.outerSize(); ++i) {
+        for(SparseMatrix<double, RowMajor>::InnerIterator it(m_cache.matThresholdedAdjacency, i); it; ++it) {
+            if((bGetMirroredVersion || it.col() > i) && i < iNumberNodes && it.col() < iNumberNodes) {
+                matDist(i,it.col()) = it.value();
             }
         }
     }
 
-    //IOUtils::write_eigen_matrix(matDist,"eigen.txt");
     return matDist;
 }
 
 //=============================================================================================================
 
+const SparseMatrix<double, RowMajor>& Network::getThresholdedAdjacency() const
+{
+    updateAdjacency();
+
+    return m_cache.matThresholdedAdjacency;
+}
+
+//=============================================================================================================
+
+VectorXi Network::getThresholdedDegrees() const
+{
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(true, vecDegree, vecIndegree, vecOutdegree);
+
+    return vecDegree;
+}
+
+//=============================================================================================================
+
+MatrixXf Network::getNodeVertices() const
+{
+    MatrixXf matVert = MatrixXf::Zero(m_lNodes.size(), 3);
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        const RowVectorXf& vecVert = m_lNodes.at(i)->getVert();
+        for(int k = 0; k < vecVert.size() && k < 3; ++k) {
+            matVert(i,k) = vecVert[k];
+        }
+    }
+
+    return matVert;
+}
+
+//=============================================================================================================
+
+int Network::getNumberNodes() const
+{
+    return m_lNodes.isEmpty() ? m_iNumberNodes : m_lNodes.size();
+}
+
+//=============================================================================================================
+
+void Network::initWeights(int iNumberNodes,
+                          int iNumberBins)
+{
+    if(iNumberNodes < 0 || iNumberBins <= 0) {
+        qWarning() << "[Network::initWeights] Number of nodes and bins must be positive. Returning.";
+        return;
+    }
+
+    m_iNumberNodes = iNumberNodes;
+
+    const int iNumberPairs = iNumberNodes * (iNumberNodes - 1) / 2;
+
+    m_matWeightSums = MatrixXd::Zero(iNumberBins + 1, iNumberPairs);
+    m_vecWeights = VectorXd::Zero(iNumberPairs);
+    m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
+
+    invalidate();
+}
+
+//=============================================================================================================
+
+void Network::setWeights(int iStartNodeID,
+                         int iEndNodeID,
+                         const VectorXd& vecWeights)
+{
+    if(iStartNodeID == iEndNodeID) {
+        return;
+    }
+
+    if(iStartNodeID < 0 || iEndNodeID < 0 || iStartNodeID >= m_iNumberNodes || iEndNodeID >= m_iNumberNodes) {
+        qWarning() << "[Network::setWeights] Node pair" << iStartNodeID << iEndNodeID << "is out of range. Call initWeights first. Returning.";
+        return;
+    }
+
+    if(vecWeights.size() != m_matWeightSums.rows() - 1) {
+        qWarning() << "[Network::setWeights] Expected" << m_matWeightSums.rows() - 1 << "weights but got" << vecWeights.size() << ". Returning.";
+        return;
+    }
+
+    double* pSums = m_matWeightSums.col(getPairIndex(iStartNodeID, iEndNodeID)).data();
+
+    pSums[0] = 0.0;
+    for(int k = 0; k < vecWeights.size(); ++k) {
+        pSums[k + 1] = pSums[k] + vecWeights[k];
+    }
+}
+
+//=============================================================================================================
+
+void Network::updateWeights()
+{
+    if(m_matWeightSums.cols() == 0) {
+        return;
+    }
+
+    const int iNumberBins = int(m_matWeightSums.rows()) - 1;
+
+    int iLowerBin = m_minMaxFreqBins.first;
+    int iUpperBin = m_minMaxFreqBins.second;
+
+    if(iLowerBin == -1 && iUpperBin == -1) {
+        iLowerBin = 0;
+        iUpperBin = iNumberBins - 1;
+    } else {
+        // The frequency range is given in bins of the full half spectrum
+        iLowerBin = std::max(iLowerBin - m_iFirstFreqBin, 0);
+        iUpperBin -= m_iFirstFreqBin;
+    }
+
+    if(iLowerBin < 0 || iUpperBin < iLowerBin || iLowerBin >= iNumberBins) {
+        qDebug() << "Network::updateWeights - Frequency bins" << iLowerBin << iUpperBin << "are out of range. Weights will not be recalculated. Returning.";
+        return;
+    }
+
+    iUpperBin = std::min(iUpperBin, iNumberBins - 1);
+
+    // Each band average is the difference of two running sums
+    m_vecWeights = (m_matWeightSums.row(iUpperBin + 1) - m_matWeightSums.row(iLowerBin)).transpose() / double(iUpperBin - iLowerBin + 1);
+
+    if(m_vecWeights.size() > 0) {
+        m_minMaxFullWeights.first = m_vecWeights.cwiseAbs().minCoeff();
+        m_minMaxFullWeights.second = m_vecWeights.cwiseAbs().maxCoeff();
+    } else {
+        m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
+    }
+
+    m_minMaxThresholdedWeights.first = m_dThreshold;
+    m_minMaxThresholdedWeights.second = m_minMaxFullWeights.second;
+
+    invalidate();
+}
+
+//=============================================================================================================
+
 const QList<NetworkEdge::SPtr>& Network::getFullEdges() const
 {
-    return m_lFullEdges;
+    updateViews();
+
+    return m_cache.lFullEdges;
 }
 
 //=============================================================================================================
 
 const QList<NetworkEdge::SPtr>& Network::getThresholdedEdges() const
 {
-    return m_lThresholdedEdges;
+    updateViews();
+
+    return m_cache.lThresholdedEdges;
 }
 
 //=============================================================================================================
 
 const QList<NetworkNode::SPtr>& Network::getNodes() const
 {
-    return m_lNodes;
+    updateViews();
+
+    return m_cache.lNodeViews;
+}
+
+//=============================================================================================================
+
+NetworkEdge::SPtr Network::getEdgeAt(int i)
+{
+    updateViews();
+
+    return m_cache.lFullEdges.at(i);
 }
 
 //=============================================================================================================
 
 NetworkNode::SPtr Network::getNodeAt(int i)
 {
-    return m_lNodes.at(i);
+    updateViews();
+
+    return m_cache.lNodeViews.at(i);
 }
 
 //=============================================================================================================
 
 qint16 Network::getFullDistribution() const
 {
-    qint16 distribution = 0;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(false, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        distribution += m_lNodes.at(i)->getFullDegree();
-    }
-
-    return distribution;
+    return vecDegree.sum();
 }
 
 //=============================================================================================================
 
 qint16 Network::getThresholdedDistribution() const
 {
-    qint16 distribution = 0;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(true, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        distribution += m_lNodes.at(i)->getThresholdedDegree();
-    }
-
-    return distribution;
+    return vecDegree.sum();
 }
 
 //=============================================================================================================
@@ -222,108 +412,84 @@ QPair<double, double> Network::getMinMaxThresholdedWeights() const
 
 QPair<int,int> Network::getMinMaxFullDegrees() const
 {
-    int maxDegree = 0;
-    int minDegree = 1000000;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(false, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        if(m_lNodes.at(i)->getFullDegree() > maxDegree){
-            maxDegree = m_lNodes.at(i)->getFullDegree();
-        } else if (m_lNodes.at(i)->getFullDegree() < minDegree){
-            minDegree = m_lNodes.at(i)->getFullDegree();
-        }
+    if(vecDegree.size() == 0) {
+        return QPair<int,int>(0,0);
     }
 
-    return QPair<int,int>(minDegree,maxDegree);
+    return QPair<int,int>(vecDegree.minCoeff(),vecDegree.maxCoeff());
 }
 
 //=============================================================================================================
 
 QPair<int,int> Network::getMinMaxThresholdedDegrees() const
 {
-    int maxDegree = 0;
-    int minDegree = 1000000;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(true, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        if(m_lNodes.at(i)->getThresholdedDegree() > maxDegree){
-            maxDegree = m_lNodes.at(i)->getThresholdedDegree();
-        } else if (m_lNodes.at(i)->getThresholdedDegree() < minDegree){
-            minDegree = m_lNodes.at(i)->getThresholdedDegree();
-        }
+    if(vecDegree.size() == 0) {
+        return QPair<int,int>(0,0);
     }
 
-    return QPair<int,int>(minDegree,maxDegree);
+    return QPair<int,int>(vecDegree.minCoeff(),vecDegree.maxCoeff());
 }
 
 //=============================================================================================================
 
 QPair<int,int> Network::getMinMaxFullIndegrees() const
 {
-    int maxDegree = 0;
-    int minDegree = 1000000;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(false, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        if(m_lNodes.at(i)->getFullIndegree() > maxDegree){
-            maxDegree = m_lNodes.at(i)->getFullIndegree();
-        } else if (m_lNodes.at(i)->getFullIndegree() < minDegree){
-            minDegree = m_lNodes.at(i)->getFullIndegree();
-        }
+    if(vecIndegree.size() == 0) {
+        return QPair<int,int>(0,0);
     }
 
-    return QPair<int,int>(minDegree,maxDegree);
+    return QPair<int,int>(vecIndegree.minCoeff(),vecIndegree.maxCoeff());
 }
 
 //=============================================================================================================
 
 QPair<int,int> Network::getMinMaxThresholdedIndegrees() const
 {
-    int maxDegree = 0;
-    int minDegree = 1000000;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(true, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        if(m_lNodes.at(i)->getThresholdedIndegree() > maxDegree){
-            maxDegree = m_lNodes.at(i)->getThresholdedIndegree();
-        } else if (m_lNodes.at(i)->getThresholdedIndegree() < minDegree){
-            minDegree = m_lNodes.at(i)->getThresholdedIndegree();
-        }
+    if(vecIndegree.size() == 0) {
+        return QPair<int,int>(0,0);
     }
 
-    return QPair<int,int>(minDegree,maxDegree);
+    return QPair<int,int>(vecIndegree.minCoeff(),vecIndegree.maxCoeff());
 }
 
 //=============================================================================================================
 
 QPair<int,int> Network::getMinMaxFullOutdegrees() const
 {
-    int maxDegree = 0;
-    int minDegree = 1000000;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(false, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        if(m_lNodes.at(i)->getFullOutdegree() > maxDegree){
-            maxDegree = m_lNodes.at(i)->getFullOutdegree();
-        } else if (m_lNodes.at(i)->getFullOutdegree() < minDegree){
-            minDegree = m_lNodes.at(i)->getFullOutdegree();
-        }
+    if(vecOutdegree.size() == 0) {
+        return QPair<int,int>(0,0);
     }
 
-    return QPair<int,int>(minDegree,maxDegree);
+    return QPair<int,int>(vecOutdegree.minCoeff(),vecOutdegree.maxCoeff());
 }
 
 //=============================================================================================================
 
 QPair<int,int> Network::getMinMaxThresholdedOutdegrees() const
 {
-    int maxDegree = 0;
-    int minDegree = 1000000;
+    VectorXi vecDegree, vecIndegree, vecOutdegree;
+    computeDegrees(true, vecDegree, vecIndegree, vecOutdegree);
 
-    for(int i = 0; i < m_lNodes.size(); ++i) {
-        if(m_lNodes.at(i)->getThresholdedOutdegree() > maxDegree){
-            maxDegree = m_lNodes.at(i)->getThresholdedOutdegree();
-        } else if (m_lNodes.at(i)->getThresholdedOutdegree() < minDegree){
-            minDegree = m_lNodes.at(i)->getThresholdedOutdegree();
-        }
+    if(vecOutdegree.size() == 0) {
+        return QPair<int,int>(0,0);
     }
 
-    return QPair<int,int>(minDegree,maxDegree);
+    return QPair<int,int>(vecOutdegree.minCoeff(),vecOutdegree.maxCoeff());
 }
 
 //=============================================================================================================
@@ -331,19 +497,11 @@ QPair<int,int> Network::getMinMaxThresholdedOutdegrees() const
 void Network::setThreshold(double dThreshold)
 {
     m_dThreshold = dThreshold;
-    m_lThresholdedEdges.clear();
-
-    for(int i = 0; i < m_lFullEdges.size(); ++i) {
-        if(fabs(m_lFullEdges.at(i)->getWeight()) >= m_dThreshold) {
-            m_lFullEdges.at(i)->setActive(true);
-            m_lThresholdedEdges.append(m_lFullEdges.at(i));
-        } else {
-            m_lFullEdges.at(i)->setActive(false);
-        }
-    }
 
     m_minMaxThresholdedWeights.first = m_dThreshold;
     m_minMaxThresholdedWeights.second = m_minMaxFullWeights.second;
+
+    invalidate();
 }
 
 //=============================================================================================================
@@ -382,21 +540,10 @@ void Network::setFrequencyRange(float fLowerFreq, float fUpperFreq)
     m_minMaxFrequency.first = fLowerFreq;
     m_minMaxFrequency.second = fUpperFreq;
 
-    int iLowerBin = fLowerFreq * dScaleFactor;
-    int iUpperBin = fUpperFreq * dScaleFactor;
+    m_minMaxFreqBins.first = fLowerFreq * dScaleFactor;
+    m_minMaxFreqBins.second = fUpperFreq * dScaleFactor;
 
-    // Update the min max values
-    m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
-
-    for(int i = 0; i < m_lFullEdges.size(); ++i) {
-        m_lFullEdges.at(i)->setFrequencyBins(QPair<int,int>(iLowerBin,iUpperBin));
-
-        if(fabs(m_lFullEdges.at(i)->getWeight()) < m_minMaxFullWeights.first) {
-            m_minMaxFullWeights.first = fabs(m_lFullEdges.at(i)->getWeight());
-        } else if(fabs(m_lFullEdges.at(i)->getWeight()) > m_minMaxFullWeights.second) {
-            m_minMaxFullWeights.second = fabs(m_lFullEdges.at(i)->getWeight());
-        }
-    }
+    updateWeights();
 }
 
 //=============================================================================================================
@@ -408,21 +555,53 @@ const QPair<float,float>& Network::getFrequencyRange() const
 
 //=============================================================================================================
 
+void Network::setFrequencyBinRange(int iLowerBin, int iUpperBin)
+{
+    if((iLowerBin != -1 || iUpperBin != -1) && (iLowerBin < 0 || iUpperBin < iLowerBin)) {
+        qDebug() << "Network::setFrequencyBinRange - Frequency bins" << iLowerBin << iUpperBin << "are out of range. Returning.";
+        return;
+    }
+
+    m_minMaxFreqBins.first = iLowerBin;
+    m_minMaxFreqBins.second = iUpperBin;
+
+    updateWeights();
+}
+
+//=============================================================================================================
+
 void Network::append(NetworkEdge::SPtr newEdge)
 {
-    if(newEdge->getEndNodeID() != newEdge->getStartNodeID()) {
-        double dEdgeWeight = newEdge->getWeight();
-        if(dEdgeWeight < m_minMaxFullWeights.first) {
-            m_minMaxFullWeights.first = dEdgeWeight;
-        } else if(dEdgeWeight >= m_minMaxFullWeights.second) {
-            m_minMaxFullWeights.second = dEdgeWeight;
-        }
+    int iStartNodeID = newEdge->getStartNodeID();
+    int iEndNodeID = newEdge->getEndNodeID();
+
+    if(iEndNodeID == iStartNodeID) {
+        return;
+    }
 
-        m_lFullEdges << newEdge;
+    MatrixXd matWeight = newEdge->getMatrixWeight();
 
-        if(fabs(newEdge->getWeight()) >= m_dThreshold) {
-            m_lThresholdedEdges << newEdge;
+    if(m_matWeightSums.cols() == 0) {
+        initWeights(std::max(m_lNodes.size(), std::max(iStartNodeID, iEndNodeID) + 1),
+                    matWeight.rows());
+    }
+
+    setWeights(iStartNodeID,
+               iEndNodeID,
+               matWeight.col(0));
+
+    if(iStartNodeID < m_iNumberNodes && iEndNodeID < m_iNumberNodes) {
+        double dEdgeWeight = newEdge->getWeight();
+        m_vecWeights[getPairIndex(iStartNodeID, iEndNodeID)] = dEdgeWeight;
+
+        if(fabs(dEdgeWeight) < m_minMaxFullWeights.first) {
+            m_minMaxFullWeights.first = fabs(dEdgeWeight);
+        }
+        if(fabs(dEdgeWeight) > m_minMaxFullWeights.second) {
+            m_minMaxFullWeights.second = fabs(dEdgeWeight);
         }
+
+        invalidate();
     }
 }
 
@@ -431,13 +610,15 @@ void Network::append(NetworkEdge::SPtr newEdge)
 void Network::append(NetworkNode::SPtr newNode)
 {
     m_lNodes << newNode;
+
+    invalidate();
 }
 
 //=============================================================================================================
 
 bool Network::isEmpty() const
 {
-    if(m_lFullEdges.isEmpty() || m_lNodes.isEmpty()) {
+    if(m_vecWeights.size() == 0 || m_lNodes.isEmpty()) {
         return true;
     }
 
@@ -454,15 +635,15 @@ void Network::normalize()
         return;
     }
 
-    for(int i = 0; i < m_lFullEdges.size(); ++i) {
-        m_lFullEdges.at(i)->setWeight(m_lFullEdges.at(i)->getWeight()/m_minMaxFullWeights.second);
-    }
+    m_vecWeights /= m_minMaxFullWeights.second;
 
     m_minMaxFullWeights.first = m_minMaxFullWeights.first/m_minMaxFullWeights.second;
     m_minMaxFullWeights.second = 1.0;
 
     m_minMaxThresholdedWeights.first = m_minMaxThresholdedWeights.first/m_minMaxThresholdedWeights.second;
     m_minMaxThresholdedWeights.second = 1.0;
+
+    invalidate();
 }
 
 //=============================================================================================================
@@ -521,3 +702,142 @@ int Network::getFFTSize()
     return m_iFFTSize;
 }
 
+//=============================================================================================================
+
+void Network::setFirstFreqBin(int iFirstFreqBin)
+{
+    m_iFirstFreqBin = iFirstFreqBin;
+}
+
+//=============================================================================================================
+
+int Network::getFirstFreqBin() const
+{
+    return m_iFirstFreqBin;
+}
+
+
+//=============================================================================================================
+
+void Network::computeDegrees(bool bThresholded,
+                             VectorXi& vecDegree,
+                             VectorXi& vecIndegree,
+                             VectorXi& vecOutdegree) const
+{
+    const int iNumberNodes = getNumberNodes();
+
+    vecDegree = VectorXi::Zero(iNumberNodes);
+    vecIndegree = VectorXi::Zero(iNumberNodes);
+    vecOutdegree = VectorXi::Zero(iNumberNodes);
+
+    if(!bThresholded) {
+        // Every node pair is an edge. Edges run from the lower to the higher node index.
+        for(int i = 0; i < iNumberNodes && i < m_iNumberNodes; ++i) {
+            vecDegree[i] = m_iNumberNodes - 1;
+            vecIndegree[i] = i;
+            vecOutdegree[i] = m_iNumberNodes - 1 - i;
+        }
+
+        return;
+    }
+
+    updateAdjacency();
+
+    for(int i = 0; i < m_cache.matThresholdedAdjacency.outerSize() && i < iNumberNodes; ++i) {
+        for(SparseMatrix<double, RowMajor>::InnerIterator it(m_cache.matThresholdedAdjacency, i); it; ++it) {
+            vecDegree[i]++;
+
+            if(it.col() < i) {
+                vecIndegree[i]++;
+            } else {
+                vecOutdegree[i]++;
+            }
+        }
+    }
+}
+
+//=============================================================================================================
+
+void Network::updateAdjacency() const
+{
+    QMutexLocker locker(&m_cache.mutex);
+
+    if(m_cache.bAdjacencyValid) {
+        return;
+    }
+
+    typedef Eigen::Triplet<double> T;
+    std::vector<T> tripletList;
+
+    int iPair = 0;
+
+    for(int i = 0; i < m_iNumberNodes; ++i) {
+        for(int j = i + 1; j < m_iNumberNodes; ++j, ++iPair) {
+            if(fabs(m_vecWeights[iPair]) >= m_dThreshold) {
+                tripletList.push_back(T(i, j, m_vecWeights[iPair]));
+                tripletList.push_back(T(j, i, m_vecWeights[iPair]));
+            }
+        }
+    }
+
+    m_cache.matThresholdedAdjacency.resize(m_iNumberNodes, m_iNumberNodes);
+    m_cache.matThresholdedAdjacency.setFromTriplets(tripletList.begin(), tripletList.end());
+    m_cache.matThresholdedAdjacency.makeCompressed();
+
+    m_cache.bAdjacencyValid = true;
+}
+
+//=============================================================================================================
+
+void Network::updateViews() const
+{
+    QMutexLocker locker(&m_cache.mutex);
+
+    if(m_cache.bViewsValid) {
+        return;
+    }
+
+    m_cache.lFullEdges.clear();
+    m_cache.lThresholdedEdges.clear();
+    m_cache.lNodeViews.clear();
+
+    for(int i = 0; i < m_lNodes.size(); ++i) {
+        m_cache.lNodeViews << NetworkNode::SPtr(new NetworkNode(m_lNodes.at(i)->getId(), m_lNodes.at(i)->getVert()));
+    }
+
+    MatrixXd matWeight(1,1);
+    NetworkEdge::SPtr pEdge;
+    int iPair = 0;
+
+    for(int i = 0; i < m_iNumberNodes; ++i) {
+        for(int j = i + 1; j < m_iNumberNodes; ++j, ++iPair) {
+            matWeight(0,0) = m_vecWeights[iPair];
+
+            bool bActive = fabs(m_vecWeights[iPair]) >= m_dThreshold;
+            pEdge = NetworkEdge::SPtr(new NetworkEdge(i, j, matWeight, bActive));
+
+            m_cache.lFullEdges << pEdge;
+
+            if(bActive) {
+                m_cache.lThresholdedEdges << pEdge;
+            }
+
+            if(i < m_cache.lNodeViews.size() && j < m_cache.lNodeViews.size()) {
+                m_cache.lNodeViews.at(i)->append(pEdge);
+                m_cache.lNodeViews.at(j)->append(pEdge);
+            }
+        }
+    }
+
+    m_cache.bViewsValid = true;
+}
+
+//=============================================================================================================
+
+void Network::invalidate()
+{
+    QMutexLocker locker(&m_cache.mutex);
+
+    m_cache.bAdjacencyValid = false;
+    m_cache.bViewsValid = false;
+}
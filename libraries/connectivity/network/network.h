@@ -46,12 +46,14 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QMutex>
 
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
 
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 //=============================================================================================================
 // FORWARD DECLARATIONS
@@ -81,6 +83,11 @@ struct VisualizationInfo {
 /**
  * This class holds information (nodes and connecting edges) about a network, can compute a distance table and provide network metrics.
  *
+ * The network is non-directional. Its edge weights are stored packed for all node pairs i < j, with the frequency bins of
+ * each pair stored as running (prefix) sums. Averaging a pair over any frequency band is therefore a single subtraction.
+ * Thresholding yields a sparse adjacency (CSR) matrix. Node and edge objects are only created on request, for callers
+ * which still need them.
+ *
  * @brief This class holds information about a network, can compute a distance table and provide network metrics.
  */
 
@@ -127,7 +134,68 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns the full and non thresholded edges.
+     * Returns the thresholded network as a symmetric sparse adjacency matrix in compressed row (CSR) format.
+     *
+     * @return    The thresholded adjacency matrix with the band averaged weights as values.
+     */
+    const Eigen::SparseMatrix<double, Eigen::RowMajor>& getThresholdedAdjacency() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the degree of each node in the thresholded network.
+     *
+     * @return    The node degrees.
+     */
+    Eigen::VectorXi getThresholdedDegrees() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the node positions.
+     *
+     * @return    The node positions, one row per node.
+     */
+    Eigen::MatrixXf getNodeVertices() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of nodes.
+     *
+     * @return    The number of nodes.
+     */
+    int getNumberNodes() const;
+
+    //=========================================================================================================
+    /**
+     * Allocates and zeros the packed weight storage. Must be called before setWeights.
+     *
+     * @param[in] iNumberNodes     The number of nodes.
+     * @param[in] iNumberBins      The number of frequency bins stored per node pair.
+     */
+    void initWeights(int iNumberNodes,
+                     int iNumberBins);
+
+    //=========================================================================================================
+    /**
+     * Sets the weights of a node pair. Self pairs are ignored. Different pairs can be set concurrently from several threads.
+     * Call updateWeights once all pairs are set.
+     *
+     * @param[in] iStartNodeID     The first node of the pair.
+     * @param[in] iEndNodeID       The second node of the pair.
+     * @param[in] vecWeights       The weights, one per frequency bin.
+     */
+    void setWeights(int iStartNodeID,
+                    int iEndNodeID,
+                    const Eigen::VectorXd& vecWeights);
+
+    //=========================================================================================================
+    /**
+     * Recalculates the band averaged weights of all node pairs and their minimum and maximum.
+     */
+    void updateWeights();
+
+    //=========================================================================================================
+    /**
+     * Returns the full and non thresholded edges. The edges are created on first request and hold the band averaged weight.
      *
      * @return Returns the network edges.
      */
@@ -143,7 +211,7 @@ public:
 
     //=========================================================================================================
     /**
-     * Returns the nodes.
+     * Returns the nodes. The nodes and their edges are created on first request.
      *
      * @return Returns the network nodes.
      */
@@ -298,6 +366,15 @@ public:
      */
     const QPair<float,float>& getFrequencyRange() const;
 
+    //=========================================================================================================
+    /**
+     * Sets the frequency bins of the half spectrum to average from/to. Setting both to -1 averages all stored bins.
+     *
+     * @param[in] iLowerBin        The lower frequency bin to average from.
+     * @param[in] iUpperBin        The upper frequency bin to average to.
+     */
+    void setFrequencyBinRange(int iLowerBin, int iUpperBin);
+
     //=========================================================================================================
     /**
      * Appends a network edge to this network node.
@@ -392,11 +469,94 @@ public:
      */
     int getFFTSize();
 
+    //=========================================================================================================
+    /**
+     * Set the frequency bin the first stored weight corresponds to. Used if only a part of the spectrum was
+     * computed.
+     *
+     * @param[in] iFirstFreqBin        The first used frequency bin of the half spectrum.
+     */
+    void setFirstFreqBin(int iFirstFreqBin);
+
+    //=========================================================================================================
+    /**
+     * Returns the frequency bin the first stored weight corresponds to.
+     *
+     * @return   The first used frequency bin of the half spectrum.
+     */
+    int getFirstFreqBin() const;
+
 protected:
-    QList<QSharedPointer<NetworkEdge> >     m_lFullEdges;               /**< List with all edges of the network.*/
-    QList<QSharedPointer<NetworkEdge> >     m_lThresholdedEdges;        /**< List with all the active (thresholded) edges of the network.*/
+    //=========================================================================================================
+    /**
+     * Returns the packed index of the node pair (i,j).
+     *
+     * @param[in] i      The first node. Must differ from j.
+     * @param[in] j      The second node.
+     *
+     * @return   The index into the packed pair storage.
+     */
+    inline int getPairIndex(int i, int j) const;
 
-    QList<QSharedPointer<NetworkNode> >     m_lNodes;                   /**< List with all nodes of the network.*/
+    //=========================================================================================================
+    /**
+     * Computes the degree, indegree and outdegree of every node of the full or thresholded network.
+     *
+     * @param[in] bThresholded       Whether to use the thresholded network.
+     * @param[out] vecDegree         The node degrees.
+     * @param[out] vecIndegree       The node indegrees.
+     * @param[out] vecOutdegree      The node outdegrees.
+     */
+    void computeDegrees(bool bThresholded,
+                        Eigen::VectorXi& vecDegree,
+                        Eigen::VectorXi& vecIndegree,
+                        Eigen::VectorXi& vecOutdegree) const;
+
+    //=========================================================================================================
+    /**
+     * The caches are built on first use by the const getters. The mutex serializes this, so that a network can be
+     * read from several threads at once. A copy gets its own mutex.
+     */
+    struct Cache {
+        Cache();
+        Cache(const Cache& other);
+        Cache& operator=(const Cache& other);
+
+        mutable QMutex                                  mutex;                      /**< Guards the caches.*/
+        Eigen::SparseMatrix<double, Eigen::RowMajor>    matThresholdedAdjacency;    /**< Cached thresholded adjacency matrix.*/
+        bool                                            bAdjacencyValid;            /**< Whether matThresholdedAdjacency is up to date.*/
+        QList<QSharedPointer<NetworkEdge> >             lFullEdges;                 /**< Cached list with all edges of the network.*/
+        QList<QSharedPointer<NetworkEdge> >             lThresholdedEdges;          /**< Cached list with all the active (thresholded) edges of the network.*/
+        QList<QSharedPointer<NetworkNode> >             lNodeViews;                 /**< Cached nodes holding their edges.*/
+        bool                                            bViewsValid;                /**< Whether the cached nodes and edges are up to date.*/
+    };
+
+    //=========================================================================================================
+    /**
+     * Rebuilds the thresholded adjacency matrix if it is out of date.
+     */
+    void updateAdjacency() const;
+
+    //=========================================================================================================
+    /**
+     * Creates the node and edge objects if they are out of date.
+     */
+    void updateViews() const;
+
+    //=========================================================================================================
+    /**
+     * Marks the adjacency matrix and the node and edge objects as out of date.
+     */
+    void invalidate();
+
+    Eigen::MatrixXd                         m_matWeightSums;            /**< Running sums over the frequency bins (rows, with a leading zero row) for each node pair i < j (columns).*/
+    Eigen::VectorXd                         m_vecWeights;               /**< The band averaged weight of each node pair i < j.*/
+    int                                     m_iNumberNodes;             /**< The number of nodes the weight storage was allocated for.*/
+    QPair<int,int>                          m_minMaxFreqBins;           /**< The lower/upper bin to average from/to. -1 means all bins.*/
+
+    QList<QSharedPointer<NetworkNode> >     m_lNodes;                   /**< List with all nodes of the network as appended, i.e. without edges.*/
+
+    mutable Cache                           m_cache;                    /**< The adjacency matrix and node/edge objects, built on first use.*/
 
     Eigen::MatrixXd                         m_matDistMatrix;            /**< The distance matrix.*/
 
@@ -410,6 +570,7 @@ protected:
     float                                   m_fSFreq;                   /**< The sampling frequency used to collect the data which this network is based on.*/
     int                                     m_iNumberFreqBins;          /**< The number of used frequency bins.*/
     int                                     m_iFFTSize;                 /**< The used FFT size (number of total frequency bins for a half spectrum - only positive frequencies).*/
+    int                                     m_iFirstFreqBin;            /**< The frequency bin of the half spectrum the first stored weight corresponds to.*/
 
     VisualizationInfo                       m_visualizationInfo;        /**< The current visualization info used to plot the network later on.*/
 };
@@ -417,6 +578,15 @@ protected:
 //=============================================================================================================
 // INLINE DEFINITIONS
 //=============================================================================================================
+
+inline int Network::getPairIndex(int i, int j) const
+{
+    if(i > j) {
+        std::swap(i, j);
+    }
+
+    return i * (2 * m_iNumberNodes - i - 1) / 2 + (j - i - 1);
+}
 } // namespace CONNECTIVITYLIB
 
 #ifndef metatype_networks
@@ -0,0 +1,202 @@
+//=============================================================================================================
+/**
+ * @file     minmaxpyramid.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    MinMaxPyramid class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "minmaxpyramid.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace DISPLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+MinMaxPyramid::MinMaxPyramid(int iBaseBinWidth,
+                             int iLevelFactor)
+: m_iBaseBinWidth(std::max(2, iBaseBinWidth))
+, m_iLevelFactor(std::max(2, iLevelFactor))
+, m_iNumSamples(0)
+{
+}
+
+//=============================================================================================================
+
+void MinMaxPyramid::build(const MatrixXd& matData)
+{
+    resize(matData.rows(), matData.cols());
+
+    if(m_vecBinWidths.isEmpty()) {
+        return;
+    }
+
+    updateBins(matData, 0, numBins(0) - 1);
+}
+
+//=============================================================================================================
+
+void MinMaxPyramid::resize(int iNumRows,
+                           int iNumSamples)
+{
+    clear();
+
+    if(iNumRows <= 0 || iNumSamples <= 0) {
+        return;
+    }
+
+    m_iNumSamples = iNumSamples;
+
+    // Add levels until a single bin covers all samples
+    int iBinWidth = m_iBaseBinWidth;
+    while(true) {
+        int iNumBins = (iNumSamples + iBinWidth - 1) / iBinWidth;
+
+        m_vecBinWidths.append(iBinWidth);
+        m_vecMin.append(MatrixXfR(iNumRows, iNumBins));
+        m_vecMax.append(MatrixXfR(iNumRows, iNumBins));
+
+        if(iNumBins <= 1) {
+            break;
+        }
+        iBinWidth *= m_iLevelFactor;
+    }
+}
+
+//=============================================================================================================
+
+void MinMaxPyramid::update(const MatrixXdR& matData,
+                           int iFirstSample,
+                           int iNumSamples)
+{
+    if(m_vecBinWidths.isEmpty() || matData.cols() != m_iNumSamples || matData.rows() != numRows()) {
+        return;
+    }
+
+    if(iNumSamples >= m_iNumSamples) {
+        updateBins(matData, 0, numBins(0) - 1);
+        return;
+    }
+
+    if(iNumSamples <= 0) {
+        return;
+    }
+
+    // Map into the ring and split the range where it wraps around
+    int iStart = iFirstSample % m_iNumSamples;
+    if(iStart < 0) {
+        iStart += m_iNumSamples;
+    }
+    int iEnd = iStart + iNumSamples;
+
+    if(iEnd > m_iNumSamples) {
+        updateBins(matData, iStart / m_iBaseBinWidth, numBins(0) - 1);
+        updateBins(matData, 0, (iEnd - m_iNumSamples - 1) / m_iBaseBinWidth);
+    } else {
+        updateBins(matData, iStart / m_iBaseBinWidth, (iEnd - 1) / m_iBaseBinWidth);
+    }
+}
+
+//=============================================================================================================
+
+void MinMaxPyramid::clear()
+{
+    m_iNumSamples = 0;
+    m_vecBinWidths.clear();
+    m_vecMin.clear();
+    m_vecMax.clear();
+}
+
+//=============================================================================================================
+
+int MinMaxPyramid::levelForSamplesPerPixel(double dSamplesPerPixel) const
+{
+    int iLevel = -1;
+
+    for(int i = 0; i < m_vecBinWidths.size(); ++i) {
+        if(m_vecBinWidths.at(i) > dSamplesPerPixel) {
+            break;
+        }
+        iLevel = i;
+    }
+
+    return iLevel;
+}
+
+//=============================================================================================================
+
+template<typename T>
+void MinMaxPyramid::updateBins(const MatrixBase<T>& matData,
+                               int iFirstBin,
+                               int iLastBin)
+{
+    // Level 0 from the samples. Reducing column blocks keeps the access pattern contiguous for column-major data.
+    for(int b = iFirstBin; b <= iLastBin; ++b) {
+        int iStart = b * m_iBaseBinWidth;
+        int iLength = std::min(m_iBaseBinWidth, m_iNumSamples - iStart);
+
+        m_vecMin[0].col(b) = matData.middleCols(iStart, iLength).rowwise().minCoeff().template cast<float>();
+        m_vecMax[0].col(b) = matData.middleCols(iStart, iLength).rowwise().maxCoeff().template cast<float>();
+    }
+
+    // Every further level from the one below
+    for(int l = 1; l < m_vecBinWidths.size(); ++l) {
+        iFirstBin /= m_iLevelFactor;
+        iLastBin /= m_iLevelFactor;
+
+        const MatrixXfR& matMinBelow = m_vecMin.at(l - 1);
+        const MatrixXfR& matMaxBelow = m_vecMax.at(l - 1);
+
+        for(int b = iFirstBin; b <= iLastBin; ++b) {
+            int iStart = b * m_iLevelFactor;
+            int iLength = std::min<int>(m_iLevelFactor, matMinBelow.cols() - iStart);
+
+            m_vecMin[l].col(b) = matMinBelow.middleCols(iStart, iLength).rowwise().minCoeff();
+            m_vecMax[l].col(b) = matMaxBelow.middleCols(iStart, iLength).rowwise().maxCoeff();
+        }
+    }
+}
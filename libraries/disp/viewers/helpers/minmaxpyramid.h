@@ -0,0 +1,279 @@
+//=============================================================================================================
+/**
+ * @file     minmaxpyramid.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    MinMaxPyramid class declaration.
+ *
+ */
+
+#ifndef MINMAXPYRAMID_H
+#define MINMAXPYRAMID_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../../disp_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+//=============================================================================================================
+// DEFINE NAMESPACE DISPLIB
+//=============================================================================================================
+
+namespace DISPLIB
+{
+
+//=============================================================================================================
+// DISPLIB FORWARD DECLARATIONS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+ * Multi-resolution min/max decimation of multi-channel data. Level 0 holds the minimum and maximum of every bin of
+ * iBaseBinWidth samples per channel, every further level combines iLevelFactor bins of the level below. The values
+ * are stored in float and row-major, so that the bins of one channel are contiguous.
+ *
+ * Viewers pick the level matching the current number of samples per pixel and draw the min/max envelope instead of
+ * the single samples, which bounds the number of drawn points by the widget width.
+ *
+ * @brief Per-channel min/max decimation pyramid.
+ */
+class DISPSHARED_EXPORT MinMaxPyramid
+{
+
+public:
+    typedef QSharedPointer<MinMaxPyramid> SPtr;              /**< Shared pointer type for MinMaxPyramid. */
+    typedef QSharedPointer<const MinMaxPyramid> ConstSPtr;   /**< Const shared pointer type for MinMaxPyramid. */
+
+    typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> MatrixXdR;
+    typedef Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> MatrixXfR;
+
+    //=========================================================================================================
+    /**
+     * Constructs a MinMaxPyramid object.
+     *
+     * @param[in] iBaseBinWidth     Number of samples per bin in level 0. Default is 4.
+     * @param[in] iLevelFactor      Number of bins combined into one bin of the next level. Default is 4.
+     */
+    explicit MinMaxPyramid(int iBaseBinWidth = 4,
+                           int iLevelFactor = 4);
+
+    //=========================================================================================================
+    /**
+     * Builds all levels from the given data block (channels x samples).
+     *
+     * @param[in] matData   The data to decimate.
+     */
+    void build(const Eigen::MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+     * Allocates all levels for data of the given size without computing them. Use with update() when the data is
+     * a ring buffer that is filled piecewise.
+     *
+     * @param[in] iNumRows      Number of channels.
+     * @param[in] iNumSamples   Number of samples.
+     */
+    void resize(int iNumRows,
+                int iNumSamples);
+
+    //=========================================================================================================
+    /**
+     * Recomputes the bins of all levels which cover the given sample range. The range wraps around the end of the
+     * data, as it does in a ring buffer. The data size has to match the one set with resize().
+     *
+     * @param[in] matData       The full data matrix (channels x samples).
+     * @param[in] iFirstSample  First changed sample. May be negative or exceed the number of samples.
+     * @param[in] iNumSamples   Number of changed samples.
+     */
+    void update(const MatrixXdR& matData,
+                int iFirstSample,
+                int iNumSamples);
+
+    //=========================================================================================================
+    /**
+     * Removes all levels.
+     */
+    void clear();
+
+    //=========================================================================================================
+    /**
+     * Returns the level with the widest bins which still do not exceed one pixel, so that one to iLevelFactor bins
+     * are drawn per pixel.
+     *
+     * @param[in] dSamplesPerPixel  The number of samples drawn per pixel.
+     *
+     * @return The level index, or -1 if the samples should be drawn directly.
+     */
+    int levelForSamplesPerPixel(double dSamplesPerPixel) const;
+
+    //=========================================================================================================
+    /**
+     * @return The number of levels.
+     */
+    inline int numLevels() const;
+
+    //=========================================================================================================
+    /**
+     * @return The number of channels.
+     */
+    inline int numRows() const;
+
+    //=========================================================================================================
+    /**
+     * @return The number of decimated samples.
+     */
+    inline int numSamples() const;
+
+    //=========================================================================================================
+    /**
+     * @param[in] iLevel    The level.
+     *
+     * @return The number of samples per bin in the given level.
+     */
+    inline int binWidth(int iLevel) const;
+
+    //=========================================================================================================
+    /**
+     * @param[in] iLevel    The level.
+     *
+     * @return The number of bins in the given level. The last bin may cover less than binWidth() samples.
+     */
+    inline int numBins(int iLevel) const;
+
+    //=========================================================================================================
+    /**
+     * @param[in] iLevel    The level.
+     * @param[in] iRow      The channel.
+     *
+     * @return Pointer to the numBins() contiguous bin minima of the given channel.
+     */
+    inline const float* minRow(int iLevel,
+                               int iRow) const;
+
+    //=========================================================================================================
+    /**
+     * @param[in] iLevel    The level.
+     * @param[in] iRow      The channel.
+     *
+     * @return Pointer to the numBins() contiguous bin maxima of the given channel.
+     */
+    inline const float* maxRow(int iLevel,
+                               int iRow) const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Recomputes the bins [iFirstBin, iLastBin] of all levels from the data and propagates them upwards.
+     */
+    template<typename T>
+    void updateBins(const Eigen::MatrixBase<T>& matData,
+                    int iFirstBin,
+                    int iLastBin);
+
+    int                 m_iBaseBinWidth;    /**< Number of samples per bin in level 0. */
+    int                 m_iLevelFactor;     /**< Number of bins combined per level. */
+    int                 m_iNumSamples;      /**< Number of decimated samples. */
+
+    QVector<int>        m_vecBinWidths;     /**< Number of samples per bin for each level. */
+    QVector<MatrixXfR>  m_vecMin;           /**< Bin minima (channels x bins) for each level. */
+    QVector<MatrixXfR>  m_vecMax;           /**< Bin maxima (channels x bins) for each level. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline int MinMaxPyramid::numLevels() const
+{
+    return m_vecBinWidths.size();
+}
+
+//=============================================================================================================
+
+inline int MinMaxPyramid::numRows() const
+{
+    return m_vecMin.isEmpty() ? 0 : m_vecMin.first().rows();
+}
+
+//=============================================================================================================
+
+inline int MinMaxPyramid::numSamples() const
+{
+    return m_iNumSamples;
+}
+
+//=============================================================================================================
+
+inline int MinMaxPyramid::binWidth(int iLevel) const
+{
+    return m_vecBinWidths.at(iLevel);
+}
+
+//=============================================================================================================
+
+inline int MinMaxPyramid::numBins(int iLevel) const
+{
+    return m_vecMin.at(iLevel).cols();
+}
+
+//=============================================================================================================
+
+inline const float* MinMaxPyramid::minRow(int iLevel,
+                                          int iRow) const
+{
+    return m_vecMin.at(iLevel).data() + iRow * m_vecMin.at(iLevel).cols();
+}
+
+//=============================================================================================================
+
+inline const float* MinMaxPyramid::maxRow(int iLevel,
+                                          int iRow) const
+{
+    return m_vecMax.at(iLevel).data() + iRow * m_vecMax.at(iLevel).cols();
+}
+} // NAMESPACE DISPLIB
+
+#endif // MINMAXPYRAMID_H
@@ -525,6 +525,47 @@ void RtFiffRawViewDelegate::createPlotPath(const QModelIndex &index,
         path.moveTo(qSamplePosition);
     }
 
+    //If more than one sample falls onto a pixel, draw the min/max envelope of the matching pyramid level instead of
+    //skipping samples. This keeps peaks visible and bounds the number of points by the widget width.
+    const MinMaxPyramid& pyramid = t_pModel->getPyramid();
+    int iLevel = -1;
+    if(data.second > 0 && pyramid.numSamples() == data.second && option.rect.width() > 0) {
+        iLevel = pyramid.levelForSamplesPerPixel((double)data.second / option.rect.width());
+    }
+
+    if(iLevel >= 0) {
+        int iRow = t_pModel->getIdxSelMap().value(index.row(),0);
+        const float* pMin = pyramid.minRow(iLevel, iRow);
+        const float* pMax = pyramid.maxRow(iLevel, iRow);
+        int iBinWidth = pyramid.binWidth(iLevel);
+        double dSampleDx = (double)option.rect.width() / data.second;
+        double dX = path.currentPosition().x();
+        double dOffset;
+
+        for(qint32 b = 0; b < pyramid.numBins(iLevel); ++b) {
+            //Remove the same offsets as for the single samples below
+            dOffset = (b * iBinWidth < currentSampleIndex) ? *(data.first) : lastFirstValue;
+
+            path.lineTo(dX, y_base - (pMax[b] - dOffset) * dScaleY);
+            path.lineTo(dX, y_base - (pMin[b] - dOffset) * dScaleY);
+
+            dX += dSampleDx * iBinWidth;
+        }
+
+        //Create ellipse position
+        qint32 j = (qint32)(m_markerPosition.x() / dSampleDx);
+        if(j >= 0 && j < data.second) {
+            dOffset = (j < currentSampleIndex) ? *(data.first) : lastFirstValue;
+
+            ellipsePos.setX(qSamplePosition.x() + j * dSampleDx);
+            ellipsePos.setY(y_base - (*(data.first+j) - dOffset) * dScaleY);
+
+            amplitude = QString::number(*(data.first+j));
+        }
+
+        return;
+    }
+
     for(qint32 j = 0; j < data.second; j += iSkip) {
         if(j < currentSampleIndex) {
             dValue = *(data.first+j) - *(data.first); //remove first sample data[0] as offset
@@ -96,6 +96,7 @@ RtFiffRawViewModel::RtFiffRawViewModel(QObject *parent)
 , m_dTriggerThreshold(0.01)
 , m_iDistanceTimerSpacer(1000)
 , m_iDetectedTriggers(0)
+, m_iTriggerStreamSample(0)
 , m_iCurrentSampleFreeze(0)
 , m_iCurrentTriggerChIndex(0)
 , m_pFiffInfo(FiffInfo::SPtr::create())
@@ -315,6 +316,8 @@ void RtFiffRawViewModel::setFiffInfo(QSharedPointer<FIFFLIB::FiffInfo> &p_pFiffI
         m_vecLastBlockFirstValuesRaw.conservativeResize(m_pFiffInfo->chs.size());
         m_vecLastBlockFirstValuesRaw.setZero();
 
+        rebuildPyramids();
+
         m_matOverlap.conservativeResize(m_pFiffInfo->chs.size(), m_iMaxFilterLength);
 
         m_matSparseProjMult = SparseMatrix<double>(m_pFiffInfo->chs.size(),m_pFiffInfo->chs.size());
@@ -388,6 +391,8 @@ void RtFiffRawViewModel::setSamplingInfo(float sps, int T, bool bSetZero)
         m_iCurrentSample = 0;
     }
 
+    rebuildPyramids();
+
     endResetModel();
 }
 
@@ -525,6 +530,8 @@ void RtFiffRawViewModel::addData(const QList<MatrixXd> &data)
             }
         }
 
+        updatePyramids(m_iCurrentSample - m_iResidual, nCol + m_iResidual);
+
         m_iCurrentSample += nCol;
         m_iCurrentBlockSize = nCol;
 
@@ -532,11 +539,19 @@ void RtFiffRawViewModel::addData(const QList<MatrixXd> &data)
         if(m_bTriggerDetectionActive) {
             int iOldDetectedTriggers = m_qMapDetectedTrigger[m_iCurrentTriggerChIndex].size();
 
-            QList<QPair<int,double> > qMapDetectedTrigger = RTPROCESSINGLIB::detectTriggerFlanksMax(data.at(b), m_iCurrentTriggerChIndex, m_iCurrentSample-nCol, m_dTriggerThreshold, true, 500);
-            //QList<QPair<int,double> > qMapDetectedTrigger = RTPROCESSINGLIB::detectTriggerFlanksGrad(data.at(b), m_iCurrentTriggerChIndex, m_iCurrentSample-nCol, m_dTriggerThreshold, false, "Rising");
+            //Detect on the continous stream, so flanks at block borders are found once, and map them into the data matrix
+            m_triggerDetector.clearEvents();
+            m_triggerDetector.detect(data.at(b), m_iTriggerStreamSample);
+
+            Eigen::Ref<const Eigen::MatrixXi> matEvents = m_triggerDetector.events();
 
             //Append results to already found triggers
-            m_qMapDetectedTrigger[m_iCurrentTriggerChIndex].append(qMapDetectedTrigger);
+            for(int i = 0; i < matEvents.rows(); ++i) {
+                m_qMapDetectedTrigger[m_iCurrentTriggerChIndex].append(qMakePair(matEvents(i,0) - m_iTriggerStreamSample + m_iCurrentSample - nCol,
+                                                                                 double(matEvents(i,2))));
+            }
+
+            m_iTriggerStreamSample += nCol;
 
             //Compute newly counted triggers
             int newTriggers = m_qMapDetectedTrigger[m_iCurrentTriggerChIndex].size() - iOldDetectedTriggers;
@@ -642,11 +657,39 @@ void RtFiffRawViewModel::resetSelection()
         m_qMapIdxRowSelection.insert(i,i);
     }
 
+    rebuildPyramids();
+
     endResetModel();
 }
 
 //=============================================================================================================
 
+void RtFiffRawViewModel::updatePyramids(int iFirstSample, int iNumSamples)
+{
+    m_pyramidRaw.update(m_matDataRaw, iFirstSample, iNumSamples);
+
+    // The filtered data is written with the filter delay and the overlap of the previous block, possibly wrapping
+    // around to the end of the matrix
+    if(!m_filterKernel.isEmpty() && m_bPerformFiltering) {
+        m_pyramidFiltered.update(m_matDataFiltered, iFirstSample - m_iMaxFilterLength, iNumSamples + 2 * m_iMaxFilterLength);
+    } else {
+        m_pyramidFiltered.update(m_matDataFiltered, iFirstSample, iNumSamples);
+    }
+}
+
+//=============================================================================================================
+
+void RtFiffRawViewModel::rebuildPyramids()
+{
+    m_pyramidRaw.resize(m_matDataRaw.rows(), m_matDataRaw.cols());
+    m_pyramidRaw.update(m_matDataRaw, 0, m_matDataRaw.cols());
+
+    m_pyramidFiltered.resize(m_matDataFiltered.rows(), m_matDataFiltered.cols());
+    m_pyramidFiltered.update(m_matDataFiltered, 0, m_matDataFiltered.cols());
+}
+
+//=============================================================================================================
+
 void RtFiffRawViewModel::toggleFreeze(const QModelIndex &)
 {
     m_bIsFreezed = !m_bIsFreezed;
@@ -654,6 +697,8 @@ void RtFiffRawViewModel::toggleFreeze(const QModelIndex &)
     if(m_bIsFreezed) {
         m_matDataRawFreeze = m_matDataRaw;
         m_matDataFilteredFreeze = m_matDataFiltered;
+        m_pyramidRawFreeze = m_pyramidRaw;
+        m_pyramidFilteredFreeze = m_pyramidFiltered;
         m_qMapDetectedTriggerFreeze = m_qMapDetectedTrigger;
         m_qMapDetectedTriggerOldFreeze = m_qMapDetectedTriggerOld;
 
@@ -1045,6 +1090,13 @@ void RtFiffRawViewModel::triggerInfoChanged(const QMap<double, QColor>& colorMap
     }
 
     m_sCurrentTriggerCh = triggerCh;
+
+    //Restart the detection with the new settings
+    m_triggerDetector = RTPROCESSINGLIB::TriggerDetector(QList<int>() << m_iCurrentTriggerChIndex,
+                                                         m_dTriggerThreshold,
+                                                         true,
+                                                         500);
+    m_iTriggerStreamSample = 0;
 }
 
 //=============================================================================================================
@@ -1167,6 +1219,8 @@ void RtFiffRawViewModel::filterDataBlock()
         m_vecLastBlockFirstValuesFiltered = m_matDataFiltered.col(0);
     }
 
+    m_pyramidFiltered.update(m_matDataFiltered, 0, m_matDataFiltered.cols());
+
     //std::cout<<"END RtFiffRawViewModel::filterDataBlock"<<std::endl;
 }
 
@@ -1300,5 +1354,14 @@ void RtFiffRawViewModel::clearModel()
     m_vecLastBlockFirstValuesRaw.setZero();
     m_matOverlap.setZero();
 
+    // The delegate draws the envelopes of the pyramids, not the data matrices
+    rebuildPyramids();
+
+    m_pyramidRawFreeze.resize(m_matDataRawFreeze.rows(), m_matDataRawFreeze.cols());
+    m_pyramidRawFreeze.update(m_matDataRawFreeze, 0, m_matDataRawFreeze.cols());
+
+    m_pyramidFilteredFreeze.resize(m_matDataFilteredFreeze.rows(), m_matDataFilteredFreeze.cols());
+    m_pyramidFilteredFreeze.update(m_matDataFilteredFreeze, 0, m_matDataFilteredFreeze.cols());
+
     endResetModel();
 }
@@ -41,11 +41,13 @@
 //=============================================================================================================
 
 #include "../../disp_global.h"
+#include "minmaxpyramid.h"
 
 #include <fiff/fiff_types.h>
 #include <fiff/fiff_proj.h>
 
 #include <rtprocessing/helpers/filterkernel.h>
+#include <rtprocessing/detecttrigger.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -243,6 +245,15 @@ public:
      */
     inline double getLastBlockFirstValue(int row) const;
 
+    //=========================================================================================================
+    /**
+     * Returns the min/max pyramid of the data which is currently returned by data(), i.e., of the raw or filtered
+     * and of the streamed or frozen data. The pyramid rows are the data rows, see getIdxSelMap().
+     *
+     * @return the min/max pyramid of the displayed data
+     */
+    inline const MinMaxPyramid& getPyramid() const;
+
     //=========================================================================================================
     /**
      * Returns a map which conatins the channel idx and its corresponding selection status
@@ -532,6 +543,21 @@ private:
      */
     void clearModel();
 
+    //=========================================================================================================
+    /**
+     * Updates the min/max pyramids after new data was written to the data matrices
+     *
+     * @param [in] iFirstSample  first written sample in the raw data matrix
+     * @param [in] iNumSamples   number of written samples
+     */
+    void updatePyramids(int iFirstSample, int iNumSamples);
+
+    //=========================================================================================================
+    /**
+     * Reallocates and recomputes the min/max pyramids of the raw and filtered data matrices
+     */
+    void rebuildPyramids();
+
     bool                                m_bProjActivated;                           /**< Projections activated */
     bool                                m_bCompActivated;                           /**< Compensator activated */
     bool                                m_bSpharaActivated;                         /**< Sphara activated */
@@ -552,6 +578,7 @@ private:
     int                                 m_iCurrentTriggerChIndex;                   /**< The index of the current trigger channel */
     int                                 m_iDistanceTimerSpacer;                     /**< The distance for the horizontal time spacers in the view in ms */
     int                                 m_iDetectedTriggers;                        /**< Detected triggers since the last reset */
+    int                                 m_iTriggerStreamSample;                     /**< Number of samples passed to the trigger detector since it was reset */
 
     QString                             m_sCurrentTriggerCh;                        /**< Current trigger channel which is beeing scanned */
     QString                             m_sFilterChannelType;                       /**< Kind of channel which is to be filtered */
@@ -568,6 +595,11 @@ private:
     MatrixXdR                           m_matDataFilteredFreeze;                    /**< The raw filtered data in freeze mode */
     Eigen::MatrixXd                     m_matOverlap;                               /**< Last overlap block for the back */
 
+    MinMaxPyramid                       m_pyramidRaw;                               /**< Min/max pyramid of the raw data */
+    MinMaxPyramid                       m_pyramidFiltered;                          /**< Min/max pyramid of the filtered data */
+    MinMaxPyramid                       m_pyramidRawFreeze;                         /**< Min/max pyramid of the raw data in freeze mode */
+    MinMaxPyramid                       m_pyramidFilteredFreeze;                    /**< Min/max pyramid of the filtered data in freeze mode */
+
     Eigen::VectorXi                     m_vecIndicesFirstVV;                        /**< The indices of the channels to pick for the first SPHARA operator in case of a VectorView system.*/
     Eigen::VectorXi                     m_vecIndicesSecondVV;                       /**< The indices of the channels to pick for the second SPHARA operator in case of a VectorView system.*/
     Eigen::VectorXi                     m_vecIndicesFirstBabyMEG;                   /**< The indices of the channels to pick for the first SPHARA operator in case of a BabyMEG system.*/
@@ -590,6 +622,7 @@ private:
 
     QMap<double, QColor>                m_qMapTriggerColor;                         /**< Current colors for all trigger channels. */
     QMap<int,QList<QPair<int,double> > >m_qMapDetectedTrigger;                      /**< Detected trigger for each trigger channel. */
+    RTPROCESSINGLIB::TriggerDetector    m_triggerDetector;                          /**< Detects the trigger flanks across the incoming blocks. */
     QList<int>                          m_lTriggerChannelIndices;                   /**< List of all trigger channel indices. */
     QMap<int,QList<QPair<int,double> > >m_qMapDetectedTriggerFreeze;                /**< Detected trigger for each trigger channel while display is freezed. */
     QMap<int,QList<QPair<int,double> > >m_qMapDetectedTriggerOld;                   /**< Old detected trigger for each trigger channel. */
@@ -665,6 +698,17 @@ inline double RtFiffRawViewModel::getLastBlockFirstValue(int row) const
 
 //=============================================================================================================
 
+inline const MinMaxPyramid& RtFiffRawViewModel::getPyramid() const
+{
+    if(m_bIsFreezed) {
+        return (!m_filterKernel.isEmpty() && m_bPerformFiltering) ? m_pyramidFilteredFreeze : m_pyramidRawFreeze;
+    }
+
+    return (!m_filterKernel.isEmpty() && m_bPerformFiltering) ? m_pyramidFiltered : m_pyramidRaw;
+}
+
+//=============================================================================================================
+
 inline const QMap<qint32,qint32>& RtFiffRawViewModel::getIdxSelMap() const
 {
     return m_qMapIdxRowSelection;
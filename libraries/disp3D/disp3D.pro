@@ -126,6 +126,8 @@ SOURCES += \
     viewers/sourceestimateview.cpp \
     engine/model/items/sensordata/sensordatatreeitem.cpp \
     helpers/interpolation/interpolation.cpp \
+    helpers/interpolation/interpolationcache.cpp \
+    helpers/interpolation/colorframekernel.cpp \
     helpers/geometryinfo/geometryinfo.cpp \
     engine/model/3dhelpers/geometrymultiplier.cpp \
     engine/model/materials/geometrymultipliermaterial.cpp \
@@ -181,6 +183,8 @@ HEADERS += \
     disp3D_global.h \
     engine/model/items/sensordata/sensordatatreeitem.h \
     helpers/interpolation/interpolation.h \
+    helpers/interpolation/interpolationcache.h \
+    helpers/interpolation/colorframekernel.h \
     helpers/geometryinfo/geometryinfo.h \
     engine/model/3dhelpers/geometrymultiplier.h \
     engine/model/materials/geometrymultipliermaterial.h \
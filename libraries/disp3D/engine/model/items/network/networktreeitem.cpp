@@ -253,8 +253,9 @@ void NetworkTreeItem::plotNodes(const Network& tNetworkData)
         return;
     }
 
-    QList<NetworkNode::SPtr> lNetworkNodes = tNetworkData.getNodes();
-    qint16 iMaxDegree = tNetworkData.getMinMaxThresholdedDegrees().second;
+    MatrixXf matNodeVert = tNetworkData.getNodeVertices();
+    VectorXi vecDegrees = tNetworkData.getThresholdedDegrees();
+    qint16 iMaxDegree = vecDegrees.size() > 0 ? vecDegrees.maxCoeff() : 0;
 
     VisualizationInfo visualizationInfo = tNetworkData.getVisualizationInfo();
 
@@ -285,13 +286,13 @@ void NetworkTreeItem::plotNodes(const Network& tNetworkData)
     QVector3D tempPos;
     qint16 iDegree = 0;
 
-    for(int i = 0; i < lNetworkNodes.size(); ++i) {
-        iDegree = lNetworkNodes.at(i)->getThresholdedDegree();
+    for(int i = 0; i < matNodeVert.rows() && i < vecDegrees.size(); ++i) {
+        iDegree = vecDegrees[i];
 
         if(iDegree != 0) {
-            tempPos = QVector3D(lNetworkNodes.at(i)->getVert()(0),
-                                lNetworkNodes.at(i)->getVert()(1),
-                                lNetworkNodes.at(i)->getVert()(2));
+            tempPos = QVector3D(matNodeVert(i,0),
+                                matNodeVert(i,1),
+                                matNodeVert(i,2));
 
             //Set position and scale
             QMatrix4x4 tempTransform;
@@ -336,8 +337,8 @@ void NetworkTreeItem::plotEdges(const Network &tNetworkData)
     double dMaxWeight = tNetworkData.getMinMaxThresholdedWeights().second;
     double dMinWeight = tNetworkData.getMinMaxThresholdedWeights().first;
 
-    QList<NetworkEdge::SPtr> lNetworkEdges = tNetworkData.getThresholdedEdges();
-    QList<NetworkNode::SPtr> lNetworkNodes = tNetworkData.getNodes();
+    const SparseMatrix<double, RowMajor>& matAdjacency = tNetworkData.getThresholdedAdjacency();
+    MatrixXf matNodeVert = tNetworkData.getNodeVertices();
 
     VisualizationInfo visualizationInfo = tNetworkData.getVisualizationInfo();
 
@@ -370,26 +371,26 @@ void NetworkTreeItem::plotEdges(const Network &tNetworkData)
     double dWeight = 0.0;
     int iStartID, iEndID;
 
-    for(int i = 0; i < lNetworkEdges.size(); ++i) {
-        //Plot in edges
-        NetworkEdge::SPtr pNetworkEdge = lNetworkEdges.at(i);
+    for(int i = 0; i < matAdjacency.outerSize(); ++i) {
+        //Plot each edge once from the upper triangle of the adjacency matrix
+        for(SparseMatrix<double, RowMajor>::InnerIterator it(matAdjacency, i); it; ++it) {
+            iStartID = i;
+            iEndID = it.col();
 
-        if(pNetworkEdge->isActive()) {
-            iStartID = pNetworkEdge->getStartNodeID();
-            iEndID = pNetworkEdge->getEndNodeID();
+            if(iEndID <= iStartID || iStartID >= matNodeVert.rows() || iEndID >= matNodeVert.rows()) {
+                continue;
+            }
 
-            RowVectorXf vectorStart = lNetworkNodes.at(iStartID)->getVert();
-            startPos = QVector3D(vectorStart(0),
-                                 vectorStart(1),
-                                 vectorStart(2));
+            startPos = QVector3D(matNodeVert(iStartID,0),
+                                 matNodeVert(iStartID,1),
+                                 matNodeVert(iStartID,2));
 
-            RowVectorXf vectorEnd = lNetworkNodes.at(iEndID)->getVert();
-            endPos = QVector3D(vectorEnd(0),
-                               vectorEnd(1),
-                               vectorEnd(2));
+            endPos = QVector3D(matNodeVert(iEndID,0),
+                               matNodeVert(iEndID,1),
+                               matNodeVert(iEndID,2));
 
             if(startPos != endPos) {
-                dWeight = fabs(pNetworkEdge->getWeight());
+                dWeight = fabs(it.value());
                 if(dWeight != 0.0) {
                     diff = endPos - startPos;
                     edgePos = endPos - diff/2;
@@ -38,7 +38,6 @@
 //=============================================================================================================
 
 #include "rtsensordataworker.h"
-#include "../../../../helpers/interpolation/interpolation.h"
 #include "../../items/common/abstractmeshtreeitem.h"
 
 //=============================================================================================================
@@ -74,7 +73,9 @@ RtSensorDataWorker::RtSensorDataWorker()
 , m_dSFreq(1000.0)
 , m_bStreamSmoothedData(true)
 , m_iCurrentSample(0)
-, m_pMatInterpolationMatrix(QSharedPointer<SparseMatrix<float> >(new SparseMatrix<float>()))
+, m_iCurrentFrame(0)
+, m_iFramesPerBlock(8)
+, m_colorFrameKernel(ColorFrameKernel::Signed)
 {
 }
 
@@ -87,26 +88,24 @@ void RtSensorDataWorker::addData(const MatrixXd& data)
         return;
     }
 
-    //Transform from matrix to list for easier handling in non loop mode
-    for(int i = 0; i<data.cols(); i++) {
-        if(m_lDataQ.size() < m_dSFreq) {
-            m_lDataQ.push_back(data.col(i));
-        } else {
-            qDebug() <<"RtSensorDataWorker::addData - worker is full ("<<m_lDataQ.size()<<")";
-            break;
-        }
+    //Keep the most recent second of data
+    if(m_dataBuffer.rows() != data.rows() || m_dataBuffer.capacity() != (int)m_dSFreq) {
+        m_dataBuffer.resize(data.rows(), (int)m_dSFreq);
+        m_iCurrentSample = 0;
     }
 
-    m_lDataLoopQ = m_lDataQ;
+    int iDropped = m_dataBuffer.push(data);
+
+    if(iDropped > 0 && !m_bIsLooping) {
+        qDebug() <<"RtSensorDataWorker::addData - worker is full, dropped"<<iDropped<<"samples";
+    }
 }
 
 //=============================================================================================================
 
 void RtSensorDataWorker::setNumberVertices(int iNumberVerts)
 {
-//    m_lVisualizationInfo.matOriginalVertColor.resize(iNumberVerts,3);
-//    m_lVisualizationInfo.matOriginalVertColor.setZero();
-    m_lVisualizationInfo.matOriginalVertColor = AbstractMeshTreeItem::createVertColor(iNumberVerts);
+    m_colorFrameKernel.setOriginalColors(AbstractMeshTreeItem::createVertColor(iNumberVerts));
 }
 
 //=============================================================================================================
@@ -127,16 +126,14 @@ void RtSensorDataWorker::setStreamSmoothedData(bool bStreamSmoothedData)
 
 void RtSensorDataWorker::setColormapType(const QString& sColormapType)
 {
-    //Create function handler to corresponding color map function
-    m_lVisualizationInfo.sColormapType = sColormapType;
+    m_colorFrameKernel.setColormapType(sColormapType);
 }
 
 //=============================================================================================================
 
 void RtSensorDataWorker::setThresholds(const QVector3D& vecThresholds)
 {
-    m_lVisualizationInfo.dThresholdX = vecThresholds.x();
-    m_lVisualizationInfo.dThresholdZ = vecThresholds.z();
+    m_colorFrameKernel.setThresholds(vecThresholds.x(), vecThresholds.z());
 }
 
 //=============================================================================================================
@@ -156,7 +153,7 @@ void RtSensorDataWorker::setSFreq(const double dSFreq)
 //=============================================================================================================
 
 void RtSensorDataWorker::setInterpolationMatrix(QSharedPointer<SparseMatrix<float> > pMatInterpolationMatrix) {
-    m_pMatInterpolationMatrix = pMatInterpolationMatrix;
+    m_colorFrameKernel.setInterpolationMatrix(pMatInterpolationMatrix);
 }
 
 //=============================================================================================================
@@ -167,59 +164,41 @@ void RtSensorDataWorker::streamData()
 //    qint64 iTime = 0;
 //    timer.start();
 
-    if(m_iAverageSamples != 0 && !m_lDataLoopQ.isEmpty()) {
-        int iSampleCtr = 0;
-
-        //Perform the actual interpolation and send signal
-        while((iSampleCtr <= m_iAverageSamples)) {
-            if(m_lDataQ.isEmpty()) {
-                if(m_bIsLooping && !m_lDataLoopQ.isEmpty()) {
-                    if(m_vecAverage.rows() != m_lDataLoopQ.front().rows()) {
-                        m_vecAverage = m_lDataLoopQ.front();
-                        m_iCurrentSample++;
-                        iSampleCtr++;
-                    } else if (m_iCurrentSample < m_lDataLoopQ.size()){
-                        m_vecAverage += m_lDataLoopQ.at(m_iCurrentSample);
-                        m_iCurrentSample++;
-                        iSampleCtr++;
-                    }
-
-                    //Set iterator back to the front if needed
-                    if(m_iCurrentSample >= m_lDataLoopQ.size()) {
-                        m_iCurrentSample = 0;
-                        break;
-                    }
-                } else {
-                    return;
-                }
-            } else {
-                if(m_vecAverage.rows() != m_lDataQ.front().rows()) {
-                    m_vecAverage = m_lDataQ.takeFirst();
-                    m_iCurrentSample++;
-                    iSampleCtr++;
-                } else {
-                    m_vecAverage += m_lDataQ.takeFirst();
-                    m_iCurrentSample++;
-                    iSampleCtr++;
-                }
-
-                //Set iterator back to the front if needed
-                if(m_iCurrentSample >= m_lDataQ.size()) {
-                    m_iCurrentSample = 0;
-                    break;
-                }
+    if(m_iCurrentFrame >= m_matAverageBlock.cols()) {
+        //Collect the averages for the next block of frames
+        int iNumberFrames = 0;
+
+        while(iNumberFrames < m_iFramesPerBlock && computeNextAverage()) {
+            if(m_matAverageBlock.rows() != m_vecAverage.rows() || m_matAverageBlock.cols() != m_iFramesPerBlock) {
+                m_matAverageBlock.resize(m_vecAverage.rows(), m_iFramesPerBlock);
             }
+
+            m_matAverageBlock.col(iNumberFrames++) = m_vecAverage;
+        }
+
+        if(iNumberFrames == 0) {
+            return;
         }
 
-        m_vecAverage /= (double)m_iAverageSamples;
+        m_matAverageBlock.conservativeResize(Eigen::NoChange, iNumberFrames);
+        m_iCurrentFrame = 0;
+
+        //Perform the interpolation for the whole block at once
         if(m_bStreamSmoothedData) {
-            emit newRtSmoothedData(generateColorsFromSensorValues(m_vecAverage));
-        } else {
-            emit newRtRawData(m_vecAverage);
+            m_colorFrameKernel.computeFrames(m_matAverageBlock.cast<float>());
+        }
+    }
+
+    if(m_bStreamSmoothedData) {
+        if(m_iCurrentFrame < m_colorFrameKernel.numberFrames()) {
+            emit newRtSmoothedData(m_colorFrameKernel.frame(m_iCurrentFrame));
         }
-        m_vecAverage.setZero(m_vecAverage.rows());
+    } else {
+        emit newRtRawData(m_matAverageBlock.col(m_iCurrentFrame));
     }
 
+    m_iCurrentFrame++;
+
     //    iTime = timer.elapsed();
     //    qWarning() << "RtSensorDataWorker::streamData iTime" << iTime;
     //    timer.restart();
@@ -230,86 +209,28 @@ void RtSensorDataWorker::streamData()
 
 //=============================================================================================================
 
-MatrixX4f RtSensorDataWorker::generateColorsFromSensorValues(const VectorXd& vecSensorValues)
+bool RtSensorDataWorker::computeNextAverage()
 {
-    if(vecSensorValues.rows() != m_pMatInterpolationMatrix->cols()) {
-        qDebug() << "RtSensorDataWorker::generateColorsFromSensorValues - Number of new vertex colors (" << vecSensorValues.rows() << ") do not match with previously set number of sensors (" << m_pMatInterpolationMatrix->cols() << "). Returning...";
-        MatrixX4f matColor = m_lVisualizationInfo.matOriginalVertColor;
-        return matColor;
+    if(m_iAverageSamples <= 0 || m_dataBuffer.isEmpty()) {
+        return false;
     }
 
-    // interpolate sensor signals
-    VectorXf vecIntrpltdVals = Interpolation::interpolateSignal(*m_pMatInterpolationMatrix, vecSensorValues.cast<float>());
-
-    // Reset to original color as default
-    m_lVisualizationInfo.matFinalVertColor = m_lVisualizationInfo.matOriginalVertColor;
-
-    //Generate color data for vertices
-    normalizeAndTransformToColor(vecIntrpltdVals,
-                                 m_lVisualizationInfo.matFinalVertColor,
-                                 m_lVisualizationInfo.dThresholdX,
-                                 m_lVisualizationInfo.dThresholdZ,
-                                 m_lVisualizationInfo.functionHandlerColorMap,
-                                 m_lVisualizationInfo.sColormapType);
-
-    return m_lVisualizationInfo.matFinalVertColor;
-}
-
-//=============================================================================================================
+    if(m_bIsLooping) {
+        //Loop over the buffered data without removing it
+        m_iCurrentSample %= m_dataBuffer.size();
+        m_dataBuffer.sum(m_iCurrentSample, m_iAverageSamples, m_vecAverage);
+        m_iCurrentSample = (m_iCurrentSample + m_iAverageSamples) % m_dataBuffer.size();
+    } else {
+        //Wait until enough samples arrived
+        if(m_dataBuffer.size() < m_iAverageSamples) {
+            return false;
+        }
 
-void RtSensorDataWorker::normalizeAndTransformToColor(const VectorXf& vecData,
-                                                      MatrixX4f& matFinalVertColor,
-                                                      double dThresholdX,
-                                                      double dThreholdZ,
-                                                      QRgb (*functionHandlerColorMap)(double v, const QString& sColorMap),
-                                                      const QString& sColorMap)
-{
-    //Note: This function needs to be implemented extremly efficient.
-    if(vecData.rows() != matFinalVertColor.rows()) {
-        qDebug() << "RtSensorDataWorker::normalizeAndTransformToColor - Sizes of input data (" << vecData.rows() <<") do not match output data ("<< matFinalVertColor.rows() <<"). Returning ...";
-        return;
+        m_dataBuffer.sum(0, m_iAverageSamples, m_vecAverage);
+        m_dataBuffer.pop(m_iAverageSamples);
     }
 
-    float fSample;
-    QRgb qRgb;
-    const double dTresholdDiff = dThreholdZ - dThresholdX;
-
-    for(int r = 0; r < vecData.rows(); ++r) {
-        //Take the absolute values because the histogram threshold is also calcualted using the absolute values
-        fSample = std::fabs(vecData(r));
-
-        if(fSample >= dThresholdX) {
-            matFinalVertColor(r,3) = 1.0f;
-
-            //Check lower and upper thresholds and normalize to one
-            if(fSample >= dThreholdZ) {
-                if(vecData(r) < 0) {
-                    fSample = 0.0;
-                } else {
-                    fSample = 1.0;
-                }
-                //fSample = 1.0f;
-            } else {
-                if(fSample != 0.0f && dTresholdDiff != 0.0 ) {
-                    if(vecData(r) < 0) {
-                        fSample = 0.5 - (fSample - dThresholdX) / (dTresholdDiff * 2);
-                    } else {
-                        fSample = 0.5 + (fSample - dThresholdX) / (dTresholdDiff * 2);
-                    }
-                } else {
-                    fSample = 0.0f;
-                }
-            }
-
-            qRgb = functionHandlerColorMap(fSample, sColorMap);
+    m_vecAverage /= (double)m_iAverageSamples;
 
-            matFinalVertColor(r,0) = (float)qRed(qRgb)/255.0f;
-            matFinalVertColor(r,1) = (float)qGreen(qRgb)/255.0f;
-            matFinalVertColor(r,2) = (float)qBlue(qRgb)/255.0f;
-        } else {
-            //matFinalVertColor(r,3) = 0.0f;
-        }
-    }
+    return true;
 }
-
-//=============================================================================================================
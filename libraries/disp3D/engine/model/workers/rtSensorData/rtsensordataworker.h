@@ -41,8 +41,9 @@
 //=============================================================================================================
 
 #include "../../../../disp3D_global.h"
+#include "../../../../helpers/interpolation/colorframekernel.h"
 
-#include <disp/plots/helpers/colormap.h>
+#include <utils/generics/columnringbuffer.h>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -180,61 +181,28 @@ public:
 protected:
     //=========================================================================================================
     /**
-     * @brief normalizeAndTransformToColor  This method normalizes final values for all vertices of the mesh and converts them to rgb using the specified color converter
+     * Averages the next m_iAverageSamples samples into m_vecAverage.
      *
-     * @param[in] vecData                       The final values for each vertex of the surface
-     * @param[in,out] matFinalVertColor         The color matrix which the results are to be written to
-     * @param[in] dThresholdX                   Lower threshold for normalizing
-     * @param[in] dThreholdZ                    Upper threshold for normalizing
-     * @param[in] functionHandlerColorMap       The pointer to the function which converts scalar values to rgb
-     * @param[in] sColorMap                     The color map to us
-     *
-     */
-    void normalizeAndTransformToColor(const Eigen::VectorXf& vecData,
-                                      Eigen::MatrixX4f &matFinalVertColor,
-                                      double dThresholdX,
-                                      double dThreholdZ,
-                                      QRgb (*functionHandlerColorMap)(double v, const QString& sColorMap),
-                                      const QString& sColorMap);
-
-    //=========================================================================================================
-    /**
-     * @brief generateColorsFromSensorValues        Produces the final color matrix that is to be emitted
-     *
-     * @param[in] vecSensorValues                   A vector of sensor signals
-     *
-     * @return The final color values for the underlying mesh surface
+     * @return true if an average was computed, false if no data is available.
      */
-    Eigen::MatrixX4f generateColorsFromSensorValues(const Eigen::VectorXd& vecSensorValues);
+    bool computeNextAverage();
 
-    QList<Eigen::VectorXd>                              m_lDataQ;                           /**< List that holds the fiff matrix data <n_channels x n_samples>. */
-    QList<Eigen::VectorXd>                              m_lDataLoopQ;                       /**< List that holds the matrix data <n_channels x n_samples> for looping. */
+    UTILSLIB::ColumnRingBuffer                          m_dataBuffer;                       /**< Ring buffer that holds the most recent second of data <n_channels x n_samples>. */
 
     Eigen::VectorXd                                     m_vecAverage;                       /**< The averaged data to be streamed. */
-    QSharedPointer<Eigen::SparseMatrix<float> >         m_pMatInterpolationMatrix;          /**< The interpolation matrix. */
+    Eigen::MatrixXd                                     m_matAverageBlock;                  /**< The averages of the current block, one column per frame. */
 
     bool                                                m_bIsLooping;                       /**< Flag if this thread should repeat sending the same data over and over again. */
     bool                                                m_bStreamSmoothedData;              /**< Flag if this thread's streams the raw or already smoothed data. Latter are produced by multiplying the smoothing operator here in this thread. */
 
-    int                                                 m_iCurrentSample;                   /**< Iterator to current sample which is/was streamed. */
+    int                                                 m_iCurrentSample;                   /**< Index of the next sample to be streamed in loop mode. */
     int                                                 m_iAverageSamples;                  /**< Number of average to compute. */
+    int                                                 m_iCurrentFrame;                    /**< The next frame of the current block to be streamed. */
+    int                                                 m_iFramesPerBlock;                  /**< The maximal number of frames which are computed at once. */
 
     double                                              m_dSFreq;                           /**< The current sampling frequency. */
 
-    //=========================================================================================================
-    /**
-     * The struct specifing visualization info.
-     */
-    struct VisualizationInfo {
-        double                      dThresholdX;
-        double                      dThresholdZ;
-
-        Eigen::MatrixX4f            matOriginalVertColor;
-        Eigen::MatrixX4f            matFinalVertColor;
-
-        QString sColormapType;
-        QRgb (*functionHandlerColorMap)(double v, const QString& sColorMap) = DISPLIB::ColorMap::valueToColor;
-    } m_lVisualizationInfo;               /**< Container for the visualization info. */
+    ColorFrameKernel                                    m_colorFrameKernel;                 /**< Interpolates the averages and converts them to vertex colors. */
 
 signals:
     //=========================================================================================================
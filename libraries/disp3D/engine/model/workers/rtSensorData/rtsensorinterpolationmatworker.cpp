@@ -40,6 +40,8 @@
 #include "../../../../helpers/geometryinfo/geometryinfo.h"
 #include "../../../../helpers/interpolation/interpolation.h"
 
+#include <utils/kdtree.h>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
@@ -56,6 +58,7 @@ using namespace DISP3DLIB;
 using namespace MNELIB;
 using namespace FIFFLIB;
 using namespace Eigen;
+using namespace UTILSLIB;
 
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -66,7 +69,7 @@ RtSensorInterpolationMatWorker::RtSensorInterpolationMatWorker()
 {
     m_lInterpolationData.dCancelDistance = 0.05;
     m_lInterpolationData.interpolationFunction = DISP3DLIB::Interpolation::cubic;
-    m_lInterpolationData.matDistanceMatrix = QSharedPointer<MatrixXd>(new MatrixXd());
+    m_lInterpolationData.sInterpolationFunction = "Cubic";
 }
 
 //=============================================================================================================
@@ -86,6 +89,8 @@ void RtSensorInterpolationMatWorker::setInterpolationFunction(const QString &sIn
         m_lInterpolationData.interpolationFunction = Interpolation::gaussian;
     }
 
+    m_lInterpolationData.sInterpolationFunction = sInterpolationFunction;
+
     if(m_bInterpolationInfoIsInit == true){
         //recalculate Interpolation matrix parameters changed
         emitMatrix();
@@ -115,6 +120,13 @@ void RtSensorInterpolationMatWorker::setInterpolationInfo(const Eigen::MatrixX3f
         return;
     }
 
+    //The vertex tree only has to be rebuilt if the surface changed, e.g., not for a new montage
+    if(!m_lInterpolationData.pVertexTree ||
+       m_lInterpolationData.matVertices.rows() != matVertices.rows() ||
+       m_lInterpolationData.matVertices != matVertices) {
+        m_lInterpolationData.pVertexTree = KdTree::SPtr(new KdTree(matVertices));
+    }
+
     //set members
     m_lInterpolationData.matVertices = matVertices;
     m_lInterpolationData.fiffInfo = fiffInfo;
@@ -134,8 +146,8 @@ void RtSensorInterpolationMatWorker::setInterpolationInfo(const Eigen::MatrixX3f
         }
     }
 
-    //sensor projecting: One time operation because surface and sensors can not change
-    m_lInterpolationData.vecMappedSubset = GeometryInfo::projectSensors(m_lInterpolationData.matVertices,
+    //sensor projecting: Nearest vertex lookups in the vertex tree
+    m_lInterpolationData.vecMappedSubset = GeometryInfo::projectSensors(*m_lInterpolationData.pVertexTree,
                                                                         vecSensorPos);
 
     m_bInterpolationInfoIsInit = true;
@@ -154,12 +166,8 @@ void RtSensorInterpolationMatWorker::setBadChannels(const FiffInfo& info)
 
     m_lInterpolationData.fiffInfo = info;
 
-    //filtering of bad channels out of the distance table
-    GeometryInfo::filterBadChannels(m_lInterpolationData.matDistanceMatrix,
-                                    m_lInterpolationData.fiffInfo,
-                                    m_lInterpolationData.iSensorType);    
-
     //set vecExcludeIndex
+    const QVector<int> vecPreviousExcludeIndex = m_lInterpolationData.vecExcludeIndex;
     m_lInterpolationData.vecExcludeIndex.clear();
     int iCounter = 0;
     for(const FiffChInfo &info : m_lInterpolationData.fiffInfo.chs) {
@@ -172,6 +180,21 @@ void RtSensorInterpolationMatWorker::setBadChannels(const FiffInfo& info)
         }
     }
 
+    //Columns of bad channels were removed from the distance table. If a bad channel became good again, the table is recalculated when needed.
+    for(int iIndex : vecPreviousExcludeIndex) {
+        if(!m_lInterpolationData.vecExcludeIndex.contains(iIndex)) {
+            m_lInterpolationData.matDistanceMatrix.clear();
+            break;
+        }
+    }
+
+    //filtering of bad channels out of the distance table
+    if(m_lInterpolationData.matDistanceMatrix) {
+        GeometryInfo::filterBadChannels(m_lInterpolationData.matDistanceMatrix,
+                                        m_lInterpolationData.fiffInfo,
+                                        m_lInterpolationData.iSensorType);
+    }
+
     emitMatrix();
 }
 
@@ -184,16 +207,8 @@ void RtSensorInterpolationMatWorker::calculateInterpolationOperator()
         return;
     }
 
-    //SCDC with cancel distance
-    m_lInterpolationData.matDistanceMatrix = GeometryInfo::scdc(m_lInterpolationData.matVertices,
-                                                                m_lInterpolationData.vecNeighborVertices,
-                                                                m_lInterpolationData.vecMappedSubset,
-                                                                m_lInterpolationData.dCancelDistance);
-
-    //filtering of bad channels out of the distance table
-    GeometryInfo::filterBadChannels(m_lInterpolationData.matDistanceMatrix,
-                                    m_lInterpolationData.fiffInfo,
-                                    m_lInterpolationData.iSensorType);
+    //The distance table depends on the cancel distance. It is only calculated if the interpolation matrix is not cached.
+    m_lInterpolationData.matDistanceMatrix.clear();
 
     emitMatrix();
 }
@@ -202,10 +217,38 @@ void RtSensorInterpolationMatWorker::calculateInterpolationOperator()
 
 void RtSensorInterpolationMatWorker::emitMatrix()
 {
-    //create Interpolation matrix
-    emit newInterpolationMatrixCalculated(Interpolation::createInterpolationMat(m_lInterpolationData.vecMappedSubset,
-                                                                                m_lInterpolationData.matDistanceMatrix,
-                                                                                m_lInterpolationData.interpolationFunction,
-                                                                                m_lInterpolationData.dCancelDistance,
-                                                                                m_lInterpolationData.vecExcludeIndex));
+    const QByteArray key = InterpolationCache::computeKey(m_lInterpolationData.matVertices,
+                                                          m_lInterpolationData.vecNeighborVertices,
+                                                          m_lInterpolationData.vecMappedSubset,
+                                                          m_lInterpolationData.vecExcludeIndex,
+                                                          m_lInterpolationData.dCancelDistance,
+                                                          m_lInterpolationData.sInterpolationFunction);
+
+    QSharedPointer<SparseMatrix<float> > pMatInterpolation = m_interpolationCache.load(key);
+
+    if(!pMatInterpolation) {
+        if(!m_lInterpolationData.matDistanceMatrix) {
+            //Sparse SCDC with cancel distance
+            m_lInterpolationData.matDistanceMatrix = GeometryInfo::scdcSparse(m_lInterpolationData.matVertices,
+                                                                              m_lInterpolationData.vecNeighborVertices,
+                                                                              m_lInterpolationData.vecMappedSubset,
+                                                                              m_lInterpolationData.dCancelDistance);
+
+            //filtering of bad channels out of the distance table
+            GeometryInfo::filterBadChannels(m_lInterpolationData.matDistanceMatrix,
+                                            m_lInterpolationData.fiffInfo,
+                                            m_lInterpolationData.iSensorType);
+        }
+
+        //create Interpolation matrix
+        pMatInterpolation = Interpolation::createInterpolationMat(m_lInterpolationData.vecMappedSubset,
+                                                                  m_lInterpolationData.matDistanceMatrix,
+                                                                  m_lInterpolationData.interpolationFunction,
+                                                                  m_lInterpolationData.dCancelDistance,
+                                                                  m_lInterpolationData.vecExcludeIndex);
+
+        m_interpolationCache.store(key, *pMatInterpolation);
+    }
+
+    emit newInterpolationMatrixCalculated(pMatInterpolation);
 }
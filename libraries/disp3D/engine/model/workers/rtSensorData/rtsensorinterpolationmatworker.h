@@ -40,6 +40,7 @@
 //=============================================================================================================
 
 #include "../../../../disp3D_global.h"
+#include "../../../../helpers/interpolation/interpolationcache.h"
 #include <fiff/fiff_info.h>
 
 //=============================================================================================================
@@ -56,6 +57,10 @@
 // FORWARD DECLARATIONS
 //=============================================================================================================
 
+namespace UTILSLIB {
+    class KdTree;
+}
+
 //=============================================================================================================
 // DEFINE NAMESPACE DISP3DLIB
 //=============================================================================================================
@@ -142,7 +147,8 @@ protected:
 
     //=========================================================================================================
     /**
-     * Emit the interpolation matrix.
+     * Emit the interpolation matrix. The matrix is taken from the interpolation cache if possible,
+     * otherwise it is calculated and stored in the cache.
      */
     void emitMatrix();
 
@@ -154,8 +160,9 @@ protected:
         int                                             iSensorType;                    /**< Type of the sensor: FIFFV_EEG_CH or FIFFV_MEG_CH. */
         double                                          dCancelDistance;                /**< Cancel distance for the interpolaion in meters. */
 
-        QSharedPointer<Eigen::MatrixXd>                 matDistanceMatrix;              /**< Distance matrix that holds distances from sensors positions to the near vertices in meters. */
+        QSharedPointer<Eigen::SparseMatrix<float, Eigen::RowMajor> > matDistanceMatrix; /**< Sparse distance matrix that holds distances from sensors positions to the near vertices in meters. */
         Eigen::MatrixX3f                                matVertices;                    /**< Holds all vertex information. */
+        QSharedPointer<UTILSLIB::KdTree>                pVertexTree;                    /**< Spatial index of matVertices, reused for new sensor positions on the same surface. */
 
         QVector<int>                                 vecMappedSubset;                /**< Vector index position represents the id of the sensor and the qint in each cell is the vertex it is mapped to. */
         QVector<int>                                 vecExcludeIndex;                /**< The indices to be excluded from vecProjectedSensors, e.g., bad channels. */
@@ -164,8 +171,11 @@ protected:
         FIFFLIB::FiffInfo                               fiffInfo;                       /**< Contains all information about the sensors. */
 
         double (*interpolationFunction) (double);                                       /**< Function that computes interpolation coefficients using the distance values. */
+        QString                                         sInterpolationFunction;         /**< The name of the interpolation function. */
     }       m_lInterpolationData;           /**< Container for the interpolation data. */
 
+    InterpolationCache  m_interpolationCache;   /**< The on-disk cache for interpolation matrices. */
+
     bool    m_bInterpolationInfoIsInit;     /**< Flag if this thread's interpoaltion data was initialized. */
 
 signals:
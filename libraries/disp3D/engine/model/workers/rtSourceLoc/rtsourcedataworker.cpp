@@ -39,7 +39,6 @@
 //=============================================================================================================
 
 #include "rtsourcedataworker.h"
-#include "../../../../helpers/interpolation/interpolation.h"
 #include "../../items/common/abstractmeshtreeitem.h"
 
 //=============================================================================================================
@@ -77,12 +76,10 @@ RtSourceDataWorker::RtSourceDataWorker()
 , m_bStreamSmoothedData(true)
 , m_iCurrentSample(0)
 , m_iSampleCtr(0)
+, m_iCurrentFrame(0)
+, m_iFramesPerBlock(8)
 {
-    VisualizationInfo leftHemiInfo;
-    VisualizationInfo rightHemiInfo;
-    leftHemiInfo.pMatInterpolationMatrix = QSharedPointer<SparseMatrix<float> >(new SparseMatrix<float>());
-    rightHemiInfo.pMatInterpolationMatrix = QSharedPointer<SparseMatrix<float> >(new SparseMatrix<float>());
-    m_lHemiVisualizationInfo << leftHemiInfo << rightHemiInfo;
+    m_lHemiVisualizationInfo << VisualizationInfo() << VisualizationInfo();
 }
 
 //=============================================================================================================
@@ -94,17 +91,17 @@ void RtSourceDataWorker::addData(const MatrixXd& data)
         return;
     }
 
-    //Transform from matrix to list for easier handling in non loop mode
-    for(int i = 0; i<data.cols(); i++) {
-        if(m_lDataQ.size() < m_dSFreq) {
-            m_lDataQ.push_back(data.col(i));
-        } else {
-            qDebug() <<"RtSourceDataWorker::addData - worker is full ("<<m_lDataQ.size()<<")";
-            break;
-        }
+    //Keep the most recent second of data
+    if(m_dataBuffer.rows() != data.rows() || m_dataBuffer.capacity() != (int)m_dSFreq) {
+        m_dataBuffer.resize(data.rows(), (int)m_dSFreq);
+        m_iCurrentSample = 0;
     }
 
-    m_lDataLoopQ = m_lDataQ;
+    int iDropped = m_dataBuffer.push(data);
+
+    if(iDropped > 0 && !m_bIsLooping) {
+        qDebug() <<"RtSourceDataWorker::addData - worker is full, dropped"<<iDropped<<"samples";
+    }
 }
 
 //=============================================================================================================
@@ -112,8 +109,8 @@ void RtSourceDataWorker::addData(const MatrixXd& data)
 void RtSourceDataWorker::setSurfaceColor(const MatrixX4f &matColorLeft,
                                          const MatrixX4f &matColorRight)
 {
-    m_lHemiVisualizationInfo[0].matOriginalVertColor = matColorLeft;
-    m_lHemiVisualizationInfo[1].matOriginalVertColor = matColorRight;
+    m_lHemiVisualizationInfo[0].colorFrameKernel.setOriginalColors(matColorLeft);
+    m_lHemiVisualizationInfo[1].colorFrameKernel.setOriginalColors(matColorRight);
 }
 
 //=============================================================================================================
@@ -134,19 +131,16 @@ void RtSourceDataWorker::setStreamSmoothedData(bool bStreamSmoothedData)
 
 void RtSourceDataWorker::setColormapType(const QString& sColormapType)
 {
-    //Create function handler to corresponding color map function
-    m_lHemiVisualizationInfo[0].sColormapType = sColormapType;
-    m_lHemiVisualizationInfo[1].sColormapType = sColormapType;
+    m_lHemiVisualizationInfo[0].colorFrameKernel.setColormapType(sColormapType);
+    m_lHemiVisualizationInfo[1].colorFrameKernel.setColormapType(sColormapType);
 }
 
 //=============================================================================================================
 
 void RtSourceDataWorker::setThresholds(const QVector3D& vecThresholds)
 {
-    m_lHemiVisualizationInfo[0].dThresholdX = vecThresholds.x();
-    m_lHemiVisualizationInfo[0].dThresholdZ = vecThresholds.z();
-    m_lHemiVisualizationInfo[1].dThresholdX = vecThresholds.x();
-    m_lHemiVisualizationInfo[1].dThresholdZ = vecThresholds.z();
+    m_lHemiVisualizationInfo[0].colorFrameKernel.setThresholds(vecThresholds.x(), vecThresholds.z());
+    m_lHemiVisualizationInfo[1].colorFrameKernel.setThresholds(vecThresholds.x(), vecThresholds.z());
 }
 
 //=============================================================================================================
@@ -167,14 +161,14 @@ void RtSourceDataWorker::setSFreq(const double dSFreq)
 
 void RtSourceDataWorker::setInterpolationMatrixLeft(QSharedPointer<Eigen::SparseMatrix<float> > pMatInterpolationMatrixLeft)
 {
-    m_lHemiVisualizationInfo[0].pMatInterpolationMatrix = pMatInterpolationMatrixLeft;
+    m_lHemiVisualizationInfo[0].colorFrameKernel.setInterpolationMatrix(pMatInterpolationMatrixLeft);
 }
 
 //=============================================================================================================
 
 void RtSourceDataWorker::setInterpolationMatrixRight(QSharedPointer<Eigen::SparseMatrix<float> > pMatInterpolationMatrixRight)
 {
-    m_lHemiVisualizationInfo[1].pMatInterpolationMatrix = pMatInterpolationMatrixRight;
+    m_lHemiVisualizationInfo[1].colorFrameKernel.setInterpolationMatrix(pMatInterpolationMatrixRight);
 }
 
 //=============================================================================================================
@@ -185,74 +179,62 @@ void RtSourceDataWorker::streamData()
 //    qint64 iTime = 0;
 //    timer.start();
 
-    if(m_iAverageSamples != 0 && !m_lDataLoopQ.isEmpty()) {
-        int iSampleCtr = 0;
-
-        //Perform the actual interpolation and send signal
-        while((iSampleCtr <= m_iAverageSamples)) {
-            if(m_lDataQ.isEmpty()) {
-                if(m_bIsLooping && !m_lDataLoopQ.isEmpty()) {
-                    if(m_vecAverage.rows() != m_lDataLoopQ.front().rows()) {
-                        m_vecAverage = m_lDataLoopQ.front();
-                        m_iCurrentSample++;
-                        iSampleCtr++;
-                    } else if (m_iCurrentSample < m_lDataLoopQ.size()){
-                        m_vecAverage += m_lDataLoopQ.at(m_iCurrentSample);
-                        m_iCurrentSample++;
-                        iSampleCtr++;
-                    }
-
-                    //Set iterator back to the front if needed
-                    if(m_iCurrentSample >= m_lDataLoopQ.size()) {
-                        m_iCurrentSample = 0;
-                        break;
-                    }
-                } else {
-                    return;
-                }
-            } else {
-                if(m_vecAverage.rows() != m_lDataQ.front().rows()) {
-                    m_vecAverage = m_lDataQ.takeFirst();
-                    m_iCurrentSample++;
-                    iSampleCtr++;
-                } else {
-                    m_vecAverage += m_lDataQ.takeFirst();
-                    m_iCurrentSample++;
-                    iSampleCtr++;
-                }
-
-                //Set iterator back to the front if needed
-                if(m_iCurrentSample >= m_lDataQ.size()) {
-                    m_iCurrentSample = 0;
-                    break;
-                }
+    const int iNumberSourcesLeft = m_lHemiVisualizationInfo[0].colorFrameKernel.interpolationMatrix()->cols();
+    const int iNumberSourcesRight = m_lHemiVisualizationInfo[1].colorFrameKernel.interpolationMatrix()->cols();
+
+    if(iNumberSourcesLeft == 0 || iNumberSourcesRight == 0) {
+        return;
+    }
+
+    if(m_iCurrentFrame >= m_matAverageBlock.cols()) {
+        //Collect the averages for the next block of frames
+        int iNumberFrames = 0;
+
+        while(iNumberFrames < m_iFramesPerBlock && computeNextAverage()) {
+            if(m_matAverageBlock.rows() != m_vecAverage.rows() || m_matAverageBlock.cols() != m_iFramesPerBlock) {
+                m_matAverageBlock.resize(m_vecAverage.rows(), m_iFramesPerBlock);
             }
+
+            m_matAverageBlock.col(iNumberFrames++) = m_vecAverage;
         }
 
-        if(m_lHemiVisualizationInfo[0].pMatInterpolationMatrix->cols() != 0
-           && m_lHemiVisualizationInfo[1].pMatInterpolationMatrix->cols() != 0) {
-            //Perform the actual interpolation and send signal
-            m_vecAverage /= (double)m_iAverageSamples;
-
-            if(m_bStreamSmoothedData) {
-                m_lHemiVisualizationInfo[0].vecSensorValues = m_vecAverage.segment(0, m_lHemiVisualizationInfo[0].pMatInterpolationMatrix->cols());
-                m_lHemiVisualizationInfo[1].vecSensorValues = m_vecAverage.segment(m_lHemiVisualizationInfo[0].pMatInterpolationMatrix->cols(), m_lHemiVisualizationInfo[1].pMatInterpolationMatrix->cols());
-
-                //Do calculations for both hemispheres in parallel
-                QFuture<void> result = QtConcurrent::map(m_lHemiVisualizationInfo,
-                                                         generateColorsFromSensorValues);
-                result.waitForFinished();
-
-                emit newRtSmoothedData(m_lHemiVisualizationInfo[0].matFinalVertColor,
-                                       m_lHemiVisualizationInfo[1].matFinalVertColor);
-            } else {
-                emit newRtRawData(m_vecAverage.segment(0, m_lHemiVisualizationInfo[0].pMatInterpolationMatrix->cols()),
-                                  m_vecAverage.segment(m_lHemiVisualizationInfo[0].pMatInterpolationMatrix->cols(), m_lHemiVisualizationInfo[1].pMatInterpolationMatrix->cols()));
-            }
-            m_vecAverage.setZero(m_vecAverage.rows());
+        if(iNumberFrames == 0) {
+            return;
+        }
+
+        m_matAverageBlock.conservativeResize(Eigen::NoChange, iNumberFrames);
+        m_iCurrentFrame = 0;
+
+        if(m_matAverageBlock.rows() < iNumberSourcesLeft + iNumberSourcesRight) {
+            qDebug() << "RtSourceDataWorker::streamData - Number of sources (" << m_matAverageBlock.rows() << ") do not match with the interpolation matrices (" << iNumberSourcesLeft + iNumberSourcesRight << "). Returning...";
+            m_matAverageBlock.resize(0, 0);
+            return;
+        }
+
+        if(m_bStreamSmoothedData) {
+            m_lHemiVisualizationInfo[0].matSensorValues = m_matAverageBlock.topRows(iNumberSourcesLeft).cast<float>();
+            m_lHemiVisualizationInfo[1].matSensorValues = m_matAverageBlock.middleRows(iNumberSourcesLeft, iNumberSourcesRight).cast<float>();
+
+            //Do calculations for both hemispheres in parallel
+            QFuture<void> result = QtConcurrent::map(m_lHemiVisualizationInfo,
+                                                     generateColorsFromSensorValues);
+            result.waitForFinished();
+        }
+    }
+
+    if(m_bStreamSmoothedData) {
+        if(m_iCurrentFrame < m_lHemiVisualizationInfo[0].colorFrameKernel.numberFrames()
+           && m_iCurrentFrame < m_lHemiVisualizationInfo[1].colorFrameKernel.numberFrames()) {
+            emit newRtSmoothedData(m_lHemiVisualizationInfo[0].colorFrameKernel.frame(m_iCurrentFrame),
+                                   m_lHemiVisualizationInfo[1].colorFrameKernel.frame(m_iCurrentFrame));
         }
+    } else if(m_matAverageBlock.rows() >= iNumberSourcesLeft + iNumberSourcesRight) {
+        emit newRtRawData(m_matAverageBlock.col(m_iCurrentFrame).segment(0, iNumberSourcesLeft),
+                          m_matAverageBlock.col(m_iCurrentFrame).segment(iNumberSourcesLeft, iNumberSourcesRight));
     }
 
+    m_iCurrentFrame++;
+
 //iTime = timer.elapsed();
 //qWarning() << "RtSourceDataWorker::streamData iTime" << iTime;
 //timer.restart();
@@ -263,84 +245,35 @@ void RtSourceDataWorker::streamData()
 
 //=============================================================================================================
 
-void RtSourceDataWorker::generateColorsFromSensorValues(VisualizationInfo &visualizationInfoHemi)
+bool RtSourceDataWorker::computeNextAverage()
 {
-    if(visualizationInfoHemi.vecSensorValues.rows() != visualizationInfoHemi.pMatInterpolationMatrix->cols()) {
-        qDebug() << "RtSourceDataWorker::generateColorsFromSensorValues - Number of new vertex colors (" << visualizationInfoHemi.vecSensorValues.rows() << ") do not match with previously set number of sensors (" << visualizationInfoHemi.pMatInterpolationMatrix->cols() << "). Returning...";
-        return;
+    if(m_iAverageSamples <= 0 || m_dataBuffer.isEmpty()) {
+        return false;
     }
 
-    // interpolate sensor signals
-    VectorXf vecIntrpltdVals = Interpolation::interpolateSignal(*visualizationInfoHemi.pMatInterpolationMatrix, visualizationInfoHemi.vecSensorValues.cast<float>());
+    if(m_bIsLooping) {
+        //Loop over the buffered data without removing it
+        m_iCurrentSample %= m_dataBuffer.size();
+        m_dataBuffer.sum(m_iCurrentSample, m_iAverageSamples, m_vecAverage);
+        m_iCurrentSample = (m_iCurrentSample + m_iAverageSamples) % m_dataBuffer.size();
+    } else {
+        //Wait until enough samples arrived
+        if(m_dataBuffer.size() < m_iAverageSamples) {
+            return false;
+        }
 
-    // Reset to original color as default
-    visualizationInfoHemi.matFinalVertColor = visualizationInfoHemi.matOriginalVertColor;
+        m_dataBuffer.sum(0, m_iAverageSamples, m_vecAverage);
+        m_dataBuffer.pop(m_iAverageSamples);
+    }
 
-    //Generate color data for vertices
-    normalizeAndTransformToColor(vecIntrpltdVals,
-                                 visualizationInfoHemi.matFinalVertColor,
-                                 visualizationInfoHemi.dThresholdX,
-                                 visualizationInfoHemi.dThresholdZ,
-                                 visualizationInfoHemi.functionHandlerColorMap,
-                                 visualizationInfoHemi.sColormapType);
+    m_vecAverage /= (double)m_iAverageSamples;
+
+    return true;
 }
 
 //=============================================================================================================
 
-void RtSourceDataWorker::normalizeAndTransformToColor(const VectorXf& vecData,
-                                                      MatrixX4f& matFinalVertColor,
-                                                      double dThresholdX,
-                                                      double dThresholdZ,
-                                                      QRgb (*functionHandlerColorMap)(double v, const QString& sColorMap),
-                                                      const QString& sColorMap)
+void RtSourceDataWorker::generateColorsFromSensorValues(VisualizationInfo &visualizationInfoHemi)
 {
-    //Note: This function needs to be implemented extremly efficient.
-    if(vecData.rows() != matFinalVertColor.rows()) {
-        qDebug() << "RtSourceDataWorker::normalizeAndTransformToColor - Sizes of input data (" << vecData.rows() <<") do not match output data ("<< matFinalVertColor.rows() <<"). Returning ...";
-        return;
-    }
-
-    float fSample;
-    QRgb qRgb;
-    const double dTresholdDiff = dThresholdZ - dThresholdX;
-
-    for(int r = 0; r < vecData.rows(); ++r) {
-        //Take the absolute values because the histogram threshold is also calcualted using the absolute values
-        fSample = std::fabs(vecData(r));
-
-        if(fSample >= dThresholdX) {
-            //Check lower and upper thresholds and normalize to one
-            if(fSample >= dThresholdZ) {
-                fSample = 1.0f;
-            } else {
-                if(fSample != 0.0f && dTresholdDiff != 0.0 ) {
-                    fSample = (fSample - dThresholdX) / (dTresholdDiff);
-                } else {
-                    fSample = 0.0f;
-                }
-            }
-
-            qRgb = functionHandlerColorMap(fSample, sColorMap);
-
-            QColor color(qRgb);
-//            QColor color (matFinalVertColor(r,0) * 255 * (1.0-0.60) + (float)qRed(qRgb)*0.60,
-//                          matFinalVertColor(r,1) * 255 * (1.0-0.60) + (float)qGreen(qRgb)*0.60,
-//                          matFinalVertColor(r,2) * 255 * (1.0-0.60) + (float)qBlue(qRgb)*0.60,
-//                          255.0 + 0.75 * (255.0-255.0));
-
-            //qDebug() << "RtSourceDataWorker::normalizeAndTransformToColor color" << color;
-
-            matFinalVertColor(r,0) = color.redF();
-            matFinalVertColor(r,1) = color.greenF();
-            matFinalVertColor(r,2) = color.blueF();
-            matFinalVertColor(r,3) = color.alphaF();
-
-//            matFinalVertColor(r,0) = (float)qRed(qRgb)/255.0f;
-//            matFinalVertColor(r,1) = (float)qGreen(qRgb)/255.0f;
-//            matFinalVertColor(r,2) = (float)qBlue(qRgb)/255.0f;
-//            matFinalVertColor(r,3) = 1.0f;
-        } else {
-            matFinalVertColor(r,3) = 0.0f; //Use this if you want only vertices with activation to be plotted
-        }
-    }
+    visualizationInfoHemi.colorFrameKernel.computeFrames(visualizationInfoHemi.matSensorValues);
 }
@@ -73,7 +73,7 @@ RtSourceInterpolationMatWorker::RtSourceInterpolationMatWorker()
 {
     m_lInterpolationData.dCancelDistance = 0.05;
     m_lInterpolationData.interpolationFunction = DISP3DLIB::Interpolation::cubic;
-    m_lInterpolationData.matDistanceMatrix = QSharedPointer<MatrixXd>(new MatrixXd());
+    m_lInterpolationData.sInterpolationFunction = QStringLiteral("Cubic");
 }
 
 //=============================================================================================================
@@ -98,12 +98,11 @@ void RtSourceInterpolationMatWorker::setInterpolationFunction(const QString &sIn
         m_lInterpolationData.interpolationFunction = Interpolation::gaussian;
     }
 
+    m_lInterpolationData.sInterpolationFunction = sInterpolationFunction;
+
     if(m_bInterpolationInfoIsInit == true){
         //recalculate Interpolation matrix parameters changed
-        m_pMatInterpolationMat = Interpolation::createInterpolationMat(m_lInterpolationData.vecMappedSubset,
-                                                                       m_lInterpolationData.matDistanceMatrix,
-                                                                       m_lInterpolationData.interpolationFunction,
-                                                                       m_lInterpolationData.dCancelDistance);
+        calculateInterpolationOperator();
 
         emitMatrix();
     }
@@ -132,6 +131,7 @@ void RtSourceInterpolationMatWorker::setCancelDistance(double dCancelDist)
     m_lInterpolationData.dCancelDistance = dCancelDist;
 
     //recalculate everything because parameters changed
+    m_lInterpolationData.matDistanceMatrix.clear();
     calculateInterpolationOperator();
 
     emitMatrix();
@@ -152,6 +152,7 @@ void RtSourceInterpolationMatWorker::setInterpolationInfo(const Eigen::MatrixX3f
     m_lInterpolationData.matVertices = matVertices;
     m_lInterpolationData.vecNeighborVertices = vecNeighborVertices;
     m_lInterpolationData.vecMappedSubset = vecMappedSubset;
+    m_lInterpolationData.matDistanceMatrix.clear();
 
     m_bInterpolationInfoIsInit = true;
 
@@ -200,18 +201,37 @@ void RtSourceInterpolationMatWorker::calculateInterpolationOperator()
         return;
     }
 
-    //SCDC with cancel distance
-    m_lInterpolationData.matDistanceMatrix = GeometryInfo::scdc(m_lInterpolationData.matVertices,
-                                                                m_lInterpolationData.vecNeighborVertices,
-                                                                m_lInterpolationData.vecMappedSubset,
-                                                                m_lInterpolationData.dCancelDistance);
+    const QByteArray key = InterpolationCache::computeKey(m_lInterpolationData.matVertices,
+                                                          m_lInterpolationData.vecNeighborVertices,
+                                                          m_lInterpolationData.vecMappedSubset,
+                                                          QVector<int>(),
+                                                          m_lInterpolationData.dCancelDistance,
+                                                          m_lInterpolationData.sInterpolationFunction);
+
+    QSharedPointer<SparseMatrix<float> > pMatInterpolation = m_interpolationCache.load(key);
+
+    if(pMatInterpolation) {
+        m_pMatInterpolationMat = pMatInterpolation;
+        return;
+    }
+
+    //The distance table is only calculated if no interpolation matrix was cached for the current parameters
+    if(!m_lInterpolationData.matDistanceMatrix) {
+        //Sparse SCDC with cancel distance
+        m_lInterpolationData.matDistanceMatrix = GeometryInfo::scdcSparse(m_lInterpolationData.matVertices,
+                                                                          m_lInterpolationData.vecNeighborVertices,
+                                                                          m_lInterpolationData.vecMappedSubset,
+                                                                          m_lInterpolationData.dCancelDistance);
+    }
 
     //create Interpolation matrix
     m_pMatInterpolationMat = Interpolation::createInterpolationMat(m_lInterpolationData.vecMappedSubset,
                                                                    m_lInterpolationData.matDistanceMatrix,
                                                                    m_lInterpolationData.interpolationFunction,
                                                                    m_lInterpolationData.dCancelDistance);
-    }
+
+    m_interpolationCache.store(key, *m_pMatInterpolationMat);
+}
 
 //=============================================================================================================
 
@@ -40,6 +40,7 @@
 //=============================================================================================================
 
 #include "../../../../disp3D_global.h"
+#include "../../../../helpers/interpolation/interpolationcache.h"
 
 #include <fs/label.h>
 
@@ -154,6 +155,7 @@ protected:
     //=========================================================================================================
     /**
      * Calculate the interpolation operator based on the set interpolation info.
+     * The operator is taken from the interpolation cache if possible, otherwise it is calculated and stored in the cache.
      */
     void calculateInterpolationOperator();
 
@@ -176,7 +178,7 @@ protected:
     struct InterpolationData {
         double                          dCancelDistance;                /**< Cancel distance for the interpolaion in meters. */
 
-        QSharedPointer<Eigen::MatrixXd> matDistanceMatrix;              /**< Distance matrix that holds distances from sensors positions to the near vertices in meters. */
+        QSharedPointer<Eigen::SparseMatrix<float, Eigen::RowMajor> > matDistanceMatrix; /**< Sparse distance matrix that holds distances from sensors positions to the near vertices in meters. */
         Eigen::MatrixX3f                matVertices;                    /**< Holds all vertex information. */
 
         QList<FSLIB::Label>             lLabels;                        /**< The annotation labels. */
@@ -187,8 +189,11 @@ protected:
         QVector<QVector<int> >          vecNeighborVertices;            /**< The neighbor vertex information. */
 
         double (*interpolationFunction) (double);                   /**< Function that computes interpolation coefficients using the distance values. */
+        QString                         sInterpolationFunction;         /**< The name of the interpolation function. */
     }                           m_lInterpolationData;               /**< Container for the interpolation data. */
 
+    InterpolationCache          m_interpolationCache;               /**< The on-disk cache for interpolation matrices. */
+
     bool                        m_bInterpolationInfoIsInit;         /**< Flag if this thread's interpoaltion data was initialized. */
     bool                        m_bAnnotationInfoIsInit;            /**< Flag if this thread's annotation data was initialized. This flag is used to decide whether specific visualization types can be computed. */
 
@@ -40,14 +40,16 @@
 #include "geometryinfo.h"
 
 #include <fiff/fiff_info.h>
+#include <utils/kdtree.h>
 
 //=============================================================================================================
 // INCLUDES
 //=============================================================================================================
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
-#include <set>
+#include <functional>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -66,6 +68,7 @@
 using namespace DISP3DLIB;
 using namespace Eigen;
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
@@ -94,53 +97,43 @@ QSharedPointer<MatrixXd> GeometryInfo::scdc(const MatrixX3f &matVertices,
 
     // convention: first dimension in distance table is "from", second dimension "to"
     QSharedPointer<MatrixXd> returnMat = QSharedPointer<MatrixXd>::create(matVertices.rows(), iCols);
+    returnMat->setConstant(FLOAT_INFINITY);
 
-    // distribute calculation on cores
-    int iCores = QThread::idealThreadCount();
-    if (iCores <= 0) {
-        // assume that we have at least two available cores
-        iCores = 2;
-    }
+    runDijkstra(returnMat,
+                matVertices,
+                vecNeighborVertices,
+                vecVertSubset,
+                dCancelDist);
 
-    // start threads with their respective parts of the final subset
-    qint32 iSubArraySize = int(double(vecVertSubset.size()) / double(iCores));
-    QVector<QFuture<void> > vecThreads(iCores);
-    qint32 iBegin = 0;
-    qint32 iEnd = iSubArraySize;
+    return returnMat;
+}
 
-    for (int i = 0; i < vecThreads.size(); ++i) {
-        //last round
-        if(i == vecThreads.size()-1)
-        {
-            vecThreads[i] = QtConcurrent::run(std::bind(iterativeDijkstra,
-                                                        returnMat,
-                                                        std::cref(matVertices),
-                                                        std::cref(vecNeighborVertices),
-                                                        std::cref(vecVertSubset),
-                                                        iBegin,
-                                                        vecVertSubset.size(),
-                                                        dCancelDist));
-            break;
-        }
-        else
-        {
-            vecThreads[i] = QtConcurrent::run(std::bind(iterativeDijkstra,
-                                                        returnMat,
-                                                        std::cref(matVertices),
-                                                        std::cref(vecNeighborVertices),
-                                                        std::cref(vecVertSubset),
-                                                        iBegin,
-                                                        iEnd,
-                                                        dCancelDist));
-            iBegin += iSubArraySize;
-            iEnd += iSubArraySize;
+//=============================================================================================================
+
+QSharedPointer<SparseMatrix<float, RowMajor> > GeometryInfo::scdcSparse(const MatrixX3f &matVertices,
+                                                                       const QVector<QVector<int> > &vecNeighborVertices,
+                                                                       QVector<int> &vecVertSubset,
+                                                                       double dCancelDist)
+{
+    if(vecVertSubset.empty()) {
+        // caller passed an empty subset, need to fill in all vertex IDs
+        qDebug() << "[WARNING] SCDC received empty subset, calculating distances for all vertices.";
+        vecVertSubset.reserve(matVertices.rows());
+        for(qint32 id = 0; id < matVertices.rows(); ++id) {
+            vecVertSubset.push_back(id);
         }
     }
 
-    // wait for all other threads to finish
-    for (QFuture<void>& f : vecThreads) {
-        f.waitForFinished();
-    }
+    QVector<Triplet<float> > vecTriplets = runDijkstra(QSharedPointer<MatrixXd>(),
+                                                       matVertices,
+                                                       vecNeighborVertices,
+                                                       vecVertSubset,
+                                                       dCancelDist);
+
+    // convention: first dimension in distance table is "from", second dimension "to"
+    QSharedPointer<SparseMatrix<float, RowMajor> > returnMat = QSharedPointer<SparseMatrix<float, RowMajor> >::create(matVertices.rows(),
+                                                                                                                   vecVertSubset.size());
+    returnMat->setFromTriplets(vecTriplets.constBegin(), vecTriplets.constEnd());
 
     return returnMat;
 }
@@ -149,171 +142,249 @@ QSharedPointer<MatrixXd> GeometryInfo::scdc(const MatrixX3f &matVertices,
 
 QVector<int> GeometryInfo::projectSensors(const MatrixX3f &matVertices,
                                           const QVector<Vector3f> &vecSensorPositions)
+{
+    if(vecSensorPositions.isEmpty()) {
+        return QVector<int>();
+    }
+
+    return projectSensors(KdTree(matVertices),
+                          vecSensorPositions);
+}
+
+//=============================================================================================================
+
+QVector<int> GeometryInfo::projectSensors(const KdTree &vertexTree,
+                                          const QVector<Vector3f> &vecSensorPositions)
 {
     QVector<int> vecOutputArray;
+    vecOutputArray.reserve(vecSensorPositions.size());
 
-    qint32 iCores = QThread::idealThreadCount();
-    if (iCores <= 0)
-    {
-        // assume that we have at least two available cores
-        iCores = 2;
+    for(const Vector3f& vecSensor : vecSensorPositions) {
+        vecOutputArray.push_back(vertexTree.nearest(vecSensor));
     }
 
-    const qint32 iSubArraySize = int(double(vecSensorPositions.size()) / double(iCores));
+    return vecOutputArray;
+}
 
-    //small input size no threads needed
-    if(iSubArraySize <= 1)
-    {
-        vecOutputArray.append(nearestNeighbor(matVertices,
-                                              vecSensorPositions.constBegin(),
-                                              vecSensorPositions.constEnd()));
-        return vecOutputArray;
-    }
+//=============================================================================================================
 
-    // split input array + thread start
-    QVector<QFuture<QVector<int> > > vecThreads(iCores);
-    qint32 iBeginOffset = 0;
-    qint32 iEndOffset = iBeginOffset + iSubArraySize;
-    for(qint32 i = 0; i < vecThreads.size(); ++i)
-    {
-        //last round
-        if(i == vecThreads.size()-1)
-        {
-            vecThreads[i] = QtConcurrent::run(nearestNeighbor,
-                                              matVertices,
-                                              vecSensorPositions.constBegin() + iBeginOffset,
-                                              vecSensorPositions.constEnd());
-            break;
-        }
-        else
-        {
-            vecThreads[i] = QtConcurrent::run(nearestNeighbor,
-                                              matVertices,
-                                              vecSensorPositions.constBegin() + iBeginOffset,
-                                              vecSensorPositions.constBegin() + iEndOffset);
-            iBeginOffset = iEndOffset;
-            iEndOffset += iSubArraySize;
-        }
-    }
+GeometryInfo::AdjacencyCsr GeometryInfo::buildAdjacency(const MatrixX3f &matVertices,
+                                                        const QVector<QVector<int> > &vecNeighborVertices)
+{
+    AdjacencyCsr adjacency;
+    const qint32 iNumVert = vecNeighborVertices.size();
 
-    //wait for threads to finish
-    for (QFuture<QVector<int> >& f : vecThreads) {
-        f.waitForFinished();
+    adjacency.vecOffsets.resize(iNumVert + 1);
+    adjacency.vecOffsets[0] = 0;
+    for(qint32 u = 0; u < iNumVert; ++u) {
+        adjacency.vecOffsets[u + 1] = adjacency.vecOffsets[u] + vecNeighborVertices.at(u).size();
     }
 
-    //move sub arrays back into output
-    for(qint32 i = 0; i < vecThreads.size(); ++i)
-    {
-        vecOutputArray.append(std::move(vecThreads[i].result()));
+    adjacency.vecNeighbors.resize(adjacency.vecOffsets[iNumVert]);
+    adjacency.vecEdgeLengths.resize(adjacency.vecOffsets[iNumVert]);
+
+    qint32 k = 0;
+    for(qint32 u = 0; u < iNumVert; ++u) {
+        for(const int v : vecNeighborVertices.at(u)) {
+            const double dDistX = matVertices(u, 0) - matVertices(v, 0);
+            const double dDistY = matVertices(u, 1) - matVertices(v, 1);
+            const double dDistZ = matVertices(u, 2) - matVertices(v, 2);
+
+            adjacency.vecNeighbors[k] = v;
+            adjacency.vecEdgeLengths[k] = sqrt(dDistX * dDistX + dDistY * dDistY + dDistZ * dDistZ);
+            ++k;
+        }
     }
 
-    return vecOutputArray;
+    return adjacency;
 }
 
 //=============================================================================================================
 
-QVector<int> GeometryInfo::nearestNeighbor(const MatrixX3f &matVertices,
-                                           QVector<Vector3f>::const_iterator itSensorBegin,
-                                           QVector<Vector3f>::const_iterator itSensorEnd)
+void GeometryInfo::truncatedDijkstra(const AdjacencyCsr &adjacency,
+                                     qint32 iRoot,
+                                     double dCancelDistance,
+                                     std::vector<double> &vecMinDists,
+                                     std::vector<qint32> &vecVisited,
+                                     std::vector<std::pair<double, qint32> > &vecHeap)
 {
-    //lin search sensor positions
-    QVector<int> vecMappedSensors;
-    vecMappedSensors.reserve(std::distance(itSensorBegin, itSensorEnd));
-int u =0;
-    for(auto sensor = itSensorBegin; sensor != itSensorEnd; ++sensor)
-    {
-        qint32 iChampionId;
-        double iChampDist = std::numeric_limits<double>::max();
-        for(qint32 i = 0; i < matVertices.rows(); ++i)
-        {
-            //calculate 3d euclidian distance
-            double dDist = sqrt(squared(matVertices(i, 0) - (*sensor)[0])  // x-cord
-                                + squared(matVertices(i, 1) - (*sensor)[1])    // y-cord
-                                + squared(matVertices(i, 2) - (*sensor)[2]));  // z-cord
-            if(dDist < iChampDist)
-            {
-                iChampionId = i;
-                iChampDist = dDist;
+    typedef std::pair<double, qint32> HeapEntry;
+    const std::greater<HeapEntry> heapOrder;
+
+    const qint32* pOffsets = adjacency.vecOffsets.constData();
+    const qint32* pNeighbors = adjacency.vecNeighbors.constData();
+    const double* pEdgeLengths = adjacency.vecEdgeLengths.constData();
+
+    vecHeap.clear();
+    vecVisited.clear();
+
+    vecMinDists[iRoot] = 0.0;
+    vecVisited.push_back(iRoot);
+    vecHeap.push_back(HeapEntry(0.0, iRoot));
+
+    while(!vecHeap.empty()) {
+        // remove next vertex from queue
+        std::pop_heap(vecHeap.begin(), vecHeap.end(), heapOrder);
+        const double dDist = vecHeap.back().first;
+        const qint32 u = vecHeap.back().second;
+        vecHeap.pop_back();
+
+        // skip outdated queue entries (lazy decreaseKey) and vertices beyond the cancel distance
+        if(dDist > vecMinDists[u] || dDist > dCancelDistance) {
+            continue;
+        }
+
+        // visit each neighbour of u
+        for(qint32 k = pOffsets[u]; k < pOffsets[u + 1]; ++k) {
+            const qint32 v = pNeighbors[k];
+            const double dDistWithU = dDist + pEdgeLengths[k];
+
+            if(dDistWithU < vecMinDists[v]) {
+                if(vecMinDists[v] == std::numeric_limits<double>::infinity()) {
+                    vecVisited.push_back(v);
+                }
+                vecMinDists[v] = dDistWithU;
+                vecHeap.push_back(HeapEntry(dDistWithU, v));
+                std::push_heap(vecHeap.begin(), vecHeap.end(), heapOrder);
             }
         }
-       // qDebug() << "[GeometryInfo::nearestNeighbor] u" << u++;
-        vecMappedSensors.push_back(iChampionId);
     }
-
-    return vecMappedSensors;
 }
 
 //=============================================================================================================
 
-void GeometryInfo::iterativeDijkstra(QSharedPointer<MatrixXd> matOutputDistMatrix,
-                                     const MatrixX3f &matVertices,
-                                     const QVector<QVector<int> > &vecNeighborVertices,
-                                     const QVector<int> &vecVertSubset,
-                                     qint32 iBegin,
-                                     qint32 iEnd,
-                                     double dCancelDistance) {
-    // initialization
-    const QVector<QVector<int> > &vecAdjacency = vecNeighborVertices;
-    qint32 n = vecAdjacency.size();
-    QVector<double> vecMinDists(n);
-    std::set< std::pair< double, qint32> > vertexQ;
-    const double INF = FLOAT_INFINITY;
-
-    // outer loop, iterated for each vertex of 'vertSubset' between 'begin' and 'end'
-    for (qint32 i = iBegin; i < iEnd; ++i) {
-        // init phase of dijkstra: set source node for current iteration and reset data fields
-        if(i ==123)
-            qDebug() << "blabla";
-        qint32 iRoot = vecVertSubset.at(i);
-        vertexQ.clear();
-        vecMinDists.fill(INF);
-        vecMinDists[iRoot] = 0.0;
-        vertexQ.insert(std::make_pair(vecMinDists[iRoot], iRoot));
-
-        // dijkstra main loop
-        while (vertexQ.empty() == false) {
-            // remove next vertex from queue
-            const double dDist = vertexQ.begin()->first;
-            const qint32 u = vertexQ.begin()->second;
-            vertexQ.erase(vertexQ.begin());
-
-            // check if we are still below cancel distance
-            if (dDist <= dCancelDistance) {
-                // visit each neighbour of u
-                const QVector<int>& vecNeighbours = vecAdjacency[u];
-
-                for (qint32 ne = 0; ne < vecNeighbours.length(); ++ne) {
-                    qint32 v = vecNeighbours[ne];
-
-                    // distance from source (i.e. root) to v, using u as its predecessor
-                    // calculate inline since designated function was magnitudes slower (even when declared as inline)
-                    const double dDistX = matVertices(u, 0) - matVertices(v, 0);
-                    const double dDistY = matVertices(u, 1) - matVertices(v, 1);
-                    const double dDistZ = matVertices(u, 2) - matVertices(v, 2);
-                    const double dDistWithU = dDist + sqrt(dDistX * dDistX + dDistY * dDistY + dDistZ * dDistZ);
-
-                    if (dDistWithU < vecMinDists[v]) {
-                        // this is a combination of insert and decreaseKey
-                        vertexQ.erase(std::make_pair(vecMinDists[v], v));
-                        vecMinDists[v] = dDistWithU;
-                        vertexQ.insert(std::make_pair(vecMinDists[v], v));
+QVector<Triplet<float> > GeometryInfo::iterativeDijkstra(QSharedPointer<MatrixXd> matOutputDistMatrix,
+                                                        const AdjacencyCsr &adjacency,
+                                                        const QVector<int> &vecVertSubset,
+                                                        QAtomicInt *pNextRoot,
+                                                        qint32 iChunkSize,
+                                                        double dCancelDistance)
+{
+    QVector<Triplet<float> > vecTriplets;
+
+    // per thread buffers, reused for every root
+    std::vector<double> vecMinDists(adjacency.vecOffsets.size() - 1, std::numeric_limits<double>::infinity());
+    std::vector<qint32> vecVisited;
+    std::vector<std::pair<double, qint32> > vecHeap;
+
+    const qint32 iNumRoots = vecVertSubset.size();
+
+    for(qint32 iBegin = pNextRoot->fetchAndAddOrdered(iChunkSize); iBegin < iNumRoots; iBegin = pNextRoot->fetchAndAddOrdered(iChunkSize)) {
+        const qint32 iEnd = std::min(iBegin + iChunkSize, iNumRoots);
+
+        for(qint32 i = iBegin; i < iEnd; ++i) {
+            truncatedDijkstra(adjacency,
+                              vecVertSubset.at(i),
+                              dCancelDistance,
+                              vecMinDists,
+                              vecVisited,
+                              vecHeap);
+
+            // save results for current root and reset only the touched entries
+            if(matOutputDistMatrix) {
+                for(const qint32 v : vecVisited) {
+                    matOutputDistMatrix->coeffRef(v, i) = vecMinDists[v];
+                    vecMinDists[v] = std::numeric_limits<double>::infinity();
+                }
+            } else {
+                for(const qint32 v : vecVisited) {
+                    if(vecMinDists[v] <= dCancelDistance) {
+                        vecTriplets.push_back(Triplet<float>(v, i, vecMinDists[v]));
                     }
+                    vecMinDists[v] = std::numeric_limits<double>::infinity();
                 }
             }
         }
+    }
 
-        // save results for current root in matrix
-        for (qint32 m = 0; m < vecMinDists.size(); ++m) {
-            matOutputDistMatrix->coeffRef(m , i) = vecMinDists[m];
-        }
+    return vecTriplets;
+}
+
+//=============================================================================================================
+
+QVector<Triplet<float> > GeometryInfo::runDijkstra(QSharedPointer<MatrixXd> matOutputDistMatrix,
+                                                  const MatrixX3f &matVertices,
+                                                  const QVector<QVector<int> > &vecNeighborVertices,
+                                                  const QVector<int> &vecVertSubset,
+                                                  double dCancelDistance)
+{
+    const AdjacencyCsr adjacency = buildAdjacency(matVertices, vecNeighborVertices);
+
+    // distribute calculation on cores
+    int iCores = QThread::idealThreadCount();
+    if (iCores <= 0) {
+        // assume that we have at least two available cores
+        iCores = 2;
+    }
+
+    // small chunks keep all threads busy even if the roots differ strongly in their amount of work
+    const qint32 iChunkSize = std::max(1, std::min(16, vecVertSubset.size() / (4 * iCores)));
+    QAtomicInt iNextRoot(0);
+
+    QVector<QFuture<QVector<Triplet<float> > > > vecThreads(iCores);
+    for (int i = 0; i < vecThreads.size(); ++i) {
+        vecThreads[i] = QtConcurrent::run(std::bind(iterativeDijkstra,
+                                                    matOutputDistMatrix,
+                                                    std::cref(adjacency),
+                                                    std::cref(vecVertSubset),
+                                                    &iNextRoot,
+                                                    iChunkSize,
+                                                    dCancelDistance));
+    }
+
+    // wait for all threads to finish and collect their results
+    QVector<Triplet<float> > vecTriplets;
+    for (QFuture<QVector<Triplet<float> > >& f : vecThreads) {
+        f.waitForFinished();
+        vecTriplets.append(f.result());
     }
+
+    return vecTriplets;
 }
 
 //=============================================================================================================
 
 QVector<int> GeometryInfo::filterBadChannels(QSharedPointer<Eigen::MatrixXd> matDistanceTable,
-                                                const FIFFLIB::FiffInfo& fiffInfo,
-                                                qint32 iSensorType) {
+                                             const FIFFLIB::FiffInfo& fiffInfo,
+                                             qint32 iSensorType) {
+    QVector<int> vecBadColumns = findBadColumns(fiffInfo, iSensorType);
+
+    // found index of our bad channel, set whole column to infinity
+    for(int col : vecBadColumns){
+        matDistanceTable->col(col).setConstant(FLOAT_INFINITY);
+    }
+
+    return vecBadColumns;
+}
+
+//=============================================================================================================
+
+QVector<int> GeometryInfo::filterBadChannels(QSharedPointer<SparseMatrix<float, RowMajor> > matDistanceTable,
+                                             const FIFFLIB::FiffInfo& fiffInfo,
+                                             qint32 iSensorType) {
+    QVector<int> vecBadColumns = findBadColumns(fiffInfo, iSensorType);
+
+    if(vecBadColumns.isEmpty()) {
+        return vecBadColumns;
+    }
+
+    // drop all entries of bad columns, missing entries are treated as infinite distances
+    QVector<bool> vecIsBad(matDistanceTable->cols(), false);
+    for(int col : vecBadColumns){
+        vecIsBad[col] = true;
+    }
+
+    matDistanceTable->prune([&vecIsBad](const Index&, const Index& col, const float&) {
+        return !vecIsBad.at(col);
+    });
+
+    return vecBadColumns;
+}
+
+//=============================================================================================================
+
+QVector<int> GeometryInfo::findBadColumns(const FIFFLIB::FiffInfo& fiffInfo,
+                                          qint32 iSensorType) {
     // use pointer to avoid copying of FiffChInfo objects
     QVector<int> vecBadColumns;
     QVector<const FiffChInfo*> vecSensors;
@@ -328,11 +399,7 @@ QVector<int> GeometryInfo::filterBadChannels(QSharedPointer<Eigen::MatrixXd> mat
     for(const QString& b : fiffInfo.bads){
         for(int col = 0; col < vecSensors.size(); ++col){
             if(vecSensors[col]->ch_name == b){
-                // found index of our bad channel, set whole column to infinity
                 vecBadColumns.push_back(col);
-                for(int row = 0; row < matDistanceTable->rows(); ++row){
-                    matDistanceTable->coeffRef(row, col) = FLOAT_INFINITY;
-                }
                 break;
             }
         }
@@ -47,6 +47,8 @@
 //=============================================================================================================
 
 #include <limits>
+#include <vector>
+#include <utility>
 
 //=============================================================================================================
 // QT INCLUDES
@@ -54,12 +56,14 @@
 
 #include <QSharedPointer>
 #include <QVector>
+#include <QAtomicInt>
 
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
 
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 //=============================================================================================================
 // FORWARD DECLARATIONS
@@ -69,6 +73,10 @@ namespace MNELIB {
     class MNEmatVertices;
 }
 
+namespace UTILSLIB {
+    class KdTree;
+}
+
 //=============================================================================================================
 // DEFINE NAMESPACE DISP3DLIB
 //=============================================================================================================
@@ -121,6 +129,25 @@ public:
                                                 QVector<int> &pVecVertSubset,
                                                 double dCancelDist = FLOAT_INFINITY);
 
+    //=========================================================================================================
+    /**
+     * @brief scdcSparse                     Calculates surface constrained distances on a mesh and only keeps the
+     *                                       distances which lie within the cancel distance. The result is stored in
+     *                                       compressed sparse row format, which keeps the memory footprint proportional
+     *                                       to the number of vertices inside the cancel distance instead of vertices x subset.
+     *
+     * @param[in] matVertices                The surface on which distances should be calculated.
+     * @param[in] vecNeighborVertices        The neighbor vertex information.
+     * @param[in/out] pVecVertSubset         The subset of IDs for which the distances should be calculated.
+     * @param[in] dCancelDist                Distances higher than this are not stored.
+     *
+     * @return                               A sparse row major float matrix. One column represents the distances for one vertex inside of the passed subset
+     */
+    static QSharedPointer<Eigen::SparseMatrix<float, Eigen::RowMajor> > scdcSparse(const Eigen::MatrixX3f &matVertices,
+                                                                                   const QVector<QVector<int> > &vecNeighborVertices,
+                                                                                   QVector<int> &pVecVertSubset,
+                                                                                   double dCancelDist = FLOAT_INFINITY);
+
     //=========================================================================================================
     /**
      * @brief                            Calculates the nearest neighbor (euclidian distance) vertex to each sensor
@@ -134,6 +161,20 @@ public:
     static QVector<int> projectSensors(const Eigen::MatrixX3f &matVertices,
                                        const QVector<Eigen::Vector3f> &vecSensorPositions);
 
+    //=========================================================================================================
+    /**
+     * @brief                            Calculates the nearest neighbor (euclidian distance) vertex to each sensor.
+     *                                   Use this overload to reuse the spatial index of a surface when remapping sensors.
+     *
+     * @param[in] vertexTree             Spatial index built on the vertices of the surface.
+     * @param[in] vecSensorPositions     Each sensor postion in saved in an Eigen vector with x, y & z coord.
+     *
+     * @return                           Output vector where the vector index position represents the id of the sensor
+     *                                   and the int in each cell is the vertex it is mapped to
+     */
+    static QVector<int> projectSensors(const UTILSLIB::KdTree &vertexTree,
+                                       const QVector<Eigen::Vector3f> &vecSensorPositions);
+
     //=========================================================================================================
     /**
      * @brief filterBadChannels          Filters bad channels from distance table
@@ -148,60 +189,116 @@ public:
                                           const FIFFLIB::FiffInfo& fiffInfo,
                                           qint32 iSensorType);
 
+    //=========================================================================================================
+    /**
+     * @brief filterBadChannels          Filters bad channels from a sparse distance table by removing their entries
+     *
+     * @param[out] matDistanceTable      Result of scdcSparse.
+     * @param[in] fiffInfo               Container for sensors.
+     * @param[in] iSensorType            Sensor type to be filtered out, use fiff constants.
+     *
+     * @return Vector of bad channel indices.
+     */
+    static QVector<int> filterBadChannels(QSharedPointer<Eigen::SparseMatrix<float, Eigen::RowMajor> > matDistanceTable,
+                                          const FIFFLIB::FiffInfo& fiffInfo,
+                                          qint32 iSensorType);
+
 protected:
     //=========================================================================================================
     /**
-     * @brief squared        Implemented for better readability only
+     * The mesh adjacency in compressed sparse row format together with the precomputed edge lengths.
+     */
+    struct AdjacencyCsr {
+        QVector<qint32>     vecOffsets;         /**< Start of the neighbors of each vertex in vecNeighbors. Holds number of vertices + 1 entries. */
+        QVector<qint32>     vecNeighbors;       /**< The neighbor IDs of all vertices, stored consecutively. */
+        QVector<double>     vecEdgeLengths;     /**< The euclidian length of each edge in vecNeighbors. */
+    };
+
+    //=========================================================================================================
+    /**
+     * @brief findBadColumns             Finds the columns of a distance table which belong to bad channels
      *
-     * @param[in] dBase      Base double value
+     * @param[in] fiffInfo               Container for sensors.
+     * @param[in] iSensorType            Sensor type to be filtered out, use fiff constants.
      *
-     * @return               Base squared
+     * @return Vector of bad channel indices.
      */
-    static inline  double squared(double dBase);
+    static QVector<int> findBadColumns(const FIFFLIB::FiffInfo& fiffInfo,
+                                       qint32 iSensorType);
 
     //=========================================================================================================
     /**
-     * @brief nearestNeighbor        Calculates the nearest vertex of an MNEmatVertices for each position between the two iterators
+     * @brief buildAdjacency             Converts the neighbor information into compressed sparse row format and computes all edge lengths once
      *
-     * @param[in] matVertices        The MNEmatVertices that holds the vertex information
-     * @param[in] itSensorBegin      The iterator that indicates the start of the wanted section of positions
-     * @param[in] itSensorEnd        The iterator that indicates the end of the wanted section of positions
+     * @param[in] matVertices            The surface on which distances should be calculated.
+     * @param[in] vecNeighborVertices    The neighbor vertex information.
      *
-     * @return                       A vector of nearest vertex IDs that corresponds to the subvector between the two iterators
+     * @return                           The adjacency in compressed sparse row format.
      */
-    static QVector<int> nearestNeighbor(const Eigen::MatrixX3f &matVertices,
-                                        QVector<Eigen::Vector3f>::const_iterator itSensorBegin,
-                                        QVector<Eigen::Vector3f>::const_iterator itSensorEnd);
+    static AdjacencyCsr buildAdjacency(const Eigen::MatrixX3f &matVertices,
+                                       const QVector<QVector<int> > &vecNeighborVertices);
 
     //=========================================================================================================
     /**
-     * @brief iterativeDijkstra     Calculates shortest distances on the mesh that is held by the MNEmatVertices for each vertex of the passed vector that lies between the two indices
+     * @brief truncatedDijkstra          Calculates the shortest distances from one root vertex using a binary heap.
+     *                                   Vertices are only expanded if they lie within the cancel distance.
+     *                                   All buffers are provided by the caller so they can be reused between roots.
      *
-     * @param[out] matOutputDistMatrix  The matrix in which the distances will be stored
+     * @param[in] adjacency              The adjacency in compressed sparse row format.
+     * @param[in] iRoot                  The root vertex.
+     * @param[in] dCancelDistance        Distance threshold: vertices farther away than this are not expanded.
+     * @param[in/out] vecMinDists        Distance buffer with one entry per vertex. Must be infinity for all entries on entry.
+     * @param[out] vecVisited            The IDs of all vertices which received a finite distance.
+     * @param[in/out] vecHeap            The heap storage.
+     */
+    static void truncatedDijkstra(const AdjacencyCsr &adjacency,
+                                  qint32 iRoot,
+                                  double dCancelDistance,
+                                  std::vector<double> &vecMinDists,
+                                  std::vector<qint32> &vecVisited,
+                                  std::vector<std::pair<double, qint32> > &vecHeap);
+
+    //=========================================================================================================
+    /**
+     * @brief iterativeDijkstra     Calculates shortest distances on the mesh for the vertices of the passed subset.
+     *                              The roots are fetched in chunks from a shared counter, so that all threads stay busy until the whole subset is processed.
+     *                              Distances are either written to the dense output matrix or, if no matrix was passed, returned as triplets.
+     *
+     * @param[out] matOutputDistMatrix  The dense matrix in which the distances will be stored. Can be a null pointer.
+     * @param[in] adjacency             The adjacency in compressed sparse row format.
+     * @param[in] vecVertSubset         The subset of vertices
+     * @param[in] pNextRoot             Shared counter holding the index of the next root which is not yet processed.
+     * @param[in] iChunkSize            The number of roots fetched from the counter at once.
+     * @param[in] dCancelDistance       Distance threshold: all vertices that have a higher distance to the respective root vertex are set to infinity
+     *
+     * @return                          The distances within the cancel distance as (vertex, subset index, distance) triplets. Empty if a dense output matrix was passed.
+     */
+    static QVector<Eigen::Triplet<float> > iterativeDijkstra(QSharedPointer<Eigen::MatrixXd> matOutputDistMatrix,
+                                                            const AdjacencyCsr &adjacency,
+                                                            const QVector<int> &vecVertSubset,
+                                                            QAtomicInt *pNextRoot,
+                                                            qint32 iChunkSize,
+                                                            double dCancelDistance);
+
+    //=========================================================================================================
+    /**
+     * @brief runDijkstra           Distributes the distance calculation of the subset on all available cores.
+     *
+     * @param[out] matOutputDistMatrix  The dense matrix in which the distances will be stored. Can be a null pointer.
      * @param[in] matVertices           The surface on which distances should be calculated
      * @param[in] vecNeighborVertices   The neighbor vertex information.
      * @param[in] vecVertSubset         The subset of vertices
-     * @param[in] iBegin                Start index of distance calculation
-     * @param[in] iEnd                  End index of distance calculation, exclusive
-     * @param[in] dCancelDistance       Distance threshold: all vertices that have a higher distance to the respective root vertex are set to infinity
+     * @param[in] dCancelDistance       Distance threshold.
+     *
+     * @return                          The triplets of all threads. Empty if a dense output matrix was passed.
      */
-    static void iterativeDijkstra(QSharedPointer<Eigen::MatrixXd> matOutputDistMatrix,
-                                  const Eigen::MatrixX3f &matVertices,
-                                  const QVector<QVector<int> > &vecNeighborVertices,
-                                  const QVector<int> &vecVertSubset,
-                                  qint32 iBegin,
-                                  qint32 iEnd,
-                                  double dCancelDistance);
+    static QVector<Eigen::Triplet<float> > runDijkstra(QSharedPointer<Eigen::MatrixXd> matOutputDistMatrix,
+                                                      const Eigen::MatrixX3f &matVertices,
+                                                      const QVector<QVector<int> > &vecNeighborVertices,
+                                                      const QVector<int> &vecVertSubset,
+                                                      double dCancelDistance);
 };
 
-//=============================================================================================================
-// INLINE DEFINITIONS
-//=============================================================================================================
-
-inline double GeometryInfo::squared(double dBase)
-{
-    return dBase * dBase;
-}
 } // namespace GEOMETRYINFO
 
 #endif // DISP3DLIB_GEOMETRYINFO_H
@@ -0,0 +1,216 @@
+//=============================================================================================================
+/**
+ * @file     colorframekernel.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    ColorFrameKernel class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "colorframekernel.h"
+
+#include <disp/plots/helpers/colormap.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace DISP3DLIB;
+using namespace DISPLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+ColorFrameKernel::ColorFrameKernel(NormalizationMode mode,
+                                   int iLutSize)
+: m_normalizationMode(mode)
+, m_dThresholdX(0.0)
+, m_dThresholdZ(1.0)
+, m_pMatInterpolationMatrix(QSharedPointer<SparseMatrix<float> >(new SparseMatrix<float>()))
+, m_iNumberFrames(0)
+{
+    m_matLut.resize(std::max(iLutSize, 2), 3);
+    buildLut();
+}
+
+//=============================================================================================================
+
+void ColorFrameKernel::setInterpolationMatrix(const QSharedPointer<SparseMatrix<float> > &pMatInterpolationMatrix)
+{
+    m_pMatInterpolationMatrix = pMatInterpolationMatrix;
+}
+
+//=============================================================================================================
+
+QSharedPointer<SparseMatrix<float> > ColorFrameKernel::interpolationMatrix() const
+{
+    return m_pMatInterpolationMatrix;
+}
+
+//=============================================================================================================
+
+void ColorFrameKernel::setOriginalColors(const MatrixX4f &matOriginalVertColor)
+{
+    m_matOriginalVertColor = matOriginalVertColor;
+}
+
+//=============================================================================================================
+
+void ColorFrameKernel::setColormapType(const QString &sColormapType)
+{
+    if(sColormapType == m_sColormapType) {
+        return;
+    }
+
+    m_sColormapType = sColormapType;
+    buildLut();
+}
+
+//=============================================================================================================
+
+void ColorFrameKernel::setThresholds(double dThresholdX,
+                                     double dThresholdZ)
+{
+    m_dThresholdX = dThresholdX;
+    m_dThresholdZ = dThresholdZ;
+}
+
+//=============================================================================================================
+
+int ColorFrameKernel::computeFrames(const MatrixXf &matSensorValues)
+{
+    m_iNumberFrames = 0;
+
+    if(!m_pMatInterpolationMatrix || m_pMatInterpolationMatrix->cols() == 0) {
+        return 0;
+    }
+
+    if(matSensorValues.rows() != m_pMatInterpolationMatrix->cols()) {
+        qDebug() << "ColorFrameKernel::computeFrames - Number of sensor values (" << matSensorValues.rows() << ") do not match with previously set number of sensors (" << m_pMatInterpolationMatrix->cols() << "). Returning...";
+        return 0;
+    }
+
+    if(m_matOriginalVertColor.rows() != m_pMatInterpolationMatrix->rows()) {
+        qDebug() << "ColorFrameKernel::computeFrames - Number of vertex colors (" << m_matOriginalVertColor.rows() << ") do not match with the number of interpolated vertices (" << m_pMatInterpolationMatrix->rows() << "). Returning...";
+        return 0;
+    }
+
+    // Interpolate all samples of the block at once
+    m_matInterpolated.noalias() = (*m_pMatInterpolationMatrix) * matSensorValues;
+
+    if(m_vecFramePool.size() < matSensorValues.cols()) {
+        m_vecFramePool.resize(matSensorValues.cols());
+    }
+
+    for(int i = 0; i < matSensorValues.cols(); ++i) {
+        // Reset to original color as default. Frames of the same size reuse their memory.
+        m_vecFramePool[i] = m_matOriginalVertColor;
+        colorize(i, m_vecFramePool[i]);
+    }
+
+    m_iNumberFrames = matSensorValues.cols();
+
+    return m_iNumberFrames;
+}
+
+//=============================================================================================================
+
+int ColorFrameKernel::numberFrames() const
+{
+    return m_iNumberFrames;
+}
+
+//=============================================================================================================
+
+const MatrixX4f& ColorFrameKernel::frame(int iFrame) const
+{
+    return m_vecFramePool.at(iFrame);
+}
+
+//=============================================================================================================
+
+void ColorFrameKernel::buildLut()
+{
+    const int iLutSize = m_matLut.rows();
+    QRgb qRgb;
+
+    for(int i = 0; i < iLutSize; ++i) {
+        qRgb = ColorMap::valueToColor(double(i) / double(iLutSize - 1), m_sColormapType);
+
+        m_matLut(i,0) = (float)qRed(qRgb)/255.0f;
+        m_matLut(i,1) = (float)qGreen(qRgb)/255.0f;
+        m_matLut(i,2) = (float)qBlue(qRgb)/255.0f;
+    }
+}
+
+//=============================================================================================================
+
+void ColorFrameKernel::colorize(int iColumn,
+                                MatrixX4f &matFrame)
+{
+    const float fThresholdX = m_dThresholdX;
+    const float fThresholdDiff = m_dThresholdZ - m_dThresholdX;
+    const float fLutScale = m_matLut.rows() - 1;
+    const auto vecValues = m_matInterpolated.col(iColumn).array();
+
+    // Normalize all vertices at once. Take the absolute values because the histogram threshold is also calculated using the absolute values.
+    if(fThresholdDiff > 0.0f) {
+        m_vecNormalized = ((vecValues.abs() - fThresholdX) / fThresholdDiff).min(1.0f).max(0.0f);
+    } else {
+        m_vecNormalized = (vecValues.abs() >= fThresholdX).cast<float>();
+    }
+
+    if(m_normalizationMode == Signed) {
+        m_vecNormalized = 0.5f + 0.5f * m_vecNormalized * vecValues.sign();
+    }
+
+    for(int r = 0; r < matFrame.rows(); ++r) {
+        if(std::fabs(vecValues(r)) >= fThresholdX) {
+            const int iLutIndex = int(m_vecNormalized(r) * fLutScale + 0.5f);
+
+            matFrame(r,0) = m_matLut(iLutIndex,0);
+            matFrame(r,1) = m_matLut(iLutIndex,1);
+            matFrame(r,2) = m_matLut(iLutIndex,2);
+            matFrame(r,3) = 1.0f;
+        } else if(m_normalizationMode == Absolute) {
+            matFrame(r,3) = 0.0f; //Only vertices with activation are plotted
+        }
+    }
+}
@@ -0,0 +1,204 @@
+//=============================================================================================================
+/**
+ * @file     colorframekernel.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    ColorFrameKernel class declaration.
+ *
+ */
+
+#ifndef DISP3DLIB_COLORFRAMEKERNEL_H
+#define DISP3DLIB_COLORFRAMEKERNEL_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../../disp3D_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+#include <QString>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+//=============================================================================================================
+// DEFINE NAMESPACE DISP3DLIB
+//=============================================================================================================
+
+namespace DISP3DLIB {
+
+//=============================================================================================================
+/**
+ * Turns a block of sensor (or source) samples into per-vertex RGBA color frames. All samples of the block are
+ * interpolated with a single sparse x dense product, the normalized values are mapped to colors via a lookup table
+ * which is only rebuilt when the colormap changes. The resulting frames are written to a pool of color matrices
+ * which is reused between blocks, so no allocations take place once the pool has reached the block size.
+ *
+ * @brief Batched interpolation and colormap kernel for the real-time data workers.
+ */
+class DISP3DSHARED_EXPORT ColorFrameKernel
+{
+
+public:
+    typedef QSharedPointer<ColorFrameKernel> SPtr;            /**< Shared pointer type for ColorFrameKernel. */
+    typedef QSharedPointer<const ColorFrameKernel> ConstSPtr; /**< Const shared pointer type for ColorFrameKernel. */
+
+    /** The way interpolated values are normalized between the two thresholds. */
+    enum NormalizationMode {
+        Signed,     /**< Map [-Z, Z] to [0, 1], 0.5 is zero. Vertices below the lower threshold keep their original color. */
+        Absolute    /**< Map |value| in [X, Z] to [0, 1]. Vertices below the lower threshold are made transparent. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Constructs a ColorFrameKernel.
+     *
+     * @param[in] mode           The normalization mode.
+     * @param[in] iLutSize       The number of entries in the colormap lookup table.
+     */
+    explicit ColorFrameKernel(NormalizationMode mode = Signed,
+                              int iLutSize = 1024);
+
+    //=========================================================================================================
+    /**
+     * Sets the interpolation matrix <n_vertices x n_sensors>.
+     *
+     * @param[in] pMatInterpolationMatrix    The interpolation matrix.
+     */
+    void setInterpolationMatrix(const QSharedPointer<Eigen::SparseMatrix<float> > &pMatInterpolationMatrix);
+
+    //=========================================================================================================
+    /**
+     * Returns the interpolation matrix.
+     *
+     * @return The interpolation matrix.
+     */
+    QSharedPointer<Eigen::SparseMatrix<float> > interpolationMatrix() const;
+
+    //=========================================================================================================
+    /**
+     * Sets the colors used for vertices below the lower threshold.
+     *
+     * @param[in] matOriginalVertColor       The original vertex colors <n_vertices x 4>.
+     */
+    void setOriginalColors(const Eigen::MatrixX4f &matOriginalVertColor);
+
+    //=========================================================================================================
+    /**
+     * Sets the colormap and rebuilds the lookup table if the colormap changed.
+     *
+     * @param[in] sColormapType      The colormap name as understood by DISPLIB::ColorMap::valueToColor.
+     */
+    void setColormapType(const QString &sColormapType);
+
+    //=========================================================================================================
+    /**
+     * Sets the normalization thresholds.
+     *
+     * @param[in] dThresholdX        The lower threshold.
+     * @param[in] dThresholdZ        The upper threshold.
+     */
+    void setThresholds(double dThresholdX,
+                       double dThresholdZ);
+
+    //=========================================================================================================
+    /**
+     * Interpolates a block of samples and generates one color frame per sample.
+     *
+     * @param[in] matSensorValues    The sensor values <n_sensors x n_frames>.
+     *
+     * @return The number of generated frames, 0 if the dimensions do not match the interpolation matrix.
+     */
+    int computeFrames(const Eigen::MatrixXf &matSensorValues);
+
+    //=========================================================================================================
+    /**
+     * Returns the number of frames generated by the last call to computeFrames.
+     *
+     * @return The number of frames.
+     */
+    int numberFrames() const;
+
+    //=========================================================================================================
+    /**
+     * Returns a frame generated by the last call to computeFrames. The reference stays valid until the next call
+     * to computeFrames.
+     *
+     * @param[in] iFrame     The frame index, must be smaller than numberFrames().
+     *
+     * @return The vertex colors <n_vertices x 4>.
+     */
+    const Eigen::MatrixX4f& frame(int iFrame) const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Rebuilds the colormap lookup table for m_sColormapType.
+     */
+    void buildLut();
+
+    //=========================================================================================================
+    /**
+     * Normalizes one column of m_matInterpolated and writes its colors to a frame.
+     *
+     * @param[in] iColumn            The column of m_matInterpolated.
+     * @param[in,out] matFrame       The frame to write to.
+     */
+    void colorize(int iColumn,
+                  Eigen::MatrixX4f &matFrame);
+
+    NormalizationMode                               m_normalizationMode;    /**< The normalization mode. */
+
+    double                                          m_dThresholdX;          /**< The lower threshold. */
+    double                                          m_dThresholdZ;          /**< The upper threshold. */
+
+    QString                                         m_sColormapType;        /**< The colormap the lookup table was built for. */
+    Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor> m_matLut;      /**< The colormap lookup table, one RGB triplet per row. */
+
+    QSharedPointer<Eigen::SparseMatrix<float> >     m_pMatInterpolationMatrix;  /**< The interpolation matrix. */
+    Eigen::MatrixX4f                                m_matOriginalVertColor; /**< The colors of vertices below the lower threshold. */
+
+    Eigen::MatrixXf                                 m_matInterpolated;      /**< The interpolated values <n_vertices x n_frames>, reused between blocks. */
+    Eigen::ArrayXf                                  m_vecNormalized;        /**< The normalized values of one frame, reused between frames. */
+    QVector<Eigen::MatrixX4f>                       m_vecFramePool;         /**< The frame pool, reused between blocks. */
+    int                                             m_iNumberFrames;        /**< The number of frames generated by the last block. */
+};
+
+} // namespace DISP3DLIB
+
+#endif // DISP3DLIB_COLORFRAMEKERNEL_H
@@ -43,6 +43,7 @@
 //=============================================================================================================
 
 #include <QSet>
+#include <QHash>
 #include <QDebug>
 
 //=============================================================================================================
@@ -137,6 +138,69 @@ QSharedPointer<SparseMatrix<float> > Interpolation::createInterpolationMat(const
 
 //=============================================================================================================
 
+QSharedPointer<SparseMatrix<float> > Interpolation::createInterpolationMat(const QVector<int> &vecProjectedSensors,
+                                                                           const QSharedPointer<SparseMatrix<float, RowMajor> > matDistanceTable,
+                                                                           double (*interpolationFunction) (double),
+                                                                           const double dCancelDist,
+                                                                           const QVector<int> &vecExcludeIndex)
+{
+    if(matDistanceTable->rows() == 0 && matDistanceTable->cols() == 0) {
+        qDebug() << "[WARNING] Interpolation::createInterpolationMat - received an empty distance table.";
+        return QSharedPointer<SparseMatrix<float> >::create();
+    }
+
+    // initialization
+    QSharedPointer<Eigen::SparseMatrix<float> > matInterpolationMatrix = QSharedPointer<SparseMatrix<float> >::create(matDistanceTable->rows(), vecProjectedSensors.size());
+
+    // temporary helper structure for filling sparse matrix
+    QVector<Triplet<float> > vecNonZeroEntries;
+    vecNonZeroEntries.reserve(matDistanceTable->nonZeros());
+    const qint32 iRows = matInterpolationMatrix->rows();
+
+    // map all sensor nodes to their index for faster lookup during later computation. Also consider bad channels here.
+    QHash<qint32, qint32> sensorLookup;
+    for(qint32 idx = vecProjectedSensors.size() - 1; idx >= 0; --idx){
+        if(!vecExcludeIndex.contains(idx)){
+            sensorLookup.insert(vecProjectedSensors.at(idx), idx);
+        }
+    }
+
+    // main loop: go through all rows of distance table and calculate weights
+    for (qint32 r = 0; r < iRows; ++r) {
+        QHash<qint32, qint32>::const_iterator itSensor = sensorLookup.constFind(r);
+
+        if (itSensor == sensorLookup.constEnd()) {
+            // "normal" node, i.e. one which was not assigned a sensor
+            const int iFirst = vecNonZeroEntries.size();
+            float dWeightsSum = 0.0;
+
+            for (SparseMatrix<float, RowMajor>::InnerIterator it(*matDistanceTable, r); it; ++it) {
+                const float dDist = it.value();
+
+                if (dDist < dCancelDist) {
+                    const float dValueWeight = std::fabs(1.0 / interpolationFunction(dDist));
+                    dWeightsSum += dValueWeight;
+                    vecNonZeroEntries.push_back(Eigen::Triplet<float> (r, it.col(), dValueWeight));
+                }
+            }
+
+            for (int i = iFirst; i < vecNonZeroEntries.size(); ++i) {
+                vecNonZeroEntries[i] = Eigen::Triplet<float> (r, vecNonZeroEntries[i].col(), vecNonZeroEntries[i].value() / dWeightsSum);
+            }
+        } else {
+            // a sensor has been assigned to this node, we do not need to interpolate anything
+            //(final vertex signal is equal to sensor input signal, thus factor 1)
+            vecNonZeroEntries.push_back(Eigen::Triplet<float> (r, itSensor.value(), 1));
+        }
+    }
+
+    matInterpolationMatrix->setFromTriplets(vecNonZeroEntries.begin(), vecNonZeroEntries.end());
+
+    return matInterpolationMatrix;
+}
+
+//=============================================================================================================
+
 VectorXf Interpolation::interpolateSignal(const QSharedPointer<SparseMatrix<float> > matInterpolationMatrix,
                                           const QSharedPointer<VectorXf> &vecMeasurementData)
 {
@@ -0,0 +1,295 @@
+//=============================================================================================================
+/**
+ * @file     interpolationcache.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    InterpolationCache class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "interpolationcache.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <limits>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace DISP3DLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define INTERPOLATION_CACHE_MAGIC   0x4D4E4549  /**< "MNEI", marks an interpolation cache file. */
+#define INTERPOLATION_CACHE_VERSION 1           /**< Increase whenever the file format or the interpolation algorithm changes. */
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+InterpolationCache::InterpolationCache(const QString& sCacheDir,
+                                       qint64 iMaxSizeBytes)
+: m_sCacheDir(sCacheDir.isEmpty() ? defaultCacheDir() : sCacheDir)
+, m_iMaxSizeBytes(iMaxSizeBytes)
+{
+}
+
+//=============================================================================================================
+
+QString InterpolationCache::defaultCacheDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/mne-cpp/interpolation";
+}
+
+//=============================================================================================================
+
+QByteArray InterpolationCache::computeKey(const MatrixX3f &matVertices,
+                                          const QVector<QVector<int> > &vecNeighborVertices,
+                                          const QVector<int> &vecMappedSubset,
+                                          const QVector<int> &vecExcludeIndex,
+                                          double dCancelDist,
+                                          const QString &sInterpolationFunction)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    const qint32 iVersion = INTERPOLATION_CACHE_VERSION;
+    hash.addData(reinterpret_cast<const char*>(&iVersion), sizeof(iVersion));
+
+    // surface geometry
+    const qint64 iNumVert = matVertices.rows();
+    hash.addData(reinterpret_cast<const char*>(&iNumVert), sizeof(iNumVert));
+    hash.addData(reinterpret_cast<const char*>(matVertices.data()), int(matVertices.size() * sizeof(float)));
+
+    for(const QVector<int>& vecNeighbors : vecNeighborVertices) {
+        const qint32 iNumNeighbors = vecNeighbors.size();
+        hash.addData(reinterpret_cast<const char*>(&iNumNeighbors), sizeof(iNumNeighbors));
+        hash.addData(reinterpret_cast<const char*>(vecNeighbors.constData()), int(iNumNeighbors * sizeof(int)));
+    }
+
+    // sensor layout and bad channels
+    const qint32 iNumMapped = vecMappedSubset.size();
+    hash.addData(reinterpret_cast<const char*>(&iNumMapped), sizeof(iNumMapped));
+    hash.addData(reinterpret_cast<const char*>(vecMappedSubset.constData()), int(iNumMapped * sizeof(int)));
+
+    const qint32 iNumExcluded = vecExcludeIndex.size();
+    hash.addData(reinterpret_cast<const char*>(&iNumExcluded), sizeof(iNumExcluded));
+    hash.addData(reinterpret_cast<const char*>(vecExcludeIndex.constData()), int(iNumExcluded * sizeof(int)));
+
+    // interpolation parameters
+    hash.addData(reinterpret_cast<const char*>(&dCancelDist), sizeof(dCancelDist));
+    hash.addData(sInterpolationFunction.toUtf8());
+
+    return hash.result().toHex();
+}
+
+//=============================================================================================================
+
+QSharedPointer<SparseMatrix<float> > InterpolationCache::load(const QByteArray &key) const
+{
+    QFile file(filePath(key));
+
+    if(!file.open(QIODevice::ReadOnly)) {
+        return QSharedPointer<SparseMatrix<float> >();
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 iMagic = 0, iVersion = 0;
+    stream >> iMagic >> iVersion;
+
+    if(iMagic != INTERPOLATION_CACHE_MAGIC || iVersion != INTERPOLATION_CACHE_VERSION) {
+        return QSharedPointer<SparseMatrix<float> >();
+    }
+
+    QByteArray storedKey;
+    qint32 iRows = 0, iCols = 0, iNonZeros = 0;
+    stream >> storedKey >> iRows >> iCols >> iNonZeros;
+
+    if(stream.status() != QDataStream::Ok || storedKey != key || iRows < 0 || iCols < 0 || iNonZeros < 0) {
+        qWarning() << "[InterpolationCache::load] Ignoring invalid cache file" << file.fileName();
+        return QSharedPointer<SparseMatrix<float> >();
+    }
+
+    // the sizes come from the file, they have to match the remaining data before anything is allocated for them
+    const qint64 iIndexSize = qint64(sizeof(SparseMatrix<float>::StorageIndex));
+    const qint64 iOuterBytes = (qint64(iCols) + 1) * iIndexSize;
+    const qint64 iInnerBytes = qint64(iNonZeros) * iIndexSize;
+    const qint64 iValueBytes = qint64(iNonZeros) * qint64(sizeof(float));
+
+    if(iOuterBytes + iInnerBytes + iValueBytes != file.size() - file.pos()
+       || qMax(iOuterBytes, qMax(iInnerBytes, iValueBytes)) > std::numeric_limits<int>::max()) {
+        qWarning() << "[InterpolationCache::load] Ignoring cache file with invalid size" << file.fileName();
+        return QSharedPointer<SparseMatrix<float> >();
+    }
+
+    QSharedPointer<SparseMatrix<float> > pMatInterpolation = QSharedPointer<SparseMatrix<float> >::create(iRows, iCols);
+    pMatInterpolation->resizeNonZeros(iNonZeros);
+
+    if(stream.readRawData(reinterpret_cast<char*>(pMatInterpolation->outerIndexPtr()), int(iOuterBytes)) != iOuterBytes
+       || stream.readRawData(reinterpret_cast<char*>(pMatInterpolation->innerIndexPtr()), int(iInnerBytes)) != iInnerBytes
+       || stream.readRawData(reinterpret_cast<char*>(pMatInterpolation->valuePtr()), int(iValueBytes)) != iValueBytes
+       || pMatInterpolation->outerIndexPtr()[0] != 0
+       || pMatInterpolation->outerIndexPtr()[iCols] != iNonZeros) {
+        qWarning() << "[InterpolationCache::load] Ignoring truncated cache file" << file.fileName();
+        return QSharedPointer<SparseMatrix<float> >();
+    }
+
+    // Eigen does not check the indices, invalid ones would be accessed out of bounds later on
+    const SparseMatrix<float>::StorageIndex* pOuter = pMatInterpolation->outerIndexPtr();
+    const SparseMatrix<float>::StorageIndex* pInner = pMatInterpolation->innerIndexPtr();
+
+    for(qint32 iCol = 0; iCol < iCols; ++iCol) {
+        if(pOuter[iCol + 1] < pOuter[iCol]) {
+            qWarning() << "[InterpolationCache::load] Ignoring cache file with decreasing outer indices" << file.fileName();
+            return QSharedPointer<SparseMatrix<float> >();
+        }
+    }
+
+    for(qint32 iCol = 0; iCol < iCols; ++iCol) {
+        for(qint32 k = pOuter[iCol]; k < pOuter[iCol + 1]; ++k) {
+            if(pInner[k] < 0 || pInner[k] >= iRows || (k > pOuter[iCol] && pInner[k] <= pInner[k - 1])) {
+                qWarning() << "[InterpolationCache::load] Ignoring cache file with invalid inner indices" << file.fileName();
+                return QSharedPointer<SparseMatrix<float> >();
+            }
+        }
+    }
+
+    // mark as recently used
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    return pMatInterpolation;
+}
+
+//=============================================================================================================
+
+bool InterpolationCache::store(const QByteArray &key,
+                               const SparseMatrix<float> &matInterpolationMatrix)
+{
+    if(!QDir().mkpath(m_sCacheDir)) {
+        qWarning() << "[InterpolationCache::store] Could not create cache directory" << m_sCacheDir;
+        return false;
+    }
+
+    // the raw arrays are only contiguous in compressed mode
+    const SparseMatrix<float>* pMat = &matInterpolationMatrix;
+    SparseMatrix<float> matCompressed;
+    if(!matInterpolationMatrix.isCompressed()) {
+        matCompressed = matInterpolationMatrix;
+        matCompressed.makeCompressed();
+        pMat = &matCompressed;
+    }
+
+    // QSaveFile only replaces the target on commit, so readers never see partially written files
+    QSaveFile file(filePath(key));
+    if(!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[InterpolationCache::store] Could not open" << file.fileName();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    const qint32 iNonZeros = qint32(pMat->nonZeros());
+    stream << quint32(INTERPOLATION_CACHE_MAGIC) << quint32(INTERPOLATION_CACHE_VERSION);
+    stream << key << qint32(pMat->rows()) << qint32(pMat->cols()) << iNonZeros;
+
+    stream.writeRawData(reinterpret_cast<const char*>(pMat->outerIndexPtr()), int((pMat->cols() + 1) * sizeof(SparseMatrix<float>::StorageIndex)));
+    stream.writeRawData(reinterpret_cast<const char*>(pMat->innerIndexPtr()), int(iNonZeros * sizeof(SparseMatrix<float>::StorageIndex)));
+    stream.writeRawData(reinterpret_cast<const char*>(pMat->valuePtr()), int(iNonZeros * sizeof(float)));
+
+    if(stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "[InterpolationCache::store] Could not write" << file.fileName();
+        return false;
+    }
+
+    enforceSizeLimit();
+
+    return true;
+}
+
+//=============================================================================================================
+
+void InterpolationCache::clear()
+{
+    QDir dir(m_sCacheDir);
+
+    for(const QFileInfo& fileInfo : dir.entryInfoList(QStringList() << "*.imat", QDir::Files)) {
+        QFile::remove(fileInfo.absoluteFilePath());
+    }
+}
+
+//=============================================================================================================
+
+QString InterpolationCache::filePath(const QByteArray &key) const
+{
+    return m_sCacheDir + "/" + QString::fromLatin1(key) + ".imat";
+}
+
+//=============================================================================================================
+
+void InterpolationCache::enforceSizeLimit()
+{
+    QDir dir(m_sCacheDir);
+
+    // most recently used first
+    const QFileInfoList lFiles = dir.entryInfoList(QStringList() << "*.imat", QDir::Files, QDir::Time);
+
+    qint64 iTotalSize = 0;
+    for(const QFileInfo& fileInfo : lFiles) {
+        iTotalSize += fileInfo.size();
+
+        if(iTotalSize > m_iMaxSizeBytes) {
+            QFile::remove(fileInfo.absoluteFilePath());
+        }
+    }
+}
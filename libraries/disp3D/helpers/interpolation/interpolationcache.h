@@ -0,0 +1,172 @@
+//=============================================================================================================
+/**
+ * @file     interpolationcache.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    InterpolationCache class declaration.
+ *
+ */
+
+#ifndef DISP3DLIB_INTERPOLATIONCACHE_H
+#define DISP3DLIB_INTERPOLATIONCACHE_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../../disp3D_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+//=============================================================================================================
+// DEFINE NAMESPACE DISP3DLIB
+//=============================================================================================================
+
+namespace DISP3DLIB {
+
+//=============================================================================================================
+/**
+ * Calculating the geodesic distance table and the interpolation matrix takes several seconds per surface.
+ * This class stores calculated interpolation matrices on disk, keyed by a hash of everything they depend on:
+ * the vertices and adjacency of the surface, the mapped sensor (or source) vertices, the excluded (bad) channels,
+ * the cancel distance and the interpolation function. Files written by a different cache format version are ignored.
+ * The total size of the cache directory is bounded, the least recently used matrices are removed first.
+ *
+ * @brief Persistent on-disk cache for interpolation matrices.
+ */
+class DISP3DSHARED_EXPORT InterpolationCache
+{
+
+public:
+    typedef QSharedPointer<InterpolationCache> SPtr;            /**< Shared pointer type for InterpolationCache. */
+    typedef QSharedPointer<const InterpolationCache> ConstSPtr; /**< Const shared pointer type for InterpolationCache. */
+
+    //=========================================================================================================
+    /**
+     * Constructs an InterpolationCache.
+     *
+     * @param[in] sCacheDir          The directory the matrices are stored in. Uses defaultCacheDir() if empty.
+     * @param[in] iMaxSizeBytes      The maximal total size of all stored matrices in bytes.
+     */
+    explicit InterpolationCache(const QString& sCacheDir = QString(),
+                                qint64 iMaxSizeBytes = 512 * 1024 * 1024);
+
+    //=========================================================================================================
+    /**
+     * Returns the default cache directory, located in the user's cache location.
+     *
+     * @return The default cache directory.
+     */
+    static QString defaultCacheDir();
+
+    //=========================================================================================================
+    /**
+     * Computes the key of an interpolation matrix.
+     *
+     * @param[in] matVertices                The surface vertices.
+     * @param[in] vecNeighborVertices        The neighbor vertex information.
+     * @param[in] vecMappedSubset            The vertices the sensors (or sources) are mapped to.
+     * @param[in] vecExcludeIndex            The excluded indices of vecMappedSubset, e.g., bad channels.
+     * @param[in] dCancelDist                The cancel distance.
+     * @param[in] sInterpolationFunction     The name of the interpolation function.
+     *
+     * @return The key as hex encoded hash.
+     */
+    static QByteArray computeKey(const Eigen::MatrixX3f &matVertices,
+                                 const QVector<QVector<int> > &vecNeighborVertices,
+                                 const QVector<int> &vecMappedSubset,
+                                 const QVector<int> &vecExcludeIndex,
+                                 double dCancelDist,
+                                 const QString &sInterpolationFunction);
+
+    //=========================================================================================================
+    /**
+     * Loads an interpolation matrix from the cache.
+     *
+     * @param[in] key    The key as returned by computeKey.
+     *
+     * @return The interpolation matrix, a null pointer if it is not cached or the file could not be read.
+     */
+    QSharedPointer<Eigen::SparseMatrix<float> > load(const QByteArray &key) const;
+
+    //=========================================================================================================
+    /**
+     * Stores an interpolation matrix in the cache and removes the least recently used matrices if the size bound is exceeded.
+     *
+     * @param[in] key                        The key as returned by computeKey.
+     * @param[in] matInterpolationMatrix     The interpolation matrix to store.
+     *
+     * @return true if the matrix was stored, false otherwise.
+     */
+    bool store(const QByteArray &key,
+               const Eigen::SparseMatrix<float> &matInterpolationMatrix);
+
+    //=========================================================================================================
+    /**
+     * Removes all stored matrices.
+     */
+    void clear();
+
+private:
+    //=========================================================================================================
+    /**
+     * Returns the file path for a key.
+     *
+     * @param[in] key    The key as returned by computeKey.
+     *
+     * @return The file path.
+     */
+    QString filePath(const QByteArray &key) const;
+
+    //=========================================================================================================
+    /**
+     * Removes the least recently used matrices until the cache size is below m_iMaxSizeBytes.
+     */
+    void enforceSizeLimit();
+
+    QString     m_sCacheDir;            /**< The directory the matrices are stored in. */
+    qint64      m_iMaxSizeBytes;        /**< The maximal total size of all stored matrices in bytes. */
+};
+
+} // namespace DISP3DLIB
+
+#endif // DISP3DLIB_INTERPOLATIONCACHE_H
@@ -0,0 +1,226 @@
+//=============================================================================================================
+/**
+ * @file     hpidemodulator.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    HPIDemodulator class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "hpidemodulator.h"
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Dense>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <qmath.h>
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+HPIDemodulator::HPIDemodulator(double dSFreq,
+                               const QVector<int>& vecFreqs,
+                               int iNumChannels,
+                               double dWindowLength,
+                               WindowType windowType)
+: m_dSFreq(dSFreq)
+, m_dWindowLength(dWindowLength)
+, m_windowType(windowType)
+, m_iNumChannels(iNumChannels)
+, m_iWindowSamples(std::max(1, int(dWindowLength * dSFreq)))
+, m_iNumSamples(0)
+, m_vecFreqs(vecFreqs)
+, m_iRingPos(0)
+{
+    reset();
+}
+
+//=============================================================================================================
+
+void HPIDemodulator::setFrequencies(const QVector<int>& vecFreqs)
+{
+    if(vecFreqs != m_vecFreqs) {
+        m_vecFreqs = vecFreqs;
+        reset();
+    }
+}
+
+//=============================================================================================================
+
+void HPIDemodulator::reset()
+{
+    // One sine and one cosine reference per coil plus a constant to absorb channel offsets
+    int iNumRef = 2 * m_vecFreqs.size() + 1;
+
+    m_iNumSamples = 0;
+    m_iRingPos = 0;
+    m_vecPhase = VectorXd::Zero(m_vecFreqs.size());
+    m_matCorr = MatrixXd::Zero(m_iNumChannels, iNumRef);
+    m_matGram = MatrixXd::Zero(iNumRef, iNumRef);
+
+    if(m_windowType == Boxcar) {
+        m_matRingData = MatrixXd::Zero(m_iNumChannels, m_iWindowSamples);
+        m_matRingRef = MatrixXd::Zero(m_iWindowSamples, iNumRef);
+    } else {
+        m_matRingData.resize(0,0);
+        m_matRingRef.resize(0,0);
+    }
+}
+
+//=============================================================================================================
+
+void HPIDemodulator::append(const MatrixXd& matData)
+{
+    if(m_vecFreqs.isEmpty() || matData.cols() == 0) {
+        return;
+    }
+
+    if(matData.rows() != m_iNumChannels) {
+        m_iNumChannels = matData.rows();
+        reset();
+    }
+
+    int iNumSamples = matData.cols();
+
+    if(m_windowType == Exponential) {
+        updateReferences(iNumSamples);
+
+        // Sample j of the block is weighted with alpha^(n-1-j), the old sums decay by alpha^n
+        double dAlpha = std::exp(-1.0 / (m_dWindowLength * m_dSFreq));
+        VectorXd vecWeights(iNumSamples);
+        double dWeight = 1.0;
+        for(int j = iNumSamples - 1; j >= 0; --j) {
+            vecWeights(j) = dWeight;
+            dWeight *= dAlpha;
+        }
+
+        m_matCorr *= dWeight;
+        m_matGram *= dWeight;
+
+        MatrixXd matRefWeighted = vecWeights.asDiagonal() * m_matRef;
+        m_matCorr.noalias() += matData * matRefWeighted;
+        m_matGram.noalias() += m_matRef.transpose() * matRefWeighted;
+
+        m_iNumSamples += iNumSamples;
+        return;
+    }
+
+    // Boxcar: add the new samples and remove the ones that leave the window, in chunks that do not wrap
+    int iFrom = 0;
+
+    while(iFrom < iNumSamples) {
+        int iChunk = std::min(iNumSamples - iFrom, m_iWindowSamples - m_iRingPos);
+
+        updateReferences(iChunk);
+
+        if(m_iNumSamples >= m_iWindowSamples) {
+            accumulate(m_matRingData.middleCols(m_iRingPos, iChunk), m_matRingRef.middleRows(m_iRingPos, iChunk), -1.0);
+        }
+
+        m_matRingData.middleCols(m_iRingPos, iChunk) = matData.middleCols(iFrom, iChunk);
+        m_matRingRef.middleRows(m_iRingPos, iChunk) = m_matRef;
+        accumulate(matData.middleCols(iFrom, iChunk), m_matRef, 1.0);
+
+        m_iRingPos = (m_iRingPos + iChunk) % m_iWindowSamples;
+        m_iNumSamples += iChunk;
+        iFrom += iChunk;
+
+        // Recompute the sums from the ring every 64 windows so rounding errors of the updates cannot pile up
+        if(m_iRingPos == 0 && (m_iNumSamples / m_iWindowSamples) % 64 == 0) {
+            m_matCorr.noalias() = m_matRingData * m_matRingRef;
+            m_matGram.noalias() = m_matRingRef.transpose() * m_matRingRef;
+        }
+    }
+}
+
+//=============================================================================================================
+
+MatrixXd HPIDemodulator::getAmplitudes() const
+{
+    int iNumCoils = m_vecFreqs.size();
+
+    if(m_iNumSamples == 0 || iNumCoils == 0) {
+        return MatrixXd::Zero(m_iNumChannels, 2 * iNumCoils);
+    }
+
+    // Least squares fit of all references at once: A = C G^-1
+    MatrixXd matAmp = m_matGram.ldlt().solve(m_matCorr.transpose()).transpose();
+
+    return matAmp.leftCols(2 * iNumCoils);
+}
+
+//=============================================================================================================
+
+void HPIDemodulator::updateReferences(int iNumSamples)
+{
+    int iNumCoils = m_vecFreqs.size();
+
+    m_matRef.resize(iNumSamples, 2 * iNumCoils + 1);
+    m_matRef.col(2 * iNumCoils).setOnes();
+
+    for(int k = 0; k < iNumCoils; ++k) {
+        double dStep = 2.0 * M_PI * m_vecFreqs.at(k) / m_dSFreq;
+
+        for(int j = 0; j < iNumSamples; ++j) {
+            double dPhase = m_vecPhase(k) + j * dStep;
+            m_matRef(j, k) = std::sin(dPhase);
+            m_matRef(j, k + iNumCoils) = std::cos(dPhase);
+        }
+
+        m_vecPhase(k) = std::fmod(m_vecPhase(k) + iNumSamples * dStep, 2.0 * M_PI);
+    }
+}
+
+//=============================================================================================================
+
+void HPIDemodulator::accumulate(const Ref<const MatrixXd>& matData,
+                                const Ref<const MatrixXd>& matRef,
+                                double dSign)
+{
+    m_matCorr.noalias() += dSign * matData * matRef;
+    m_matGram.noalias() += dSign * matRef.transpose() * matRef;
+}
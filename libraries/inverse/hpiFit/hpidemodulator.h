@@ -0,0 +1,205 @@
+//=============================================================================================================
+/**
+ * @file     hpidemodulator.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    HPIDemodulator class declaration.
+ *
+ */
+
+#ifndef HPIDEMODULATOR_H
+#define HPIDEMODULATOR_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../inverse_global.h"
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+
+//=============================================================================================================
+// DEFINE NAMESPACE INVERSELIB
+//=============================================================================================================
+
+namespace INVERSELIB
+{
+
+//=============================================================================================================
+/**
+ * Streaming lock-in demodulation of the HPI coil signals. Keeps running correlations of every channel with a
+ * sine and cosine reference per coil frequency, together with the Gram matrix of the references. Both are
+ * updated block by block with an exponential or boxcar window, so amplitudes can be read out at any rate.
+ * The amplitudes are the least squares fit of the windowed data to all references at once, which keeps the
+ * coils separated even if their frequencies are close.
+ *
+ * @brief Streaming lock-in demodulation of the HPI coil signals.
+ */
+class INVERSESHARED_EXPORT HPIDemodulator
+{
+
+public:
+    typedef QSharedPointer<HPIDemodulator> SPtr;             /**< Shared pointer type for HPIDemodulator. */
+    typedef QSharedPointer<const HPIDemodulator> ConstSPtr;  /**< Const shared pointer type for HPIDemodulator. */
+
+    enum WindowType {
+        Exponential,    /**< Exponentially decaying weights, the window length is the time constant. */
+        Boxcar          /**< Equal weights over the last window length samples. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Constructs a HPIDemodulator.
+     *
+     * @param[in] dSFreq            The sampling frequency in Hz.
+     * @param[in] vecFreqs          The coil frequencies in Hz.
+     * @param[in] iNumChannels      The number of channels of the incoming data.
+     * @param[in] dWindowLength     The window length (Boxcar) or time constant (Exponential) in seconds.
+     * @param[in] windowType        The window type.
+     */
+    explicit HPIDemodulator(double dSFreq = 1000.0,
+                            const QVector<int>& vecFreqs = QVector<int>(),
+                            int iNumChannels = 0,
+                            double dWindowLength = 0.2,
+                            WindowType windowType = Exponential);
+
+    //=========================================================================================================
+    /**
+     * Sets the coil frequencies and resets the demodulator if they changed.
+     *
+     * @param[in] vecFreqs          The coil frequencies in Hz.
+     */
+    void setFrequencies(const QVector<int>& vecFreqs);
+
+    //=========================================================================================================
+    /**
+     * Returns the coil frequencies.
+     *
+     * @return The coil frequencies in Hz.
+     */
+    const QVector<int>& getFrequencies() const;
+
+    //=========================================================================================================
+    /**
+     * Clears all running sums and the reference phases.
+     */
+    void reset();
+
+    //=========================================================================================================
+    /**
+     * Adds a block of data. Costs O(channels x coils) per sample.
+     *
+     * @param[in] matData           The data block (channels x samples).
+     */
+    void append(const Eigen::MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+     * Returns whether at least one window length of data was appended since the last reset.
+     *
+     * @return Whether the amplitudes are valid.
+     */
+    bool isReady() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the current amplitudes. Column i holds the sine and column i + number of coils the cosine
+     * component of coil i.
+     *
+     * @return The amplitudes (channels x 2*coils).
+     */
+    Eigen::MatrixXd getAmplitudes() const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Fills m_matRef with the references of the next iNumSamples samples and advances the phases.
+     *
+     * @param[in] iNumSamples       The number of samples.
+     */
+    void updateReferences(int iNumSamples);
+
+    //=========================================================================================================
+    /**
+     * Adds (dSign = 1) or removes (dSign = -1) a data block and its references from the running sums.
+     *
+     * @param[in] matData           The data block (channels x samples).
+     * @param[in] matRef            The references (samples x 2*coils).
+     * @param[in] dSign             The sign.
+     */
+    void accumulate(const Eigen::Ref<const Eigen::MatrixXd>& matData,
+                    const Eigen::Ref<const Eigen::MatrixXd>& matRef,
+                    double dSign);
+
+    double              m_dSFreq;           /**< The sampling frequency in Hz. */
+    double              m_dWindowLength;    /**< The window length in seconds. */
+    WindowType          m_windowType;       /**< The window type. */
+    int                 m_iNumChannels;     /**< The number of channels. */
+    int                 m_iWindowSamples;   /**< The window length in samples. */
+    qint64              m_iNumSamples;      /**< The number of samples appended since the last reset. */
+    QVector<int>        m_vecFreqs;         /**< The coil frequencies in Hz. */
+
+    Eigen::VectorXd     m_vecPhase;         /**< The reference phase of each coil at the next sample. */
+    Eigen::MatrixXd     m_matRef;           /**< The references of the current block (samples x 2*coils). */
+    Eigen::MatrixXd     m_matCorr;          /**< The running data-reference correlations (channels x 2*coils). */
+    Eigen::MatrixXd     m_matGram;          /**< The running reference Gram matrix (2*coils x 2*coils). */
+
+    Eigen::MatrixXd     m_matRingData;      /**< Boxcar: the data of the last window (channels x window samples). */
+    Eigen::MatrixXd     m_matRingRef;       /**< Boxcar: the references of the last window (window samples x 2*coils). */
+    int                 m_iRingPos;         /**< Boxcar: the next write position in the ring buffers. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline const QVector<int>& HPIDemodulator::getFrequencies() const
+{
+    return m_vecFreqs;
+}
+
+//=============================================================================================================
+
+inline bool HPIDemodulator::isReady() const
+{
+    return m_iNumSamples >= m_iWindowSamples && !m_vecFreqs.isEmpty();
+}
+} //NAMESPACE
+
+#endif // HPIDEMODULATOR_H
@@ -142,6 +142,109 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         bUpdateModel = false;
     }
 
+    // Get the data from inner layer channels
+    MatrixXd matInnerdata(m_vecInnerind.size(), t_mat.cols());
+
+    for(int j = 0; j < m_vecInnerind.size(); ++j) {
+        matInnerdata.row(j) << t_mat.row(m_vecInnerind[j]);
+    }
+
+    // Calculate topo
+    MatrixXd matTopo;
+    matTopo = m_matModel * matInnerdata.transpose(); // topo: # of good inner channel x 8
+
+    // Sort the sine and cosine components of each frequency into the columns of the amplitude matrix
+    int iNumFreqs = vecFreqs.size();
+    MatrixXd matSinCos(m_vecInnerind.size(), 2 * iNumFreqs);
+
+    if(m_bDoFastFit) {
+        matSinCos = matTopo.topRows(2 * iNumFreqs).transpose();
+    } else {
+        for(int i = 0; i < iNumFreqs; ++i) {
+            matSinCos.col(i) = matTopo.row(2*i).transpose();
+            matSinCos.col(i + iNumFreqs) = matTopo.row(2*i+1).transpose();
+        }
+    }
+
+    fitCoils(matSinCos,
+             m_bDoFastFit,
+             t_matProjectors,
+             transDevHead,
+             vecFreqs,
+             vecError,
+             vecGoF,
+             fittedPointSet,
+             pFiffInfo,
+             bDoDebug,
+             sHPIResourceDir);
+}
+
+//=============================================================================================================
+
+void HPIFit::fitHPIFromAmplitudes(const MatrixXd& matAmplitudes,
+                                  const MatrixXd& t_matProjectors,
+                                  FiffCoordTrans& transDevHead,
+                                  const QVector<int>& vecFreqs,
+                                  QVector<double>& vecError,
+                                  VectorXd& vecGoF,
+                                  FiffDigPointSet& fittedPointSet,
+                                  FiffInfo::SPtr pFiffInfo,
+                                  bool bDoDebug,
+                                  const QString& sHPIResourceDir)
+{
+    //Check if amplitudes were passed
+    if(matAmplitudes.rows() != pFiffInfo->chs.size() || matAmplitudes.cols() != 2 * vecFreqs.size()) {
+        std::cout<<std::endl<< "HPIFit::fitHPIFromAmplitudes - Amplitudes do not match channels and frequencies. Returning.";
+        return;
+    }
+    //Check if projector was passed
+    if(t_matProjectors.rows() == 0 || t_matProjectors.cols() == 0 ) {
+        std::cout<<std::endl<< "HPIFit::fitHPIFromAmplitudes - No projector passed. Returning.";
+        return;
+    }
+
+    // check if bads have changed and update coils/channellist if so
+    if(!(m_lBads == pFiffInfo->bads)) {
+        m_lBads = pFiffInfo->bads;
+        updateChannels(pFiffInfo);
+        updateSensor();
+    }
+
+    // Get the amplitudes of the inner layer channels
+    MatrixXd matSinCos(m_vecInnerind.size(), matAmplitudes.cols());
+
+    for(int j = 0; j < m_vecInnerind.size(); ++j) {
+        matSinCos.row(j) = matAmplitudes.row(m_vecInnerind[j]);
+    }
+
+    // The phase of the references is arbitrary with respect to the coil signals, so always estimate it
+    fitCoils(matSinCos,
+             false,
+             t_matProjectors,
+             transDevHead,
+             vecFreqs,
+             vecError,
+             vecGoF,
+             fittedPointSet,
+             pFiffInfo,
+             bDoDebug,
+             sHPIResourceDir);
+}
+
+//=============================================================================================================
+
+void HPIFit::fitCoils(const MatrixXd& matSinCos,
+                      bool bSelectComponent,
+                      const MatrixXd& t_matProjectors,
+                      FiffCoordTrans& transDevHead,
+                      const QVector<int>& vecFreqs,
+                      QVector<double>& vecError,
+                      VectorXd& vecGoF,
+                      FiffDigPointSet& fittedPointSet,
+                      FiffInfo::SPtr pFiffInfo,
+                      bool bDoDebug,
+                      const QString& sHPIResourceDir)
+{
     // Make sure the fitted digitzers are empty
     fittedPointSet.clear();
 
@@ -205,39 +308,27 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         matProjectorsInnerind.col(i) = matProjectorsRows.col(m_vecInnerind.at(i));
     }
 
-    // Get the data from inner layer channels
-    MatrixXd matInnerdata(m_vecInnerind.size(), t_mat.cols());
-
-    for(int j = 0; j < m_vecInnerind.size(); ++j) {
-        matInnerdata.row(j) << t_mat.row(m_vecInnerind[j]);
-    }
-
-    // Calculate topo
-    MatrixXd matTopo;
+    // Get the amplitude per coil from its sine and cosine component
+    int iNumFreqs = matSinCos.cols() / 2;
     MatrixXd matAmp(m_vecInnerind.size(), iNumCoils);
-    MatrixXd matAmpC(m_vecInnerind.size(), iNumCoils);
 
-    matTopo = m_matModel * matInnerdata.transpose(); // topo: # of good inner channel x 8
-
-    if(m_bDoFastFit) {
+    if(bSelectComponent) {
         // Select sine or cosine component depending on the relative size
-        matTopo.transposeInPlace();
-        matAmp = matTopo.leftCols(iNumCoils);
-        matAmpC = matTopo.rightCols(iNumCoils);
         for(int j = 0; j < iNumCoils; ++j) {
-           float fNS = 0.0;
-           float fNC = 0.0;
-           fNS = matAmp.col(j).array().square().sum();
-           fNC = matAmpC.col(j).array().square().sum();
-           if(fNC > fNS) {
-               matAmp.col(j) = matAmpC.col(j);
+           double dNS = matSinCos.col(j).squaredNorm();
+           double dNC = matSinCos.col(j + iNumFreqs).squaredNorm();
+           if(dNC > dNS) {
+               matAmp.col(j) = matSinCos.col(j + iNumFreqs);
+           } else {
+               matAmp.col(j) = matSinCos.col(j);
            }
         }
     } else {
         // estimate the sinusoid phase
         for(int i = 0; i < iNumCoils; ++i) {
-            int from = 2*i;
-            MatrixXd m = matTopo.block(from,0,2,matTopo.cols());
+            MatrixXd m(2, matSinCos.rows());
+            m.row(0) = matSinCos.col(i).transpose();
+            m.row(1) = matSinCos.col(i + iNumFreqs).transpose();
             JacobiSVD<MatrixXd> svd(m, ComputeThinU | ComputeThinV);
             matAmp.col(i) = svd.singularValues()(0) * svd.matrixV().col(0);
         }
@@ -269,14 +360,18 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
                 matCoilPos.row(j) = (-1 * pFiffInfo->chs.at(vecChIdcs(j)).chpos.ez * 0.03 + r0).cast<double>();
             }
         }
+    } else if(m_matLastCoilPos.rows() == iNumCoils) {
+        // Warm start from the coil positions of the previous fit
+        matCoilPos = m_matLastCoilPos;
     } else {
-            matCoilPos = transDevHead.apply_inverse_trans(matHeadHPI.cast<float>()).cast<double>();
+        matCoilPos = transDevHead.apply_inverse_trans(matHeadHPI.cast<float>()).cast<double>();
     }
 
     coil.pos = matCoilPos;
 
     // Perform actual localization
     coil = dipfit(coil, m_sensors, matAmp, iNumCoils, matProjectorsInnerind);
+    m_matLastCoilPos = coil.pos;
 
     Matrix4d matTrans = computeTransformation(matHeadHPI, coil.pos);
     //Eigen::Matrix4d matTrans = computeTransformation(coil.pos, matHeadHPI);
@@ -420,6 +515,9 @@ void HPIFit::findOrder(const MatrixXd& t_mat,
         vecErrorTemp = vecError;
         vecGoFTemp = vecGoF;
     }
+    // the fits above used the same frequency for all coils, do not warm start from them
+    m_matLastCoilPos.resize(0,3);
+
     // check if still all frequencies are represented and update model
     if(std::accumulate(vecFreqs.begin(), vecFreqs.end(), .0) ==  std::accumulate(vecToOrder.begin(), vecToOrder.end(), .0)) {
         vecFreqs = vecToOrder;
@@ -441,12 +539,13 @@ CoilParam HPIFit::dipfit(struct CoilParam coil,
     //Generate QList structure which can be handled by the QConcurrent framework
     QList<HPIFitData> lCoilData;
 
+    // The sensors and the projector are shared by reference, only the coil data is copied
     for(qint32 i = 0; i < iNumCoils; ++i) {
         HPIFitData coilData;
         coilData.coilPos = coil.pos.row(i);
         coilData.sensorData = matData.col(i);
-        coilData.sensors = sensors;
-        coilData.matProjector = t_matProjectors;
+        coilData.pSensors = &sensors;
+        coilData.pMatProjector = &t_matProjectors;
 
         lCoilData.append(coilData);
     }
@@ -465,7 +564,7 @@ CoilParam HPIFit::dipfit(struct CoilParam coil,
         //Transform results to final coil information
         for(qint32 i = 0; i < lCoilData.size(); ++i) {
             coil.pos.row(i) = lCoilData.at(i).coilPos;
-            coil.mom = lCoilData.at(i).errorInfo.moment.transpose();
+            coil.mom.row(i) = lCoilData.at(i).errorInfo.moment.transpose();
             coil.dpfiterror(i) = lCoilData.at(i).errorInfo.error;
             coil.dpfitnumitr(i) = lCoilData.at(i).errorInfo.numIterations;
 
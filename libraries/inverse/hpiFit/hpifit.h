@@ -176,6 +176,33 @@ public:
                 bool bDoDebug = false,
                 const QString& sHPIResourceDir = QString("./HPIFittingDebug"));
 
+    //=========================================================================================================
+    /**
+     * Perform one single HPI fit from already demodulated coil amplitudes, e.g. from a HPIDemodulator.
+     *
+     * @param[in]    matAmplitudes      The sine (first half of columns) and cosine (second half) amplitudes of
+     *                                  each coil frequency for all channels (channels x 2*frequencies).
+     * @param[in]    t_matProjectors    The projectors to apply. Bad channels are still included.
+     * @param[out]   transDevHead       The final dev head transformation matrix
+     * @param[in]    vecFreqs           The frequencies for each coil.
+     * @param[out]   vecError           The HPI estimation Error in mm for each fitted HPI coil.
+     * @param[out]   vecGoF             The goodness of fit for each fitted HPI coil
+     * @param[out]   fittedPointSet     The final fitted positions in form of a digitizer set.
+     * @param[in]    pFiffInfo          Associated Fiff Information.
+     * @param[in]    bDoDebug           Print debug info to cmd line and write debug info to file.
+     * @param[in]    sHPIResourceDir    The path to the debug file which is to be written.
+     */
+    void fitHPIFromAmplitudes(const Eigen::MatrixXd& matAmplitudes,
+                              const Eigen::MatrixXd& t_matProjectors,
+                              FIFFLIB::FiffCoordTrans &transDevHead,
+                              const QVector<int>& vecFreqs,
+                              QVector<double>& vecError,
+                              Eigen::VectorXd& vecGoF,
+                              FIFFLIB::FiffDigPointSet& fittedPointSet,
+                              QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo,
+                              bool bDoDebug = false,
+                              const QString& sHPIResourceDir = QString("./HPIFittingDebug"));
+
     //=========================================================================================================
     /**
      * assign frequencies to correct position
@@ -219,6 +246,34 @@ public:
                                   const Eigen::VectorXd& vecGoF,
                                   const QVector<double>& vecError);
 protected:
+    //=========================================================================================================
+    /**
+     * Fits the coils to the sine and cosine amplitudes of the inner layer channels.
+     *
+     * @param[in]    matSinCos          The sine and cosine amplitudes of the inner layer channels (channels x 2*frequencies).
+     * @param[in]    bSelectComponent   Use the stronger of sine and cosine component instead of estimating the phase.
+     * @param[in]    t_matProjectors    The projectors to apply. Bad channels are still included.
+     * @param[out]   transDevHead       The final dev head transformation matrix
+     * @param[in]    vecFreqs           The frequencies for each coil.
+     * @param[out]   vecError           The HPI estimation Error in mm for each fitted HPI coil.
+     * @param[out]   vecGoF             The goodness of fit for each fitted HPI coil
+     * @param[out]   fittedPointSet     The final fitted positions in form of a digitizer set.
+     * @param[in]    pFiffInfo          Associated Fiff Information.
+     * @param[in]    bDoDebug           Print debug info to cmd line and write debug info to file.
+     * @param[in]    sHPIResourceDir    The path to the debug file which is to be written.
+     */
+    void fitCoils(const Eigen::MatrixXd& matSinCos,
+                  bool bSelectComponent,
+                  const Eigen::MatrixXd& t_matProjectors,
+                  FIFFLIB::FiffCoordTrans &transDevHead,
+                  const QVector<int>& vecFreqs,
+                  QVector<double>& vecError,
+                  Eigen::VectorXd& vecGoF,
+                  FIFFLIB::FiffDigPointSet& fittedPointSet,
+                  QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo,
+                  bool bDoDebug,
+                  const QString& sHPIResourceDir);
+
     //=========================================================================================================
     /**
      * Fits dipoles for the given coils and a given data set.
@@ -305,6 +360,7 @@ private:
     bool                m_bDoFastFit;       /**< Do fast fit */
 
     QVector<int>        m_vecFreqs;         /**< The frequencies for each coil in unknown order. */
+    Eigen::MatrixXd     m_matLastCoilPos;   /**< The coil positions of the previous fit in device space, used as warm start. */
 
 };
 
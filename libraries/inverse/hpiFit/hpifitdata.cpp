@@ -40,26 +40,26 @@
 
 #include "hpifitdata.h"
 #include "hpifit.h"
-#include <utils/mnemath.h>
-
-#include <iostream>
-#include <algorithm>
 
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
 
+#include <Eigen/Dense>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <qmath.h>
+#include <QDebug>
 
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace INVERSELIB;
+using namespace Eigen;
 
 //=============================================================================================================
 // DEFINE GLOBAL METHODS
@@ -70,393 +70,192 @@ using namespace INVERSELIB;
 //=============================================================================================================
 
 HPIFitData::HPIFitData()
+: coilPos(RowVector3d::Zero())
+, pSensors(Q_NULLPTR)
+, pMatProjector(Q_NULLPTR)
 {
+    errorInfo.error = 1.0;
+    errorInfo.moment = Vector3d::Zero();
+    errorInfo.numIterations = 0;
 }
 
 //=============================================================================================================
 
 void HPIFitData::doDipfitConcurrent()
 {
-    // Initialize variables
-    Eigen::RowVectorXd vecCurrentCoil = this->coilPos;
-    Eigen::VectorXd vecCurrentData = this->sensorData;
-    SensorSet currentSensors = this->sensors;
-
-    int iDisplay = 0;
-    int iMaxiter = 200;
-    int iSimplexNumitr = 0;
-
-    this->coilPos = fminsearch(vecCurrentCoil,
-                               iMaxiter,
-                               2 * iMaxiter * vecCurrentCoil.cols(),
-                               iDisplay,
-                               vecCurrentData,
-                               this->matProjector,
-                               currentSensors,
-                               iSimplexNumitr);
-
-    this->errorInfo = dipfitError(vecCurrentCoil,
-                                  vecCurrentData,
-                                  currentSensors,
-                                  this->matProjector);
-
-    this->errorInfo.numIterations = iSimplexNumitr;
+    if(!pSensors || !pMatProjector || sensorData.size() != pSensors->ncoils) {
+        qWarning() << "[HPIFitData::doDipfitConcurrent] Sensors, projector or data missing. Returning.";
+        return;
+    }
+
+    // Allocate all buffers once, the solver itself does not allocate
+    int iNumSensors = pSensors->ncoils;
+    m_matLf.resize(iNumSensors, 3);
+    for(int k = 0; k < 3; ++k) {
+        m_matDLf[k].resize(iNumSensors, 3);
+    }
+    m_vecModel.resize(iNumSensors);
+    m_vecResidual.resize(iNumSensors);
+    m_matJacobian.resize(iNumSensors, 3);
+
+    int iMaxIter = 100;
+    int iNumIter = 0;
+
+    Vector3d vecPos = levenbergMarquardt(coilPos.transpose(),
+                                         iMaxIter,
+                                         iNumIter);
+
+    this->coilPos = vecPos.transpose();
+    this->errorInfo.error = computeResidual(vecPos,
+                                            false,
+                                            this->errorInfo.moment);
+    this->errorInfo.numIterations = iNumIter;
 }
 
 //=============================================================================================================
 
-Eigen::MatrixXd HPIFitData::magnetic_dipole(Eigen::MatrixXd matPos,
-                                            Eigen::MatrixXd matPnt,
-                                            Eigen::MatrixXd matOri)
+void HPIFitData::computeLeadfield(const Vector3d& vecPos,
+                                  bool bDerivatives)
 {
-    double u0 = 1e-7;
-    int iNchan;
-    Eigen::MatrixXd r, r2, r5, x, y, z, mx, my, mz, Tx, Ty, Tz, lf;
-
-    iNchan = matPnt.rows();
+    const SensorSet& sensors = *pSensors;
+    const double dScale = 1e-7 / (4.0 * M_PI);
+    int iNp = sensors.np;
 
-    // Shift the magnetometers so that the dipole is in the origin
-    matPnt.array().col(0) -=matPos(0);
-    matPnt.array().col(1) -=matPos(1);
-    matPnt.array().col(2) -=matPos(2);
+    Vector3d vecDiff, vecOri, vecNum, vecLf;
+    Matrix3d matDNum, matDLf;
 
-    r = matPnt.array().square().rowwise().sum().sqrt();
+    for(int i = 0; i < sensors.ncoils; ++i) {
+        vecLf.setZero();
+        matDLf.setZero();
 
-    r2 = r5 = x = y = z = mx = my = mz = Tx = Ty = Tz = lf = Eigen::MatrixXd::Zero(iNchan,3);
+        // Sum up the weighted integration points of this coil
+        for(int p = i * iNp; p < (i + 1) * iNp; ++p) {
+            vecDiff << sensors.rmag(p,0) - vecPos(0), sensors.rmag(p,1) - vecPos(1), sensors.rmag(p,2) - vecPos(2);
+            vecOri << sensors.cosmag(p,0), sensors.cosmag(p,1), sensors.cosmag(p,2);
 
-    for(int i = 0;i < iNchan;i++) {
-        r2.row(i).array().fill(pow(r(i),2));
-        r5.row(i).array().fill(pow(r(i),5));
-    }
+            double dR2 = vecDiff.squaredNorm();
+            double dWR5 = sensors.w(p) * dScale / (dR2 * dR2 * std::sqrt(dR2));
+            double dDot = vecDiff.dot(vecOri);
 
-    for(int i = 0;i < iNchan;i++) {
-        x.row(i).array().fill(matPnt(i,0));
-        y.row(i).array().fill(matPnt(i,1));
-        z.row(i).array().fill(matPnt(i,2));
-    }
+            // B = (3 (d.o) d - |d|^2 o) / |d|^5 with d = rmag - pos
+            vecNum = 3.0 * dDot * vecDiff - dR2 * vecOri;
+            vecLf += dWR5 * vecNum;
 
-    mx.col(0).array().fill(1);
-    my.col(1).array().fill(1);
-    mz.col(2).array().fill(1);
-
-    Tx = 3 * x.cwiseProduct(matPnt) - mx.cwiseProduct(r2);
-    Ty = 3 * y.cwiseProduct(matPnt) - my.cwiseProduct(r2);
-    Tz = 3 * z.cwiseProduct(matPnt) - mz.cwiseProduct(r2);
+            if(bDerivatives) {
+                // dB_j/dpos_k, column k holds the derivative with respect to pos_k
+                matDNum.noalias() = 2.0 * vecOri * vecDiff.transpose() - 3.0 * vecDiff * vecOri.transpose();
+                matDNum.diagonal().array() -= 3.0 * dDot;
+                matDNum.noalias() += (5.0 / dR2) * vecNum * vecDiff.transpose();
+                matDLf += dWR5 * matDNum;
+            }
+        }
 
-    for(int i = 0;i < iNchan;i++) {
-        lf(i,0) = Tx.row(i).dot(matOri.row(i));
-        lf(i,1) = Ty.row(i).dot(matOri.row(i));
-        lf(i,2) = Tz.row(i).dot(matOri.row(i));
-    }
+        m_matLf.row(i) = vecLf.transpose();
 
-    for(int i = 0;i < iNchan;i++) {
-        for(int j = 0;j < 3;j++) {
-            lf(i,j) = u0 * lf(i,j)/(4 * M_PI * r5(i,j));
+        if(bDerivatives) {
+            for(int k = 0; k < 3; ++k) {
+                m_matDLf[k].row(i) = matDLf.col(k).transpose();
+            }
         }
     }
-
-    return lf;
 }
 
 //=============================================================================================================
 
-Eigen::MatrixXd HPIFitData::compute_leadfield(const Eigen::MatrixXd& matPos, const SensorSet& sensors)
+double HPIFitData::computeResidual(const Vector3d& vecPos,
+                                   bool bJacobian,
+                                   Vector3d& vecMoment)
 {
-
-    Eigen::MatrixXd matPnt, matOri, matLf;
-    matPnt = sensors.rmag; // position of each integrationpoint
-    matOri = sensors.cosmag; // mOrientation of each coil
-
-    matLf = magnetic_dipole(matPos, matPnt, matOri);
-
-    return matLf;
-}
-
-//=============================================================================================================
-
-DipFitError HPIFitData::dipfitError(const Eigen::MatrixXd& matPos,
-                                    const Eigen::MatrixXd& matData,
-                                    const struct SensorSet& sensors,
-                                    const Eigen::MatrixXd& matProjectors)
-{
-    // Variable Declaration
-    struct DipFitError e;
-    Eigen::MatrixXd matLfSensor, matDif;
-    Eigen::MatrixXd matLf(matData.size(),3);
-    int iNp = sensors.np;
-
-    // calculate lf for all sensorpoints
-    matLfSensor = compute_leadfield(matPos, sensors);
-
-    // apply averaging per coil
-    for(int i = 0; i < sensors.ncoils; i++){
-        matLf.row(i) = sensors.w.segment(i*iNp,iNp) * matLfSensor.block(i*iNp,0,iNp,matLfSensor.cols());
+    computeLeadfield(vecPos, bJacobian);
+
+    // Closed-form least squares moment: m = (L'L)^-1 L'd
+    Matrix3d matGram = m_matLf.transpose() * m_matLf;
+    Matrix3d matGramInv = matGram.inverse();
+    Vector3d vecLtd = m_matLf.transpose() * sensorData;
+    vecMoment = matGramInv * vecLtd;
+
+    // r = d - P L m
+    m_vecModel.noalias() = m_matLf * vecMoment;
+    m_vecResidual = sensorData;
+    m_vecResidual.noalias() -= (*pMatProjector) * m_vecModel;
+
+    if(bJacobian) {
+        Matrix3d matDGram;
+        Vector3d vecDMoment;
+
+        for(int k = 0; k < 3; ++k) {
+            const MatrixX3d& matDLf = m_matDLf[k];
+
+            // dm = (L'L)^-1 (dL'd - (dL'L + L'dL) m), dr = -P (dL m + L dm)
+            matDGram.noalias() = matDLf.transpose() * m_matLf;
+            matDGram += matDGram.transpose().eval();
+            vecDMoment.noalias() = matDLf.transpose() * sensorData;
+            vecDMoment.noalias() -= matDGram * vecMoment;
+            vecDMoment = matGramInv * vecDMoment;
+
+            m_vecModel.noalias() = matDLf * vecMoment;
+            m_vecModel.noalias() += m_matLf * vecDMoment;
+            m_matJacobian.col(k).noalias() = -(*pMatProjector) * m_vecModel;
+        }
     }
-    //matLf = sensors.tra * matLf;
-
-    // Compute lead field for a magnetic dipole in infinite vacuum
-    e.moment = UTILSLIB::MNEMath::pinv(matLf) * matData;
 
-    //matDif = matData - matLf * e.moment;
-    matDif = matData - matProjectors * matLf * e.moment;
-
-    e.error = matDif.array().square().sum()/matData.array().square().sum();
-
-    e.numIterations = 0;
-
-    return e;
+    return m_vecResidual.squaredNorm() / sensorData.squaredNorm();
 }
 
 //=============================================================================================================
 
-bool HPIFitData::compare(HPISortStruct a, HPISortStruct b)
+Vector3d HPIFitData::levenbergMarquardt(const Vector3d& vecPos,
+                                        int iMaxIter,
+                                        int& iNumIter)
 {
-    return (a.base_arr < b.base_arr);
-}
+    const double dTolStep = 1e-9;
+    const double dTolCost = 1e-12;
 
-//=============================================================================================================
+    Vector3d vecX = vecPos;
+    Vector3d vecTrial, vecStep, vecMoment;
+    Matrix3d matJtJ, matA;
+    Vector3d vecJtr;
 
-Eigen::MatrixXd HPIFitData::fminsearch(const Eigen::MatrixXd& matPos,
-                                       int iMaxiter,
-                                       int iMaxfun,
-                                       int iDisplay,
-                                       const Eigen::MatrixXd& matData,
-                                       const Eigen::MatrixXd& matProjectors,
-                                       const struct SensorSet& sensors,
-                                       int &iSimplexNumitr)
-{
-    double tolx, tolf, rho, chi, psi, sigma, func_evals, usual_delta, zero_term_delta, temp1, temp2;
-    std::string header, how;
-    int n, itercount, prnt;
-    Eigen::MatrixXd onesn, two2np1, one2n, v, y, v1, tempX1, tempX2, xbar, xr, x, xe, xc, xcc, xin,posCopy;
-    std::vector <double> fv, fv1;
-    std::vector <int> idx;
-
-    DipFitError tempdip, fxr, fxe, fxc, fxcc;
-
-    tolx = tolf = 1e-5;
-    // Seok
-    // tolx = tolf = 1e-9;
-
-    switch(iDisplay) {
-        case 0:
-            prnt = 0;
-            break;
-        default:
-            prnt = 1;
-    }
-
-    header = " Iteration   Func-count     min f(x) Procedure";
-
-    posCopy =matPos;
-
-    n = posCopy.cols();
+    double dCost = computeResidual(vecX, true, vecMoment);
+    matJtJ.noalias() = m_matJacobian.transpose() * m_matJacobian;
+    vecJtr.noalias() = m_matJacobian.transpose() * m_vecResidual;
 
-    // Initialize parameters
-    rho = 1; chi = 2; psi = 0.5; sigma = 0.5;
-    onesn = Eigen::MatrixXd::Ones(1,n);
-    two2np1 = one2n = Eigen::MatrixXd::Zero(1,n);
+    double dLambda = 1e-3;
+    iNumIter = 0;
 
-    for(int i = 0;i < n;i++) {
-        two2np1(i) = 1 + i;
-        one2n(i) = i;
-    }
-
-    v = v1 = Eigen::MatrixXd::Zero(n, n+1);
-    fv.resize(n+1);
-    idx.resize(n+1);
-    fv1.resize(n+1);
+    while(iNumIter < iMaxIter) {
+        ++iNumIter;
 
-    for(int i = 0;i < n; i++) {
-        v(i,0) = posCopy(i);
-    }
+        // Marquardt damping of the Gauss-Newton normal equations
+        matA = matJtJ;
+        matA.diagonal() *= 1.0 + dLambda;
+        vecStep = -matA.ldlt().solve(vecJtr);
+        vecTrial = vecX + vecStep;
 
-    tempdip = dipfitError(posCopy, matData, sensors, matProjectors);
-    fv[0] = tempdip.error;
+        double dTrialCost = computeResidual(vecTrial, false, vecMoment);
 
-    func_evals = 1;
-    itercount = 0;
-    how = "";
+        if(dTrialCost < dCost) {
+            bool bConverged = vecStep.norm() < dTolStep || (dCost - dTrialCost) < dTolCost * dCost;
 
-    // Continue setting up the initial simplex.
-    // Following improvement suggested by L.Pfeffer at Stanford
-    usual_delta = 0.05;             // 5 percent deltas for non-zero terms
-    zero_term_delta = 0.00025;      // Even smaller delta for zero elements of x
-    xin = posCopy.transpose();
+            vecX = vecTrial;
+            dCost = dTrialCost;
+            dLambda = std::max(dLambda * 0.1, 1e-12);
 
-    for(int j = 0;j < n;j++) {
-        y = xin;
+            if(bConverged) {
+                break;
+            }
 
-        if(y(j) != 0) {
-            y(j) = (1 + usual_delta) * y(j);
+            computeResidual(vecX, true, vecMoment);
+            matJtJ.noalias() = m_matJacobian.transpose() * m_matJacobian;
+            vecJtr.noalias() = m_matJacobian.transpose() * m_vecResidual;
         } else {
-            y(j) = zero_term_delta;
-        }
+            dLambda *= 10.0;
 
-        v.col(j+1).array() = y;
-        posCopy = y.transpose();
-        tempdip = dipfitError(posCopy, matData, sensors, matProjectors);
-        fv[j+1] = tempdip.error;
-    }
-
-    // Sort elements of fv
-    std::vector<HPISortStruct> vecSortStruct;
-
-    for (int i = 0; i < fv.size(); i++) {
-        HPISortStruct structTemp;
-        structTemp.base_arr = fv[i];
-        structTemp.idx = i;
-        vecSortStruct.push_back(structTemp);
-    }
-
-    std::sort(vecSortStruct.begin(), vecSortStruct.end(), compare);
-
-    for (int i = 0; i < vecSortStruct.size(); i++) {
-        idx[i] = vecSortStruct[i].idx;
-    }
-
-    for (int i = 0;i < n+1;i++) {
-        v1.col(i) = v.col(idx[i]);
-        fv1[i] = fv[idx[i]];
-    }
-
-    v = v1;fv = fv1;
-
-    how = "initial simplex";
-    itercount = itercount + 1;
-    func_evals = n + 1;
-
-    tempX1 = Eigen::MatrixXd::Zero(1,n);
-
-    while ((func_evals < iMaxfun) && (itercount < iMaxiter)) {
-
-        for (int i = 0;i < n;i++) {
-            tempX1(i) = std::fabs(fv[0] - fv[i+1]);
-        }
-
-        temp1 = tempX1.maxCoeff();
-
-        tempX2 = Eigen::MatrixXd::Zero(n,n);
-
-        for(int i = 0;i < n;i++) {
-            tempX2.col(i) = v.col(i+1) -  v.col(0);
-        }
-
-        tempX2 = tempX2.array().abs();
-
-        temp2 = tempX2.maxCoeff();
-
-        if((temp1 <= tolf) && (temp2 <= tolx)) {
-            break;
-        }
-
-        xbar = v.block(0,0,n,n).rowwise().sum();
-        xbar /= n;
-
-        xr = (1+rho) * xbar - rho * v.block(0,n,v.rows(),1);
-
-        x = xr.transpose();
-        //std::cout << "Iteration Count: " << itercount << ":" << x << std::endl;
-
-        fxr = dipfitError(x, matData, sensors, matProjectors);
-
-        func_evals = func_evals+1;
-
-        if (fxr.error < fv[0]) {
-            // Calculate the expansion point
-            xe = (1 + rho * chi) * xbar - rho * chi * v.col(v.cols()-1);
-            x = xe.transpose();
-            fxe = dipfitError(x, matData, sensors, matProjectors);
-            func_evals = func_evals+1;
-
-            if(fxe.error < fxr.error) {
-                v.col(v.cols()-1) = xe;
-                fv[n] = fxe.error;
-                how = "expand";
-            } else {
-                v.col(v.cols()-1) = xr;
-                fv[n] = fxr.error;
-                how = "reflect";
+            if(dLambda > 1e10 || vecStep.norm() < dTolStep) {
+                break;
             }
         }
-        else {
-            if(fxr.error < fv[n-1]) {
-                v.col(v.cols()-1) = xr;
-                fv[n] = fxr.error;
-                how = "reflect";
-            } else { // fxr.error >= fv[:,n-1]
-                // Perform contraction
-                if(fxr.error < fv[n]) {
-                    // Perform an outside contraction
-                    xc = (1 + psi * rho) * xbar - psi * rho * v.col(v.cols()-1);
-                    x = xc.transpose();
-                    fxc = dipfitError(x, matData, sensors, matProjectors);
-                    func_evals = func_evals + 1;
-
-                    if(fxc.error <= fxr.error) {
-                        v.col(v.cols()-1) = xc;
-                        fv[n] = fxc.error;
-                        how = "contract outside";
-                    } else {
-                        // perform a shrink
-                        how = "shrink";
-                    }
-                } else {
-                    xcc = (1 - psi) * xbar + psi * v.col(v.cols()-1);
-                    x = xcc.transpose();
-                    fxcc = dipfitError(x, matData, sensors, matProjectors);
-                    func_evals = func_evals+1;
-                    if(fxcc.error < fv[n]) {
-                        v.col(v.cols()-1) = xcc;
-                        fv[n] = fxcc.error;
-                        how = "contract inside";
-                    } else {
-                        // perform a shrink
-                        how = "shrink";
-                    }
-                }
-
-                if(how.compare("shrink") == 0) {
-                    for(int j = 1;j < n+1;j++) {
-                        v.col(j).array() = v.col(0).array() + sigma * (v.col(j).array() - v.col(0).array());
-                        x = v.col(j).array().transpose();
-                        tempdip = dipfitError(x,matData, sensors, matProjectors);
-                        fv[j] = tempdip.error;
-                    }
-                }
-            }
-        }
-
-        // Sort elements of fv
-        vecSortStruct.clear();
-
-        for (int i = 0; i < fv.size(); i++) {
-            HPISortStruct structTemp;
-            structTemp.base_arr = fv[i];
-            structTemp.idx = i;
-            vecSortStruct.push_back(structTemp);
-        }
-
-        std::sort(vecSortStruct.begin(), vecSortStruct.end(), compare);
-        for (int i = 0; i < vecSortStruct.size(); i++) {
-            idx[i] = vecSortStruct[i].idx;
-        }
-
-        for (int i = 0;i < n+1;i++) {
-            v1.col(i) = v.col(idx[i]);
-            fv1[i] = fv[idx[i]];
-        }
-
-        v = v1;
-        fv = fv1;
-        itercount = itercount + 1;
     }
 
-    x = v.col(0).transpose();
-
-    // Seok
-    iSimplexNumitr = itercount;
-
-    return x;
+    return vecX;
 }
-
@@ -81,28 +81,18 @@ namespace INVERSELIB
  */
 struct DipFitError {
     double error;
-    Eigen::MatrixXd moment;
+    Eigen::Vector3d moment;
     int numIterations;
 };
 
-
-
-//=========================================================================================================
-/**
- * The strucut specifing the sorting parameters.
- */
-struct HPISortStruct {
-    double base_arr;
-    int idx;
-};
-
 //=============================================================================================================
 // FORWARD DECLARATIONS
 //=============================================================================================================
 
 //=============================================================================================================
 /**
- * HPI Fit algorithm data structure.
+ * HPI Fit algorithm data structure. Fits the position of one coil with a Levenberg-Marquardt solver on the
+ * three position parameters. The dipole moment is eliminated by a closed-form 3x3 least squares solve.
  *
  * @brief HPI Fit algorithm data structure.
  */
@@ -121,70 +111,62 @@ public:
 
     //=========================================================================================================
     /**
-     * dipfit function is adapted from Fieldtrip Software.
+     * Fits coilPos to sensorData, starting from the current value of coilPos.
      */
     void doDipfitConcurrent();
 
-    Eigen::MatrixXd         coilPos;
-    Eigen::RowVectorXd      sensorData;
-    DipFitError             errorInfo;
-    struct SensorSet        sensors;
-    Eigen::MatrixXd         matProjector;
+    Eigen::RowVector3d          coilPos;        /**< The coil position. Input: start value, output: fitted position. */
+    Eigen::VectorXd             sensorData;     /**< The measured amplitudes of this coil, one per sensor. */
+    DipFitError                 errorInfo;      /**< The relative residual, moment and number of iterations of the fit. */
+    const SensorSet*            pSensors;       /**< The sensors, shared by all coils. Must outlive the fit. */
+    const Eigen::MatrixXd*      pMatProjector;  /**< The projector, shared by all coils. Must outlive the fit. */
 
 protected:
     //=========================================================================================================
     /**
-     * magnetic_dipole leadfield for a magnetic dipole in an infinite medium.
-     * The function has been compared with matlab magnetic_dipole and it gives same output.
-     */
-    Eigen::MatrixXd magnetic_dipole(Eigen::MatrixXd matPos,
-                                    Eigen::MatrixXd matPnt,
-                                    Eigen::MatrixXd matOri);
-
-    //=========================================================================================================
-    /**
-     * compute_leadfield computes a forward solution for a dipole in a a volume
-     * conductor model. The forward solution is expressed as the leadfield
-     * matrix (Nchan*3), where each column corresponds with the potential or field
-     * distributions on all sensors for one of the x,y,z-orientations of the dipole.
-     * The function has been compared with matlab ft_compute_leadfield and it gives
-     * same output.
-     */
-    Eigen::MatrixXd compute_leadfield(const Eigen::MatrixXd& matPos,
-                                      const struct SensorSet& sensors);
-
-    //=========================================================================================================
-    /**
-     * dipfitError computes the error between measured and model data
-     * and can be used for non-linear fitting of dipole position.
-     * The function has been compared with matlab dipfit_error and it gives
-     * same output
+     * Computes the coil averaged lead field of a magnetic dipole in an infinite medium into m_matLf and,
+     * if requested, its analytic derivatives with respect to the dipole position into m_matDLf.
+     *
+     * @param[in] vecPos         The dipole position.
+     * @param[in] bDerivatives   Whether to compute the derivatives.
      */
-    DipFitError dipfitError(const Eigen::MatrixXd& matPos,
-                            const Eigen::MatrixXd& matData,
-                            const struct SensorSet& sensors,
-                            const Eigen::MatrixXd& matProjectors);
+    void computeLeadfield(const Eigen::Vector3d& vecPos,
+                          bool bDerivatives);
 
     //=========================================================================================================
     /**
-     * Compare function for sorting
+     * Computes the residual between measured and projected model data into m_vecResidual and, if requested,
+     * its Jacobian into m_matJacobian. The moment is the least squares solution for the unprojected lead field.
+     *
+     * @param[in] vecPos         The dipole position.
+     * @param[in] bJacobian      Whether to compute the Jacobian.
+     * @param[out] vecMoment     The estimated dipole moment.
+     *
+     * @return The relative residual energy.
      */
-    static bool compare(HPISortStruct a, HPISortStruct b);
+    double computeResidual(const Eigen::Vector3d& vecPos,
+                           bool bJacobian,
+                           Eigen::Vector3d& vecMoment);
 
     //=========================================================================================================
     /**
-     * fminsearch Multidimensional unconstrained nonlinear minimization (Nelder-Mead).
-     * X = fminsearch(X0, iMaxiter, iMaxfun, iDisplay, matData, sensors) starts at X0 and
-     * attempts to find a local minimizer
+     * Levenberg-Marquardt minimization of the relative residual energy over the dipole position.
+     *
+     * @param[in] vecPos         The start position.
+     * @param[in] iMaxIter       The maximum number of iterations.
+     * @param[out] iNumIter      The number of iterations done.
+     *
+     * @return The fitted position.
      */
-    Eigen::MatrixXd fminsearch(const Eigen::MatrixXd& matPos,
-                               int iMaxiter,
-                               int iMaxfun,
-                               int iDisplay,
-                               const Eigen::MatrixXd& matData,
-                               const Eigen::MatrixXd& matProjectors,
-                               const struct SensorSet& sensors,
-                               int &iSimplexNumitr);
+    Eigen::Vector3d levenbergMarquardt(const Eigen::Vector3d& vecPos,
+                                       int iMaxIter,
+                                       int& iNumIter);
+
+    Eigen::MatrixX3d    m_matLf;            /**< The coil averaged lead field (sensors x 3). */
+    Eigen::MatrixX3d    m_matDLf[3];        /**< The derivatives of m_matLf with respect to x, y and z. */
+    Eigen::VectorXd     m_vecModel;         /**< Scratch buffer for unprojected model data (sensors). */
+    Eigen::VectorXd     m_vecResidual;      /**< The projected residual (sensors). */
+    Eigen::MatrixX3d    m_matJacobian;      /**< The derivatives of m_vecResidual with respect to x, y and z. */
 };
 
 //=============================================================================================================
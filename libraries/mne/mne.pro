@@ -80,6 +80,7 @@ SOURCES += \
     mne_inverse_operator.cpp \
     mne_epoch_data.cpp \
     mne_epoch_data_list.cpp \
+    mne_artifact_rejector.cpp \
     mne_cluster_info.cpp \
     mne_surface.cpp \
     mne_corsourceestimate.cpp\
@@ -130,6 +131,7 @@ HEADERS += \
     mne_inverse_operator.h \
     mne_epoch_data.h \
     mne_epoch_data_list.h \
+    mne_artifact_rejector.h \
     mne_cluster_info.h \
     mne_surface.h \
     mne_corsourceestimate.h\
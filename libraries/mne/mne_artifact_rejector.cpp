@@ -0,0 +1,191 @@
+//=============================================================================================================
+/**
+ * @file     mne_artifact_rejector.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    MNEArtifactRejector class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_artifact_rejector.h"
+
+#include <limits>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace MNELIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+MNEArtifactRejector::MNEArtifactRejector()
+: m_iBlockSize(128)
+{
+}
+
+//=============================================================================================================
+
+MNEArtifactRejector::MNEArtifactRejector(const FiffInfo& info,
+                                         const QMap<QString,double>& mapReject,
+                                         const QStringList& lExcludeChs)
+: m_iBlockSize(128)
+{
+    setup(info, mapReject, lExcludeChs);
+}
+
+//=============================================================================================================
+
+void MNEArtifactRejector::setup(const FiffInfo& info,
+                                const QMap<QString,double>& mapReject,
+                                const QStringList& lExcludeChs)
+{
+    m_mapChannels.clear();
+    m_lChNames.clear();
+    m_vecThresholds = ArrayXd::Constant(info.chs.size(), std::numeric_limits<double>::infinity());
+
+    QString sType;
+
+    for(int i = 0; i < info.chs.size(); ++i) {
+        const FiffChInfo& chInfo = info.chs.at(i);
+        m_lChNames << chInfo.ch_name;
+
+        switch (chInfo.kind) {
+        case FIFFV_MEG_CH:
+            if(chInfo.unit == FIFF_UNIT_T) {
+                sType = "mag";
+            } else if(chInfo.unit == FIFF_UNIT_T_M) {
+                sType = "grad";
+            } else {
+                continue;
+            }
+            break;
+
+        case FIFFV_EEG_CH:
+            sType = "eeg";
+            break;
+
+        case FIFFV_EOG_CH:
+            sType = "eog";
+            break;
+
+        default:
+            continue;
+        }
+
+        if(!mapReject.contains(sType)
+           || lExcludeChs.contains(chInfo.ch_name)
+           || info.bads.contains(chInfo.ch_name)
+           || chInfo.chpos.coil_type == FIFFV_COIL_BABY_REF_MAG
+           || chInfo.chpos.coil_type == FIFFV_COIL_BABY_REF_MAG2) {
+            continue;
+        }
+
+        m_vecThresholds(i) = mapReject.value(sType);
+        m_mapChannels[sType].append(i);
+    }
+}
+
+//=============================================================================================================
+
+bool MNEArtifactRejector::isEmpty() const
+{
+    return m_mapChannels.isEmpty();
+}
+
+//=============================================================================================================
+
+QVector<int> MNEArtifactRejector::channels(const QString& sType) const
+{
+    return m_mapChannels.value(sType);
+}
+
+//=============================================================================================================
+
+bool MNEArtifactRejector::check(const Ref<const MatrixXd>& data,
+                                int* pRejectChannel) const
+{
+    if(pRejectChannel) {
+        *pRejectChannel = -1;
+    }
+
+    if(isEmpty() || data.cols() == 0) {
+        return false;
+    }
+
+    if(data.rows() != m_vecThresholds.rows()) {
+        qWarning() << "[MNEArtifactRejector::check] Number of rows (" << data.rows() << ") does not match the number of channels (" << m_vecThresholds.rows() << "). Do not reject. Returning.";
+        return false;
+    }
+
+    ArrayXd vecMin = data.col(0).array();
+    ArrayXd vecMax = vecMin;
+    Index iRejectChannel;
+
+    for(int iStart = 0; iStart < data.cols(); iStart += m_iBlockSize) {
+        const int iCols = std::min(m_iBlockSize, int(data.cols()) - iStart);
+
+        // Running min/max of all rows, one vectorized sweep over the columns of the block
+        vecMin = vecMin.min(data.middleCols(iStart, iCols).rowwise().minCoeff().array());
+        vecMax = vecMax.max(data.middleCols(iStart, iCols).rowwise().maxCoeff().array());
+
+        // Peak to peak. Rows which are not scanned have an infinite threshold.
+        if(((vecMax - vecMin) > m_vecThresholds).any()) {
+            ((vecMax - vecMin) - m_vecThresholds).maxCoeff(&iRejectChannel);
+
+            if(pRejectChannel) {
+                *pRejectChannel = iRejectChannel;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//=============================================================================================================
+
+QString MNEArtifactRejector::channelName(int iChannel) const
+{
+    return m_lChNames.value(iChannel);
+}
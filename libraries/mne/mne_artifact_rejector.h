@@ -0,0 +1,162 @@
+//=============================================================================================================
+/**
+ * @file     mne_artifact_rejector.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    MNEArtifactRejector class declaration.
+ *
+ */
+
+#ifndef MNE_ARTIFACT_REJECTOR_H
+#define MNE_ARTIFACT_REJECTOR_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_global.h"
+
+#include <fiff/fiff_info.h>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE MNELIB
+//=============================================================================================================
+
+namespace MNELIB
+{
+
+//=============================================================================================================
+/**
+ * Peak-to-peak artifact rejection. The channels to scan and their thresholds are resolved once from the
+ * measurement info, the rejection map ("grad", "mag", "eeg", "eog") and the excluded channels. Checking a data
+ * matrix then is a single pass over blocks of columns which computes the running min/max of all rows at once and
+ * stops at the first block in which a channel exceeds its threshold.
+ *
+ * @brief Prebuilt peak-to-peak artifact rejector.
+ */
+class MNESHARED_EXPORT MNEArtifactRejector
+{
+
+public:
+    typedef QSharedPointer<MNEArtifactRejector> SPtr;              /**< Shared pointer type for MNEArtifactRejector. */
+    typedef QSharedPointer<const MNEArtifactRejector> ConstSPtr;   /**< Const shared pointer type for MNEArtifactRejector. */
+
+    //=========================================================================================================
+    /**
+     * Default constructor. Does not reject anything until setup is called.
+     */
+    MNEArtifactRejector();
+
+    //=========================================================================================================
+    /**
+     * Constructs a MNEArtifactRejector.
+     *
+     * @param[in] info           The measurement info. Its channels correspond to the rows of the checked data.
+     * @param[in] mapReject      The peak-to-peak thresholds per channel type. Supported keys are grad, mag, eeg and eog.
+     * @param[in] lExcludeChs    List of channel names to exclude.
+     */
+    MNEArtifactRejector(const FIFFLIB::FiffInfo& info,
+                        const QMap<QString,double>& mapReject,
+                        const QStringList& lExcludeChs = QStringList());
+
+    //=========================================================================================================
+    /**
+     * Resolves the channels to scan and their thresholds.
+     *
+     * @param[in] info           The measurement info. Its channels correspond to the rows of the checked data.
+     * @param[in] mapReject      The peak-to-peak thresholds per channel type. Supported keys are grad, mag, eeg and eog.
+     * @param[in] lExcludeChs    List of channel names to exclude.
+     */
+    void setup(const FIFFLIB::FiffInfo& info,
+               const QMap<QString,double>& mapReject,
+               const QStringList& lExcludeChs = QStringList());
+
+    //=========================================================================================================
+    /**
+     * Returns whether no channels are scanned.
+     *
+     * @return true if no channels are scanned, false otherwise.
+     */
+    bool isEmpty() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the rows which are scanned for the given channel type.
+     *
+     * @param[in] sType      The channel type as used in the rejection map, e.g., eog.
+     *
+     * @return The scanned rows.
+     */
+    QVector<int> channels(const QString& sType) const;
+
+    //=========================================================================================================
+    /**
+     * Checks the data for peak-to-peak artifacts.
+     *
+     * @param[in] data               The data matrix <n_channels x n_samples>.
+     * @param[out] pRejectChannel    The row of the channel which caused the rejection, -1 if the data is not rejected. Optional.
+     *
+     * @return Whether a threshold artifact was detected.
+     */
+    bool check(const Eigen::Ref<const Eigen::MatrixXd>& data,
+               int* pRejectChannel = Q_NULLPTR) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the name of a channel.
+     *
+     * @param[in] iChannel   The row of the channel.
+     *
+     * @return The channel name.
+     */
+    QString channelName(int iChannel) const;
+
+private:
+    QMap<QString, QVector<int> >    m_mapChannels;          /**< The scanned rows per channel type. */
+    QStringList                     m_lChNames;             /**< The names of all channels. */
+    Eigen::ArrayXd                  m_vecThresholds;        /**< The threshold per row, infinity for rows which are not scanned. */
+    int                             m_iBlockSize;           /**< The number of columns processed before checking the thresholds. */
+};
+} // NAMESPACE
+
+#endif // MNE_ARTIFACT_REJECTOR_H
@@ -43,6 +43,9 @@
 
 #include <utils/mnemath.h>
 
+#include <algorithm>
+#include <numeric>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
@@ -121,52 +124,74 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
         }
     }
 
+    // Determine the segment of each event. All epochs need to have the same length.
     fiff_int_t event_samp, from, to;
-    fiff_int_t dropCount = 0;
-    MatrixXd timesDummy;
-    MatrixXd times;
-
-    QScopedPointer<MNEEpochData> epoch(Q_NULLPTR);
+    fiff_int_t iNumSamples = -1;
+    QVector<fiff_int_t> vecFrom;
 
     for (p = 0; p < count; ++p) {
-        // Read a data segment
         event_samp = events(selected(p),0);
         from = event_samp + tmin*raw.info.sfreq;
         to   = event_samp + floor(tmax*raw.info.sfreq + 0.5);
 
-        epoch.reset(new MNEEpochData());
-
-        if(raw.read_raw_segment(epoch->epoch, timesDummy, from, to, picksNew)) {
-            if (p == 0) {
-                times.resize(1, to-from+1);
-                for (qint32 i = 0; i < times.cols(); ++i)
-                    times(0, i) = ((float)(from-event_samp+i)) / raw.info.sfreq;
-            }
-
-            epoch->event = event;
-            epoch->tmin = tmin;
-            epoch->tmax = tmax;
+        if(iNumSamples < 0) {
+            iNumSamples = to - from + 1;
+        }
 
-            epoch->bReject = checkForArtifact(epoch->epoch,
-                                              raw.info,
-                                              mapReject,
-                                              lExcludeChs);
+        if(to - from + 1 == iNumSamples) {
+            vecFrom.append(from);
+        }
+    }
 
-            if (epoch->bReject) {
-                dropCount++;
+    // Read all epochs at once
+    const int iNumEpochs = vecFrom.size();
+    QVector<MatrixXd> vecEpochs;
+    QVector<bool> vecRead;
+    readEpochBlock(raw, vecFrom, iNumSamples, picksNew, vecEpochs, vecRead);
+
+    // Check all epochs for artifacts in parallel
+    MNEArtifactRejector rejector(raw.info,
+                                 mapReject,
+                                 lExcludeChs);
+    QVector<int> vecRejectChannel(iNumEpochs, -1);
+
+    if(!rejector.isEmpty()) {
+        QVector<int> vecEpochIdx(iNumEpochs);
+        std::iota(vecEpochIdx.begin(), vecEpochIdx.end(), 0);
+
+        const QVector<bool>& vecReadConst = vecRead;
+        const QVector<MatrixXd>& vecEpochsConst = vecEpochs;
+        int* pRejectChannel = vecRejectChannel.data();
+
+        QtConcurrent::blockingMap(vecEpochIdx, [&](const int& iEpoch) {
+            if(vecReadConst.at(iEpoch)) {
+                rejector.check(vecEpochsConst.at(iEpoch), pRejectChannel + iEpoch);
             }
+        });
+    }
 
-            //Check if data block has the same size as the previous one
-            if(!data.isEmpty()) {
-                if(epoch->epoch.size() == data.last()->epoch.size()) {
-                    data.append(MNEEpochData::SPtr(epoch.take()));//List takes ownwership of the pointer - no delete need
-                }
-            } else {
-                data.append(MNEEpochData::SPtr(epoch.take()));//List takes ownwership of the pointer - no delete need
-            }
-        } else {
+    fiff_int_t dropCount = 0;
+
+    for (p = 0; p < iNumEpochs; ++p) {
+        if(!vecRead[p]) {
             qWarning("[MNEEpochDataList::readEpochs] Can't read the event data segments.");
+            continue;
+        }
+
+        // Move the epoch data instead of copying it
+        MNEEpochData::SPtr epoch(new MNEEpochData());
+        epoch->epoch.swap(vecEpochs[p]);
+        epoch->event = event;
+        epoch->tmin = tmin;
+        epoch->tmax = tmax;
+        epoch->bReject = vecRejectChannel[p] >= 0;
+
+        if (epoch->bReject) {
+            qInfo().noquote() << "[MNEEpochDataList::readEpochs] Reject trial because of channel"<<rejector.channelName(vecRejectChannel[p]);
+            dropCount++;
         }
+
+        data.append(epoch);
     }
 
     qInfo().noquote() << "[MNEEpochDataList::readEpochs] Read a total of"<< data.size() <<"epochs of type" << event << "and marked"<< dropCount <<"for rejection.";
@@ -176,6 +201,87 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
 
 //=============================================================================================================
 
+int MNEEpochDataList::readEpochBlock(const FiffRawData& raw,
+                                     const QVector<fiff_int_t>& vecFrom,
+                                     fiff_int_t iNumSamples,
+                                     const RowVectorXi& picks,
+                                     QVector<MatrixXd>& vecEpochs,
+                                     QVector<bool>& vecRead)
+{
+    const int iNumEpochs = vecFrom.size();
+
+    vecRead.fill(false, iNumEpochs);
+    vecEpochs.fill(MatrixXd(), iNumEpochs);
+
+    if(iNumSamples <= 0 || iNumEpochs == 0) {
+        return 0;
+    }
+
+    // Sort the epochs by their first sample
+    QVector<int> vecOrder(iNumEpochs);
+    std::iota(vecOrder.begin(), vecOrder.end(), 0);
+    std::sort(vecOrder.begin(), vecOrder.end(), [&vecFrom](int a, int b) {
+        return vecFrom[a] < vecFrom[b];
+    });
+
+    // Epochs closer than one raw buffer share buffers and are read together. The length of a single read is bounded.
+    const fiff_int_t iMaxGap = raw.rawdir.isEmpty() ? 0 : raw.rawdir.first().nsamp;
+    const fiff_int_t iMaxReadSamples = std::max(iNumSamples, fiff_int_t(10.0 * raw.info.sfreq));
+
+    MatrixXd matSegment, timesDummy;
+    QVector<int> vecSegmentEpochs;
+    fiff_int_t iSegmentFrom = 0, iSegmentTo = -1;
+    int iNumRead = 0;
+
+    for(int i = 0; i <= iNumEpochs; ++i) {
+        int iEpoch = -1;
+        fiff_int_t iFrom = 0, iTo = 0;
+
+        if(i < iNumEpochs) {
+            iEpoch = vecOrder[i];
+            iFrom = vecFrom[iEpoch];
+            iTo = iFrom + iNumSamples - 1;
+
+            if(iFrom < raw.first_samp || iTo > raw.last_samp) {
+                continue;
+            }
+
+            if(!vecSegmentEpochs.isEmpty()
+               && iFrom <= iSegmentTo + iMaxGap
+               && iTo - iSegmentFrom < iMaxReadSamples) {
+                iSegmentTo = std::max(iSegmentTo, iTo);
+                vecSegmentEpochs.append(iEpoch);
+                continue;
+            }
+        }
+
+        // Read the current segment and scatter it to its epochs
+        if(!vecSegmentEpochs.isEmpty()
+           && raw.read_raw_segment(matSegment, timesDummy, iSegmentFrom, iSegmentTo, picks)) {
+            for(int j = 0; j < vecSegmentEpochs.size(); ++j) {
+                const int iSegmentEpoch = vecSegmentEpochs.at(j);
+                vecEpochs[iSegmentEpoch] = matSegment.middleCols(vecFrom[iSegmentEpoch] - iSegmentFrom, iNumSamples);
+                vecRead[iSegmentEpoch] = true;
+            }
+
+            iNumRead += vecSegmentEpochs.size();
+        }
+
+        // Start a new segment
+        vecSegmentEpochs.clear();
+
+        if(iEpoch >= 0) {
+            vecSegmentEpochs.append(iEpoch);
+            iSegmentFrom = iFrom;
+            iSegmentTo = iTo;
+        }
+    }
+
+    return iNumRead;
+}
+
+//=============================================================================================================
+
 FiffEvoked MNEEpochDataList::average(const FiffInfo& info,
                                      fiff_int_t first,
                                      fiff_int_t last,
@@ -239,11 +345,10 @@ FiffEvoked MNEEpochDataList::average(const FiffInfo& info,
 
 void MNEEpochDataList::applyBaselineCorrection(const QPair<float, float> &baseline)
 {
-    // Run baseline correction
-    QMutableListIterator<MNEEpochData::SPtr> i(*this);
-    while (i.hasNext()) {
-        i.next()->applyBaselineCorrection(baseline);
-    }
+    // Run baseline correction, the epochs are independent of each other
+    QtConcurrent::blockingMap(*this, [&baseline](MNEEpochData::SPtr& pEpoch) {
+        pEpoch->applyBaselineCorrection(baseline);
+    });
 }
 
 //=============================================================================================================
@@ -275,116 +380,21 @@ bool MNEEpochDataList::checkForArtifact(const MatrixXd& data,
                                         const QMap<QString,double>& mapReject,
                                         const QStringList& lExcludeChs)
 {
-    //qDebug() << "MNEEpochDataList::checkForArtifact - Doing artifact reduction for" << mapReject;
-
-    bool bReject = false;
-
-    //Prepare concurrent data handling
-    QList<ArtifactRejectionData> lchData;
-    QList<int> lChTypes;
-
-    if(mapReject.contains("grad") ||
-       mapReject.contains("mag") ) {
-        lChTypes << FIFFV_MEG_CH;
-    }
-
-    if(mapReject.contains("eeg")) {
-        lChTypes << FIFFV_EEG_CH;
-    }
-
-    if(mapReject.contains("eog")) {
-        lChTypes << FIFFV_EOG_CH;
-    }
-
-    if(lChTypes.isEmpty()) {
-        return bReject;
-    }
-
-    for(int i = 0; i < pFiffInfo.chs.size(); ++i) {
-        if(lChTypes.contains(pFiffInfo.chs.at(i).kind)
-           && !lExcludeChs.contains(pFiffInfo.chs.at(i).ch_name)
-           && !pFiffInfo.bads.contains(pFiffInfo.chs.at(i).ch_name)
-           && pFiffInfo.chs.at(i).chpos.coil_type != FIFFV_COIL_BABY_REF_MAG
-           && pFiffInfo.chs.at(i).chpos.coil_type != FIFFV_COIL_BABY_REF_MAG2) {
-            ArtifactRejectionData tempData;
-            tempData.data = data.row(i);
-
-            switch (pFiffInfo.chs.at(i).kind) {
-            case FIFFV_MEG_CH:
-                if(pFiffInfo.chs.at(i).unit == FIFF_UNIT_T) {
-                    tempData.dThreshold = mapReject["mag"];
-                } else if(pFiffInfo.chs.at(i).unit == FIFF_UNIT_T_M) {
-                    tempData.dThreshold = mapReject["grad"];
-                }
-            break;
-
-            case FIFFV_EEG_CH:
-                tempData.dThreshold = mapReject["eeg"];
-            break;
-
-            case FIFFV_EOG_CH:
-                tempData.dThreshold = mapReject["eog"];
-            break;
-            }
-
-            tempData.sChName = pFiffInfo.chs.at(i).ch_name;
-            lchData.append(tempData);
-        }
-    }
+    MNEArtifactRejector rejector(pFiffInfo,
+                                 mapReject,
+                                 lExcludeChs);
 
-    if(lchData.isEmpty()) {
+    if(rejector.isEmpty()) {
         qWarning() << "[MNEEpochDataList::checkForArtifact] No channels found to scan for artifacts. Do not reject. Returning.";
-
-        return bReject;
+        return false;
     }
 
-    //qDebug() << "MNEEpochDataList::checkForArtifact - lchData.size()" << lchData.size();
-
-    //Start the concurrent processing
-    QFuture<void> future = QtConcurrent::map(lchData, checkChThreshold);
-    future.waitForFinished();
-
-    for(int i = 0; i < lchData.size(); ++i) {
-        if(lchData.at(i).bRejected) {
-            bReject = true;
-            qInfo().noquote() << "[MNEEpochDataList::checkForArtifact] Reject trial because of channel"<<lchData.at(i).sChName;
-            break;
-        }
-    }
-
-    return bReject;
-}
-
-//=============================================================================================================
-
-void MNEEpochDataList::checkChThreshold(ArtifactRejectionData& inputData)
-{
-    RowVectorXd temp = inputData.data;
-
-    // Remove offset
-    //temp = temp.array() - temp(0);
-
-    double min = temp.minCoeff();
-    double max = temp.maxCoeff();
+    int iRejectChannel;
 
-    // Peak to Peak
-    double pp = max - min;
-
-    if(std::fabs(pp) > inputData.dThreshold) {
-        inputData.bRejected = true;
-    } else {
-        inputData.bRejected = false;
+    if(rejector.check(data, &iRejectChannel)) {
+        qInfo().noquote() << "[MNEEpochDataList::checkForArtifact] Reject trial because of channel"<<rejector.channelName(iRejectChannel);
+        return true;
     }
 
-//    qDebug() << "MNEEpochDataList::checkChThreshold - min" << min;
-//    qDebug() << "MNEEpochDataList::checkChThreshold - max" << max;
-//    qDebug() << "MNEEpochDataList::checkChThreshold - pp" << pp;
-//    qDebug() << "MNEEpochDataList::checkChThreshold - inputData.dThreshold" << inputData.dThreshold;
-
-//    //If absolute vaue of min or max if bigger than threshold -> reject
-//    if((std::fabs(min) > inputData.dThreshold) || (std::fabs(max) > inputData.dThreshold)) {
-//        inputData.bRejected = true;
-//    } else {
-//        inputData.bRejected = false;
-//    }
+    return false;
 }
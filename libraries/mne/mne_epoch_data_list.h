@@ -47,6 +47,7 @@
 
 #include "mne_global.h"
 #include "mne_epoch_data.h"
+#include "mne_artifact_rejector.h"
 
 //=============================================================================================================
 // QT INCLUDES
@@ -62,13 +63,6 @@
 namespace MNELIB
 {
 
-struct ArtifactRejectionData {
-    bool bRejected = false;
-    Eigen::RowVectorXd data;
-    double dThreshold;
-    QString sChName;
-};
-
 //=============================================================================================================
 /**
  * Epoch data list, which corresponds to a set of events
@@ -115,6 +109,28 @@ public:
                                        const QStringList &lExcludeChs = QStringList(),
                                        const Eigen::RowVectorXi& picks = Eigen::RowVectorXi());
 
+    //=========================================================================================================
+    /**
+     * Reads equally long data segments. The segments are sorted and nearby segments are coalesced into larger
+     * reads, so every raw buffer is read and decoded once and its samples are scattered into all overlapping
+     * segments. Segments which are not completely within the raw data are not read.
+     *
+     * @param[in] raw                The raw data.
+     * @param[in] vecFrom            The first sample of each segment.
+     * @param[in] iNumSamples        The number of samples of each segment.
+     * @param[in] picks              Which channels to pick. All channels if empty.
+     * @param[out] vecEpochs         The segments <n_channels x n_samples>. Segments which were not read are empty.
+     * @param[out] vecRead           Whether each segment was read.
+     *
+     * @return The number of read segments.
+     */
+    static int readEpochBlock(const FIFFLIB::FiffRawData& raw,
+                              const QVector<FIFFLIB::fiff_int_t>& vecFrom,
+                              FIFFLIB::fiff_int_t iNumSamples,
+                              const Eigen::RowVectorXi& picks,
+                              QVector<Eigen::MatrixXd>& vecEpochs,
+                              QVector<bool>& vecRead);
+
     //=========================================================================================================
     /**
      * Averages epoch list. Note that no baseline correction performed.
@@ -133,7 +149,7 @@ public:
 
     //=========================================================================================================
     /**
-     * Applies baseline correction to the evoked data.
+     * Applies baseline correction to all epochs in parallel.
      *
      * @param[in] baseline     time definition of the baseline in seconds [from, to]
      */
@@ -155,7 +171,8 @@ public:
 
     //=========================================================================================================
     /**
-     * Checks the givven matrix for artifacts beyond a threshold value.
+     * Checks the givven matrix for artifacts beyond a threshold value. This resolves the channels to scan on every
+     * call, use MNEArtifactRejector directly when checking several data blocks with the same settings.
      *
      * @param[in] data           The data matrix.
      * @param[in] pFiffInfo      The fiff info.
@@ -168,8 +185,6 @@ public:
                                  const FIFFLIB::FiffInfo& pFiffInfo,
                                  const QMap<QString,double>& mapReject,
                                  const QStringList &lExcludeChs = QStringList());
-
-    static void checkChThreshold(ArtifactRejectionData& inputData);
 };
 } // NAMESPACE
 
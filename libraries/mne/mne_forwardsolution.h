@@ -123,7 +123,9 @@ struct RegionData
         // Kmeans Reduction
         RegionDataOut p_RegionDataOut;
 
-        UTILSLIB::KMeans t_kMeans(t_sDistMeasure, QString("sample"), 5);
+        // Seed with the label, the clustering of a region does not depend on the order the regions are processed in
+        UTILSLIB::KMeans t_kMeans(t_sDistMeasure, QString("kmeans++"), 5);
+        t_kMeans.setSeed(this->iLabelIdxIn);
 
         if(bUseWhitened)
         {
@@ -122,7 +122,9 @@ struct RegionMT
         // Kmeans Reduction
         RegionMTOut p_RegionMTOut;
 
-        UTILSLIB::KMeans t_kMeans(t_sDistMeasure, QString("sample"), 5);
+        // Seed with the label, the clustering of a region does not depend on the order the regions are processed in
+        UTILSLIB::KMeans t_kMeans(t_sDistMeasure, QString("kmeans++"), 5);
+        t_kMeans.setSeed(this->iLabelIdxIn);
 
         t_kMeans.calculate(this->matRoiMT, this->nClusters, p_RegionMTOut.roiIdx, p_RegionMTOut.ctrs, p_RegionMTOut.sumd, p_RegionMTOut.D);
 
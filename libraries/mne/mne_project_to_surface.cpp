@@ -50,12 +50,23 @@
 // QT INCLUDES
 //=============================================================================================================
 
+#include <QAtomicInt>
+#include <QtConcurrent>
+
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
 
 #include <Eigen/Geometry>
 
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
@@ -113,10 +124,12 @@ MNEProjectToSurface::MNEProjectToSurface(const MNEBemSurface &p_MNEBemSurf)
     {
         for (int i = 0; i < p_MNEBemSurf.ntri; ++i)
         {
-            nn.row(i) = r12.row(i).transpose().cross(r13.row(i).transpose()).transpose();
+            nn.row(i) = r12.row(i).transpose().cross(r13.row(i).transpose()).normalized().transpose();
         }
     }
     det = (a.array()*b.array() - c.array()*c.array()).matrix();
+
+    build_bvh();
 }
 
 //=============================================================================================================
@@ -136,72 +149,124 @@ MNEProjectToSurface::MNEProjectToSurface(const MNESurface &p_MNESurf)
         r1.row(i) = p_MNESurf.rr.row(p_MNESurf.tris(i,0));
         r12.row(i) = p_MNESurf.rr.row(p_MNESurf.tris(i,1)) - r1.row(i);
         r13.row(i) = p_MNESurf.rr.row(p_MNESurf.tris(i,2)) - r1.row(i);
-        nn.row(i) = r12.row(i).transpose().cross(r13.row(i).transpose()).transpose();
+        nn.row(i) = r12.row(i).transpose().cross(r13.row(i).transpose()).normalized().transpose();
         a(i) = r12.row(i) * r12.row(i).transpose();
         b(i) = r13.row(i) * r13.row(i).transpose();
         c(i) = r12.row(i) * r13.row(i).transpose();
     }
 
     det = (a.array()*b.array() - c.array()*c.array()).matrix();
+
+    build_bvh();
 }
 
 //=============================================================================================================
 
 bool MNEProjectToSurface::mne_find_closest_on_surface(const MatrixXf &r, const int np, MatrixXf &rTri,
-                                                      VectorXi &nearest, VectorXf &dist)
+                                                      VectorXi &nearest, VectorXf &dist) const
 {
     // resize output
     nearest.resize(np);
     dist.resize(np);
     rTri.resize(np,3);
 
-    if (this->r1.isZero(0))
+    if (this->r1.isZero(0) || this->m_vecBvh.isEmpty())
     {
         qDebug() << "No surface loaded to make the projection./n";
         return false;
     }
-    int bestTri = -1;
-    float bestDist = -1;
-    Vector3f rTriK;
-    for (int k = 0; k < np; ++k)
-    {
-        /*
-         * To do: decide_search_restriction for the use in an iterative closest point to plane algorithm
-         * For now it's OK to go through all triangles.
-         */
+
+    // Every point writes to its own row of the output, so the points can be projected in parallel
+    QVector<int> vecPoints(np);
+    std::iota(vecPoints.begin(), vecPoints.end(), 0);
+    QAtomicInt iFailed(-1);
+
+    QtConcurrent::blockingMap(vecPoints, [&](const int k) {
+        int bestTri = -1;
+        float bestDist = -1;
+        Vector3f rTriK;
+
         if (!this->mne_project_to_surface(r.row(k).transpose(), rTriK, bestTri, bestDist))
         {
-            qDebug() << "The projection of point number " << k << " didn't work./n";
-            return false;
+            iFailed.testAndSetRelaxed(-1, k);
+            return;
         }
         rTri.row(k) = rTriK.transpose();
         nearest[k] = bestTri;
         dist[k] = bestDist;
+    });
+
+    if (iFailed.loadAcquire() >= 0)
+    {
+        qDebug() << "The projection of point number " << iFailed.loadAcquire() << " didn't work./n";
+        return false;
     }
     return true;
 }
 
 //=============================================================================================================
 
-bool MNEProjectToSurface::mne_project_to_surface(const Vector3f &r, Vector3f &rTri, int &bestTri, float &bestDist)
+bool MNEProjectToSurface::mne_project_to_surface(const Vector3f &r, Vector3f &rTri, int &bestTri, float &bestDist) const
 {
     float p = 0, q = 0, p0 = 0, q0 = 0, dist0 = 0;
+    float bestDistSquared = std::numeric_limits<float>::max();
     bestDist = 0.0f;
     bestTri = -1;
-    for (int tri = 0; tri < a .size(); ++tri)
+
+    // Depth first traversal, the closer child first. Boxes farther away than the best triangle are skipped.
+    int vecStack[64];
+    int iStackSize = 0;
+    vecStack[iStackSize++] = 0;
+
+    while (iStackSize > 0)
     {
-        if (!this->nearest_triangle_point(r, tri, p0, q0, dist0))
+        int iNode = vecStack[--iStackSize];
+        const BvhNode& node = m_vecBvh.at(iNode);
+
+        if ((r - r.cwiseMax(node.vecMin).cwiseMin(node.vecMax)).squaredNorm() > bestDistSquared)
         {
-            qDebug() << "The projection on triangle " << tri << " didn't work./n";
-            return false;
+            continue;
         }
 
-        if ((bestTri < 0) || (std::fabs(dist0) < std::fabs(bestDist)))
+        if (node.iCount > 0)
         {
-            bestDist = dist0;
-            p = p0;
-            q = q0;
-            bestTri = tri;
+            for (int i = node.iFirst; i < node.iFirst + node.iCount; ++i)
+            {
+                int tri = m_vecTriOrder[i];
+                if (!this->nearest_triangle_point(r, tri, p0, q0, dist0))
+                {
+                    qDebug() << "The projection on triangle " << tri << " didn't work./n";
+                    return false;
+                }
+
+                if ((bestTri < 0) || (std::fabs(dist0) < std::fabs(bestDist)))
+                {
+                    bestDist = dist0;
+                    bestDistSquared = dist0 * dist0;
+                    p = p0;
+                    q = q0;
+                    bestTri = tri;
+                }
+            }
+            continue;
+        }
+
+        int iLeft = iNode + 1;
+        int iRight = node.iRight;
+        const BvhNode& left = m_vecBvh.at(iLeft);
+        const BvhNode& right = m_vecBvh.at(iRight);
+        float fDistLeft = (r - r.cwiseMax(left.vecMin).cwiseMin(left.vecMax)).squaredNorm();
+        float fDistRight = (r - r.cwiseMax(right.vecMin).cwiseMin(right.vecMax)).squaredNorm();
+
+        if (fDistLeft < fDistRight)
+        {
+            vecStack[iStackSize++] = iRight;
+            vecStack[iStackSize++] = iLeft;
+        }
+        else
+        {
+            vecStack[iStackSize++] = iLeft;
+            vecStack[iStackSize++] = iRight;
         }
     }
 
@@ -221,7 +286,82 @@ bool MNEProjectToSurface::mne_project_to_surface(const Vector3f &r, Vector3f &rT
 
 //=============================================================================================================
 
-bool MNEProjectToSurface::nearest_triangle_point(const Vector3f &r, const int tri, float &p, float &q, float &dist)
+void MNEProjectToSurface::build_bvh()
+{
+    int iNumTri = a.size();
+
+    m_vecBvh.clear();
+    if (iNumTri == 0)
+    {
+        return;
+    }
+
+    MatrixX3f matCentroids = r1 + (r12 + r13) / 3.0f;
+
+    m_vecTriOrder.resize(iNumTri);
+    std::iota(m_vecTriOrder.data(), m_vecTriOrder.data() + iNumTri, 0);
+
+    m_vecBvh.reserve(2 * iNumTri);
+    build_bvh_node(0, iNumTri, matCentroids);
+}
+
+//=============================================================================================================
+
+int MNEProjectToSurface::build_bvh_node(const int iFirst, const int iCount, const MatrixX3f &matCentroids)
+{
+    const int iMaxLeafSize = 4;
+
+    BvhNode node;
+    node.vecMin = Vector3f::Constant(std::numeric_limits<float>::max());
+    node.vecMax = Vector3f::Constant(-std::numeric_limits<float>::max());
+    node.iFirst = iFirst;
+    node.iCount = iCount;
+    node.iRight = -1;
+
+    Vector3f vecCentroidMin = node.vecMin;
+    Vector3f vecCentroidMax = node.vecMax;
+
+    for (int i = iFirst; i < iFirst + iCount; ++i)
+    {
+        int tri = m_vecTriOrder[i];
+        Vector3f vecR1 = r1.row(tri).transpose();
+        Vector3f vecR2 = vecR1 + r12.row(tri).transpose();
+        Vector3f vecR3 = vecR1 + r13.row(tri).transpose();
+        node.vecMin = node.vecMin.cwiseMin(vecR1).cwiseMin(vecR2).cwiseMin(vecR3);
+        node.vecMax = node.vecMax.cwiseMax(vecR1).cwiseMax(vecR2).cwiseMax(vecR3);
+        vecCentroidMin = vecCentroidMin.cwiseMin(matCentroids.row(tri).transpose());
+        vecCentroidMax = vecCentroidMax.cwiseMax(matCentroids.row(tri).transpose());
+    }
+
+    int iNode = m_vecBvh.size();
+    m_vecBvh.append(node);
+
+    if (iCount <= iMaxLeafSize)
+    {
+        return iNode;
+    }
+
+    // Split at the median centroid along the longest axis
+    int iAxis;
+    (vecCentroidMax - vecCentroidMin).maxCoeff(&iAxis);
+    int* pFirst = m_vecTriOrder.data() + iFirst;
+    int iHalf = iCount / 2;
+    std::nth_element(pFirst, pFirst + iHalf, pFirst + iCount, [&matCentroids, iAxis](int i, int j) {
+        return matCentroids(i, iAxis) < matCentroids(j, iAxis);
+    });
+
+    build_bvh_node(iFirst, iHalf, matCentroids);
+    int iRight = build_bvh_node(iFirst + iHalf, iCount - iHalf, matCentroids);
+
+    m_vecBvh[iNode].iCount = 0;
+    m_vecBvh[iNode].iRight = iRight;
+
+    return iNode;
+}
+
+//=============================================================================================================
+
+bool MNEProjectToSurface::nearest_triangle_point(const Vector3f &r, const int tri, float &p, float &q, float &dist) const
 {
     //Calculate some helpers
     Vector3f rr = r - this->r1.row(tri).transpose(); //Vector from triangle corner #1 to r
@@ -329,7 +469,7 @@ bool MNEProjectToSurface::nearest_triangle_point(const Vector3f &r, const int tr
 
 //=============================================================================================================
 
-bool MNEProjectToSurface::project_to_triangle(Vector3f &rTri, const float p, const float q, const int tri)
+bool MNEProjectToSurface::project_to_triangle(Vector3f &rTri, const float p, const float q, const int tri) const
 {
     rTri = this->r1.row(tri) + p*this->r12.row(tri) + q*this->r13.row(tri);
     return true;
@@ -47,6 +47,7 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QVector>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -111,7 +112,8 @@ public:
 
     //=========================================================================================================
     /**
-     * Projects a set of points r on the Surface
+     * Projects a set of points r on the Surface. The points are processed in parallel, each point only visits the
+     * triangles whose bounding boxes are closer than the best triangle found so far.
      *
      * @brief mne_find_closest_on_surface
      *
@@ -124,14 +126,50 @@ public:
      * @return true if succeeded, false otherwise
      */
     bool mne_find_closest_on_surface(const Eigen::MatrixXf &r, const int np, Eigen::MatrixXf &rTri,
-                                     Eigen::VectorXi &nearest, Eigen::VectorXf &dist);
+                                     Eigen::VectorXi &nearest, Eigen::VectorXf &dist) const;
 
 protected:
 
 private:
     //=========================================================================================================
     /**
-     * Projects a point r on the Surface
+     * A node of the bounding volume hierarchy over the surface triangles. Inner nodes store their left child
+     * directly behind themselves, leaves refer to a range of m_vecTriOrder.
+     */
+    struct BvhNode {
+        Eigen::Vector3f vecMin;     /**< Lower corner of the axis aligned bounding box */
+        Eigen::Vector3f vecMax;     /**< Upper corner of the axis aligned bounding box */
+        int iFirst;                 /**< Leaf: first index into m_vecTriOrder */
+        int iCount;                 /**< Leaf: number of triangles, 0 for inner nodes */
+        int iRight;                 /**< Inner node: index of the right child */
+    };
+
+    //=========================================================================================================
+    /**
+     * Builds the bounding volume hierarchy over all triangles. Called once by the constructors.
+     *
+     * @brief build_bvh
+     */
+    void build_bvh();
+
+    //=========================================================================================================
+    /**
+     * Builds the subtree for the triangles m_vecTriOrder[iFirst, iFirst + iCount) by splitting at the median
+     * centroid along the longest axis.
+     *
+     * @brief build_bvh_node
+     *
+     * @param[in] iFirst        First index into m_vecTriOrder
+     * @param[in] iCount        Number of triangles
+     * @param[in] matCentroids  The triangle centroids
+     *
+     * @return the index of the new node
+     */
+    int build_bvh_node(const int iFirst, const int iCount, const Eigen::MatrixX3f &matCentroids);
+
+    //=========================================================================================================
+    /**
+     * Projects a point r on the Surface, using the bounding volume hierarchy
      *
      * @brief mne_project_to_surface
      *
@@ -142,7 +180,7 @@ private:
      *
      * @return true if succeeded, false otherwise
      */
-    bool mne_project_to_surface(const Eigen::Vector3f &r, Eigen::Vector3f &rTri, int &bestTri, float &bestDist);
+    bool mne_project_to_surface(const Eigen::Vector3f &r, Eigen::Vector3f &rTri, int &bestTri, float &bestDist) const;
 
     //=========================================================================================================
     /**
@@ -158,7 +196,7 @@ private:
      *
      * @return true if succeeded, false otherwise
      */
-    bool nearest_triangle_point(const Eigen::Vector3f &r, const int tri, float &p, float &q, float &dist);
+    bool nearest_triangle_point(const Eigen::Vector3f &r, const int tri, float &p, float &q, float &dist) const;
 
     //=========================================================================================================
     /**
@@ -173,16 +211,19 @@ private:
      *
      * @return true if succeeded, false otherwise
      */
-    bool project_to_triangle(Eigen::Vector3f &rTri, const float p, const float q, const int tri);
+    bool project_to_triangle(Eigen::Vector3f &rTri, const float p, const float q, const int tri) const;
 
     Eigen::MatrixX3f r1;         /**< Cartesian Vector to the first triangel corner */
     Eigen::MatrixX3f r12;        /**< Cartesian Vector from the first to the second triangel corner */
     Eigen::MatrixX3f r13;        /**< Cartesian Vector from the first to the third triangel corner */
-    Eigen::MatrixX3f nn;         /**< Cartesian Vector of the triangle plane normal */
+    Eigen::MatrixX3f nn;         /**< Cartesian unit Vector of the triangle plane normal */
     Eigen::VectorXf a;           /**< r12*r12 */
     Eigen::VectorXf b;           /**< r13*r13 */
     Eigen::VectorXf c;           /**< r12*r13 */
     Eigen::VectorXf det;         /**< Determinant of the Matrix [a c, c b] */
+
+    QVector<BvhNode> m_vecBvh;   /**< The bounding volume hierarchy, m_vecBvh[0] is the root */
+    Eigen::VectorXi m_vecTriOrder; /**< The triangle indices, ordered such that each leaf covers a contiguous range */
 };
 
 //=============================================================================================================
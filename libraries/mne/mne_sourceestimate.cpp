@@ -45,9 +45,16 @@
 //=============================================================================================================
 
 #include <QFile>
-#include <QDataStream>
 #include <QSharedPointer>
 #include <QDebug>
+#include <QtEndian>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cstring>
+#include <limits>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -57,6 +64,54 @@ using namespace MNELIB;
 using namespace FSLIB;
 using namespace Eigen;
 
+//=============================================================================================================
+// DEFINE STATIC METHODS
+//=============================================================================================================
+
+static const qint64 STC_BLOCK_BYTES = 16 * 1024 * 1024;   /**< Size of the blocks used to convert data which is not memory mapped. */
+
+static inline float stcReadFloat(const uchar* pSrc)
+{
+    quint32 iBits = qFromBigEndian<quint32>(pSrc);
+    float fValue;
+    std::memcpy(&fValue, &iBits, sizeof(float));
+    return fValue;
+}
+
+//=============================================================================================================
+
+static inline void stcWriteFloat(float fValue, uchar* pDest)
+{
+    quint32 iBits;
+    std::memcpy(&iBits, &fValue, sizeof(float));
+    qToBigEndian<quint32>(iBits, pDest);
+}
+
+//=============================================================================================================
+
+static void stcConvertSamples(const uchar* pSrc,
+                              qint32 nVertices,
+                              qint32 nSamples,
+                              const VectorXi& sel,
+                              MatrixXd& matData,
+                              qint32 iCol)
+{
+    // The samples are stored one after another, each holding the values of all vertices
+    for(qint32 s = 0; s < nSamples; ++s) {
+        const uchar* pSample = pSrc + qint64(s) * nVertices * 4;
+
+        if(sel.size() > 0) {
+            for(qint32 r = 0; r < sel.size(); ++r) {
+                matData(r, iCol + s) = stcReadFloat(pSample + qint64(sel[r]) * 4);
+            }
+        } else {
+            for(qint32 r = 0; r < nVertices; ++r) {
+                matData(r, iCol + s) = stcReadFloat(pSample + qint64(r) * 4);
+            }
+        }
+    }
+}
+
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
@@ -136,13 +191,18 @@ MNESourceEstimate MNESourceEstimate::reduce(qint32 start, qint32 n)
 
 bool MNESourceEstimate::read(QIODevice &p_IODevice, MNESourceEstimate& p_stc)
 {
-    QSharedPointer<QDataStream> t_pStream(new QDataStream(&p_IODevice));
+    return read(p_IODevice, p_stc, 0, -1);
+}
 
-    t_pStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
-    t_pStream->setByteOrder(QDataStream::BigEndian);
-    t_pStream->setVersion(QDataStream::Qt_5_0);
+//=============================================================================================================
 
-    if(!t_pStream->device()->open(QIODevice::ReadOnly))
+bool MNESourceEstimate::read(QIODevice &p_IODevice,
+                             MNESourceEstimate& p_stc,
+                             qint32 start,
+                             qint32 n,
+                             const VectorXi& sel)
+{
+    if(!p_IODevice.open(QIODevice::ReadOnly))
         return false;
 
     QFile* t_pFile = qobject_cast<QFile*>(&p_IODevice);
@@ -151,38 +211,104 @@ bool MNESourceEstimate::read(QIODevice &p_IODevice, MNESourceEstimate& p_stc)
     else
         printf("Reading source estimate...");
 
-    // read start time in ms
-     *t_pStream >> p_stc.tmin;
-    p_stc.tmin /= 1000;
-    // read sampling rate in ms
-     *t_pStream >> p_stc.tstep;
-    p_stc.tstep /= 1000;
-    // read number of vertices
-    quint32 t_nVertices;
-     *t_pStream >> t_nVertices;
-    p_stc.vertices = VectorXi(t_nVertices);
-    // read the vertex indices
-    for(quint32 i = 0; i < t_nVertices; ++i)
-        *t_pStream >> p_stc.vertices[i];
-    // read the number of timepts
     quint32 t_nTimePts;
-     *t_pStream >> t_nTimePts;
-    //
-    // read the data
-    //
-    p_stc.data = MatrixXd(t_nVertices, t_nTimePts);
-    for(qint32 i = 0; i < p_stc.data.array().size(); ++i)
-    {
-        float value;
-        *t_pStream >> value;
-        p_stc.data.array()(i) = value;
+    if(!readHeaderData(p_IODevice, p_stc, t_nTimePts)) {
+        printf("Failed to read source estimate header!\n");
+        p_IODevice.close();
+        return false;
+    }
+
+    qint32 t_nVertices = p_stc.vertices.size();
+
+    if(n < 0) {
+        n = qint32(t_nTimePts) - start;
     }
 
+    if(start < 0 || n < 0 || qint64(start) + n > qint64(t_nTimePts)) {
+        qWarning() << "MNESourceEstimate::read - Requested samples" << start << "to" << start + n << "are out of range. The file holds" << t_nTimePts << "samples.";
+        p_IODevice.close();
+        return false;
+    }
+
+    for(qint32 i = 0; i < sel.size(); ++i) {
+        if(sel[i] < 0 || sel[i] >= t_nVertices) {
+            qWarning() << "MNESourceEstimate::read - Selected source" << sel[i] << "is out of range. The file holds" << t_nVertices << "sources.";
+            p_IODevice.close();
+            return false;
+        }
+    }
+
+    // Data offsets in bytes: tmin, tstep, number of vertices, vertices, number of samples
+    qint64 iSampleBytes = qint64(t_nVertices) * 4;
+    qint64 iOffset = qint64(4 + t_nVertices) * 4 + start * iSampleBytes;
+    qint64 iSize = n * iSampleBytes;
+
+    if(!p_IODevice.isSequential() && iOffset + iSize > p_IODevice.size()) {
+        qWarning() << "MNESourceEstimate::read - The header announces" << t_nTimePts << "samples, which exceeds the size of the source estimate.";
+        p_IODevice.close();
+        return false;
+    }
+
+    // Sequential devices can not tell their size, their data grows with the blocks which were actually read
+    p_stc.data = MatrixXd(sel.size() > 0 ? sel.size() : t_nVertices, p_IODevice.isSequential() ? 0 : n);
+
+    // Map the requested time window if possible, otherwise read and convert it block by block
+    uchar* pMapped = (t_pFile && iSize > 0) ? t_pFile->map(iOffset, iSize) : Q_NULLPTR;
+
+    if(pMapped) {
+        stcConvertSamples(pMapped, t_nVertices, n, sel, p_stc.data, 0);
+        t_pFile->unmap(pMapped);
+    } else if(iSize > 0) {
+        if(p_IODevice.isSequential()) {
+            // Sequential devices can not seek, skip the samples before the time window instead
+            qint64 iSkip = start * iSampleBytes;
+            while(iSkip > 0) {
+                qint64 iRead = p_IODevice.read(qMin(iSkip, STC_BLOCK_BYTES)).size();
+                if(iRead <= 0) {
+                    break;
+                }
+                iSkip -= iRead;
+            }
+        } else {
+            p_IODevice.seek(iOffset);
+        }
+
+        qint32 iBlockSamples = qint32(qMax(qint64(1), STC_BLOCK_BYTES / qMax(qint64(1), iSampleBytes)));
+        QByteArray buffer;
+
+        for(qint32 i = 0; i < n; i += iBlockSamples) {
+            qint32 iSamples = qMin(iBlockSamples, n - i);
+            buffer = p_IODevice.read(iSamples * iSampleBytes);
+
+            if(buffer.size() != iSamples * iSampleBytes) {
+                printf("Failed to read source estimate data!\n");
+                p_IODevice.close();
+                return false;
+            }
+
+            if(p_stc.data.cols() < i + iSamples) {
+                p_stc.data.conservativeResize(NoChange, qMin(n, qMax(i + iSamples, qint32(2 * p_stc.data.cols()))));
+            }
+
+            stcConvertSamples(reinterpret_cast<const uchar*>(buffer.constData()), t_nVertices, iSamples, sel, p_stc.data, i);
+        }
+    }
+
+    if(sel.size() > 0) {
+        VectorXi vertSel(sel.size());
+        for(qint32 i = 0; i < sel.size(); ++i) {
+            vertSel[i] = p_stc.vertices[sel[i]];
+        }
+        p_stc.vertices = vertSel;
+    }
+
+    p_stc.tmin += start * p_stc.tstep;
+
     //Update time vector
     p_stc.update_times();
 
     // close the file
-    t_pStream->device()->close();
+    p_IODevice.close();
 
     printf("[done]\n");
 
@@ -191,16 +317,30 @@ bool MNESourceEstimate::read(QIODevice &p_IODevice, MNESourceEstimate& p_stc)
 
 //=============================================================================================================
 
-bool MNESourceEstimate::write(QIODevice &p_IODevice)
+bool MNESourceEstimate::readHeader(QIODevice &p_IODevice, MNESourceEstimate& p_stc, qint32& p_nTimePts)
 {
-    // Create the file and save the essentials
-    QSharedPointer<QDataStream> t_pStream(new QDataStream(&p_IODevice));
+    if(!p_IODevice.open(QIODevice::ReadOnly))
+        return false;
+
+    quint32 t_nTimePts;
+    bool bResult = readHeaderData(p_IODevice, p_stc, t_nTimePts);
+
+    p_IODevice.close();
+
+    if(bResult) {
+        p_stc.data = MatrixXd();
+        p_stc.update_times();
+        p_nTimePts = qint32(t_nTimePts);
+    }
 
-    t_pStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
-    t_pStream->setByteOrder(QDataStream::BigEndian);
-    t_pStream->setVersion(QDataStream::Qt_5_0);
+    return bResult;
+}
+
+//=============================================================================================================
 
-    if(!t_pStream->device()->open(QIODevice::WriteOnly))
+bool MNESourceEstimate::write(QIODevice &p_IODevice)
+{
+    if(!p_IODevice.open(QIODevice::WriteOnly))
     {
         printf("Failed to write source estimate!\n");
         return false;
@@ -212,25 +352,14 @@ bool MNESourceEstimate::write(QIODevice &p_IODevice)
     else
         printf("Write source estimate...");
 
-    // write start time in ms
-     *t_pStream << (float)1000*this->tmin;
-    // write sampling rate in ms
-     *t_pStream << (float)1000*this->tstep;
-    // write number of vertices
-     *t_pStream << (quint32)this->vertices.size();
-    // write the vertex indices
-    for(qint32 i = 0; i < this->vertices.size(); ++i)
-        *t_pStream << (quint32)this->vertices[i];
-    // write the number of timepts
-     *t_pStream << (quint32)this->data.cols();
-    //
-    // write the data
-    //
-    for(qint32 i = 0; i < this->data.array().size(); ++i)
-        *t_pStream << (float)this->data.array()(i);
+    if(!writeHeaderData(p_IODevice, quint32(this->data.cols())) || !writeData(p_IODevice)) {
+        printf("Failed to write source estimate!\n");
+        p_IODevice.close();
+        return false;
+    }
 
     // close the file
-    t_pStream->device()->close();
+    p_IODevice.close();
 
     printf("[done]\n");
     return true;
@@ -238,6 +367,180 @@ bool MNESourceEstimate::write(QIODevice &p_IODevice)
 
 //=============================================================================================================
 
+bool MNESourceEstimate::append(QIODevice &p_IODevice)
+{
+    if(!p_IODevice.open(QIODevice::ReadWrite))
+    {
+        printf("Failed to append source estimate!\n");
+        return false;
+    }
+
+    if(p_IODevice.isSequential()) {
+        qWarning() << "MNESourceEstimate::append - Appending needs a random access device.";
+        p_IODevice.close();
+        return false;
+    }
+
+    if(this->data.rows() != this->vertices.size()) {
+        qWarning() << "MNESourceEstimate::append - The number of data rows does not match the number of vertices.";
+        p_IODevice.close();
+        return false;
+    }
+
+    // Start a new file
+    if(p_IODevice.size() == 0) {
+        bool bResult = writeHeaderData(p_IODevice, quint32(this->data.cols())) && writeData(p_IODevice);
+        p_IODevice.close();
+        return bResult;
+    }
+
+    MNESourceEstimate t_stcHeader;
+    quint32 t_nTimePts;
+
+    if(!readHeaderData(p_IODevice, t_stcHeader, t_nTimePts)) {
+        qWarning() << "MNESourceEstimate::append - Could not read the header of the existing source estimate.";
+        p_IODevice.close();
+        return false;
+    }
+
+    if(t_stcHeader.vertices.size() != this->vertices.size() || t_stcHeader.vertices != this->vertices) {
+        qWarning() << "MNESourceEstimate::append - The vertices do not match the ones of the existing source estimate.";
+        p_IODevice.close();
+        return false;
+    }
+
+    // The header only stores tmin and tstep of the first block, the samples have to continue with the same step
+    if(!qFuzzyCompare(t_stcHeader.tstep, this->tstep)) {
+        qWarning() << "MNESourceEstimate::append - The time step" << this->tstep << "does not match the time step" << t_stcHeader.tstep << "of the existing source estimate.";
+        p_IODevice.close();
+        return false;
+    }
+
+    qint64 iHeaderBytes = qint64(4 + this->vertices.size()) * 4;
+    if(p_IODevice.size() != iHeaderBytes + qint64(t_nTimePts) * this->vertices.size() * 4) {
+        qWarning() << "MNESourceEstimate::append - The size of the existing source estimate does not match its header.";
+        p_IODevice.close();
+        return false;
+    }
+
+    // Append the data first and update the number of samples afterwards
+    if(!p_IODevice.seek(p_IODevice.size()) || !writeData(p_IODevice)) {
+        qWarning() << "MNESourceEstimate::append - Could not append the data.";
+        p_IODevice.close();
+        return false;
+    }
+
+    uchar pTimePts[4];
+    qToBigEndian<quint32>(t_nTimePts + quint32(this->data.cols()), pTimePts);
+
+    bool bResult = p_IODevice.seek(iHeaderBytes - 4)
+                   && p_IODevice.write(reinterpret_cast<const char*>(pTimePts), 4) == 4;
+
+    p_IODevice.close();
+
+    return bResult;
+}
+
+//=============================================================================================================
+
+bool MNESourceEstimate::readHeaderData(QIODevice &p_IODevice, MNESourceEstimate& p_stc, quint32& p_nTimePts)
+{
+    // read start time and sampling rate in ms and the number of vertices
+    QByteArray buffer = p_IODevice.read(12);
+    if(buffer.size() != 12)
+        return false;
+
+    const uchar* pData = reinterpret_cast<const uchar*>(buffer.constData());
+
+    p_stc.tmin = stcReadFloat(pData) / 1000;
+    p_stc.tstep = stcReadFloat(pData + 4) / 1000;
+    quint32 t_nVertices = qFromBigEndian<quint32>(pData + 8);
+
+    // The number of vertices comes from the file. Check it against the device before allocating anything for it.
+    qint64 iVertexBytes = qint64(t_nVertices) * 4 + 4;
+
+    if(iVertexBytes > std::numeric_limits<int>::max() ||
+       (!p_IODevice.isSequential() && p_IODevice.pos() + iVertexBytes > p_IODevice.size())) {
+        qWarning() << "MNESourceEstimate::readHeaderData - The header announces" << t_nVertices << "vertices, which exceeds the size of the source estimate.";
+        return false;
+    }
+
+    // read the vertex indices and the number of timepts. Sequential devices are read block by block, so that a
+    // corrupt header only allocates as much memory as the device actually delivers.
+    buffer.clear();
+    while(buffer.size() < iVertexBytes) {
+        QByteArray block = p_IODevice.read(qMin(iVertexBytes - buffer.size(), STC_BLOCK_BYTES));
+        if(block.isEmpty()) {
+            break;
+        }
+        buffer.append(block);
+    }
+
+    if(buffer.size() != iVertexBytes)
+        return false;
+
+    pData = reinterpret_cast<const uchar*>(buffer.constData());
+
+    p_stc.vertices = VectorXi(t_nVertices);
+    for(quint32 i = 0; i < t_nVertices; ++i)
+        p_stc.vertices[i] = qint32(qFromBigEndian<quint32>(pData + qint64(i) * 4));
+
+    p_nTimePts = qFromBigEndian<quint32>(pData + qint64(t_nVertices) * 4);
+
+    return true;
+}
+
+//=============================================================================================================
+
+bool MNESourceEstimate::writeHeaderData(QIODevice &p_IODevice, quint32 nTimePts) const
+{
+    QByteArray buffer(int(this->vertices.size() + 4) * 4, 0);
+    uchar* pData = reinterpret_cast<uchar*>(buffer.data());
+
+    // write start time and sampling rate in ms and the number of vertices
+    stcWriteFloat(1000 * this->tmin, pData);
+    stcWriteFloat(1000 * this->tstep, pData + 4);
+    qToBigEndian<quint32>(quint32(this->vertices.size()), pData + 8);
+
+    // write the vertex indices and the number of timepts
+    for(qint32 i = 0; i < this->vertices.size(); ++i)
+        qToBigEndian<quint32>(quint32(this->vertices[i]), pData + 12 + qint64(i) * 4);
+
+    qToBigEndian<quint32>(nTimePts, pData + 12 + qint64(this->vertices.size()) * 4);
+
+    return p_IODevice.write(buffer) == buffer.size();
+}
+
+//=============================================================================================================
+
+bool MNESourceEstimate::writeData(QIODevice &p_IODevice) const
+{
+    qint64 iSampleBytes = qint64(this->data.rows()) * 4;
+    qint32 iBlockSamples = qint32(qMax(qint64(1), STC_BLOCK_BYTES / qMax(qint64(1), iSampleBytes)));
+    QByteArray buffer;
+
+    // write the data sample by sample, each holding the values of all vertices
+    for(qint32 i = 0; i < this->data.cols(); i += iBlockSamples) {
+        qint32 iSamples = qMin(iBlockSamples, qint32(this->data.cols()) - i);
+        buffer.resize(int(iSamples * iSampleBytes));
+        uchar* pData = reinterpret_cast<uchar*>(buffer.data());
+
+        for(qint32 s = 0; s < iSamples; ++s) {
+            for(qint32 r = 0; r < this->data.rows(); ++r) {
+                stcWriteFloat(float(this->data(r, i + s)), pData);
+                pData += 4;
+            }
+        }
+
+        if(p_IODevice.write(buffer) != buffer.size())
+            return false;
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+
 void MNESourceEstimate::update_times()
 {
     if(data.cols() > 0)
@@ -149,6 +149,38 @@ public:
      */
     static bool read(QIODevice &p_IODevice, MNESourceEstimate& p_stc);
 
+    //=========================================================================================================
+    /**
+     * Reads a time window and optionally a subset of the sources from a given stc file. Only the requested part
+     * of the file is converted. Files are memory mapped if possible, other devices are read block by block.
+     *
+     * @param [in] p_IODevice    IO device to read the stc from.
+     * @param [out] p_stc        the read stc
+     * @param [in] start         The first sample to read.
+     * @param [in] n             The number of samples to read. -1 reads up to the last sample.
+     * @param [in] sel           The row indices of the sources to read. Reads all sources if empty.
+     *
+     * @return true if successful, false otherwise
+     */
+    static bool read(QIODevice &p_IODevice,
+                     MNESourceEstimate& p_stc,
+                     qint32 start,
+                     qint32 n = -1,
+                     const Eigen::VectorXi& sel = Eigen::VectorXi());
+
+    //=========================================================================================================
+    /**
+     * Reads only the header of a given stc file, i.e. tmin, tstep and the vertices. Use this to choose the time
+     * window and sources before reading them.
+     *
+     * @param [in] p_IODevice    IO device to read the stc header from.
+     * @param [out] p_stc        the stc holding the header information but no data
+     * @param [out] p_nTimePts   the number of samples stored in the file
+     *
+     * @return true if successful, false otherwise
+     */
+    static bool readHeader(QIODevice &p_IODevice, MNESourceEstimate& p_stc, qint32& p_nTimePts);
+
     //=========================================================================================================
     /**
      * mne_write_stc_file
@@ -159,6 +191,18 @@ public:
      */
     bool write(QIODevice &p_IODevice);
 
+    //=========================================================================================================
+    /**
+     * Appends the samples of this source estimate to a stc file, e.g. to stream a real-time source estimate to
+     * disk block by block. Writes a new file if the device is empty. Otherwise the vertices and tstep must match
+     * the ones in the file and the number of samples in the header is updated. The device needs random access.
+     *
+     * @param [in] p_IODevice   IO device to append the stc to.
+     *
+     * @return true if successful, false otherwise
+     */
+    bool append(QIODevice &p_IODevice);
+
     //=========================================================================================================
     /**
      * Returns whether SourceEstimate is empty.
@@ -209,6 +253,40 @@ private:
      * Update the times attribute after changing tmin, tmax, or tstep
      */
     void update_times();
+
+    //=========================================================================================================
+    /**
+     * Reads the header from an opened IO device positioned at the beginning of the stc.
+     *
+     * @param [in] p_IODevice    IO device to read the header from.
+     * @param [out] p_stc        the stc holding tmin, tstep and the vertices
+     * @param [out] p_nTimePts   the number of samples stored in the file
+     *
+     * @return true if successful, false otherwise
+     */
+    static bool readHeaderData(QIODevice &p_IODevice, MNESourceEstimate& p_stc, quint32& p_nTimePts);
+
+    //=========================================================================================================
+    /**
+     * Writes the header to an opened IO device.
+     *
+     * @param [in] p_IODevice   IO device to write the header to.
+     * @param [in] nTimePts     the number of samples to store in the header
+     *
+     * @return true if successful, false otherwise
+     */
+    bool writeHeaderData(QIODevice &p_IODevice, quint32 nTimePts) const;
+
+    //=========================================================================================================
+    /**
+     * Writes the data sample by sample as big endian floats to an opened IO device. The data is converted in
+     * blocks of samples.
+     *
+     * @param [in] p_IODevice   IO device to write the data to.
+     *
+     * @return true if successful, false otherwise
+     */
+    bool writeData(QIODevice &p_IODevice) const;
 };
 
 //=============================================================================================================
@@ -150,6 +150,12 @@ FiffEvoked RTPROCESSINGLIB::computeFilteredAverage(const FiffRawData& raw,
     QScopedPointer<MNEEpochData> epoch(Q_NULLPTR);
     int iFilterDelay = filterKernel.getFilterOrder()/2;
 
+    // Resolve the channels to scan for artifacts once for all epochs
+    MNEArtifactRejector rejector(raw.info,
+                                 mapReject,
+                                 lExcludeChs);
+    int iRejectChannel;
+
     for (p = 0; p < count; ++p) {
         // Read a data segment
         event_samp = matEvents(selected(p),0);
@@ -172,12 +178,10 @@ FiffEvoked RTPROCESSINGLIB::computeFilteredAverage(const FiffRawData& raw,
             epoch->tmin = fTMinS;
             epoch->tmax = fTMaxS;
 
-            epoch->bReject = MNEEpochDataList::checkForArtifact(epoch->epoch,
-                                                                raw.info,
-                                                                mapReject,
-                                                                lExcludeChs);
+            epoch->bReject = rejector.check(epoch->epoch, &iRejectChannel);
 
             if (epoch->bReject) {
+                qInfo().noquote() << "[RTPROCESSINGLIB::computeFilteredAverage] Reject trial because of channel"<<rejector.channelName(iRejectChannel);
                 dropCount++;
             }
 
@@ -43,6 +43,19 @@
 //=============================================================================================================
 
 #include <QMapIterator>
+#include <QDebug>
+
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -51,6 +64,28 @@
 using namespace Eigen;
 using namespace RTPROCESSINGLIB;
 
+//=============================================================================================================
+// DEFINE STATIC METHODS
+//=============================================================================================================
+
+static inline int countTrailingZeros(quint64 iWord)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long iIndex;
+    _BitScanForward64(&iIndex, iWord);
+    return static_cast<int>(iIndex);
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(iWord);
+#else
+    int iIndex = 0;
+    while(!(iWord & 1)) {
+        iWord >>= 1;
+        ++iIndex;
+    }
+    return iIndex;
+#endif
+}
+
 //=============================================================================================================
 // DEFINE RTPROCESSINGLIB GLOBAL METHODS
 //=============================================================================================================
@@ -256,3 +291,139 @@ QList<QPair<int,double> > RTPROCESSINGLIB::detectTriggerFlanksGrad(const MatrixX
 
     return lDetectedTriggers;
 }
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+TriggerDetector::TriggerDetector(const QList<int>& lTriggerChannels,
+                                 double dThreshold,
+                                 bool bRemoveOffset,
+                                 int iBurstLengthSamp)
+: m_lTriggerChannels(lTriggerChannels)
+, m_dThreshold(dThreshold)
+, m_bRemoveOffset(bRemoveOffset)
+, m_iBurstLengthSamp(std::max(0, iBurstLengthSamp))
+, m_iNumEvents(0)
+{
+    reset();
+}
+
+//=============================================================================================================
+
+int TriggerDetector::detect(const MatrixXd& matData,
+                            int iFirstSample)
+{
+    const int iNumSamples = matData.cols();
+    const int iNumEventsBefore = m_iNumEvents;
+
+    if(iNumSamples == 0) {
+        return 0;
+    }
+
+    for(int c = 0; c < m_lTriggerChannels.size(); ++c) {
+        const int iChIdx = m_lTriggerChannels.at(c);
+
+        if(iChIdx >= matData.rows() || iChIdx < 0) {
+            qWarning() << "[TriggerDetector::detect] Trigger channel" << iChIdx << "is not part of the data.";
+            continue;
+        }
+
+        // The rows of the column major data are strided, copy the channel once so the compare below runs on
+        // contiguous memory
+        m_vecRow = matData.row(iChIdx);
+        const double* pRow = m_vecRow.data();
+
+        if(m_bFirstBlock && m_bRemoveOffset) {
+            m_vecOffsets[c] = pRow[0];
+        }
+
+        const double dLevel = m_dThreshold + m_vecOffsets.at(c);
+        quint64 iCarry = m_vecLastAbove.at(c) ? 1 : 0;
+        qint64 iHoldUntil = m_vecHoldUntil.at(c);
+
+        for(int iWordStart = 0; iWordStart < iNumSamples; iWordStart += 64) {
+            const int iWordLength = std::min(64, iNumSamples - iWordStart);
+            const double* pWord = pRow + iWordStart;
+
+            // Branch free threshold compare into one bit per sample
+            quint64 iAbove = 0;
+            for(int k = 0; k < iWordLength; ++k) {
+                iAbove |= quint64(pWord[k] >= dLevel) << k;
+            }
+
+            // A flank is a sample above the threshold whose predecessor is below
+            quint64 iFlanks = iAbove & ~((iAbove << 1) | iCarry);
+            iCarry = (iAbove >> (iWordLength - 1)) & 1;
+
+            while(iFlanks) {
+                const int k = countTrailingZeros(iFlanks);
+                iFlanks &= iFlanks - 1;
+
+                const qint64 iSample = qint64(iFirstSample) + iWordStart + k;
+                if(iSample < iHoldUntil) {
+                    continue;
+                }
+
+                if(m_iNumEvents == m_matEvents.rows()) {
+                    m_matEvents.conservativeResize(std::max(1024, 2 * m_iNumEvents), 3);
+                }
+
+                m_matEvents(m_iNumEvents, 0) = static_cast<int>(iSample);
+                m_matEvents(m_iNumEvents, 1) = iChIdx;
+                m_matEvents(m_iNumEvents, 2) = static_cast<int>(std::lround(pWord[k]));
+                ++m_iNumEvents;
+
+                iHoldUntil = iSample + m_iBurstLengthSamp + 1;
+            }
+        }
+
+        m_vecLastAbove[c] = iCarry != 0;
+        m_vecHoldUntil[c] = iHoldUntil;
+    }
+
+    m_bFirstBlock = false;
+
+    return m_iNumEvents - iNumEventsBefore;
+}
+
+//=============================================================================================================
+
+void TriggerDetector::reserve(int iNumEvents)
+{
+    if(iNumEvents > m_matEvents.rows()) {
+        m_matEvents.conservativeResize(iNumEvents, 3);
+    }
+}
+
+//=============================================================================================================
+
+void TriggerDetector::clearEvents()
+{
+    m_iNumEvents = 0;
+}
+
+//=============================================================================================================
+
+void TriggerDetector::reset()
+{
+    m_iNumEvents = 0;
+    m_bFirstBlock = true;
+    m_vecOffsets.fill(0.0, m_lTriggerChannels.size());
+    m_vecLastAbove.fill(false, m_lTriggerChannels.size());
+    m_vecHoldUntil.fill(std::numeric_limits<qint64>::min(), m_lTriggerChannels.size());
+}
+
+//=============================================================================================================
+
+int TriggerDetector::numEvents() const
+{
+    return m_iNumEvents;
+}
+
+//=============================================================================================================
+
+Ref<const MatrixXi> TriggerDetector::events() const
+{
+    return m_matEvents.topRows(m_iNumEvents);
+}
@@ -46,6 +46,9 @@
 //=============================================================================================================
 
 #include <QPair>
+#include <QList>
+#include <QVector>
+#include <QSharedPointer>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -160,6 +163,99 @@ RTPROCESINGSHARED_EXPORT QList<QPair<int,double> > detectTriggerFlanksGrad(const
                                                                            const QString& type,
                                                                            int iBurstLengthSamp = 100);
 
+//=============================================================================================================
+/**
+ * Detects rising trigger flanks in continous data streams. All trigger channels are scanned block wise: each
+ * channel is compared against the threshold into a bit mask of 64 samples, the flanks are masked out with a shift
+ * and visited by bit scanning. The last threshold state and the burst hold off of every channel are kept between
+ * blocks, so flanks at block boundaries are neither lost nor reported twice.
+ *
+ * The events are written into a preallocated buffer with one row per event: sample, trigger channel index and
+ * rounded signal value.
+ *
+ * @brief Block wise trigger flank detection for continous data streams.
+ */
+class RTPROCESINGSHARED_EXPORT TriggerDetector
+{
+public:
+    typedef QSharedPointer<TriggerDetector> SPtr;             /**< Shared pointer type for TriggerDetector. */
+    typedef QSharedPointer<const TriggerDetector> ConstSPtr;  /**< Const shared pointer type for TriggerDetector. */
+
+    //=========================================================================================================
+    /**
+     * Constructs a TriggerDetector.
+     *
+     * @param[in] lTriggerChannels  The indices of the trigger channels.
+     * @param[in] dThreshold        The signal threshold value used to find the trigger flanks.
+     * @param[in] bRemoveOffset     Whether to remove the first sample of the stream as offset.
+     * @param[in] iBurstLengthSamp  The number of samples which are skipped after a trigger was found.
+     */
+    TriggerDetector(const QList<int>& lTriggerChannels = QList<int>(),
+                    double dThreshold = 0.0,
+                    bool bRemoveOffset = false,
+                    int iBurstLengthSamp = 100);
+
+    //=========================================================================================================
+    /**
+     * Detects the rising trigger flanks in the next block of the stream and appends them to the event buffer.
+     * Within a block the events are ordered by channel and then by sample.
+     *
+     * @param[in] matData       The next data block (channels x samples).
+     * @param[in] iFirstSample  The sample index of the first column of matData.
+     *
+     * @return The number of new events.
+     */
+    int detect(const Eigen::MatrixXd& matData,
+               int iFirstSample);
+
+    //=========================================================================================================
+    /**
+     * Reserves space in the event buffer.
+     *
+     * @param[in] iNumEvents    The number of events to reserve space for.
+     */
+    void reserve(int iNumEvents);
+
+    //=========================================================================================================
+    /**
+     * Removes the events from the buffer. The state of the stream and the capacity of the buffer are kept.
+     */
+    void clearEvents();
+
+    //=========================================================================================================
+    /**
+     * Removes the events and resets the state of the stream, e.g. to restart at another position.
+     */
+    void reset();
+
+    //=========================================================================================================
+    /**
+     * @return The number of events in the buffer.
+     */
+    int numEvents() const;
+
+    //=========================================================================================================
+    /**
+     * @return The events in the buffer (events x 3) holding sample, trigger channel index and signal value.
+     */
+    Eigen::Ref<const Eigen::MatrixXi> events() const;
+
+private:
+    QList<int>          m_lTriggerChannels;     /**< The indices of the trigger channels. */
+    double              m_dThreshold;           /**< The signal threshold value. */
+    bool                m_bRemoveOffset;        /**< Whether to remove the first sample of the stream as offset. */
+    int                 m_iBurstLengthSamp;     /**< The number of samples which are skipped after a trigger. */
+
+    bool                m_bFirstBlock;          /**< Whether the next block is the first of the stream. */
+    QVector<double>     m_vecOffsets;           /**< The offset of each trigger channel. */
+    QVector<bool>       m_vecLastAbove;         /**< Whether the last sample of each trigger channel was above the threshold. */
+    QVector<qint64>     m_vecHoldUntil;         /**< The first sample at which each trigger channel may trigger again. */
+
+    Eigen::RowVectorXd  m_vecRow;               /**< Contiguous copy of the currently scanned channel. */
+    Eigen::MatrixXi     m_matEvents;            /**< The event buffer. Only the first m_iNumEvents rows are valid. */
+    int                 m_iNumEvents;           /**< The number of events in the buffer. */
+};
+
 //=============================================================================================================
 // INLINE DEFINITIONS
 //=============================================================================================================
@@ -84,6 +84,7 @@ RtAveragingWorker::RtAveragingWorker(quint32 numAverages,
 , m_fTriggerThreshold(0.5f)
 , m_iTriggerChIndex(-1)
 , m_iNewTriggerIndex(iTriggerIndex)
+, m_iStreamSample(0)
 , m_bDoBaselineCorrection(false)
 , m_pairBaselineSec(qMakePair(float(iBaselineFromMSecs),float(iBaselineToMSecs)))
 , m_bActivateThreshold(false)
@@ -92,6 +93,8 @@ RtAveragingWorker::RtAveragingWorker(quint32 numAverages,
 
     m_stimEvokedSet.info = *m_pFiffInfo.data();
 
+    m_artifactRejector.setup(*m_pFiffInfo, m_mapThresholds);
+
     m_iNewPreStimSamples = m_iPreStimSamples;
     m_iNewPostStimSamples = m_iPostStimSamples;
 
@@ -182,6 +185,10 @@ void RtAveragingWorker::setArtifactReduction(const QMap<QString, double> &mapThr
     }
 
     m_mapThresholds = mapThresholds;
+
+    if(m_pFiffInfo) {
+        m_artifactRejector.setup(*m_pFiffInfo, m_mapThresholds);
+    }
 }
 
 //=============================================================================================================
@@ -231,8 +238,18 @@ void RtAveragingWorker::setBaselineTo(int toSamp,
 
 void RtAveragingWorker::doAveraging(const MatrixXd& rawSegment)
 {
-    //Detect trigger
-    QList<QPair<int,double> > lDetectedTriggers = RTPROCESSINGLIB::detectTriggerFlanksMax(rawSegment, m_iTriggerChIndex, 0, m_fTriggerThreshold, true);
+    //Detect trigger. The detector keeps its state between blocks, so flanks at block borders are found exactly once
+    m_triggerDetector.clearEvents();
+    m_triggerDetector.detect(rawSegment, m_iStreamSample);
+
+    const Eigen::Ref<const Eigen::MatrixXi> matEvents = m_triggerDetector.events();
+    QList<QPair<int,double> > lDetectedTriggers;
+
+    for(int i = 0; i < matEvents.rows(); ++i) {
+        lDetectedTriggers.append(qMakePair(matEvents(i,0) - m_iStreamSample, double(matEvents(i,2))));
+    }
+
+    m_iStreamSample += rawSegment.cols();
 
     //TODO: This does not permit the same trigger type twice in one data block
     for(int i = 0; i < lDetectedTriggers.size(); ++i) {
@@ -433,9 +450,12 @@ void RtAveragingWorker::mergeData(double dTriggerType)
     if(m_bActivateThreshold && m_pFiffInfo) {
         qDebug() << "[RtAveragingWorker::mergeData] Doing artifact reduction for" << m_mapThresholds;
 
-        bArtifactDetected = MNEEpochDataList::checkForArtifact(mergedData,
-                                                               *m_pFiffInfo,
-                                                               m_mapThresholds);
+        int iRejectChannel;
+        bArtifactDetected = m_artifactRejector.check(mergedData, &iRejectChannel);
+
+        if(bArtifactDetected) {
+            qInfo().noquote() << "[RtAveragingWorker::mergeData] Reject trial because of channel"<<m_artifactRejector.channelName(iRejectChannel);
+        }
     }
 
     if(!bArtifactDetected) {
@@ -526,6 +546,15 @@ void RtAveragingWorker::reset()
     m_iPostStimSamples = m_iNewPostStimSamples;
     m_iTriggerChIndex = m_iNewTriggerIndex;
 
+    //Restart the trigger detection, the first sample of the stream is removed as offset
+    QList<int> lTriggerChannels;
+    if(m_iTriggerChIndex >= 0) {
+        lTriggerChannels << m_iTriggerChIndex;
+    }
+
+    m_triggerDetector = TriggerDetector(lTriggerChannels, m_fTriggerThreshold, true);
+    m_iStreamSample = 0;
+
     //Clear all evoked data information
     m_stimEvokedSet.evoked.clear();
 
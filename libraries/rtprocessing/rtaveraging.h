@@ -41,10 +41,13 @@
 //=============================================================================================================
 
 #include "rtprocessing_global.h"
+#include "detecttrigger.h"
 
 #include <fiff/fiff_evoked_set.h>
 #include <fiff/fiff_info.h>
 
+#include <mne/mne_artifact_rejector.h>
+
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
@@ -246,6 +249,9 @@ protected:
 
     float                                           m_fTriggerThreshold;        /**< Threshold to detect trigger */
 
+    TriggerDetector                                 m_triggerDetector;          /**< Detects the trigger flanks across the incoming blocks. */
+    int                                             m_iStreamSample;            /**< Stream sample index of the first column of the next block. */
+
     bool                                            m_bActivateThreshold;       /**< Whether to do threshold artifact reduction or not. */
 
     bool                                            m_bDoBaselineCorrection;    /**< Whether to perform baseline correction. */
@@ -257,6 +263,7 @@ protected:
     FIFFLIB::FiffEvokedSet                          m_stimEvokedSet;            /**< Holds the evoked information. */
 
     QMap<QString,double>                            m_mapThresholds;            /**< Holds the current thresholds for artifact rejection. */
+    MNELIB::MNEArtifactRejector                     m_artifactRejector;         /**< The artifact rejector built from m_mapThresholds. */
     QMap<double,QList<Eigen::MatrixXd> >            m_mapStimAve;               /**< the current stimulus average buffer. Holds m_iNumAverages vectors */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPre;               /**< The matrix holding pre stim data. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPost;              /**< The matrix holding post stim data. */
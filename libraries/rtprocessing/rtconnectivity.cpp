@@ -77,12 +77,31 @@ void RtConnectivityWorker::doWork(const ConnectivitySettings &connectivitySettin
 
     ConnectivitySettings connectivitySettingsTemp = connectivitySettings;
 
+    // In streaming mode the incoming settings only carry the new trials. Continue from the running sums kept
+    // here so that they do not need to be passed back and forth through the queued connection.
+    bool bStreamingMode = connectivitySettingsTemp.isStreamingModeActive();
+
+    if(bStreamingMode) {
+        if(!connectivitySettingsTemp.isEmpty() &&
+           !m_streamingSumData.vecPairCsdSum.isEmpty() &&
+           m_streamingSumData.vecPairCsdSum.size() != connectivitySettingsTemp.at(0).matData.rows()) {
+            qDebug() << "RtConnectivityWorker::doWork - Number of nodes changed. Resetting running sums.";
+            m_streamingSumData = ConnectivitySettings::IntermediateSumData();
+        }
+
+        std::swap(connectivitySettingsTemp.getIntermediateSumData(), m_streamingSumData);
+    }
+
     QElapsedTimer time;
     qint64 iTime = 0;
     time.start();
 
     QList<Network> finalNetworks = Connectivity::calculate(connectivitySettingsTemp);
 
+    if(bStreamingMode) {
+        std::swap(connectivitySettingsTemp.getIntermediateSumData(), m_streamingSumData);
+    }
+
 //    iTime = time.elapsed();
 
 //    qDebug()<<"----------------------------------------";
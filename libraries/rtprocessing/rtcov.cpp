@@ -40,13 +40,14 @@
 
 #include "rtcov.h"
 
+#include <cmath>
+
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -63,6 +64,8 @@ using namespace Eigen;
 RtCov::RtCov(QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo)
 : m_fiffInfo(*pFiffInfo)
 , m_iSamples(0)
+, m_dWeight(0.0)
+, m_bExponentialForgetting(false)
 {
 }
 
@@ -76,24 +79,42 @@ FiffCov RtCov::estimateCovariance(const Eigen::MatrixXd& matData,
         return FiffCov();
     }
 
-    m_lData.append(matData);
+    if(matData.cols() == 0) {
+        return FiffCov();
+    }
+
+    if(m_vecMean.size() != matData.rows()) {
+        m_vecMean.setZero(matData.rows());
+        m_matM2.setZero(matData.rows(), matData.rows());
+        m_dWeight = 0.0;
+        m_iSamples = 0;
+    }
+
+    // Down-weight the accumulated samples by the age of the new block
+    if(m_bExponentialForgetting && iNewMaxSamples > 0) {
+        const double dDecay = std::exp(-double(matData.cols()) / double(iNewMaxSamples));
+        m_dWeight *= dDecay;
+        m_matM2.triangularView<Lower>() *= dDecay;
+    }
+
+    accumulate(matData);
     m_iSamples += matData.cols();
 
     if(m_iSamples < iNewMaxSamples) {
         return FiffCov();
     }
 
-    QFuture<RtCovComputeResult> result = QtConcurrent::mappedReduced(m_lData,
-                                                                     compute,
-                                                                     reduce);
+    m_iSamples = 0;
 
-    result.waitForFinished();
-
-    RtCovComputeResult finalResult = result.result();
+    if(m_dWeight <= 1.0) {
+        qWarning() << "[RtCov::estimateCovariance] Number of samples too small. Regularization not possible. Returning empty covariance estimation.";
+        return FiffCov();
+    }
 
     //Final computation
     FiffCov computedCov;
-    computedCov.data = finalResult.matData;
+    computedCov.data = m_matM2.selfadjointView<Lower>();
+    computedCov.data /= (m_dWeight - 1.0);
 
     QStringList exclude;
     for(int i = 0; i<m_fiffInfo.chs.size(); i++) {
@@ -104,65 +125,61 @@ FiffCov RtCov::estimateCovariance(const Eigen::MatrixXd& matData,
     }
     bool doProj = true;
 
-    if(m_iSamples > 0) {
-        finalResult.mu /= (float)m_iSamples;
-        computedCov.data.array() -= m_iSamples * (finalResult.mu * finalResult.mu.transpose()).array();
-        computedCov.data.array() /= (m_iSamples - 1);
+    computedCov.kind = FIFFV_MNE_NOISE_COV;
+    computedCov.diag = false;
+    computedCov.dim = computedCov.data.rows();
 
-        computedCov.kind = FIFFV_MNE_NOISE_COV;
-        computedCov.diag = false;
-        computedCov.dim = computedCov.data.rows();
+    //ToDo do picks
+    computedCov.names = m_fiffInfo.ch_names;
+    computedCov.projs = m_fiffInfo.projs;
+    computedCov.bads = m_fiffInfo.bads;
+    computedCov.nfree = qRound(m_dWeight);
 
-        //ToDo do picks
-        computedCov.names = m_fiffInfo.ch_names;
-        computedCov.projs = m_fiffInfo.projs;
-        computedCov.bads = m_fiffInfo.bads;
-        computedCov.nfree = m_iSamples;
+    // regularize noise covariance
+    computedCov = computedCov.regularize(m_fiffInfo, 0.05, 0.05, 0.1, doProj, exclude);
 
-        // regularize noise covariance
-        computedCov = computedCov.regularize(m_fiffInfo, 0.05, 0.05, 0.1, doProj, exclude);
-
-//            qint32 samples = rawSegment.cols();
-//            VectorXf mu = rawSegment.rowwise().sum().array() / (float)samples;
-
-//            MatrixXf noise_covariance = rawSegment * rawSegment.transpose();// noise_covariance == raw_covariance
-//            noise_covariance.array() -= samples * (mu * mu.transpose()).array();
-//            noise_covariance.array() /= (samples - 1);
-
-//            std::cout << "Noise Covariance:\n" << noise_covariance.block(0,0,10,10) << std::endl;
-
-//            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
+    if(!m_bExponentialForgetting) {
+        reset();
+    }
 
-        m_lData.clear();
-        m_iSamples = 0;
+    return computedCov;
+}
 
-        return computedCov;
-    } else {
-        qWarning() << "[RtCov::estimateCovariance] Number of samples equals zero. Regularization not possible. Returning empty covariance estimation.";
-        return FiffCov();
-    }
+//=============================================================================================================
 
+void RtCov::setExponentialForgetting(bool bExponentialForgetting)
+{
+    m_bExponentialForgetting = bExponentialForgetting;
 }
 
 //=============================================================================================================
 
-RtCovComputeResult RtCov::compute(const MatrixXd &matData)
+void RtCov::reset()
 {
-    RtCovComputeResult result;
-    result.mu = matData.rowwise().sum();
-    result.matData = matData * matData.transpose();
-    return result;
+    m_vecMean.setZero();
+    m_matM2.setZero();
+    m_dWeight = 0.0;
+    m_iSamples = 0;
 }
 
 //=============================================================================================================
 
-void RtCov::reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult)
+void RtCov::accumulate(const MatrixXd &matData)
 {
-    if(finalResult.matData.size() == 0 || finalResult.mu.size() == 0) {
-        finalResult.mu = tempResult.mu;
-        finalResult.matData = tempResult.matData;
-    } else {
-        finalResult.mu += tempResult.mu;
-        finalResult.matData += tempResult.matData;
+    const double dBlockWeight = matData.cols();
+    const double dTotalWeight = m_dWeight + dBlockWeight;
+
+    // Sum of squared deviations of the block from its own mean, rank-k update of the lower triangle
+    VectorXd vecBlockMean = matData.rowwise().mean();
+    MatrixXd matCentered = matData.colwise() - vecBlockMean;
+    m_matM2.selfadjointView<Lower>().rankUpdate(matCentered);
+
+    // Merge with the accumulated statistics (Chan et al.)
+    VectorXd vecDelta = vecBlockMean - m_vecMean;
+    if(m_dWeight > 0.0) {
+        m_matM2.selfadjointView<Lower>().rankUpdate(vecDelta, m_dWeight * dBlockWeight / dTotalWeight);
     }
+    m_vecMean += vecDelta * (dBlockWeight / dTotalWeight);
+
+    m_dWeight = dTotalWeight;
 }
@@ -77,14 +77,12 @@ namespace RTPROCESSINGLIB
 // RTPROCESSINGLIB FORWARD DECLARATIONS
 //=============================================================================================================
 
-struct RtCovComputeResult {
-    Eigen::VectorXd mu;
-    Eigen::MatrixXd matData;
-};
-
 //=============================================================================================================
 /**
- * Real-time covariance worker.
+ * Real-time covariance worker. Incoming blocks are folded into a running mean and a running sum of squared
+ * deviations as they arrive (pairwise Welford update), so memory is O(channels^2) regardless of the estimation
+ * window. Only the lower triangle is updated. In exponential forgetting mode, the accumulator is not reset after
+ * an estimate was returned, instead older samples are down-weighted with a time constant of iNewMaxSamples.
  *
  * @brief Real-time covariance worker.
  */
@@ -99,34 +97,44 @@ public:
     /**
      * Perform actual covariance estimation.
      *
-     * @param[in] inputData  Data to estimate the covariance from.
+     * @param[in] matData            Data to estimate the covariance from.
+     * @param[in] iNewMaxSamples     Number of samples after which an estimate is returned. In exponential forgetting
+     *                               mode also the time constant of the forgetting.
+     *
+     * @return The covariance estimate, empty if fewer than iNewMaxSamples samples arrived since the last estimate.
      */
     FIFFLIB::FiffCov estimateCovariance(const Eigen::MatrixXd& matData,
                                         int iNewMaxSamples);
 
-protected:
     //=========================================================================================================
     /**
-     * Computer multiplication with transposed.
-     *
-     * @param[in] matData  Data to self multiply with.
+     * Sets whether older samples are exponentially forgotten instead of discarding all samples after each estimate.
      *
-     * @return   The multiplication result.
+     * @param[in] bExponentialForgetting     Whether to use exponential forgetting.
      */
-    static RtCovComputeResult compute(const Eigen::MatrixXd &matData);
+    void setExponentialForgetting(bool bExponentialForgetting);
 
     //=========================================================================================================
     /**
-     * Computer multiplication with transposed.
+     * Discards all accumulated samples.
+     */
+    void reset();
+
+protected:
+    //=========================================================================================================
+    /**
+     * Folds a data block into the running mean and the running sum of squared deviations.
      *
-     * @param[out]   finalResult     The final covariance estimation.
-     * @param[in]    tempResult      The intermediate result from the compute function
+     * @param[in] matData  The data block <n_channels x n_samples>.
      */
-    static void reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult);
+    void accumulate(const Eigen::MatrixXd &matData);
 
-    int                     m_iSamples;                 /**< The number of stored samples. */
+    int                     m_iSamples;                 /**< The number of samples since the last estimate. */
+    double                  m_dWeight;                  /**< The (effective) number of accumulated samples. */
+    bool                    m_bExponentialForgetting;   /**< Whether older samples are exponentially forgotten. */
 
-    QList<Eigen::MatrixXd>  m_lData;                    /**< The stored data blocks. */
+    Eigen::VectorXd         m_vecMean;                  /**< The running mean. */
+    Eigen::MatrixXd         m_matM2;                    /**< The running sum of squared deviations from the mean. Only the lower triangle is used. */
 
     FIFFLIB::FiffInfo       m_fiffInfo;                 /**< Holds the fiff measurement information. */
 };
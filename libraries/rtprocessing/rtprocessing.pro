@@ -89,6 +89,7 @@ SOURCES += \
     filter.cpp \
     rtconnectivity.cpp \
     sphara.cpp \
+    spatialoperator.cpp \
     detecttrigger.cpp \
     helpers/cosinefilter.cpp \
     helpers/parksmcclellan.cpp \
@@ -107,6 +108,7 @@ HEADERS +=  \
     filter.h \
     detecttrigger.h \
     sphara.h \
+    spatialoperator.h \
     rtconnectivity.h \
     helpers/cosinefilter.h \
     helpers/parksmcclellan.h \
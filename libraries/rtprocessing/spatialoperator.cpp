@@ -0,0 +1,368 @@
+//=============================================================================================================
+/**
+ * @file     spatialoperator.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Definition of the SpatialOperator class.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "spatialoperator.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+#include <QVector>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+SpatialOperator::SpatialOperator()
+: m_bCompActive(false)
+, m_bProjActive(false)
+, m_bSpharaActive(false)
+, m_bDirty(false)
+, m_bCommuteValid(false)
+, m_bCommutes(true)
+{
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setCompensator(const MatrixXd& matComp)
+{
+    m_matComp = toSparse(matComp);
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setProjector(const MatrixXd& matProj)
+{
+    m_matProj = toSparse(matProj);
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setSphara(const MatrixXd& matSphara)
+{
+    m_matSphara = toSparse(matSphara);
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setBadChannels(const VectorXi& vecBadIdx)
+{
+    m_vecBadIdx = vecBadIdx;
+    m_bDirty = true;
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setCompensatorActive(bool bActive)
+{
+    if(m_bCompActive != bActive) {
+        m_bCompActive = bActive;
+        m_bDirty = true;
+    }
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setProjectorActive(bool bActive)
+{
+    if(m_bProjActive != bActive) {
+        m_bProjActive = bActive;
+        m_bDirty = true;
+    }
+}
+
+//=============================================================================================================
+
+void SpatialOperator::setSpharaActive(bool bActive)
+{
+    if(m_bSpharaActive != bActive) {
+        m_bSpharaActive = bActive;
+        m_bDirty = true;
+    }
+}
+
+//=============================================================================================================
+
+bool SpatialOperator::isIdentity()
+{
+    if(m_bDirty) {
+        update();
+    }
+
+    return m_op.bIdentity;
+}
+
+//=============================================================================================================
+
+bool SpatialOperator::commutesWith(const RowVectorXi& vecChannels)
+{
+    if(m_bDirty) {
+        update();
+    }
+
+    if(m_preFilterOp.bIdentity || vecChannels.size() == 0) {
+        return true;
+    }
+
+    if(m_bCommuteValid
+       && m_vecCommuteChannels.size() == vecChannels.size()
+       && m_vecCommuteChannels == vecChannels) {
+        return m_bCommutes;
+    }
+
+    const ComposedOperator& op = m_preFilterOp;
+    const int iNumChannels = op.bUseDense ? int(op.matDense.rows()) : int(op.matSparse.rows());
+
+    QVector<bool> vecFiltered(iNumChannels, false);
+    for(int i = 0; i < vecChannels.size(); ++i) {
+        if(vecChannels[i] >= 0 && vecChannels[i] < iNumChannels) {
+            vecFiltered[vecChannels[i]] = true;
+        }
+    }
+
+    // A per-channel filter commutes with the compensator and projector as long as no output channel mixes
+    // filtered and unfiltered inputs. SPHARA runs after the filter anyway.
+    m_bCommutes = true;
+
+    if(op.bUseDense) {
+        for(int j = 0; j < op.matDense.cols() && m_bCommutes; ++j) {
+            for(int i = 0; i < op.matDense.rows(); ++i) {
+                if(op.matDense(i,j) != 0.0 && vecFiltered[i] != vecFiltered[j]) {
+                    m_bCommutes = false;
+                    break;
+                }
+            }
+        }
+    } else {
+        for(int k = 0; k < op.matSparse.outerSize() && m_bCommutes; ++k) {
+            for(SparseMatrix<double>::InnerIterator it(op.matSparse, k); it; ++it) {
+                if(vecFiltered[it.row()] != vecFiltered[it.col()]) {
+                    m_bCommutes = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    m_vecCommuteChannels = vecChannels;
+    m_bCommuteValid = true;
+
+    return m_bCommutes;
+}
+
+//=============================================================================================================
+
+void SpatialOperator::apply(MatrixXd& matData)
+{
+    if(m_bDirty) {
+        update();
+    }
+
+    multiply(m_op, matData);
+}
+
+//=============================================================================================================
+
+void SpatialOperator::applyPreFilter(MatrixXd& matData)
+{
+    if(m_bDirty) {
+        update();
+    }
+
+    multiply(m_preFilterOp, matData);
+}
+
+//=============================================================================================================
+
+void SpatialOperator::applyPostFilter(MatrixXd& matData)
+{
+    if(m_bDirty) {
+        update();
+    }
+
+    multiply(m_postFilterOp, matData);
+}
+
+//=============================================================================================================
+
+void SpatialOperator::update()
+{
+    m_bDirty = false;
+    m_bCommuteValid = false;
+
+    auto compose = [](SparseMatrix<double>& matOp, const SparseMatrix<double>& matStage) {
+        if(matStage.size() == 0) {
+            return;
+        }
+
+        if(matOp.size() == 0) {
+            matOp = matStage;
+        } else if(matStage.cols() != matOp.rows()) {
+            qWarning() << "[SpatialOperator::update] Stage dimensions" << matStage.rows() << "x" << matStage.cols() << "do not match the operator. Skipping.";
+        } else {
+            matOp = (matStage * matOp).pruned();
+        }
+    };
+
+    // Stages in front of the filter
+    SparseMatrix<double> matPreFilter;
+
+    if(m_bCompActive) {
+        compose(matPreFilter, m_matComp);
+    }
+
+    if(m_bProjActive) {
+        compose(matPreFilter, m_matProj);
+    }
+
+    // Stages after the filter
+    SparseMatrix<double> matPostFilter;
+
+    if(m_bSpharaActive && m_matSphara.size() > 0) {
+        // Masking the bad rows of the input is the same as zeroing the matching SPHARA columns
+        SparseMatrix<double> matSphara = m_matSphara;
+        for(int i = 0; i < m_vecBadIdx.size(); ++i) {
+            if(m_vecBadIdx[i] >= 0 && m_vecBadIdx[i] < matSphara.cols()) {
+                matSphara.col(m_vecBadIdx[i]) *= 0.0;
+            }
+        }
+        compose(matPostFilter, matSphara.pruned());
+    }
+
+    SparseMatrix<double> matOp = matPreFilter;
+    compose(matOp, matPostFilter);
+
+    store(matOp, m_op);
+    store(matPreFilter, m_preFilterOp);
+    store(matPostFilter, m_postFilterOp);
+}
+
+//=============================================================================================================
+
+SparseMatrix<double> SpatialOperator::toSparse(const MatrixXd& matDense)
+{
+    typedef Eigen::Triplet<double> T;
+    std::vector<T> tripletList;
+    tripletList.reserve(matDense.rows()*matDense.cols());
+
+    for(int i = 0; i < matDense.rows(); ++i) {
+        for(int k = 0; k < matDense.cols(); ++k) {
+            if(matDense(i,k) != 0) {
+                tripletList.push_back(T(i, k, matDense(i,k)));
+            }
+        }
+    }
+
+    SparseMatrix<double> matSparse(matDense.rows(), matDense.cols());
+    if(tripletList.size() > 0) {
+        matSparse.setFromTriplets(tripletList.begin(), tripletList.end());
+    }
+
+    return matSparse;
+}
+
+//=============================================================================================================
+
+void SpatialOperator::store(const SparseMatrix<double>& matOp,
+                            ComposedOperator& op)
+{
+    op.bIdentity = matOp.size() == 0;
+
+    if(op.bIdentity) {
+        op.matSparse.resize(0,0);
+        op.matDense.resize(0,0);
+        return;
+    }
+
+    // Sparse products only pay off for fairly sparse operators, since the dense product is vectorized. SSP
+    // projectors on MEG are typically dense within the MEG block.
+    const double dDenseThreshold = 0.2;
+    const double dDensity = double(matOp.nonZeros()) / (double(matOp.rows()) * double(matOp.cols()));
+
+    op.bUseDense = dDensity > dDenseThreshold;
+
+    if(op.bUseDense) {
+        op.matDense = MatrixXd(matOp);
+        op.matSparse.resize(0,0);
+    } else {
+        op.matSparse = matOp;
+        op.matSparse.makeCompressed();
+        op.matDense.resize(0,0);
+    }
+}
+
+//=============================================================================================================
+
+void SpatialOperator::multiply(const ComposedOperator& op,
+                               MatrixXd& matData)
+{
+    if(op.bIdentity) {
+        return;
+    }
+
+    const Index iNumCols = op.bUseDense ? op.matDense.cols() : op.matSparse.cols();
+
+    if(matData.rows() != iNumCols) {
+        qWarning() << "[SpatialOperator::apply] Data has" << matData.rows() << "channels but the operator expects" << iNumCols << ". Returning.";
+        return;
+    }
+
+    if(op.bUseDense) {
+        m_matBuffer.noalias() = op.matDense * matData;
+    } else {
+        m_matBuffer.noalias() = op.matSparse * matData;
+    }
+
+    matData.swap(m_matBuffer);
+}
@@ -0,0 +1,251 @@
+//=============================================================================================================
+/**
+ * @file     spatialoperator.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Declaration of the SpatialOperator class.
+ *
+ */
+
+#ifndef SPATIALOPERATOR_RTPROCESSING_H
+#define SPATIALOPERATOR_RTPROCESSING_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rtprocessing_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+//=============================================================================================================
+// DEFINE NAMESPACE RTPROCESSINGLIB
+//=============================================================================================================
+
+namespace RTPROCESSINGLIB
+{
+
+//=============================================================================================================
+/**
+ * Composes the linear spatial preprocessing steps of a real-time pipeline (CTF compensation, SSP projection,
+ * bad channel masking and SPHARA) into a single operator
+ *
+ *     A = Sphara * Mask * Proj * Comp.
+ *
+ * The product is rebuilt lazily the first time it is needed after one of its stages changed. It is stored
+ * sparse or dense, whichever makes the per block multiplication cheaper, so that every block costs exactly
+ * one matrix product regardless of how many stages are active.
+ *
+ * In a pipeline with a temporal filter, compensation and projection run in front of the filter and SPHARA
+ * after it. The two parts are therefore also kept separately, so they can be applied around the filter if
+ * the compensator or projector mix filtered and unfiltered channels.
+ *
+ * @brief Composed compensator, projector, bad channel mask and SPHARA operator.
+ */
+class RTPROCESINGSHARED_EXPORT SpatialOperator
+{
+public:
+    typedef QSharedPointer<SpatialOperator> SPtr;             /**< Shared pointer type for SpatialOperator. */
+    typedef QSharedPointer<const SpatialOperator> ConstSPtr;  /**< Const shared pointer type for SpatialOperator. */
+
+    //=========================================================================================================
+    /**
+     * Constructs an identity SpatialOperator.
+     */
+    SpatialOperator();
+
+    //=========================================================================================================
+    /**
+     * Sets the compensator matrix.
+     *
+     * @param[in] matComp    The compensator (nchan x nchan).
+     */
+    void setCompensator(const Eigen::MatrixXd& matComp);
+
+    //=========================================================================================================
+    /**
+     * Sets the SSP projector. Columns of bad channels should already be zeroed.
+     *
+     * @param[in] matProj    The projector (nchan x nchan).
+     */
+    void setProjector(const Eigen::MatrixXd& matProj);
+
+    //=========================================================================================================
+    /**
+     * Sets the SPHARA operator. Bad channels are zeroed in front of it so they do not get smeared into their
+     * neighbours.
+     *
+     * @param[in] matSphara  The SPHARA operator (nchan x nchan).
+     */
+    void setSphara(const Eigen::MatrixXd& matSphara);
+
+    //=========================================================================================================
+    /**
+     * Sets the indices of the bad channels. These are masked in front of the SPHARA stage.
+     *
+     * @param[in] vecBadIdx  The bad channel indices.
+     */
+    void setBadChannels(const Eigen::VectorXi& vecBadIdx);
+
+    //=========================================================================================================
+    /**
+     * Switches the individual stages on or off without touching their matrices.
+     *
+     * @param[in] bActive    The new activation state.
+     */
+    void setCompensatorActive(bool bActive);
+    void setProjectorActive(bool bActive);
+    void setSpharaActive(bool bActive);
+
+    //=========================================================================================================
+    /**
+     * Returns whether the composed operator is the identity, i.e. no stage is active.
+     *
+     * @return Whether applying the operator is a no-op.
+     */
+    bool isIdentity();
+
+    //=========================================================================================================
+    /**
+     * Returns whether the stages in front of the filter (compensator and projector) commute with a per-channel
+     * temporal filter which is applied to the given channels only, i.e. whether they never mix filtered and
+     * unfiltered channels. If they do, the filter can run on the raw data and the composed operator can be
+     * applied once to the filter output. Otherwise use applyPreFilter() and applyPostFilter() around the filter.
+     *
+     * @param[in] vecChannels    The indices of the filtered channels. An empty list means all channels.
+     *
+     * @return Whether filtering and applying the operator can be swapped.
+     */
+    bool commutesWith(const Eigen::RowVectorXi& vecChannels);
+
+    //=========================================================================================================
+    /**
+     * Applies the composed operator in place.
+     *
+     * @param[in, out] matData   The data (nchan x nsamples).
+     */
+    void apply(Eigen::MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+     * Applies the stages in front of the temporal filter, i.e. compensator and projector, in place.
+     *
+     * @param[in, out] matData   The data (nchan x nsamples).
+     */
+    void applyPreFilter(Eigen::MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+     * Applies the stages after the temporal filter, i.e. bad channel masking and SPHARA, in place.
+     *
+     * @param[in, out] matData   The data (nchan x nsamples).
+     */
+    void applyPostFilter(Eigen::MatrixXd& matData);
+
+private:
+    /**
+     * A composed operator, stored sparse or dense.
+     */
+    struct ComposedOperator {
+        Eigen::SparseMatrix<double>     matSparse;          /**< The operator if sparse. */
+        Eigen::MatrixXd                 matDense;           /**< The operator if dense. */
+        bool                            bIdentity = true;   /**< Whether the operator is the identity. */
+        bool                            bUseDense = false;  /**< Whether the operator is stored dense. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Rebuilds the composed operator from the currently active stages.
+     */
+    void update();
+
+    //=========================================================================================================
+    /**
+     * Converts a dense matrix to a sparse one, dropping exact zeros.
+     *
+     * @param[in] matDense   The dense matrix.
+     *
+     * @return The sparse matrix.
+     */
+    static Eigen::SparseMatrix<double> toSparse(const Eigen::MatrixXd& matDense);
+
+    //=========================================================================================================
+    /**
+     * Stores a composed operator sparse or dense, whichever makes the multiplication cheaper.
+     *
+     * @param[in] matOp          The composed operator. An empty matrix stands for the identity.
+     * @param[out] op            The stored operator.
+     */
+    static void store(const Eigen::SparseMatrix<double>& matOp,
+                      ComposedOperator& op);
+
+    //=========================================================================================================
+    /**
+     * Multiplies the data in place with a composed operator.
+     *
+     * @param[in] op             The operator.
+     * @param[in, out] matData   The data (nchan x nsamples).
+     */
+    void multiply(const ComposedOperator& op,
+                  Eigen::MatrixXd& matData);
+
+    Eigen::SparseMatrix<double>     m_matComp;              /**< The compensator. */
+    Eigen::SparseMatrix<double>     m_matProj;              /**< The SSP projector. */
+    Eigen::SparseMatrix<double>     m_matSphara;            /**< The SPHARA operator. */
+    Eigen::VectorXi                 m_vecBadIdx;            /**< The bad channel indices. */
+
+    bool                            m_bCompActive;          /**< Whether the compensator is applied. */
+    bool                            m_bProjActive;          /**< Whether the projector is applied. */
+    bool                            m_bSpharaActive;        /**< Whether the SPHARA operator is applied. */
+    bool                            m_bDirty;               /**< Whether the composed operator needs to be rebuilt. */
+
+    ComposedOperator                m_op;                   /**< The composed operator of all stages. */
+    ComposedOperator                m_preFilterOp;          /**< The composed compensator and projector. */
+    ComposedOperator                m_postFilterOp;         /**< The masked SPHARA operator. */
+
+    Eigen::RowVectorXi              m_vecCommuteChannels;   /**< The channel list commutesWith was last evaluated for. */
+    bool                            m_bCommuteValid;        /**< Whether m_bCommutes is up to date. */
+    bool                            m_bCommutes;            /**< The cached result of commutesWith. */
+
+    Eigen::MatrixXd                 m_matBuffer;            /**< Output buffer reused across blocks. */
+};
+
+} // NAMESPACE RTPROCESSINGLIB
+
+#endif // SPATIALOPERATOR_RTPROCESSING_H
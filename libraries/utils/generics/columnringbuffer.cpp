@@ -0,0 +1,191 @@
+//=============================================================================================================
+/**
+ * @file     columnringbuffer.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    ColumnRingBuffer class definition.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "columnringbuffer.h"
+
+#include <algorithm>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+ColumnRingBuffer::ColumnRingBuffer(int iRows,
+                                   int iCapacity,
+                                   DropPolicy dropPolicy)
+: m_iTail(0)
+, m_iSize(0)
+, m_dropPolicy(dropPolicy)
+{
+    resize(iRows, iCapacity);
+}
+
+//=============================================================================================================
+
+void ColumnRingBuffer::resize(int iRows,
+                              int iCapacity)
+{
+    m_matData.resize(std::max(iRows, 0), std::max(iCapacity, 0));
+    clear();
+}
+
+//=============================================================================================================
+
+void ColumnRingBuffer::clear()
+{
+    m_iTail = 0;
+    m_iSize = 0;
+}
+
+//=============================================================================================================
+
+void ColumnRingBuffer::setDropPolicy(DropPolicy dropPolicy)
+{
+    m_dropPolicy = dropPolicy;
+}
+
+//=============================================================================================================
+
+int ColumnRingBuffer::push(const MatrixXd& matData)
+{
+    if(matData.rows() != rows()) {
+        qWarning() << "ColumnRingBuffer::push - Number of rows (" << matData.rows() << ") do not match the buffer (" << rows() << "). Returning...";
+        return matData.cols();
+    }
+
+    const int iCount = matData.cols();
+    const int iFree = capacity() - m_iSize;
+
+    if(iCount <= iFree) {
+        write(matData);
+        return 0;
+    }
+
+    if(m_dropPolicy == DropNewest) {
+        write(matData.leftCols(iFree));
+        return iCount - iFree;
+    }
+
+    // DropOldest: only the newest samples which fit into the buffer are kept
+    if(iCount >= capacity()) {
+        const int iDropped = m_iSize + iCount - capacity();
+        clear();
+        write(matData.rightCols(capacity()));
+        return iDropped;
+    }
+
+    pop(iCount - iFree);
+    write(matData);
+
+    return iCount - iFree;
+}
+
+//=============================================================================================================
+
+void ColumnRingBuffer::pop(int iCount)
+{
+    iCount = std::min(std::max(iCount, 0), m_iSize);
+
+    if(iCount == m_iSize) {
+        clear();
+        return;
+    }
+
+    m_iTail = column(iCount);
+    m_iSize -= iCount;
+}
+
+//=============================================================================================================
+
+void ColumnRingBuffer::sum(int iStart,
+                           int iCount,
+                           VectorXd& vecSum) const
+{
+    vecSum.setZero(rows());
+
+    if(m_iSize == 0) {
+        return;
+    }
+
+    iStart %= m_iSize;
+
+    while(iCount > 0) {
+        // Largest contiguous span in memory, limited by the end of the storage and the end of the stored samples
+        const int iColumn = column(iStart);
+        const int iSpan = std::min(iCount, std::min(capacity() - iColumn, m_iSize - iStart));
+
+        vecSum += m_matData.middleCols(iColumn, iSpan).rowwise().sum();
+
+        iStart = (iStart + iSpan) % m_iSize;
+        iCount -= iSpan;
+    }
+}
+
+//=============================================================================================================
+
+void ColumnRingBuffer::write(const Ref<const MatrixXd>& matData)
+{
+    const int iCount = matData.cols();
+
+    if(iCount == 0) {
+        return;
+    }
+
+    const int iHead = column(m_iSize);
+    const int iFirst = std::min(iCount, capacity() - iHead);
+
+    m_matData.middleCols(iHead, iFirst) = matData.leftCols(iFirst);
+
+    if(iCount > iFirst) {
+        m_matData.leftCols(iCount - iFirst) = matData.rightCols(iCount - iFirst);
+    }
+
+    m_iSize += iCount;
+}
@@ -0,0 +1,265 @@
+//=============================================================================================================
+/**
+ * @file     columnringbuffer.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    ColumnRingBuffer class declaration.
+ *
+ */
+
+#ifndef COLUMNRINGBUFFER_H
+#define COLUMNRINGBUFFER_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../utils_global.h"
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+//=============================================================================================================
+/**
+ * Stores the most recent samples of a multi-channel stream in one pre-allocated matrix, one column per sample.
+ * Head and tail are plain indices, so pushing and popping samples never allocates. Once the buffer is full,
+ * the drop policy decides whether the oldest stored or the newest incoming samples are discarded.
+ * This class is not thread safe, use CircularBuffer to pass data between threads.
+ *
+ * @brief Fixed-capacity ring of Eigen column vectors.
+ */
+class UTILSSHARED_EXPORT ColumnRingBuffer
+{
+
+public:
+    typedef QSharedPointer<ColumnRingBuffer> SPtr;              /**< Shared pointer type for ColumnRingBuffer. */
+    typedef QSharedPointer<const ColumnRingBuffer> ConstSPtr;   /**< Const shared pointer type for ColumnRingBuffer. */
+
+    /** Which samples are discarded when pushing to a full buffer. */
+    enum DropPolicy {
+        DropOldest,     /**< Overwrite the oldest stored samples. */
+        DropNewest      /**< Discard the incoming samples which do not fit. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Constructs a ColumnRingBuffer.
+     *
+     * @param[in] iRows          The number of rows (channels) of each sample.
+     * @param[in] iCapacity      The maximal number of stored samples.
+     * @param[in] dropPolicy     The drop policy.
+     */
+    explicit ColumnRingBuffer(int iRows = 0,
+                              int iCapacity = 0,
+                              DropPolicy dropPolicy = DropOldest);
+
+    //=========================================================================================================
+    /**
+     * Reallocates the buffer. All stored samples are removed.
+     *
+     * @param[in] iRows          The number of rows (channels) of each sample.
+     * @param[in] iCapacity      The maximal number of stored samples.
+     */
+    void resize(int iRows,
+                int iCapacity);
+
+    //=========================================================================================================
+    /**
+     * Removes all stored samples. The memory is kept.
+     */
+    void clear();
+
+    //=========================================================================================================
+    /**
+     * Sets the drop policy.
+     *
+     * @param[in] dropPolicy     The drop policy.
+     */
+    void setDropPolicy(DropPolicy dropPolicy);
+
+    //=========================================================================================================
+    /**
+     * Appends samples. Samples which do not fit are dropped according to the drop policy.
+     *
+     * @param[in] matData        The samples <n_rows x n_samples>. The number of rows must match rows().
+     *
+     * @return The number of dropped samples.
+     */
+    int push(const Eigen::MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+     * Removes the oldest samples.
+     *
+     * @param[in] iCount         The number of samples to remove. Clamped to size().
+     */
+    void pop(int iCount);
+
+    //=========================================================================================================
+    /**
+     * Sums up a span of samples without copying them. The span may wrap around the end of the stored samples,
+     * which allows looping over the buffer.
+     *
+     * @param[in] iStart         The index of the first sample, 0 is the oldest stored sample.
+     * @param[in] iCount         The number of samples to sum up.
+     * @param[out] vecSum        The sum <n_rows>. Resized if needed.
+     */
+    void sum(int iStart,
+             int iCount,
+             Eigen::VectorXd& vecSum) const;
+
+    //=========================================================================================================
+    /**
+     * Returns a stored sample.
+     *
+     * @param[in] iIndex         The index of the sample, 0 is the oldest stored sample. Must be smaller than size().
+     *
+     * @return The sample.
+     */
+    inline Eigen::MatrixXd::ConstColXpr at(int iIndex) const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of rows (channels) of each sample.
+     *
+     * @return The number of rows.
+     */
+    inline int rows() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the maximal number of stored samples.
+     *
+     * @return The capacity.
+     */
+    inline int capacity() const;
+
+    //=========================================================================================================
+    /**
+     * Returns the number of stored samples.
+     *
+     * @return The number of stored samples.
+     */
+    inline int size() const;
+
+    //=========================================================================================================
+    /**
+     * Returns whether no samples are stored.
+     *
+     * @return true if empty, false otherwise.
+     */
+    inline bool isEmpty() const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Maps a sample index to the column in m_matData.
+     *
+     * @param[in] iIndex         The index of the sample, 0 is the oldest stored sample.
+     *
+     * @return The column index.
+     */
+    inline int column(int iIndex) const;
+
+    //=========================================================================================================
+    /**
+     * Copies samples to the free columns after the newest stored sample.
+     *
+     * @param[in] matData        The samples, must fit into the free columns.
+     */
+    void write(const Eigen::Ref<const Eigen::MatrixXd>& matData);
+
+    Eigen::MatrixXd     m_matData;          /**< The pre-allocated storage <n_rows x capacity>. */
+    int                 m_iTail;            /**< The column of the oldest stored sample. */
+    int                 m_iSize;            /**< The number of stored samples. */
+    DropPolicy          m_dropPolicy;       /**< The drop policy. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline Eigen::MatrixXd::ConstColXpr ColumnRingBuffer::at(int iIndex) const
+{
+    return m_matData.col(column(iIndex));
+}
+
+//=============================================================================================================
+
+inline int ColumnRingBuffer::rows() const
+{
+    return m_matData.rows();
+}
+
+//=============================================================================================================
+
+inline int ColumnRingBuffer::capacity() const
+{
+    return m_matData.cols();
+}
+
+//=============================================================================================================
+
+inline int ColumnRingBuffer::size() const
+{
+    return m_iSize;
+}
+
+//=============================================================================================================
+
+inline bool ColumnRingBuffer::isEmpty() const
+{
+    return m_iSize == 0;
+}
+
+//=============================================================================================================
+
+inline int ColumnRingBuffer::column(int iIndex) const
+{
+    return (m_iTail + iIndex) % m_matData.cols();
+}
+
+} // NAMESPACE
+
+#endif // COLUMNRINGBUFFER_H
@@ -0,0 +1,324 @@
+//=============================================================================================================
+/**
+ * @file     kdtree.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Definition of the KdTree Class.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "kdtree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtConcurrent/QtConcurrent>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+KdTree::KdTree(const MatrixX3f& matPoints,
+               int iLeafSize)
+: m_matPoints(matPoints.transpose())
+, m_iLeafSize(std::max(1, iLeafSize))
+{
+    const int iNumPoints = static_cast<int>(matPoints.rows());
+
+    m_vecIndices.resize(iNumPoints);
+    for(int i = 0; i < iNumPoints; ++i) {
+        m_vecIndices[i] = i;
+    }
+
+    if(iNumPoints == 0) {
+        return;
+    }
+
+    m_vecNodes.reserve(2 * (iNumPoints / m_iLeafSize + 1));
+    buildNode(0, iNumPoints);
+
+    // store the points in tree order, so that the points of one leaf are contiguous in memory
+    for(int i = 0; i < iNumPoints; ++i) {
+        m_matPoints.col(i) = matPoints.row(m_vecIndices[i]).transpose();
+    }
+}
+
+//=============================================================================================================
+
+int KdTree::nearest(const Vector3f& vecQuery,
+                    float* pDistance) const
+{
+    int iBest = -1;
+    float fBestDistSquared = std::numeric_limits<float>::max();
+
+    if(!m_vecNodes.empty()) {
+        searchNearest(0, vecQuery, iBest, fBestDistSquared);
+    }
+
+    if(pDistance) {
+        *pDistance = iBest >= 0 ? std::sqrt(fBestDistSquared) : std::numeric_limits<float>::infinity();
+    }
+
+    return iBest >= 0 ? m_vecIndices[iBest] : -1;
+}
+
+//=============================================================================================================
+
+QVector<int> KdTree::nearestBatch(const MatrixX3f& matQueries) const
+{
+    const int iNumQueries = static_cast<int>(matQueries.rows());
+    QVector<int> vecResult(iNumQueries);
+    int* pResult = vecResult.data();
+
+    // thread overhead does not pay off for small batches
+    if(iNumQueries < 256) {
+        for(int i = 0; i < iNumQueries; ++i) {
+            pResult[i] = nearest(Vector3f(matQueries.row(i).transpose()));
+        }
+        return vecResult;
+    }
+
+    QVector<int> vecQueryIdx(iNumQueries);
+    for(int i = 0; i < iNumQueries; ++i) {
+        vecQueryIdx[i] = i;
+    }
+
+    QtConcurrent::blockingMap(vecQueryIdx, [this, &matQueries, pResult](const int& i) {
+        pResult[i] = nearest(Vector3f(matQueries.row(i).transpose()));
+    });
+
+    return vecResult;
+}
+
+//=============================================================================================================
+
+QVector<int> KdTree::kNearest(const Vector3f& vecQuery,
+                              int k,
+                              QVector<float>* pDistances) const
+{
+    std::vector<std::pair<float, int> > vecHeap;
+    k = std::min(k, size());
+
+    if(k > 0) {
+        vecHeap.reserve(k + 1);
+        searchKNearest(0, vecQuery, k, vecHeap);
+    }
+
+    std::sort_heap(vecHeap.begin(), vecHeap.end());
+
+    QVector<int> vecResult;
+    vecResult.reserve(static_cast<int>(vecHeap.size()));
+    if(pDistances) {
+        pDistances->clear();
+        pDistances->reserve(static_cast<int>(vecHeap.size()));
+    }
+
+    for(const std::pair<float, int>& entry : vecHeap) {
+        vecResult.append(m_vecIndices[entry.second]);
+        if(pDistances) {
+            pDistances->append(std::sqrt(entry.first));
+        }
+    }
+
+    return vecResult;
+}
+
+//=============================================================================================================
+
+QVector<int> KdTree::radiusSearch(const Vector3f& vecQuery,
+                                  float fRadius) const
+{
+    QVector<int> vecResult;
+
+    if(!m_vecNodes.empty() && fRadius >= 0.0f) {
+        searchRadius(0, vecQuery, fRadius * fRadius, vecResult);
+    }
+
+    for(int& i : vecResult) {
+        i = m_vecIndices[i];
+    }
+
+    return vecResult;
+}
+
+//=============================================================================================================
+
+int KdTree::buildNode(int iBegin,
+                      int iEnd)
+{
+    const int iNode = static_cast<int>(m_vecNodes.size());
+
+    Node node;
+    node.iBegin = iBegin;
+    node.iEnd = iEnd;
+    node.iLeft = -1;
+    node.iRight = -1;
+    node.iAxis = 0;
+    node.fSplit = 0.0f;
+    m_vecNodes.push_back(node);
+
+    if(iEnd - iBegin <= m_iLeafSize) {
+        return iNode;
+    }
+
+    // split along the axis with the largest extent
+    Vector3f vecMin = m_matPoints.col(m_vecIndices[iBegin]);
+    Vector3f vecMax = vecMin;
+    for(int i = iBegin + 1; i < iEnd; ++i) {
+        vecMin = vecMin.cwiseMin(m_matPoints.col(m_vecIndices[i]));
+        vecMax = vecMax.cwiseMax(m_matPoints.col(m_vecIndices[i]));
+    }
+
+    int iAxis = 0;
+    if((vecMax - vecMin).maxCoeff(&iAxis) <= 0.0f) {
+        // all points are identical, no split possible
+        return iNode;
+    }
+
+    const int iMid = iBegin + (iEnd - iBegin) / 2;
+    std::nth_element(m_vecIndices.begin() + iBegin,
+                     m_vecIndices.begin() + iMid,
+                     m_vecIndices.begin() + iEnd,
+                     [this, iAxis](int a, int b) {
+                         return m_matPoints(iAxis, a) < m_matPoints(iAxis, b);
+                     });
+
+    const float fSplit = m_matPoints(iAxis, m_vecIndices[iMid]);
+    const int iLeft = buildNode(iBegin, iMid);
+    const int iRight = buildNode(iMid, iEnd);
+
+    m_vecNodes[iNode].iLeft = iLeft;
+    m_vecNodes[iNode].iRight = iRight;
+    m_vecNodes[iNode].iAxis = iAxis;
+    m_vecNodes[iNode].fSplit = fSplit;
+
+    return iNode;
+}
+
+//=============================================================================================================
+
+void KdTree::searchNearest(int iNode,
+                           const Vector3f& vecQuery,
+                           int& iBest,
+                           float& fBestDistSquared) const
+{
+    const Node& node = m_vecNodes[iNode];
+
+    if(node.iLeft < 0) {
+        for(int i = node.iBegin; i < node.iEnd; ++i) {
+            const float fDistSquared = (m_matPoints.col(i) - vecQuery).squaredNorm();
+            if(fDistSquared < fBestDistSquared) {
+                fBestDistSquared = fDistSquared;
+                iBest = i;
+            }
+        }
+        return;
+    }
+
+    // visit the side of the query first, the other side only if it can hold a closer point
+    const float fDiff = vecQuery[node.iAxis] - node.fSplit;
+    searchNearest(fDiff < 0.0f ? node.iLeft : node.iRight, vecQuery, iBest, fBestDistSquared);
+
+    if(fDiff * fDiff < fBestDistSquared) {
+        searchNearest(fDiff < 0.0f ? node.iRight : node.iLeft, vecQuery, iBest, fBestDistSquared);
+    }
+}
+
+//=============================================================================================================
+
+void KdTree::searchKNearest(int iNode,
+                            const Vector3f& vecQuery,
+                            int k,
+                            std::vector<std::pair<float, int> >& vecHeap) const
+{
+    const Node& node = m_vecNodes[iNode];
+
+    if(node.iLeft < 0) {
+        for(int i = node.iBegin; i < node.iEnd; ++i) {
+            const float fDistSquared = (m_matPoints.col(i) - vecQuery).squaredNorm();
+            if(static_cast<int>(vecHeap.size()) < k) {
+                vecHeap.push_back(std::make_pair(fDistSquared, i));
+                std::push_heap(vecHeap.begin(), vecHeap.end());
+            } else if(fDistSquared < vecHeap.front().first) {
+                std::pop_heap(vecHeap.begin(), vecHeap.end());
+                vecHeap.back() = std::make_pair(fDistSquared, i);
+                std::push_heap(vecHeap.begin(), vecHeap.end());
+            }
+        }
+        return;
+    }
+
+    const float fDiff = vecQuery[node.iAxis] - node.fSplit;
+    searchKNearest(fDiff < 0.0f ? node.iLeft : node.iRight, vecQuery, k, vecHeap);
+
+    if(static_cast<int>(vecHeap.size()) < k || fDiff * fDiff < vecHeap.front().first) {
+        searchKNearest(fDiff < 0.0f ? node.iRight : node.iLeft, vecQuery, k, vecHeap);
+    }
+}
+
+//=============================================================================================================
+
+void KdTree::searchRadius(int iNode,
+                          const Vector3f& vecQuery,
+                          float fRadiusSquared,
+                          QVector<int>& vecResult) const
+{
+    const Node& node = m_vecNodes[iNode];
+
+    if(node.iLeft < 0) {
+        for(int i = node.iBegin; i < node.iEnd; ++i) {
+            if((m_matPoints.col(i) - vecQuery).squaredNorm() <= fRadiusSquared) {
+                vecResult.append(i);
+            }
+        }
+        return;
+    }
+
+    const float fDiff = vecQuery[node.iAxis] - node.fSplit;
+    searchRadius(fDiff < 0.0f ? node.iLeft : node.iRight, vecQuery, fRadiusSquared, vecResult);
+
+    if(fDiff * fDiff <= fRadiusSquared) {
+        searchRadius(fDiff < 0.0f ? node.iRight : node.iLeft, vecQuery, fRadiusSquared, vecResult);
+    }
+}
@@ -0,0 +1,215 @@
+//=============================================================================================================
+/**
+ * @file     kdtree.h
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    KdTree class declaration.
+ *
+ */
+
+#ifndef KDTREE_H
+#define KDTREE_H
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+#include <vector>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QVector>
+
+//=============================================================================================================
+// EIGEN INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+//=============================================================================================================
+/**
+ * Spatial index for 3D point clouds, e.g., the vertices of a FreeSurfer or BEM surface. The tree is built once
+ * and answers nearest neighbor, k-nearest neighbor and radius queries in O(log N) on average. All queries are
+ * const and do not use any shared state, so they can be run concurrently from multiple threads.
+ *
+ * @brief k-d tree for nearest neighbor and radius queries on 3D point clouds.
+ */
+class UTILSSHARED_EXPORT KdTree
+{
+public:
+    typedef QSharedPointer<KdTree> SPtr;            /**< Shared pointer type for KdTree. */
+    typedef QSharedPointer<const KdTree> ConstSPtr; /**< Const shared pointer type for KdTree. */
+
+    //=========================================================================================================
+    /**
+     * Builds the tree for the given points.
+     *
+     * @param[in] matPoints      n x 3 matrix of cartesian point coordinates. The returned indices refer to the rows of this matrix.
+     * @param[in] iLeafSize      Maximum number of points stored in one leaf.
+     */
+    explicit KdTree(const Eigen::MatrixX3f& matPoints,
+                    int iLeafSize = 16);
+
+    //=========================================================================================================
+    /**
+     * Returns the number of indexed points.
+     *
+     * @return The number of indexed points.
+     */
+    int size() const;
+
+    //=========================================================================================================
+    /**
+     * Finds the closest point (euclidian distance) to a query position.
+     *
+     * @param[in] vecQuery       The query position.
+     * @param[out] pDistance     (optional) The distance to the closest point.
+     *
+     * @return The row index of the closest point, -1 if the tree is empty.
+     */
+    int nearest(const Eigen::Vector3f& vecQuery,
+                float* pDistance = Q_NULLPTR) const;
+
+    //=========================================================================================================
+    /**
+     * Finds the closest point for each query position. Large batches are processed in parallel.
+     *
+     * @param[in] matQueries     m x 3 matrix of query positions.
+     *
+     * @return The row index of the closest point for each query position.
+     */
+    QVector<int> nearestBatch(const Eigen::MatrixX3f& matQueries) const;
+
+    //=========================================================================================================
+    /**
+     * Finds the k closest points to a query position.
+     *
+     * @param[in] vecQuery       The query position.
+     * @param[in] k              The number of points to find.
+     * @param[out] pDistances    (optional) The distances to the found points.
+     *
+     * @return The row indices of the found points, sorted by increasing distance.
+     */
+    QVector<int> kNearest(const Eigen::Vector3f& vecQuery,
+                          int k,
+                          QVector<float>* pDistances = Q_NULLPTR) const;
+
+    //=========================================================================================================
+    /**
+     * Finds all points within a radius around a query position.
+     *
+     * @param[in] vecQuery       The query position.
+     * @param[in] fRadius        The search radius.
+     *
+     * @return The row indices of the found points, in no particular order.
+     */
+    QVector<int> radiusSearch(const Eigen::Vector3f& vecQuery,
+                              float fRadius) const;
+
+private:
+    //=========================================================================================================
+    /**
+     * Node of the tree. Leafs hold a range of points, inner nodes split the space at fSplit along iAxis.
+     */
+    struct Node {
+        int     iBegin;     /**< First point of this node in m_vecIndices. */
+        int     iEnd;       /**< One past the last point of this node in m_vecIndices. */
+        int     iLeft;      /**< Index of the child holding the points below the split, -1 for leafs. */
+        int     iRight;     /**< Index of the child holding the points above the split, -1 for leafs. */
+        int     iAxis;      /**< The split axis. */
+        float   fSplit;     /**< The split position. */
+    };
+
+    //=========================================================================================================
+    /**
+     * Recursively builds the subtree for the points between iBegin and iEnd.
+     *
+     * @param[in] iBegin     First point in m_vecIndices.
+     * @param[in] iEnd       One past the last point in m_vecIndices.
+     *
+     * @return The index of the created node.
+     */
+    int buildNode(int iBegin,
+                  int iEnd);
+
+    //=========================================================================================================
+    /**
+     * Recursive nearest neighbor search.
+     */
+    void searchNearest(int iNode,
+                       const Eigen::Vector3f& vecQuery,
+                       int& iBest,
+                       float& fBestDistSquared) const;
+
+    //=========================================================================================================
+    /**
+     * Recursive k-nearest neighbor search. vecHeap is a max heap of (squared distance, index) pairs.
+     */
+    void searchKNearest(int iNode,
+                        const Eigen::Vector3f& vecQuery,
+                        int k,
+                        std::vector<std::pair<float, int> >& vecHeap) const;
+
+    //=========================================================================================================
+    /**
+     * Recursive radius search.
+     */
+    void searchRadius(int iNode,
+                      const Eigen::Vector3f& vecQuery,
+                      float fRadiusSquared,
+                      QVector<int>& vecResult) const;
+
+    Eigen::Matrix<float, 3, Eigen::Dynamic>     m_matPoints;        /**< The points in tree order, one column per point. */
+    std::vector<int>                            m_vecIndices;       /**< The original row index of each point in tree order. */
+    std::vector<Node>                           m_vecNodes;         /**< The tree nodes, the root is stored first. */
+    int                                         m_iLeafSize;        /**< Maximum number of points stored in one leaf. */
+};
+
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline int KdTree::size() const
+{
+    return static_cast<int>(m_vecIndices.size());
+}
+} // NAMESPACE
+
+#endif // KDTREE_H
@@ -43,13 +43,16 @@
 #include <iostream>
 #include <algorithm>
 #include <vector>
-#include <time.h>
+#include <random>
+#include <limits>
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QDebug>
+#include <QVector>
+#include <QtConcurrent>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -58,6 +61,171 @@
 using namespace UTILSLIB;
 using namespace Eigen;
 
+//=============================================================================================================
+// DEFINE LOCAL TEMPLATES
+//=============================================================================================================
+
+namespace {
+
+//=============================================================================================================
+/**
+ * Distance kernels, specialized per distance measure. The centroids are prepared once per update (normalized for
+ * the cosine distance), the distances of a set of points to all prepared centroids are then evaluated at once;
+ * with a single GEMM wherever the measure allows it. metric() maps a distance to a value which satisfies the
+ * triangle inequality, drift() measures the movement of a centroid in the same units.
+ */
+template<KMeans::DistanceType T>
+struct KMeansDistance
+{
+    static void prepare(const MatrixXd& C, MatrixXd& Cp)
+    {
+        Cp = C;
+    }
+
+    static void pairwise(const MatrixXd& X, const VectorXd& vecXNorm2, const MatrixXd& Cp, MatrixXd& D)
+    {
+        //ToDo hamming
+        Q_UNUSED(vecXNorm2)
+        D = MatrixXd::Zero(X.rows(), Cp.rows());
+    }
+
+    static double point(const MatrixXd& X, qint32 i, const MatrixXd& Cp, qint32 j)
+    {
+        Q_UNUSED(X) Q_UNUSED(i) Q_UNUSED(Cp) Q_UNUSED(j)
+        return 0.0;
+    }
+
+    static double metric(double dist)
+    {
+        return dist;
+    }
+
+    static double drift(const MatrixXd& CpOld, const MatrixXd& CpNew, qint32 j)
+    {
+        Q_UNUSED(CpOld) Q_UNUSED(CpNew) Q_UNUSED(j)
+        return 0.0;
+    }
+};
+
+template<>
+struct KMeansDistance<KMeans::SqEuclidean>
+{
+    static void prepare(const MatrixXd& C, MatrixXd& Cp)
+    {
+        Cp = C;
+    }
+
+    static void pairwise(const MatrixXd& X, const VectorXd& vecXNorm2, const MatrixXd& Cp, MatrixXd& D)
+    {
+        // |x - c|^2 = |x|^2 + |c|^2 - 2 x'c
+        D.noalias() = -2.0 * X * Cp.transpose();
+        D.colwise() += vecXNorm2;
+        D.rowwise() += Cp.rowwise().squaredNorm().transpose();
+        D = D.cwiseMax(0.0);
+    }
+
+    static double point(const MatrixXd& X, qint32 i, const MatrixXd& Cp, qint32 j)
+    {
+        return (X.row(i) - Cp.row(j)).squaredNorm();
+    }
+
+    static double metric(double dist)
+    {
+        return std::sqrt(dist);
+    }
+
+    static double drift(const MatrixXd& CpOld, const MatrixXd& CpNew, qint32 j)
+    {
+        return (CpNew.row(j) - CpOld.row(j)).norm();
+    }
+};
+
+template<>
+struct KMeansDistance<KMeans::CityBlock>
+{
+    static void prepare(const MatrixXd& C, MatrixXd& Cp)
+    {
+        Cp = C;
+    }
+
+    static void pairwise(const MatrixXd& X, const VectorXd& vecXNorm2, const MatrixXd& Cp, MatrixXd& D)
+    {
+        Q_UNUSED(vecXNorm2)
+        D.resize(X.rows(), Cp.rows());
+        for(qint32 j = 0; j < Cp.rows(); ++j)
+            D.col(j) = (X.rowwise() - Cp.row(j)).cwiseAbs().rowwise().sum();
+    }
+
+    static double point(const MatrixXd& X, qint32 i, const MatrixXd& Cp, qint32 j)
+    {
+        return (X.row(i) - Cp.row(j)).cwiseAbs().sum();
+    }
+
+    static double metric(double dist)
+    {
+        return dist;
+    }
+
+    static double drift(const MatrixXd& CpOld, const MatrixXd& CpNew, qint32 j)
+    {
+        return (CpNew.row(j) - CpOld.row(j)).cwiseAbs().sum();
+    }
+};
+
+template<>
+struct KMeansDistance<KMeans::Cosine>
+{
+    static void prepare(const MatrixXd& C, MatrixXd& Cp)
+    {
+        // The points are normalized, centroids are not, so normalize them
+        Cp = C;
+        Cp.array().colwise() /= C.rowwise().norm().array();
+    }
+
+    static void pairwise(const MatrixXd& X, const VectorXd& vecXNorm2, const MatrixXd& Cp, MatrixXd& D)
+    {
+        Q_UNUSED(vecXNorm2)
+        D.noalias() = -X * Cp.transpose();
+        D.array() += 1.0;
+        D = D.cwiseMax(0.0);
+    }
+
+    static double point(const MatrixXd& X, qint32 i, const MatrixXd& Cp, qint32 j)
+    {
+        return std::max(1.0 - X.row(i).dot(Cp.row(j)), 0.0);
+    }
+
+    static double metric(double dist)
+    {
+        // Points and prepared centroids have unit length: |x - c|^2 = 2 (1 - x'c)
+        return std::sqrt(2.0 * dist);
+    }
+
+    static double drift(const MatrixXd& CpOld, const MatrixXd& CpNew, qint32 j)
+    {
+        return (CpNew.row(j) - CpOld.row(j)).norm();
+    }
+};
+
+template<>
+struct KMeansDistance<KMeans::Correlation> : public KMeansDistance<KMeans::Cosine>
+{
+};
+
+//=============================================================================================================
+
+template<KMeans::DistanceType T>
+MatrixXd pairwiseDistances(const MatrixXd& X, const VectorXd& vecXNorm2, const MatrixXd& C)
+{
+    MatrixXd Cp;
+    MatrixXd D;
+    KMeansDistance<T>::prepare(C, Cp);
+    KMeansDistance<T>::pairwise(X, vecXNorm2, Cp, D);
+    return D;
+}
+
+} // NAMESPACE
+
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
@@ -69,12 +237,13 @@ KMeans::KMeans(QString distance,
                bool online,
                qint32 maxit)
 : m_sDistance(distance)
+, m_distanceType(SqEuclidean)
 , m_sStart(start)
 , m_iReps(replicates)
 , m_sEmptyact(emptyact)
 , m_iMaxit(maxit)
 , m_bOnline(online)
-, emptyErrCnt(0)
+, m_iSeed(0)
 , iter(0)
 , k(0)
 , n(0)
@@ -85,6 +254,24 @@ KMeans::KMeans(QString distance,
     // Assume one replicate
     if (m_iReps < 1)
         m_iReps = 1;
+
+    if (m_sDistance.compare("cityblock") == 0)
+        m_distanceType = CityBlock;
+    else if (m_sDistance.compare("cosine") == 0)
+        m_distanceType = Cosine;
+    else if (m_sDistance.compare("correlation") == 0)
+        m_distanceType = Correlation;
+    else if (m_sDistance.compare("hamming") == 0)
+        m_distanceType = Hamming;
+    else if (m_sDistance.compare("sqeuclidean") != 0)
+        qWarning() << "[KMeans::KMeans] Unknown distance" << m_sDistance << "- using sqeuclidean.";
+}
+
+//=============================================================================================================
+
+void KMeans::setSeed(quint32 iSeed)
+{
+    m_iSeed = iSeed;
 }
 
 //=============================================================================================================
@@ -96,252 +283,282 @@ bool KMeans::calculate(MatrixXd X,
                        VectorXd& sumD,
                        MatrixXd& D)
 {
-    if (kClusters < 1)
+    if (kClusters < 1 || X.rows() < 1)
         return false;
 
-    //Init random generator
-    srand ( time(NULL) );
-
 // n points in p dimensional space
     k = kClusters;
     n = X.rows();
     p = X.cols();
 
-    if(m_sDistance.compare("cosine") == 0)
+    if(m_distanceType == Cosine || m_distanceType == Correlation)
     {
-//        Xnorm = sqrt(sum(X.^2, 2));
-//        if any(min(Xnorm) <= eps(max(Xnorm)))
-//            error(['Some points have small relative magnitudes, making them ', ...
-//                   'effectively zero.\nEither remove those points, or choose a ', ...
-//                   'distance other than ''cosine''.']);
-//        end
-//        X = X ./ Xnorm(:,ones(1,p));
-    }
-    else if(m_sDistance.compare("correlation")==0)
-    {
-        X.array() -= (X.rowwise().sum().array() / (double)p).replicate(1,p); //X - X.rowwise().sum();//.repmat(mean(X,2),1,p);
-        MatrixXd Xnorm = (X.array().pow(2).rowwise().sum()).sqrt();//sqrt(sum(X.^2, 2));
-//        if any(min(Xnorm) <= eps(max(Xnorm)))
-//            error(['Some points have small relative standard deviations, making them ', ...
-//                   'effectively constant.\nEither remove those points, or choose a ', ...
-//                   'distance other than ''correlation''.']);
-//        end
-        X.array() /= Xnorm.replicate(1,p).array();
-    }
-//    else if(m_sDistance.compare('hamming')==0)
-//    {
-//        if ~all(ismember(X(:),[0 1]))
-//            error(message('NonbinaryDataForHamm'));
-//        end
-//    }
+        if(m_distanceType == Correlation)
+            X.colwise() -= X.rowwise().mean();
 
-    // Start
-    RowVectorXd Xmins;
-    RowVectorXd Xmaxs;
-    if (m_sStart.compare("uniform") == 0)
-    {
-        if (m_sDistance.compare("hamming") == 0)
+        VectorXd Xnorm = X.rowwise().norm();
+        if(Xnorm.minCoeff() <= std::numeric_limits<double>::epsilon() * Xnorm.maxCoeff())
         {
-            printf("Error: Uniform Start For Hamming\n");
+            printf("Error: Some points have small relative magnitudes, making them effectively zero. Choose a distance other than %s.\n", m_sDistance.toUtf8().constData());
             return false;
         }
-        Xmins = X.colwise().minCoeff();
-        Xmaxs = X.colwise().maxCoeff();
+        X.array().colwise() /= Xnorm.array();
+    }
+    else if(m_distanceType == Hamming && m_sStart.compare("uniform") == 0)
+    {
+        printf("Error: Uniform Start For Hamming\n");
+        return false;
     }
 
+    m_vecXNorm2 = X.rowwise().squaredNorm();
+
     //
     // Done with input argument processing, begin clustering
     //
+    // The replicates are independent of each other: each one runs on its own copy of the clustering state and
+    // draws its start from its own seed, which makes the result independent of the scheduling.
+    struct Replicate {
+        quint32 iSeed;
+        double dTotSumD;
+        VectorXi idx;
+        MatrixXd C;
+        VectorXd sumD;
+        MatrixXd D;
+    };
+
+    QVector<Replicate> vecReplicates(m_iReps);
+    for(qint32 rep = 0; rep < m_iReps; ++rep)
+        vecReplicates[rep].iSeed = m_iSeed + rep;
+
+    QtConcurrent::blockingMap(vecReplicates, [this, &X](Replicate& replicate) {
+        KMeans worker(*this);
+        replicate.dTotSumD = worker.runReplicate(X, replicate.iSeed, replicate.idx, replicate.C, replicate.sumD, replicate.D);
+    });
+
+    // Return the best solution
+    qint32 iBest = -1;
+    double totsumDBest = std::numeric_limits<double>::infinity();
+    for(qint32 rep = 0; rep < m_iReps; ++rep)
+    {
+        if(vecReplicates[rep].dTotSumD < totsumDBest)
+        {
+            totsumDBest = vecReplicates[rep].dTotSumD;
+            iBest = rep;
+        }
+    }
+
+    if(iBest < 0)
+        return false;
+
+    idx = vecReplicates[iBest].idx;
+    C = vecReplicates[iBest].C;
+    sumD = vecReplicates[iBest].sumD;
+    D = vecReplicates[iBest].D;
+    totsumD = totsumDBest;
+
+    return true;
+}
+
+//=============================================================================================================
+
+double KMeans::runReplicate(const MatrixXd& X,
+                            quint32 iSeed,
+                            VectorXi& idx,
+                            MatrixXd& C,
+                            VectorXd& sumD,
+                            MatrixXd& D)
+{
+    if(!initCentroids(X, iSeed, C))
+        return std::numeric_limits<double>::infinity();
+
     if (m_bOnline)
     {
         Del = MatrixXd(n,k);
         Del.fill(std::numeric_limits<double>::quiet_NaN());// reassignment criterion
     }
 
-    double totsumDBest = std::numeric_limits<double>::max();
-    emptyErrCnt = 0;
+    // Compute the distance from every point to each cluster centroid and the
+    // initial assignment of points to clusters
+    D = distfun(X, C);
+    idx = VectorXi::Zero(n);
+    d = VectorXd::Zero(n);
 
-    VectorXi idxBest;
-    MatrixXd Cbest;
-    VectorXd sumDBest;
-    MatrixXd Dbest;
+    for(qint32 i = 0; i < n; ++i)
+        d[i] = D.row(i).minCoeff(&idx[i]);
 
-    for(qint32 rep = 0; rep < m_iReps; ++rep)
+    m = VectorXi::Zero(k);
+    for(qint32 i = 0; i < n; ++i)
+        ++m[idx[i]];
+
+    // Begin phase one:  batch reassignments
+    bool converged = false;
+    switch(m_distanceType)
     {
-        if (m_sStart.compare("uniform") == 0)
-        {
-            C = MatrixXd::Zero(k,p);
-            for(qint32 i = 0; i < k; ++i)
-                for(qint32 j = 0; j < p; ++j)
-                    C(i,j) = unifrnd(Xmins[j], Xmaxs[j]);
-            // For 'cosine' and 'correlation', these are uniform inside a subset
-            // of the unit hypersphere.  Still need to center them for
-            // 'correlation'.  (Re)normalization for 'cosine'/'correlation' is
-            // done at each iteration.
-            if (m_sDistance.compare("correlation") == 0)
-                C.array() -= (C.array().rowwise().sum()/p).replicate(1, p).array();
-        }
-        else if (m_sStart.compare("sample") == 0)
-        {
-            C = MatrixXd::Zero(k,p);
-            for(qint32 i = 0; i < k; ++i)
-                C.block(i,0,1,p) = X.block(rand() % n, 0, 1, p);
-            // DEBUG
-//            C.block(0,0,1,p) = X.block(2, 0, 1, p);
-//            C.block(1,0,1,p) = X.block(7, 0, 1, p);
-//            C.block(2,0,1,p) = X.block(17, 0, 1, p);
-        }
-    //    else if (start.compare("cluster") == 0)
-    //    {
-    //        Xsubset = X(randsample(n,floor(.1*n)),:);
-    //        [dum, C] = kmeans(Xsubset, k, varargin{:}, 'start','sample', 'replicates',1);
-    //    }
-    //    else if (start.compare("numeric") == 0)
-    //    {
-    //        C = CC(:,:,rep);
-    //    }
-
-        // Compute the distance from every point to each cluster centroid and the
-        // initial assignment of points to clusters
-        D = distfun(X, C);//, 0);
-        idx = VectorXi::Zero(D.rows());
-        d = VectorXd::Zero(D.rows());
-
-        for(qint32 i = 0; i < D.rows(); ++i)
-            d[i] = D.row(i).minCoeff(&idx[i]);
-
-        m = VectorXi::Zero(k);
-        for(qint32 i = 0; i < k; ++i)
-            for (qint32 j = 0; j < idx.rows(); ++j)
-                if(idx[j] == i)
-                    ++ m[i];
+        case CityBlock:
+            converged = batchUpdate<CityBlock>(X, C, idx);
+            break;
+        case Cosine:
+            converged = batchUpdate<Cosine>(X, C, idx);
+            break;
+        case Correlation:
+            converged = batchUpdate<Correlation>(X, C, idx);
+            break;
+        case Hamming:
+            converged = batchUpdate<Hamming>(X, C, idx);
+            break;
+        default:
+            converged = batchUpdate<SqEuclidean>(X, C, idx);
+            break;
+    }
 
-        try // catch empty cluster errors and move on to next rep
-        {
-            // Begin phase one:  batch reassignments
-            bool converged = batchUpdate(X, C, idx);
+    // Begin phase two:  single reassignments
+    if (m_bOnline)
+        converged = onlineUpdate(X, C, idx);
+
+    if (!converged)
+        printf("Failed To Converge during replicate with seed %u\n", iSeed);
+
+    // Calculate cluster-wise sums of distances
+    VectorXi nonempties(k);
+    qint32 count = 0;
+    for(qint32 i = 0; i < k; ++i)
+        if(m[i] > 0)
+            nonempties[count++] = i;
 
-            // Begin phase two:  single reassignments
-            if (m_bOnline)
-                converged = onlineUpdate(X, C, idx);
+    MatrixXd C_tmp(count, p);
+    for(qint32 i = 0; i < count; ++i)
+        C_tmp.row(i) = C.row(nonempties[i]);
 
-            if (!converged)
-                printf("Failed To Converge during replicate %d\n", rep);
+    MatrixXd D_tmp = distfun(X, C_tmp);
+    for(qint32 i = 0; i < count; ++i)
+        D.col(nonempties[i]) = D_tmp.col(i);
 
-            // Calculate cluster-wise sums of distances
-            VectorXi nonempties = VectorXi::Zero(m.rows());
-            quint32 count = 0;
-            for(qint32 i = 0; i < m.rows(); ++i)
-            {
-                if(m[i] > 0)
-                {
-                    nonempties[i] = 1;
-                    ++count;
-                }
-            }
-            MatrixXd C_tmp(count,C.cols());
-            count = 0;
-            for(qint32 i = 0; i < nonempties.rows(); ++i)
-            {
-                if(nonempties[i])
-                {
-                    C_tmp.row(count) = C.row(i);
-                    ++count;
-                }
-            }
+    sumD = VectorXd::Zero(k);
+    for(qint32 i = 0; i < n; ++i)
+    {
+        d[i] = D(i, idx[i]);
+        sumD[idx[i]] += d[i];
+    }
 
-            MatrixXd D_tmp = distfun(X, C_tmp);//, iter);
-            count = 0;
-            for(qint32 i = 0; i < nonempties.rows(); ++i)
-            {
-                if(nonempties[i])
-                {
-                    D.col(i) = D_tmp.col(count);
-                    C.row(i) = C_tmp.row(count);
-                    ++count;
-                }
-            }
+    totsumD = sumD.sum();
 
-            d = VectorXd::Zero(n);
-            for(qint32 i = 0; i < n; ++i)
-                d[i] += D.array()(idx[i]*n+i);//Colum Major
+//    printf("%d iterations, total sum of distances = %f\n", iter, totsumD);
 
-            sumD = VectorXd::Zero(k);
-            for(qint32 i = 0; i < k; ++i)
-                for (qint32 j = 0; j < idx.rows(); ++j)
-                    if(idx[j] == i)
-                        sumD[i] += d[j];
+    return totsumD;
+}
 
-            totsumD = sumD.array().sum();
+//=============================================================================================================
 
-//            printf("%d iterations, total sum of distances = %f\n", iter, totsumD);
+bool KMeans::initCentroids(const MatrixXd& X,
+                           quint32 iSeed,
+                           MatrixXd& C)
+{
+    std::mt19937 generator(iSeed);
+    C = MatrixXd::Zero(k,p);
 
-            // Save the best solution so far
-            if (totsumD < totsumDBest)
-            {
-                totsumDBest = totsumD;
-                idxBest = idx;
-                Cbest = C;
-                sumDBest = sumD;
-                Dbest = D;
-            }
+    if (m_sStart.compare("uniform") == 0)
+    {
+        RowVectorXd Xmins = X.colwise().minCoeff();
+        RowVectorXd Xmaxs = X.colwise().maxCoeff();
+        for(qint32 j = 0; j < p; ++j)
+        {
+            std::uniform_real_distribution<double> unif(Xmins[j], Xmaxs[j]);
+            for(qint32 i = 0; i < k; ++i)
+                C(i,j) = unif(generator);
         }
-        catch (int e)
+        // For 'cosine' and 'correlation', these are uniform inside a subset
+        // of the unit hypersphere.  Still need to center them for
+        // 'correlation'.  (Re)normalization for 'cosine'/'correlation' is
+        // done at each iteration.
+        if (m_distanceType == Correlation)
+            C.colwise() -= C.rowwise().mean();
+    }
+    else if (m_sStart.compare("sample") == 0)
+    {
+        std::uniform_int_distribution<qint32> unif(0, n - 1);
+        for(qint32 i = 0; i < k; ++i)
+            C.row(i) = X.row(unif(generator));
+    }
+    else if (m_sStart.compare("kmeans++") == 0)
+    {
+        // The first centroid is drawn uniformly, every following one with a probability proportional to the
+        // distance of the point to the closest centroid drawn so far
+        std::uniform_int_distribution<qint32> unif(0, n - 1);
+        C.row(0) = X.row(unif(generator));
+
+        VectorXd vecMinD = distfun(X, C.topRows(1)).col(0);
+        for(qint32 i = 1; i < k; ++i)
         {
-            if(e == 0)
+            double dSum = vecMinD.sum();
+            qint32 iNext = n - 1;
+
+            if(dSum > 0.0)
             {
-                // If an empty cluster error occurred in one of multiple replicates, catch
-                // it, warn, and move on to next replicate.  Error only when all replicates
-                // fail.  Rethrow an other kind of error.
-                if (m_iReps == 1)
-                    return false;
-                else
+                std::uniform_real_distribution<double> unifReal(0.0, dSum);
+                double dTarget = unifReal(generator);
+                double dCumSum = 0.0;
+                for(qint32 j = 0; j < n; ++j)
                 {
-                    emptyErrCnt = emptyErrCnt + 1;
-//                    printf("Replicate %d terminated: empty cluster created at iteration %d.\n", rep, iter);
-                    if (emptyErrCnt == m_iReps)
+                    dCumSum += vecMinD[j];
+                    if(dCumSum > dTarget)
                     {
-//                        error(message('EmptyClusterAllReps'));
-                        return false;
+                        iNext = j;
+                        break;
                     }
-
                 }
             }
-        } // catch
+            else
+            {
+                iNext = unif(generator);
+            }
 
-    } // replicates
+            C.row(i) = X.row(iNext);
+            vecMinD = vecMinD.cwiseMin(distfun(X, C.row(i)).col(0));
+        }
+    }
+//    else if (start.compare("cluster") == 0)
+//    {
+//        Xsubset = X(randsample(n,floor(.1*n)),:);
+//        [dum, C] = kmeans(Xsubset, k, varargin{:}, 'start','sample', 'replicates',1);
+//    }
+//    else if (start.compare("numeric") == 0)
+//    {
+//        C = CC(:,:,rep);
+//    }
+    else
+    {
+        printf("Error: Unknown start %s\n", m_sStart.toUtf8().constData());
+        return false;
+    }
 
-    // Return the best solution
-    idx = idxBest;
-    C = Cbest;
-    sumD = sumDBest;
-    D = Dbest;
-
-//if hadNaNs
-//    idx = statinsertnan(wasnan, idx);
-//end
     return true;
 }
 
 //=============================================================================================================
 
+template<KMeans::DistanceType T>
 bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 {
-    // Every point moved, every cluster will need an update
-    qint32 i = 0;
-    VectorXi moved(n);
-    for(i = 0; i < n; ++i)
-        moved[i] = i;
+    typedef KMeansDistance<T> Distance;
 
-    VectorXi changed(k);
-    for(i = 0; i < k; ++i)
-        changed[i] = i;
+    // Every point moved, every cluster will need an update
+    VectorXi changed = VectorXi::LinSpaced(k, 0, k - 1);
 
     previdx = VectorXi::Zero(n);
 
     prevtotsumD = std::numeric_limits<double>::max();//max double
 
-    MatrixXd D = MatrixXd::Zero(X.rows(), k);
+    // Lower bounds of the distances of every point to all but its own centroid, in metric units. They start at
+    // -infinity, which forces a full comparison in the first iteration.
+    VectorXd vecLower = VectorXd::Constant(n, -std::numeric_limits<double>::infinity());
+    MatrixXd Cp;
+    MatrixXd CpPrev;
+    VectorXi vecCandidates(n);
+    MatrixXd Xc;
+    VectorXd vecXcNorm2;
+    MatrixXd Dc;
+    std::vector<int> vecMoved;
+    std::vector<int> vecMovedTo;
 
     //
     // Begin phase one:  batch reassignments
@@ -352,27 +569,24 @@ bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
     {
         ++iter;
 
-        // Calculate the new cluster centroids and counts, and update the
-        // distance from every point to those new cluster centroids
+        // Calculate the new cluster centroids and counts
         MatrixXd C_new;
         VectorXi m_new;
-        KMeans::gcentroids(X, idx, changed, C_new, m_new);
-        MatrixXd D_new = distfun(X, C_new);//, iter);
+        gcentroids(X, idx, changed, C_new, m_new);
 
         for(qint32 i = 0; i < changed.rows(); ++i)
         {
             C.row(changed[i]) = C_new.row(i);
-            D.col(changed[i]) = D_new.col(i);
             m[changed[i]] = m_new[i];
         }
 
         // Deal with clusters that have just lost all their members
-        VectorXi empties = VectorXi::Zero(changed.rows());
+        qint32 nEmpties = 0;
         for(qint32 i = 0; i < changed.rows(); ++i)
-            if(m(i) == 0)
-                empties[i] = 1;
+            if(m[changed[i]] == 0)
+                ++nEmpties;
 
-        if (empties.sum() > 0)
+        if (nEmpties > 0)
         {
             if (m_sEmptyact.compare("error") == 0)
             {
@@ -417,20 +631,27 @@ bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
             }
         }
 
-        // Compute the total sum of distances for the current configuration.
+        // Compute the distance of every point to its own centroid and the
+        // total sum of distances for the current configuration.
+        Distance::prepare(C, Cp);
         totsumD = 0;
         for(qint32 i = 0; i < n; ++i)
-            totsumD += D.array()(idx[i]*n+i);//Colum Major
+        {
+            d[i] = Distance::point(X, i, Cp, idx[i]);
+            totsumD += d[i];
+        }
+
         // Test for a cycle: if objective is not decreased, back out
         // the last step and move on to the single update phase
         if(prevtotsumD <= totsumD)
         {
             idx = previdx;
-            MatrixXd C_new;
-            VectorXi m_new;
             gcentroids(X, idx, changed, C_new, m_new);
-            C.block(0,0,k,C.cols()) = C_new;
-            m.block(0,0,k,1) = m_new;
+            for(qint32 i = 0; i < changed.rows(); ++i)
+            {
+                C.row(changed[i]) = C_new.row(i);
+                m[changed[i]] = m_new[i];
+            }
             --iter;
             break;
         }
@@ -439,60 +660,100 @@ bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
         if (iter >= m_iMaxit)
             break;
 
-        // Determine closest cluster for each point and reassign points to clusters
         previdx = idx;
         prevtotsumD = totsumD;
 
-        VectorXi nidx(D.rows());
-        for(qint32 i = 0; i < D.rows(); ++i)
-            d[i] = D.row(i).minCoeff(&nidx[i]);
-
-        // Determine which points moved
-        VectorXi moved = VectorXi::Zero(nidx.rows());
-        qint32 count = 0;
-        for(qint32 i = 0; i < nidx.rows(); ++i)
+        // Loosen the lower bounds by the largest movement of any other centroid
+        double dMaxDrift = 0.0;
+        double dSecondDrift = 0.0;
+        qint32 iMaxDrift = -1;
+        if(CpPrev.rows() == k)
         {
-            if(nidx[i] != previdx[i])
+            for(qint32 j = 0; j < k; ++j)
             {
-                moved[count] = i;
-                ++count;
+                double dDrift = Distance::drift(CpPrev, Cp, j);
+                if(std::isnan(dDrift))
+                    dDrift = std::numeric_limits<double>::infinity();
+
+                if(dDrift > dMaxDrift)
+                {
+                    dSecondDrift = dMaxDrift;
+                    dMaxDrift = dDrift;
+                    iMaxDrift = j;
+                }
+                else if(dDrift > dSecondDrift)
+                {
+                    dSecondDrift = dDrift;
+                }
             }
         }
-        moved.conservativeResize(count);
+        CpPrev = Cp;
 
-        if (moved.rows() > 0)
+        // Only points which are not provably closest to their own centroid are compared to all centroids
+        qint32 nCandidates = 0;
+        for(qint32 i = 0; i < n; ++i)
         {
-            // Resolve ties in favor of not moving
-            VectorXi moved_new = VectorXi::Zero(moved.rows());
-            count = 0;
-            for(qint32 i = 0; i < moved.rows(); ++i)
+            vecLower[i] -= idx[i] == iMaxDrift ? dSecondDrift : dMaxDrift;
+            if(Distance::metric(d[i]) > vecLower[i])
+                vecCandidates[nCandidates++] = i;
+        }
+
+        Xc.resize(nCandidates, p);
+        vecXcNorm2.resize(nCandidates);
+        for(qint32 r = 0; r < nCandidates; ++r)
+        {
+            Xc.row(r) = X.row(vecCandidates[r]);
+            vecXcNorm2[r] = m_vecXNorm2[vecCandidates[r]];
+        }
+        Distance::pairwise(Xc, vecXcNorm2, Cp, Dc);
+
+        // Determine closest cluster for each candidate, resolve ties in favor of not moving
+        vecMoved.clear();
+        vecMovedTo.clear();
+        for(qint32 r = 0; r < nCandidates; ++r)
+        {
+            qint32 i = vecCandidates[r];
+            qint32 iClosest = idx[i];
+            double dClosest = std::numeric_limits<double>::infinity();
+            double dSecond = std::numeric_limits<double>::infinity();
+            for(qint32 j = 0; j < k; ++j)
             {
-                if(D.array()(previdx[moved[i]] * n + moved[i]) > d[moved[i]])
+                double dDist = Dc(r,j);
+                if(dDist < dClosest)
                 {
-                    moved_new[count] = moved[i];
-                    ++count;
+                    dSecond = dClosest;
+                    dClosest = dDist;
+                    iClosest = j;
+                }
+                else if(dDist < dSecond)
+                {
+                    dSecond = dDist;
                 }
             }
-            moved_new.conservativeResize(count);
-            moved = moved_new;
+
+            vecLower[i] = Distance::metric(dSecond);
+
+            if(Dc(r,idx[i]) > dClosest)
+            {
+                vecMoved.push_back(i);
+                vecMovedTo.push_back(iClosest);
+            }
         }
 
-        if (moved.rows() == 0)
+        if (vecMoved.empty())
         {
             converged = true;
             break;
         }
 
-        for(qint32 i = 0; i < moved.rows(); ++i)
-            if(moved[i] >= 0)
-                idx[ moved[i] ] = nidx[ moved[i] ];
-
         // Find clusters that gained or lost members
         std::vector<int> tmp;
-        for(qint32 i = 0; i < moved.rows(); ++i)
-            tmp.push_back(idx[moved[i]]);
-        for(qint32 i = 0; i < moved.rows(); ++i)
-            tmp.push_back(previdx[moved[i]]);
+        for(size_t i = 0; i < vecMoved.size(); ++i)
+        {
+            tmp.push_back(idx[vecMoved[i]]);
+            tmp.push_back(vecMovedTo[i]);
+            idx[vecMoved[i]] = vecMovedTo[i];
+        }
 
         std::sort(tmp.begin(),tmp.end());
 
@@ -515,7 +776,7 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
     // Initialize some cluster information prior to phase two
     MatrixXd Xmid1;
     MatrixXd Xmid2;
-    if (m_sDistance.compare("cityblock") == 0)
+    if (m_distanceType == CityBlock)
     {
         Xmid1 = MatrixXd::Zero(k,p);
         Xmid2 = MatrixXd::Zero(k,p);
@@ -557,7 +818,7 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
             }
         }
     }
-    else if (m_sDistance.compare("hamming") == 0)
+    else if (m_distanceType == Hamming)
     {
 //    Xsum = zeros(k,p);
 //    for i = 1:k
@@ -600,8 +861,9 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
         // point will stay in its own cluster.  Happily, we get
         // Del(i,idx(i)) == 0 automatically for them.
 
-        if (m_sDistance.compare("sqeuclidean") == 0)
+        if (m_distanceType == SqEuclidean)
         {
+            VectorXd XCi;
             for(qint32 j = 0; j < changed.rows(); ++j)
             {
                 qint32 i = changed[j];
@@ -617,12 +879,13 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                         if(mbrs[l])
                             sgn[l] = 0; // prevent divide-by-zero for singleton mbrs
 
-                Del.col(i) = ((double)m[i] / ((double)m[i] + sgn.cast<double>().array()));
-
-                Del.col(i).array() *= (X - C.row(i).replicate(n,1)).array().pow(2).rowwise().sum().array();
+                // |x - c|^2 = |x|^2 + |c|^2 - 2 x'c
+                XCi.noalias() = X * C.row(i).transpose();
+                Del.col(i) = ((double)m[i] / ((double)m[i] + sgn.cast<double>().array()))
+                             * (m_vecXNorm2.array() + C.row(i).squaredNorm() - 2.0 * XCi.array()).cwiseMax(0.0);
             }
         }
-        else if (m_sDistance.compare("cityblock") == 0)
+        else if (m_distanceType == CityBlock)
         {
             for(qint32 j = 0; j < changed.rows(); ++j)
             {
@@ -651,7 +914,7 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                     Del.col(i) = ((X - C.row(i).replicate(n,1)).array().abs()).rowwise().sum();
             }
         }
-        else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+        else if (m_distanceType == Cosine || m_distanceType == Correlation)
         {
             // The points are normalized, centroids are not, so normalize them
             MatrixXd normC = C.array().pow(2).rowwise().sum().sqrt();
@@ -679,13 +942,11 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                 Del.col(i) = 1 + sgn.cast<double>().array()*
                         (A - (B + 2 * sgn.cast<double>().array() * m[i] * XCi.array() + 1).sqrt());
 
-                std::cout << "Del.col(i)\n" << Del.col(i) << std::endl;
-
 //                Del(:,i) = 1 + sgn .*...
 //                      (m(i).*normC(i) - sqrt((m(i).*normC(i)).^2 + 2.*sgn.*m(i).*XCi + 1));
             }
         }
-        else if (m_sDistance.compare("hamming") == 0)
+        else if (m_distanceType == Hamming)
         {
 //            for i = changed
 //                if mod(m(i),2) == 0 % this will never catch singleton clusters
@@ -788,12 +1049,12 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
         m( nidx[0] ) = m( nidx[0] ) + 1;
         m( oidx ) = m( oidx ) - 1;
 
-        if (m_sDistance.compare("sqeuclidean") == 0)
+        if (m_distanceType == SqEuclidean)
         {
             C.row(nidx[0]) = C.row(nidx[0]).array() + (X.row(moved[0]) - C.row(nidx[0])).array() / m[nidx[0]];
             C.row(oidx) = C.row(oidx).array() - (X.row(moved[0]) - C.row(oidx)).array() / m[oidx];
         }
-        else if (m_sDistance.compare("cityblock") == 0)
+        else if (m_distanceType == CityBlock)
         {
             VectorXi onidx(2);
             onidx << oidx, nidx[0];//ToDo always right?
@@ -841,12 +1102,12 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                 }
             }
         }
-        else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+        else if (m_distanceType == Cosine || m_distanceType == Correlation)
         {
             C.row(nidx[0]).array() += (X.row(moved[0]) - C.row(nidx[0])).array() / m[nidx[0]];
             C.row(oidx).array() += (X.row(moved[0]) - C.row(oidx)).array() / m[oidx];
         }
-        else if (m_sDistance.compare("hamming") == 0)
+        else if (m_distanceType == Hamming)
         {
 //                % Update summed coords for points in each cluster.  New
 //                % centroid is the coord median.  All done component-wise.
@@ -867,58 +1128,21 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
 //=============================================================================================================
 //DISTFUN Calculate point to cluster centroid distances.
-MatrixXd KMeans::distfun(const MatrixXd& X, MatrixXd& C)//, qint32 iter)
+MatrixXd KMeans::distfun(const MatrixXd& X, const MatrixXd& C)
 {
-    MatrixXd D = MatrixXd::Zero(n,C.rows());
-    qint32 nclusts = C.rows();
-
-    if (m_sDistance.compare("sqeuclidean") == 0)
+    switch(m_distanceType)
     {
-        for(qint32 i = 0; i < nclusts; ++i)
-        {
-            D.col(i) = (X.col(0).array() - C(i,0)).pow(2);
-
-            for(qint32 j = 1; j < p; ++j)
-                D.col(i) = D.col(i).array() + (X.col(j).array() - C(i,j)).pow(2);
-        }
+        case CityBlock:
+            return pairwiseDistances<CityBlock>(X, m_vecXNorm2, C);
+        case Cosine:
+            return pairwiseDistances<Cosine>(X, m_vecXNorm2, C);
+        case Correlation:
+            return pairwiseDistances<Correlation>(X, m_vecXNorm2, C);
+        case Hamming:
+            return pairwiseDistances<Hamming>(X, m_vecXNorm2, C);
+        default:
+            return pairwiseDistances<SqEuclidean>(X, m_vecXNorm2, C);
     }
-    else if (m_sDistance.compare("cityblock") == 0)
-    {
-        for(qint32 i = 0; i < nclusts; ++i)
-        {
-            D.col(i) = (X.col(0).array() - C(i,0)).array().abs();
-            for(qint32 j = 1; j < p; ++j)
-            {
-                D.col(i).array() += (X.col(j).array() - C(i,j)).array().abs();
-            }
-        }
-    }
-    else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
-    {
-        // The points are normalized, centroids are not, so normalize them
-        MatrixXd normC = C.array().pow(2).rowwise().sum().sqrt();
-//        if any(normC < eps(class(normC))) % small relative to unit-length data points
-//            error('Zero cluster centroid created at iteration %d.',iter);
-        for (qint32 i = 0; i < nclusts; ++i)
-        {
-            MatrixXd C_tmp = (C.row(i).array() / normC(i,0)).transpose();
-            D.col(i) = X * C_tmp;//max(1 - X * (C(i,:)./normC(i))', 0);
-            for(qint32 j = 0; j < D.rows(); ++j)
-                if(D(j,i) < 0)
-                    D(j,i) = 0;
-        }
-    }
-//case 'hamming'
-//    for i = 1:nclusts
-//        D(:,i) = abs(X(:,1) - C(i,1));
-//        for j = 2:p
-//            D(:,i) = D(:,i) + abs(X(:,j) - C(i,j));
-//        end
-//        D(:,i) = D(:,i) / p;
-//        % D(:,i) = sum(abs(X - C(repmat(i,n,1),:)), 2) / p;
-//    end
-//end
-    return D;
 } // function
 
 //=============================================================================================================
@@ -931,41 +1155,25 @@ void KMeans::gcentroids(const MatrixXd& X, const VectorXi& index, const VectorXi
     centroids.fill(std::numeric_limits<double>::quiet_NaN());
     counts = VectorXi::Zero(num);
 
-    VectorXi members;
+    // Map the cluster indeces to the rows of the centroids, one pass over the points collects all of them
+    VectorXi slots = VectorXi::Constant(k, -1);
+    for(qint32 i = 0; i < num; ++i)
+        slots[clusts[i]] = i;
 
-    qint32 c;
+    for(qint32 j = 0; j < index.rows(); ++j)
+        if(slots[index[j]] >= 0)
+            ++counts[slots[index[j]]];
 
-    for(qint32 i = 0; i < num; ++i)
+    if(m_distanceType == CityBlock)
     {
-        c = 0;
-        members = VectorXi::Zero(index.rows());
-        for(qint32 j = 0; j < index.rows(); ++j)
+        for(qint32 i = 0; i < num; ++i)
         {
-            if(index[j] == clusts[i])
-            {
-                members[c] = j;
-                ++c;
-            }
-        }
-        members.conservativeResize(c);
-        if (c > 0)
-        {
-            counts[i] = c;
-            if(m_sDistance.compare("sqeuclidean") == 0)
-            {
-                //Initialize
-                if(members.rows() > 0)
-                    centroids.row(i) = RowVectorXd::Zero(centroids.cols());
-
-                for(qint32 j = 0; j < members.rows(); ++j)
-                    centroids.row(i).array() += X.row(members[j]).array() / counts[i];
-            }
-            else if(m_sDistance.compare("cityblock") == 0)
+            if (counts[i] > 0)
             {
                 // Separate out sorted coords for points in i'th cluster,
                 // and use to compute a fast median, component-wise
                 MatrixXd Xsorted(counts[i],p);
-                c = 0;
+                qint32 c = 0;
 
                 for(qint32 j = 0; j < index.rows(); ++j)
                 {
@@ -985,33 +1193,23 @@ void KMeans::gcentroids(const MatrixXd& X, const VectorXi& index, const VectorXi
                 else
                     centroids.row(i) = Xsorted.row(nn+1);
             }
-            else if(m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
-            {
-                for(qint32 j = 0; j < members.rows(); ++j)
-                    centroids.row(i).array() += X.row(members[j]).array() / counts[i]; // unnormalized
-            }
-//            else if(m_sDistance.compare("hamming") == 0)
-//            {
-//                % Compute a fast median for binary data, component-wise
-//                centroids(i,:) = .5*sign(2*sum(X(members,:), 1) - counts(i)) + .5;
-//            }
         }
     }
-}// function
-
-//=============================================================================================================
-
-double KMeans::unifrnd(double a, double b)
-{
-    if (a > b)
-        return std::numeric_limits<double>::quiet_NaN();
-
-    double a2 = a/2.0;
-    double b2 = b/2.0;
-    double mu = a2+b2;
-    double sig = b2-a2;
-
-    double r = mu + sig * (2.0* (rand() % 1000)/1000 -1.0);
+    else if(m_distanceType == SqEuclidean || m_distanceType == Cosine || m_distanceType == Correlation)
+    {
+        // Cosine and correlation centroids stay unnormalized
+        MatrixXd sums = MatrixXd::Zero(num,p);
+        for(qint32 j = 0; j < index.rows(); ++j)
+            if(slots[index[j]] >= 0)
+                sums.row(slots[index[j]]) += X.row(j);
 
-    return r;
-}
+        for(qint32 i = 0; i < num; ++i)
+            if(counts[i] > 0)
+                centroids.row(i) = sums.row(i) / counts[i];
+    }
+//    else if(m_distanceType == Hamming)
+//    {
+//        % Compute a fast median for binary data, component-wise
+//        centroids(i,:) = .5*sign(2*sum(X(members,:), 1) - counts(i)) + .5;
+//    }
+}// function
@@ -75,15 +75,26 @@ public:
     typedef QSharedPointer<const KMeans> ConstSPtr; /**< Const shared pointer type for KMeans. */
 
     //distance {'sqeuclidean','cityblock','cosine','correlation','hamming'};
-    //startNames = {'uniform','sample','cluster'};
+    //startNames = {'uniform','sample','kmeans++','cluster'};
     //emptyactNames = {'error','drop','singleton'};
 
+    /**
+     * Distance measure. Resolved once from the distance name, the distance kernels are selected at compile time.
+     */
+    enum DistanceType {
+        SqEuclidean,
+        CityBlock,
+        Cosine,
+        Correlation,
+        Hamming
+    };
+
     //=========================================================================================================
     /**
      * Constructs a KMeans algorithm object.
      *
      * @param[in] distance   (optional) K-Means distance measure: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming"
-     * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "cluster"
+     * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "kmeans++", "cluster"
      * @param[in] replicates (optional) Number of K-Means replicates, which are generated. Best is returned.
      * @param[in] emptyact   (optional) What happens if a cluster wents empty: "error" (default), "drop", "singleton"
      * @param[in] online     (optional) If centroids should be updated during iterations: true (default), false
@@ -98,7 +109,16 @@ public:
 
     //=========================================================================================================
     /**
-     * Clusters input data X
+     * Sets the seed of the random generators. Replicate r is initialized with the seed iSeed + r, which makes the
+     * result reproducible independent of the order in which the replicates are processed.
+     *
+     * @param[in] iSeed      The seed; 0 by default.
+     */
+    void setSeed(quint32 iSeed);
+
+    //=========================================================================================================
+    /**
+     * Clusters input data X. The replicates are processed in parallel, the best one is returned.
      *
      * @param[in] X          Input data (rows = points; cols = p dimensional space)
      * @param[in] kClusters  Number of k clusters
@@ -115,6 +135,40 @@ public:
                     Eigen::MatrixXd& D);
 
 private:
+    //=========================================================================================================
+    /**
+     * Runs a single replicate, starting from the centroids drawn with the given seed.
+     *
+     * @param[in] X          Input data (rows = points; cols = p dimensional space)
+     * @param[in] iSeed      Seed of the random generator used for the initialization
+     * @param[out] idx       The cluster indeces to which cluster the input points belong to
+     * @param[out] C         Cluster centroids k x p
+     * @param[out] sumD      Summation of the distances to the centroid within one cluster
+     * @param[out] D         Cluster distances to the centroid
+     *
+     * @return The total sum of distances, infinity if the replicate failed.
+     */
+    double runReplicate(const Eigen::MatrixXd& X,
+                        quint32 iSeed,
+                        Eigen::VectorXi& idx,
+                        Eigen::MatrixXd& C,
+                        Eigen::VectorXd& sumD,
+                        Eigen::MatrixXd& D);
+
+    //=========================================================================================================
+    /**
+     * Draws the initial centroids according to the start method.
+     *
+     * @param[in] X          Input data
+     * @param[in] iSeed      Seed of the random generator
+     * @param[out] C         The initial centroids k x p
+     *
+     * @return true if successful, false otherwise
+     */
+    bool initCentroids(const Eigen::MatrixXd& X,
+                       quint32 iSeed,
+                       Eigen::MatrixXd& C);
+
     //=========================================================================================================
     /**
      * Calculate point to cluster centroid distances.
@@ -125,11 +179,12 @@ private:
      * @return Cluster centroid distances
      */
     Eigen::MatrixXd distfun(const Eigen::MatrixXd& X,
-                            Eigen::MatrixXd& C);//, qint32 iter);
+                            const Eigen::MatrixXd& C);
 
     //=========================================================================================================
     /**
-     * Updates clusters when points moved
+     * Updates clusters when points moved. Points are only compared against all centroids when the distance to their
+     * own centroid exceeds a lower bound on the distance to any other centroid (Hamerly).
      *
      * @param[in] X          Input data
      * @param[in, out] C     Cluster centroids
@@ -137,6 +192,7 @@ private:
      *
      * @return true if converged, false otherwise
      */
+    template<DistanceType T>
     bool batchUpdate(const Eigen::MatrixXd& X,
                      Eigen::MatrixXd& C,
                      Eigen::VectorXi& idx);
@@ -171,25 +227,16 @@ private:
                       Eigen::MatrixXd& C,
                       Eigen::VectorXi& idx);
 
-    //=========================================================================================================
-    /**
-     * Uniform random generator in the intervall [a, b]
-     *
-     * @param[in] a      lower boundary
-     * @param[in] b      upper boundary
-     *
-     * @return random number
-     */
-    double unifrnd(double a, double b);
-
     QString m_sDistance;    /**< Distance measurement to use: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming". */
-    QString m_sStart;       /**< Initialization to use: "sample" (default), "uniform", "cluster". */
+    DistanceType m_distanceType;    /**< The distance measurement resolved from m_sDistance. */
+    QString m_sStart;       /**< Initialization to use: "sample" (default), "uniform", "kmeans++", "cluster". */
     qint32 m_iReps;         /**< Number of K-Means replicates, which should be generated. */
     QString m_sEmptyact;    /**< What should be done if a cluster wents empty: "error" (default), "drop", "singleton" */
     qint32 m_iMaxit;        /**< Maximal number of iterations per replicate */
     bool m_bOnline;         /**< If online update should be performed */
+    quint32 m_iSeed;        /**< Seed of the first replicate */
 
-    qint32 emptyErrCnt;     /**< Counts the occurence of empty errors */
+    Eigen::VectorXd m_vecXNorm2;    /**< Squared norms of the input points */
 
     qint32 iter;            /**< Current iteration */
     qint32 k;               /**< Number of clusters */
@@ -41,7 +41,6 @@
 // EIGEN INCLUDES
 //=============================================================================================================
 
-#include <Eigen/SparseCore>
 #include <unsupported/Eigen/FFT>
 
 //=============================================================================================================
@@ -49,10 +48,18 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QList>
 #include <QElapsedTimer>
 #include <QThread>
 #include <QtConcurrent>
 
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+#include <cmath>
+
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
@@ -64,53 +71,110 @@ using namespace Eigen;
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
-MatrixXd Spectrogram::makeSpectrogram(VectorXd signal, qint32 windowSize = 0)
+MatrixXd Spectrogram::makeSpectrogram(VectorXd signal,
+                                      qint32 windowSize,
+                                      qint32 iHopSize,
+                                      qint32 iNfft)
+{
+    QVector<MatrixXd> lResult = makeSpectrograms(signal.transpose(),
+                                                 windowSize,
+                                                 iHopSize,
+                                                 iNfft);
+
+    return lResult.isEmpty() ? MatrixXd() : lResult.first();
+}
+
+//=============================================================================================================
+
+QVector<MatrixXd> Spectrogram::makeSpectrograms(const MatrixXd& matData,
+                                                qint32 windowSize,
+                                                qint32 iHopSize,
+                                                qint32 iNfft)
 {
     //QElapsedTimer timer;
     //timer.start();
 
-    signal.array() -= signal.mean();
-    QList<SpectogramInputData> lData;
-    int iThreadSize = QThread::idealThreadCount()*2;
-    int iStepsSize = signal.rows()/iThreadSize;
-    int iResidual = signal.rows()%iThreadSize;
-
-    SpectogramInputData dataTemp;
-    dataTemp.vecInputData = signal;
-    dataTemp.window_size = windowSize;
-    if(dataTemp.window_size == 0) {
-        dataTemp.window_size = signal.rows()/15;
+    QVector<MatrixXd> lResult;
+
+    if(matData.rows() == 0 || matData.cols() == 0) {
+        qWarning() << "[Spectrogram::makeSpectrograms] Input data is empty. Returning.";
+        return lResult;
+    }
+
+    int iNumSamples = matData.cols();
+
+    if(windowSize <= 0) {
+        windowSize = std::max(1, iNumSamples/15);
+    }
+
+    iHopSize = std::max(1, int(iHopSize));
+
+    // The window is only evaluated where it is not negligible, so the fft length depends on the window size and
+    // not on the signal length
+    VectorXd vecWindow = gaussWindow(windowSize);
+
+    int iMinNfft = 1;
+    while(iMinNfft < vecWindow.size()) {
+        iMinNfft <<= 1;
+    }
+
+    if(iNfft <= 0) {
+        iNfft = iMinNfft;
+    } else if(iNfft < vecWindow.size()) {
+        qWarning() << "[Spectrogram::makeSpectrograms] Fft length" << iNfft << "is shorter than the window support" << vecWindow.size() << ". Using" << iMinNfft << "instead.";
+        iNfft = iMinNfft;
     }
 
-    for (int i = 0; i < iThreadSize; ++i) {
-        dataTemp.iRangeLow = i*iStepsSize;
-        dataTemp.iRangeHigh = i*iStepsSize+iStepsSize;
-        lData.append(dataTemp);
+    int iNumFrames = (iNumSamples + iHopSize - 1) / iHopSize;
+
+    // Remove the mean of each channel and preallocate one output per channel
+    QVector<VectorXd> lSignals(int(matData.rows()));
+    lResult.resize(int(matData.rows()));
+
+    for(int i = 0; i < matData.rows(); ++i) {
+        lSignals[i] = matData.row(i).transpose();
+        lSignals[i].array() -= lSignals[i].mean();
+        lResult[i].resize(iNfft/2, iNumFrames);
     }
 
-    dataTemp.iRangeLow = iThreadSize*iStepsSize;
-    dataTemp.iRangeHigh = iThreadSize*iStepsSize+iResidual;
-    lData.append(dataTemp);
+    // Split the frames of all channels into chunks, each chunk writes its own columns of the output
+    int iNumChunksPerChannel = std::max(1, QThread::idealThreadCount() * 2 / int(matData.rows()));
+    iNumChunksPerChannel = std::min(iNumChunksPerChannel, iNumFrames);
+    int iStepsSize = iNumFrames / iNumChunksPerChannel;
+
+    QList<SpectrogramChunk> lChunks;
+
+    for(int i = 0; i < matData.rows(); ++i) {
+        for(int j = 0; j < iNumChunksPerChannel; ++j) {
+            SpectrogramChunk chunk;
+            chunk.pSignal = &lSignals.at(i);
+            chunk.pResult = &lResult[i];
+            chunk.iFirstFrame = j * iStepsSize;
+            chunk.iLastFrame = (j == iNumChunksPerChannel - 1) ? iNumFrames : (j + 1) * iStepsSize;
+            lChunks.append(chunk);
+        }
+    }
 
-    QFuture<MatrixXd> resultMat = QtConcurrent::mappedReduced(lData,
-                                                              compute,
-                                                              reduce);
-    resultMat.waitForFinished();
+    QtConcurrent::blockingMap(lChunks, [&vecWindow, iHopSize, iNfft](const SpectrogramChunk& chunk) {
+        compute(chunk, vecWindow, iHopSize, iNfft);
+    });
 
-    //qDebug() << "Spectrogram::make_spectrogram - timer.elapsed()" << timer.elapsed();
-    return resultMat.result();
+    //qDebug() << "Spectrogram::makeSpectrograms - timer.elapsed()" << timer.elapsed();
+    return lResult;
 }
 
 //=============================================================================================================
 
-VectorXd Spectrogram::gaussWindow(qint32 sample_count, qreal scale, quint32 translation)
+VectorXd Spectrogram::gaussWindow(qreal scale)
 {
-    VectorXd gauss = VectorXd::Zero(sample_count);
+    // exp(-pi * 2.5^2) is below 3e-9, everything outside of +-2.5 scales is truncated
+    int iHalfSize = std::max(0, int(std::ceil(2.5 * scale)));
+    VectorXd gauss(2 * iHalfSize + 1);
 
-    for(qint32 n = 0; n < sample_count; n++)
+    for(qint32 n = -iHalfSize; n <= iHalfSize; n++)
     {
-        qreal t = (qreal(n) - translation) / scale;
-        gauss[n] = exp(-3.14 * pow(t, 2))*pow(sqrt(scale),(-1))*pow(qreal(2),(0.25));
+        qreal t = qreal(n) / scale;
+        gauss[n + iHalfSize] = exp(-3.14 * pow(t, 2))*pow(sqrt(scale),(-1))*pow(qreal(2),(0.25));
     }
 
     return gauss;
@@ -118,44 +182,37 @@ VectorXd Spectrogram::gaussWindow(qint32 sample_count, qreal scale, quint32 tran
 
 //=============================================================================================================
 
-MatrixXd Spectrogram::compute(const SpectogramInputData& inputData)
+void Spectrogram::compute(const SpectrogramChunk& chunk,
+                          const VectorXd& vecWindow,
+                          qint32 iHopSize,
+                          qint32 iNfft)
 {
     #ifdef EIGEN_FFTW_DEFAULT
         fftw_make_planner_thread_safe();
     #endif
 
     Eigen::FFT<double> fft;
-    MatrixXd tf_matrix = MatrixXd::Zero(inputData.vecInputData.rows()/2, inputData.vecInputData.rows());
-    VectorXd envelope, windowed_sig, real_coeffs;
-    VectorXcd fft_win_sig;
-    qint32 window_size = inputData.window_size;
-
-    for(quint32 translate = inputData.iRangeLow; translate < inputData.iRangeHigh; translate++) {
-        envelope = gaussWindow(inputData.vecInputData.rows(), window_size, translate);
+    fft.SetFlag(fft.HalfSpectrum);
 
-        windowed_sig = VectorXd::Zero(inputData.vecInputData.rows());
-        fft_win_sig = VectorXcd::Zero(inputData.vecInputData.rows());
+    const VectorXd& vecSignal = *chunk.pSignal;
+    int iNumSamples = vecSignal.rows();
+    int iHalfSize = (vecWindow.rows() - 1) / 2;
 
-        windowed_sig = inputData.vecInputData.array() * envelope.array();\
+    VectorXd windowed_sig(iNfft);
+    VectorXcd fft_win_sig(iNfft/2 + 1);
 
-        fft.fwd(fft_win_sig, windowed_sig);
-
-        real_coeffs = fft_win_sig.segment(0,inputData.vecInputData.rows()/2).array().abs2();
-
-        tf_matrix.col(translate) = real_coeffs;
-    }
+    for(int iFrame = chunk.iFirstFrame; iFrame < chunk.iLastFrame; ++iFrame) {
+        int translate = iFrame * iHopSize;
+        int iFrom = std::max(0, translate - iHalfSize);
+        int iTo = std::min(iNumSamples, translate + iHalfSize + 1);
+        int iLength = iTo - iFrom;
 
-    return tf_matrix;
-}
+        // The position of the segment inside the fft buffer only changes the phase, not the power
+        windowed_sig.setZero();
+        windowed_sig.head(iLength) = vecSignal.segment(iFrom, iLength).cwiseProduct(vecWindow.segment(iFrom - translate + iHalfSize, iLength));
 
-//=============================================================================================================
+        fft.fwd(fft_win_sig, windowed_sig);
 
-void Spectrogram::reduce(MatrixXd &resultData,
-                         const MatrixXd &data)
-{
-    if(resultData.size() == 0) {
-        resultData = data;
-    } else {
-        resultData += data;
+        chunk.pResult->col(iFrame) = fft_win_sig.head(iNfft/2).cwiseAbs2();
     }
 }
@@ -40,6 +40,12 @@
 
 #include "utils_global.h"
 
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QVector>
+
 //=============================================================================================================
 // EIGEN INCLUDES
 //=============================================================================================================
@@ -53,11 +59,15 @@
 namespace UTILSLIB
 {
 
-struct SpectogramInputData {
-    Eigen::VectorXd vecInputData;
-    quint32 iRangeLow;
-    quint32 iRangeHigh;
-    qint32 window_size;
+//=============================================================================================================
+/**
+ * A range of frames [iFirstFrame, iLastFrame) of one channel, computed by one worker thread.
+ */
+struct SpectrogramChunk {
+    const Eigen::VectorXd*  pSignal;        /**< The mean free input signal. */
+    Eigen::MatrixXd*        pResult;        /**< The preallocated output, the chunk only writes its own columns. */
+    int                     iFirstFrame;    /**< The first frame to compute. */
+    int                     iLastFrame;     /**< One past the last frame to compute. */
 };
 
 class UTILSSHARED_EXPORT Spectrogram
@@ -69,47 +79,59 @@ public:
      * Calculates the spectrogram (tf-representation) of a given signal
      *
      * @param[in] signal         input-signal to calculate spectrogram of
-     * @param[in] windowSize     size of the window which is used (resolution in time an frequency is depending on it)
+     * @param[in] windowSize     size of the window which is used (resolution in time an frequency is depending on it).
+     *                           0 uses a fifteenth of the signal length.
+     * @param[in] iHopSize       number of samples between two consecutive frames. Default is 1.
+     * @param[in] iNfft          fft length. 0 uses the next power of two above the effective window support.
      *
-     * @return spectrogram-matrix (tf-representation of the input signal)
+     * @return spectrogram-matrix (tf-representation of the input signal), iNfft/2 frequency bins x frames
      */
     static Eigen::MatrixXd makeSpectrogram(Eigen::VectorXd signal,
-                                           qint32 windowSize);
+                                           qint32 windowSize = 0,
+                                           qint32 iHopSize = 1,
+                                           qint32 iNfft = 0);
 
-private:
     //=========================================================================================================
     /**
-     * Calculates a gaussean window function
+     * Calculates the spectrograms of all rows of a given data matrix in one call. All channels and frames are
+     * distributed over the thread pool, each thread writes to disjoint columns of the preallocated outputs.
      *
-     * @param[in] sample_count   number of samples
-     * @param[in] scale          window width
-     * @param[in] translation    translation of the window among a signal
+     * @param[in] matData        input-data (channels x samples)
+     * @param[in] windowSize     size of the window which is used. 0 uses a fifteenth of the signal length.
+     * @param[in] iHopSize       number of samples between two consecutive frames. Default is 1.
+     * @param[in] iNfft          fft length. 0 uses the next power of two above the effective window support.
      *
-     * @return samples of window-vector
+     * @return one spectrogram-matrix per row of matData, iNfft/2 frequency bins x frames each
      */
-    static Eigen::VectorXd gaussWindow (qint32 sample_count,
-                                        qreal scale,
-                                        quint32 translation);
+    static QVector<Eigen::MatrixXd> makeSpectrograms(const Eigen::MatrixXd& matData,
+                                                     qint32 windowSize = 0,
+                                                     qint32 iHopSize = 1,
+                                                     qint32 iNfft = 0);
 
+private:
     //=========================================================================================================
     /**
-     * Calculates the spectogram matrix for a given input data matrix.
+     * Calculates a gaussean window function, truncated to its effective support
      *
-     * @param[in] data       The input data.
+     * @param[in] scale          window width
      *
-     * @return               The spectogram matrix.
+     * @return samples of window-vector, centered at its middle sample
      */
-    static Eigen::MatrixXd compute(const SpectogramInputData& data);
+    static Eigen::VectorXd gaussWindow(qreal scale);
 
     //=========================================================================================================
     /**
-     * Sums up (reduces) the in parallel processed spectogram matrix.
+     * Calculates the spectogram columns of one chunk.
      *
-     * @param[out] resultData    The result data.
-     * @param[in]  data          The incoming, temporary result data.
+     * @param[in] chunk          The chunk to compute.
+     * @param[in] vecWindow      The truncated window.
+     * @param[in] iHopSize       The number of samples between two consecutive frames.
+     * @param[in] iNfft          The fft length.
      */
-    static void reduce(Eigen::MatrixXd &resultData,
-                       const Eigen::MatrixXd &data);
+    static void compute(const SpectrogramChunk& chunk,
+                        const Eigen::VectorXd& vecWindow,
+                        qint32 iHopSize,
+                        qint32 iNfft);
 };
 }//namespace
 
@@ -63,6 +63,7 @@ contains(MNECPP_CONFIG, static) {
 
 SOURCES += \
     kmeans.cpp \
+    kdtree.cpp \
     mnemath.cpp \
     ioutils.cpp \
     layoutloader.cpp \
@@ -73,10 +74,12 @@ SOURCES += \
     sphere.cpp \
     generics/observerpattern.cpp \
     generics/applicationlogger.cpp \
+    generics/columnringbuffer.cpp \
     spectral.cpp
 
 HEADERS += \
     kmeans.h\
+    kdtree.h \
     utils_global.h \
     mnemath.h \
     ioutils.h \
@@ -88,6 +91,7 @@ HEADERS += \
     sphere.h \
     simplex_algorithm.h \
     generics/circularbuffer.h \
+    generics/columnringbuffer.h \
     generics/commandpattern.h \
     generics/observerpattern.h \
     generics/applicationlogger.h \
@@ -65,3 +65,8 @@ applications.depends = libraries
 examples.depends = libraries
 testframes.depends = libraries
 
+# Some tests link against the mne_analyze shared library
+!contains(MNECPP_CONFIG, noApplications) {
+    testframes.depends += applications
+}
+
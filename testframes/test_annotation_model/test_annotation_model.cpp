@@ -0,0 +1,344 @@
+//=============================================================================================================
+/**
+ * @file     test_annotation_model.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test and benchmarks for the event bookkeeping of the AnnotationModel.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <anShared/Model/annotationmodel.h>
+
+#include <algorithm>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QScopedPointer>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace ANSHAREDLIB;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestAnnotationModel
+ *
+ * @brief The TestAnnotationModel class provides tests and benchmarks for inserting, sorting, filtering and
+ *        range querying events in the AnnotationModel.
+ *
+ */
+class TestAnnotationModel: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestAnnotationModel();
+
+private slots:
+    void initTestCase();
+    void testSortedOrder();
+    void testFilteredOrder();
+    void testAnnotationRange();
+    void benchmarkInsertEvents_data();
+    void benchmarkInsertEvents();
+    void benchmarkAnnotationRange_data();
+    void benchmarkAnnotationRange();
+    void benchmarkEventFilter_data();
+    void benchmarkEventFilter();
+    void cleanupTestCase();
+
+private:
+    void addSizes();
+    AnnotationModel* createModel() const;
+    QVector<int> generateSamples(int iNumEvents,
+                                 quint32 uSeed) const;
+    QVector<int> getFilteredSamples(const AnnotationModel& model) const;
+
+    int m_iMaxSample;
+    int m_iNumQueries;
+};
+
+//=============================================================================================================
+
+TestAnnotationModel::TestAnnotationModel()
+: m_iMaxSample(10000000)
+, m_iNumQueries(1000)
+{
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::initTestCase()
+{
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::testSortedOrder()
+{
+    QScopedPointer<AnnotationModel> pModel(createModel());
+
+    // Insert several unsorted batches, the model has to keep all events sorted by sample
+    QVector<int> vecAll;
+    for(int i = 0; i < 3; ++i) {
+        QVector<int> vecSamples = generateSamples(5000, 10 + i);
+        vecAll.append(vecSamples);
+        pModel->insertEvents(vecSamples);
+    }
+
+    std::sort(vecAll.begin(), vecAll.end());
+
+    QCOMPARE(pModel->getNumberOfAnnotations(), vecAll.size());
+    QCOMPARE(getFilteredSamples(*pModel), vecAll);
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::testFilteredOrder()
+{
+    QScopedPointer<AnnotationModel> pModel(createModel());
+
+    // Events of the group type 0
+    QVector<int> vecTypeZero = generateSamples(4000, 20);
+    pModel->insertEvents(vecTypeZero);
+
+    // Events of type 2, inserted while the filter is active
+    QVector<int> vecTypeTwo = generateSamples(3000, 21);
+    pModel->setEventFilterType("2");
+    pModel->insertEvents(vecTypeTwo);
+
+    std::sort(vecTypeZero.begin(), vecTypeZero.end());
+    std::sort(vecTypeTwo.begin(), vecTypeTwo.end());
+
+    // Only the type 2 events are visible and sorted
+    QCOMPARE(getFilteredSamples(*pModel), vecTypeTwo);
+    for(int i = 0; i < pModel->getNumberOfAnnotations(); ++i) {
+        QCOMPARE(pModel->data(pModel->index(i, 2)).toInt(), 2);
+    }
+
+    pModel->setEventFilterType("0");
+    QCOMPARE(getFilteredSamples(*pModel), vecTypeZero);
+    for(int i = 0; i < pModel->getNumberOfAnnotations(); ++i) {
+        QCOMPARE(pModel->data(pModel->index(i, 2)).toInt(), 0);
+    }
+
+    // Without a filter all events are visible, sorted by sample
+    pModel->setEventFilterType("All");
+
+    QVector<int> vecAll = vecTypeZero + vecTypeTwo;
+    std::sort(vecAll.begin(), vecAll.end());
+    QCOMPARE(getFilteredSamples(*pModel), vecAll);
+
+    int iNumTypeTwo = 0;
+    for(int i = 0; i < pModel->getNumberOfAnnotations(); ++i) {
+        if(pModel->data(pModel->index(i, 2)).toInt() == 2) {
+            ++iNumTypeTwo;
+        }
+    }
+    QCOMPARE(iNumTypeTwo, vecTypeTwo.size());
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::testAnnotationRange()
+{
+    QScopedPointer<AnnotationModel> pModel(createModel());
+
+    QVector<int> vecSamples = generateSamples(20000, 30);
+    pModel->insertEvents(vecSamples);
+
+    // Compare the binary search against a linear count, including windows outside of the event range
+    QRandomGenerator generator(31);
+    for(int i = 0; i < m_iNumQueries; ++i) {
+        int iFirstSample = generator.bounded(-1000, m_iMaxSample + 1000);
+        int iLastSample = iFirstSample + generator.bounded(0, m_iMaxSample / 100);
+
+        int iFirst = std::count_if(vecSamples.constBegin(), vecSamples.constEnd(), [iFirstSample](int iSample) {
+            return iSample < iFirstSample;
+        });
+        int iLast = std::count_if(vecSamples.constBegin(), vecSamples.constEnd(), [iLastSample](int iSample) {
+            return iSample <= iLastSample;
+        });
+
+        QPair<int,int> range = pModel->getAnnotationRange(iFirstSample, iLastSample);
+        QCOMPARE(range.first, iFirst);
+        QCOMPARE(range.second, iLast);
+
+        for(int j = range.first; j < range.second; ++j) {
+            QVERIFY(pModel->getAnnotation(j) >= iFirstSample && pModel->getAnnotation(j) <= iLastSample);
+        }
+    }
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::benchmarkInsertEvents_data()
+{
+    addSizes();
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::benchmarkInsertEvents()
+{
+    QFETCH(int, iNumEvents);
+
+    QVector<int> vecSamples = generateSamples(iNumEvents, 40);
+
+    QBENCHMARK {
+        QScopedPointer<AnnotationModel> pModel(createModel());
+        pModel->insertEvents(vecSamples);
+    }
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::benchmarkAnnotationRange_data()
+{
+    addSizes();
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::benchmarkAnnotationRange()
+{
+    QFETCH(int, iNumEvents);
+
+    QScopedPointer<AnnotationModel> pModel(createModel());
+    pModel->insertEvents(generateSamples(iNumEvents, 50));
+
+    // Windows of one second at 1 kHz, as requested when painting the raw data view
+    QVector<int> vecFirstSamples = generateSamples(m_iNumQueries, 51);
+    qint64 iNumVisible = 0;
+
+    QBENCHMARK {
+        for(int i = 0; i < vecFirstSamples.size(); ++i) {
+            QPair<int,int> range = pModel->getAnnotationRange(vecFirstSamples.at(i), vecFirstSamples.at(i) + 1000);
+            iNumVisible += range.second - range.first;
+        }
+    }
+
+    QVERIFY(iNumVisible >= 0);
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::benchmarkEventFilter_data()
+{
+    addSizes();
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::benchmarkEventFilter()
+{
+    QFETCH(int, iNumEvents);
+
+    QScopedPointer<AnnotationModel> pModel(createModel());
+    pModel->insertEvents(generateSamples(iNumEvents / 2, 60));
+    pModel->setEventFilterType("2");
+    pModel->insertEvents(generateSamples(iNumEvents / 2, 61));
+
+    QBENCHMARK {
+        pModel->setEventFilterType("All");
+        pModel->setEventFilterType("2");
+    }
+
+    QCOMPARE(pModel->getNumberOfAnnotations(), iNumEvents / 2);
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+void TestAnnotationModel::addSizes()
+{
+    QTest::addColumn<int>("iNumEvents");
+
+    QTest::newRow("10^4 events") << 10000;
+    QTest::newRow("10^5 events") << 100000;
+    QTest::newRow("10^6 events") << 1000000;
+}
+
+//=============================================================================================================
+
+AnnotationModel* TestAnnotationModel::createModel() const
+{
+    AnnotationModel* pModel = new AnnotationModel();
+    pModel->switchGroup(pModel->createGroup("Test"));
+
+    return pModel;
+}
+
+//=============================================================================================================
+
+QVector<int> TestAnnotationModel::generateSamples(int iNumEvents,
+                                                  quint32 uSeed) const
+{
+    QRandomGenerator generator(uSeed);
+
+    QVector<int> vecSamples(iNumEvents);
+    for(int i = 0; i < iNumEvents; ++i) {
+        vecSamples[i] = generator.bounded(m_iMaxSample);
+    }
+
+    return vecSamples;
+}
+
+//=============================================================================================================
+
+QVector<int> TestAnnotationModel::getFilteredSamples(const AnnotationModel& model) const
+{
+    QVector<int> vecSamples(model.getNumberOfAnnotations());
+    for(int i = 0; i < vecSamples.size(); ++i) {
+        vecSamples[i] = model.getAnnotation(i);
+    }
+
+    return vecSamples;
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestAnnotationModel)
+#include "test_annotation_model.moc"
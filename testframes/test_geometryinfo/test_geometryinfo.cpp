@@ -84,8 +84,10 @@ private slots:
     void initTestCase();
     void testBadChannelFiltering();
     void testEmptyInputsForProjecting();
+    void testProjectingAgainstLinearSearch();
     void testEmptyInputsForSCDC();
     void testDimensionsForSCDC();
+    void testSparseSCDC();
     void cleanupTestCase();
 
 private:
@@ -188,6 +190,26 @@ void TestGeometryInfo::testEmptyInputsForProjecting() {
 
 //=============================================================================================================
 
+void TestGeometryInfo::testProjectingAgainstLinearSearch() {
+    QVector<Vector3f> vSensors;
+    for(int i = 0; i < 50; ++i) {
+        vSensors.push_back(Vector3f::Random());
+    }
+
+    QVector<int> vMapping = GeometryInfo::projectSensors(smallSurface.rr, vSensors);
+    QVERIFY(vMapping.size() == vSensors.size());
+
+    for(int i = 0; i < vSensors.size(); ++i) {
+        float fMinDist = std::numeric_limits<float>::max();
+        for(int v = 0; v < smallSurface.rr.rows(); ++v) {
+            fMinDist = std::min(fMinDist, (smallSurface.rr.row(v).transpose() - vSensors[i]).squaredNorm());
+        }
+        QVERIFY(qFuzzyCompare((smallSurface.rr.row(vMapping[i]).transpose() - vSensors[i]).squaredNorm(), fMinDist));
+    }
+}
+
+//=============================================================================================================
+
 void TestGeometryInfo::testEmptyInputsForSCDC() {
     QVector<int> vVertSubset;
     QSharedPointer<MatrixXd> pDistTable = GeometryInfo::scdc(smallSurface.rr, smallSurface.neighbor_vert, vVertSubset);
@@ -204,6 +226,29 @@ void TestGeometryInfo::testDimensionsForSCDC() {
 
 //=============================================================================================================
 
+void TestGeometryInfo::testSparseSCDC() {
+    const double dCancelDist = 0.5;
+    QSharedPointer<MatrixXd> pDistTable = GeometryInfo::scdc(smallSurface.rr, smallSurface.neighbor_vert, vSmallSubset, dCancelDist);
+    QSharedPointer<SparseMatrix<float, RowMajor> > pSparseDistTable = GeometryInfo::scdcSparse(smallSurface.rr, smallSurface.neighbor_vert, vSmallSubset, dCancelDist);
+
+    QVERIFY(pSparseDistTable->rows() == pDistTable->rows());
+    QVERIFY(pSparseDistTable->cols() == pDistTable->cols());
+
+    // the sparse table has to hold exactly the distances of the dense table which lie within the cancel distance
+    qint64 iWithinCancelDist = 0;
+    for (qint32 row = 0; row < pDistTable->rows(); ++row) {
+        for (qint32 col = 0; col < pDistTable->cols(); ++col) {
+            if (pDistTable->coeff(row, col) <= dCancelDist) {
+                QVERIFY(qAbs(pSparseDistTable->coeff(row, col) - float(pDistTable->coeff(row, col))) < 1e-6f);
+                iWithinCancelDist++;
+            }
+        }
+    }
+    QVERIFY(pSparseDistTable->nonZeros() == iWithinCancelDist);
+}
+
+//=============================================================================================================
+
 void TestGeometryInfo::cleanupTestCase() {
 }
 
@@ -0,0 +1,308 @@
+//=============================================================================================================
+/**
+ * @file     test_hpi_demodulator.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of the block wise HPI lock-in demodulation on synthetic coil signals.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <inverse/hpiFit/hpidemodulator.h>
+
+#include <cmath>
+
+#include <Eigen/Dense>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QRandomGenerator>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestHpiDemodulator
+ *
+ * @brief The TestHpiDemodulator class feeds coil signals with known amplitudes and phases block wise through the
+ *        HPIDemodulator and checks the recovered amplitudes and phases.
+ *
+ */
+class TestHpiDemodulator: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestHpiDemodulator();
+
+private slots:
+    void initTestCase();
+    void compareBoxcar();
+    void compareExponential();
+    void compareBlockSizes();
+    void compareAmplitudeChange();
+    void compareNoise();
+    void cleanupTestCase();
+
+private:
+    MatrixXd generateData(const MatrixXd& matAmp,
+                          const MatrixXd& matPhase,
+                          qint64 iFirstSample,
+                          int iNumSamples,
+                          double dNoise = 0.0);
+    void appendBlockWise(HPIDemodulator& demodulator,
+                         const MatrixXd& matData,
+                         int iBlockSize) const;
+    void compareAmplitudes(const HPIDemodulator& demodulator,
+                           const MatrixXd& matAmp,
+                           const MatrixXd& matPhase,
+                           double dErrorAmp,
+                           double dErrorPhase) const;
+
+    double              m_dSFreq;
+    QVector<int>        m_vecFreqs;
+    int                 m_iNumChannels;
+    double              m_dErrorAmp;
+    double              m_dErrorPhase;
+    MatrixXd            m_matAmp;
+    MatrixXd            m_matPhase;
+    VectorXd            m_vecOffset;
+    QRandomGenerator    m_generator;
+};
+
+//=============================================================================================================
+
+TestHpiDemodulator::TestHpiDemodulator()
+: m_dSFreq(1000.0)
+, m_iNumChannels(6)
+, m_dErrorAmp(1e-8)
+, m_dErrorPhase(1e-8)
+, m_generator(1)
+{
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::initTestCase()
+{
+    // The coil frequencies of a VectorView system, only a few Hz apart from each other
+    m_vecFreqs << 166 << 154 << 161 << 158;
+
+    // Known amplitudes (fT scale) and phases of every coil on every channel, and a channel offset
+    m_matAmp.resize(m_iNumChannels, m_vecFreqs.size());
+    m_matPhase.resize(m_iNumChannels, m_vecFreqs.size());
+    m_vecOffset.resize(m_iNumChannels);
+
+    for(int c = 0; c < m_iNumChannels; ++c) {
+        for(int k = 0; k < m_vecFreqs.size(); ++k) {
+            m_matAmp(c,k) = 1e-13 * (1.0 + 9.0 * m_generator.generateDouble());
+            m_matPhase(c,k) = M_PI * (2.0 * m_generator.generateDouble() - 1.0);
+        }
+
+        m_vecOffset(c) = 1e-12 * (2.0 * m_generator.generateDouble() - 1.0);
+    }
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::compareBoxcar()
+{
+    HPIDemodulator demodulator(m_dSFreq, m_vecFreqs, m_iNumChannels, 0.2, HPIDemodulator::Boxcar);
+
+    // Not ready before one window length was appended
+    appendBlockWise(demodulator, generateData(m_matAmp, m_matPhase, 0, 150), 50);
+    QVERIFY(!demodulator.isReady());
+
+    appendBlockWise(demodulator, generateData(m_matAmp, m_matPhase, 150, 850), 50);
+    QVERIFY(demodulator.isReady());
+
+    compareAmplitudes(demodulator, m_matAmp, m_matPhase, m_dErrorAmp, m_dErrorPhase);
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::compareExponential()
+{
+    HPIDemodulator demodulator(m_dSFreq, m_vecFreqs, m_iNumChannels, 0.2, HPIDemodulator::Exponential);
+
+    appendBlockWise(demodulator, generateData(m_matAmp, m_matPhase, 0, 1000), 100);
+    QVERIFY(demodulator.isReady());
+
+    compareAmplitudes(demodulator, m_matAmp, m_matPhase, m_dErrorAmp, m_dErrorPhase);
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::compareBlockSizes()
+{
+    MatrixXd matData = generateData(m_matAmp, m_matPhase, 0, 1200);
+
+    // The amplitudes must not depend on how the stream is split into blocks, including splits that wrap the
+    // boxcar ring buffer
+    QList<HPIDemodulator::WindowType> lTypes;
+    lTypes << HPIDemodulator::Boxcar << HPIDemodulator::Exponential;
+
+    for(int t = 0; t < lTypes.size(); ++t) {
+        HPIDemodulator reference(m_dSFreq, m_vecFreqs, m_iNumChannels, 0.2, lTypes.at(t));
+        reference.append(matData);
+        MatrixXd matRefAmp = reference.getAmplitudes();
+
+        QVector<int> vecBlockSizes;
+        vecBlockSizes << 1 << 7 << 64 << 199 << 200 << 201 << 333;
+
+        for(int i = 0; i < vecBlockSizes.size(); ++i) {
+            HPIDemodulator demodulator(m_dSFreq, m_vecFreqs, m_iNumChannels, 0.2, lTypes.at(t));
+            appendBlockWise(demodulator, matData, vecBlockSizes.at(i));
+
+            double dError = (demodulator.getAmplitudes() - matRefAmp).cwiseAbs().maxCoeff() / matRefAmp.cwiseAbs().maxCoeff();
+            QVERIFY(dError < m_dErrorAmp);
+        }
+    }
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::compareAmplitudeChange()
+{
+    // The boxcar window forgets the old amplitudes after one window length
+    HPIDemodulator demodulator(m_dSFreq, m_vecFreqs, m_iNumChannels, 0.2, HPIDemodulator::Boxcar);
+
+    MatrixXd matAmpNew = 0.5 * m_matAmp;
+    MatrixXd matPhaseNew = m_matPhase.array() + 0.3;
+
+    appendBlockWise(demodulator, generateData(m_matAmp, m_matPhase, 0, 1000), 100);
+    appendBlockWise(demodulator, generateData(matAmpNew, matPhaseNew, 1000, 200), 30);
+
+    compareAmplitudes(demodulator, matAmpNew, matPhaseNew, m_dErrorAmp, m_dErrorPhase);
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::compareNoise()
+{
+    // White noise at half of the smallest coil amplitude averages out over a window of one second
+    HPIDemodulator demodulator(m_dSFreq, m_vecFreqs, m_iNumChannels, 1.0, HPIDemodulator::Boxcar);
+
+    appendBlockWise(demodulator, generateData(m_matAmp, m_matPhase, 0, 2000, 5e-14), 100);
+
+    compareAmplitudes(demodulator, m_matAmp, m_matPhase, 0.1, 0.1);
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+MatrixXd TestHpiDemodulator::generateData(const MatrixXd& matAmp,
+                                          const MatrixXd& matPhase,
+                                          qint64 iFirstSample,
+                                          int iNumSamples,
+                                          double dNoise)
+{
+    MatrixXd matData(m_iNumChannels, iNumSamples);
+
+    for(int c = 0; c < m_iNumChannels; ++c) {
+        for(int j = 0; j < iNumSamples; ++j) {
+            double dValue = m_vecOffset(c);
+
+            for(int k = 0; k < m_vecFreqs.size(); ++k) {
+                double dTime = double(iFirstSample + j) / m_dSFreq;
+                dValue += matAmp(c,k) * std::sin(2.0 * M_PI * m_vecFreqs.at(k) * dTime + matPhase(c,k));
+            }
+
+            if(dNoise > 0.0) {
+                dValue += dNoise * std::sqrt(3.0) * (2.0 * m_generator.generateDouble() - 1.0);
+            }
+
+            matData(c,j) = dValue;
+        }
+    }
+
+    return matData;
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::appendBlockWise(HPIDemodulator& demodulator,
+                                         const MatrixXd& matData,
+                                         int iBlockSize) const
+{
+    for(int iFrom = 0; iFrom < matData.cols(); iFrom += iBlockSize) {
+        demodulator.append(matData.middleCols(iFrom, std::min(iBlockSize, int(matData.cols()) - iFrom)));
+    }
+}
+
+//=============================================================================================================
+
+void TestHpiDemodulator::compareAmplitudes(const HPIDemodulator& demodulator,
+                                           const MatrixXd& matAmp,
+                                           const MatrixXd& matPhase,
+                                           double dErrorAmp,
+                                           double dErrorPhase) const
+{
+    // a*sin(wt + phi) = a*cos(phi)*sin(wt) + a*sin(phi)*cos(wt)
+    int iNumCoils = m_vecFreqs.size();
+    MatrixXd matResult = demodulator.getAmplitudes();
+
+    QCOMPARE(int(matResult.rows()), m_iNumChannels);
+    QCOMPARE(int(matResult.cols()), 2 * iNumCoils);
+
+    for(int c = 0; c < m_iNumChannels; ++c) {
+        for(int k = 0; k < iNumCoils; ++k) {
+            double dSin = matResult(c,k);
+            double dCos = matResult(c,k + iNumCoils);
+
+            double dAmp = std::sqrt(dSin * dSin + dCos * dCos);
+            double dPhaseDiff = std::remainder(std::atan2(dCos, dSin) - matPhase(c,k), 2.0 * M_PI);
+
+            QVERIFY(std::fabs(dAmp - matAmp(c,k)) / matAmp(c,k) < dErrorAmp);
+            QVERIFY(std::fabs(dPhaseDiff) < dErrorPhase);
+        }
+    }
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestHpiDemodulator)
+#include "test_hpi_demodulator.moc"
@@ -0,0 +1,466 @@
+//=============================================================================================================
+/**
+ * @file     test_hpi_fit_data.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of the HPI coil dipole fit on simulated data.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <inverse/hpiFit/hpifit.h>
+#include <inverse/hpiFit/hpifitdata.h>
+
+#include <utils/mnemath.h>
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QRandomGenerator>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestHpiFitData
+ *
+ * @brief The TestHpiFitData class fits simulated coil fields with the Levenberg-Marquardt solver of HPIFitData and
+ *        compares the results with the known coil positions and with the previous Nelder-Mead simplex fit.
+ *
+ */
+class TestHpiFitData: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestHpiFitData();
+
+private slots:
+    void initTestCase();
+    void compareKnownPositions();
+    void compareReferenceFit();
+    void compareNoiseFree();
+    void cleanupTestCase();
+
+private:
+    VectorXd simulate(const Vector3d& vecPos,
+                      const Vector3d& vecMoment,
+                      const MatrixXd& matProjector,
+                      double dNoise);
+    void fit(const Vector3d& vecStart,
+             const VectorXd& vecData,
+             const MatrixXd& matProjector,
+             HPIFitData& coil) const;
+    MatrixX3d referenceLeadfield(const Vector3d& vecPos) const;
+    double referenceError(const Vector3d& vecPos,
+                          const VectorXd& vecData,
+                          const MatrixXd& matProjector,
+                          Vector3d& vecMoment) const;
+    Vector3d referenceFit(const Vector3d& vecStart,
+                          const VectorXd& vecData,
+                          const MatrixXd& matProjector,
+                          int& iNumIter) const;
+    Vector3d randomDirection();
+    double randomNormal();
+
+    int                 m_iNumSensors;
+    int                 m_iNumPoints;
+    double              m_dNoise;
+    double              m_dStartOffset;
+    SensorSet           m_sensors;
+    MatrixXd            m_matIdentity;
+    MatrixXd            m_matProjector;
+    MatrixX3d           m_matCoils;
+    QRandomGenerator    m_generator;
+};
+
+//=============================================================================================================
+
+TestHpiFitData::TestHpiFitData()
+: m_iNumSensors(120)
+, m_iNumPoints(4)
+, m_dNoise(0.01)
+, m_dStartOffset(0.005)
+, m_generator(1)
+{
+}
+
+//=============================================================================================================
+
+void TestHpiFitData::initTestCase()
+{
+    // Magnetometers on a helmet shaped cap with a radius of 12 cm, each with four integration points
+    m_sensors.ncoils = m_iNumSensors;
+    m_sensors.np = m_iNumPoints;
+    m_sensors.r0.resize(m_iNumSensors, 3);
+    m_sensors.rmag.resize(m_iNumSensors * m_iNumPoints, 3);
+    m_sensors.cosmag.resize(m_iNumSensors * m_iNumPoints, 3);
+    m_sensors.w.resize(m_iNumSensors * m_iNumPoints);
+    m_sensors.tra = MatrixXd::Identity(m_iNumSensors, m_iNumSensors);
+
+    const double dGoldenAngle = M_PI * (3.0 - std::sqrt(5.0));
+
+    for(int i = 0; i < m_iNumSensors; ++i) {
+        double dTheta = std::acos(1.0 - 0.9 * (i + 0.5) / m_iNumSensors);
+        double dPhi = i * dGoldenAngle;
+        Vector3d vecNormal(std::sin(dTheta) * std::cos(dPhi), std::sin(dTheta) * std::sin(dPhi), std::cos(dTheta));
+        Vector3d vecCenter = 0.12 * vecNormal;
+
+        Vector3d vecTan1 = vecNormal.cross(std::abs(vecNormal(0)) < 0.9 ? Vector3d::UnitX() : Vector3d::UnitY()).normalized();
+        Vector3d vecTan2 = vecNormal.cross(vecTan1);
+
+        m_sensors.r0.row(i) = vecCenter.transpose();
+
+        for(int p = 0; p < m_iNumPoints; ++p) {
+            double dAngle = p * M_PI / 2.0;
+            Vector3d vecPoint = vecCenter + 0.005 * (std::cos(dAngle) * vecTan1 + std::sin(dAngle) * vecTan2);
+
+            m_sensors.rmag.row(i * m_iNumPoints + p) = vecPoint.transpose();
+            m_sensors.cosmag.row(i * m_iNumPoints + p) = vecNormal.transpose();
+            m_sensors.w(i * m_iNumPoints + p) = 1.0 / m_iNumPoints;
+        }
+    }
+
+    // A single SSP vector, like the projectors applied to real data
+    VectorXd vecSsp(m_iNumSensors);
+    for(int i = 0; i < m_iNumSensors; ++i) {
+        vecSsp(i) = randomNormal();
+    }
+    vecSsp.normalize();
+
+    m_matIdentity = MatrixXd::Identity(m_iNumSensors, m_iNumSensors);
+    m_matProjector = m_matIdentity - vecSsp * vecSsp.transpose();
+
+    // Four coils on the head surface
+    m_matCoils.resize(4, 3);
+    m_matCoils << 0.06, 0.0, 0.05,
+                  -0.06, 0.0, 0.05,
+                  0.0, 0.06, 0.05,
+                  0.0, -0.06, 0.05;
+}
+
+//=============================================================================================================
+
+void TestHpiFitData::compareKnownPositions()
+{
+    for(int c = 0; c < m_matCoils.rows(); ++c) {
+        Vector3d vecTrue = m_matCoils.row(c).transpose();
+        VectorXd vecData = simulate(vecTrue, 1e-8 * randomDirection(), m_matIdentity, m_dNoise);
+
+        HPIFitData coil;
+        fit(vecTrue + m_dStartOffset * randomDirection(), vecData, m_matIdentity, coil);
+
+        // With 1 % noise the coils are found within a millimeter and the GoF is close to one
+        QVERIFY((coil.coilPos.transpose() - vecTrue).norm() < 1e-3);
+        QVERIFY(1.0 - coil.errorInfo.error > 0.999);
+        QVERIFY(coil.errorInfo.numIterations > 0 && coil.errorInfo.numIterations < 100);
+
+        // The reported error and moment belong to the fitted position
+        Vector3d vecMoment;
+        double dError = referenceError(coil.coilPos.transpose(), vecData, m_matIdentity, vecMoment);
+        QVERIFY(qAbs(coil.errorInfo.error - dError) < 1e-9);
+        QVERIFY((coil.errorInfo.moment - vecMoment).norm() < 1e-6 * vecMoment.norm());
+    }
+}
+
+//=============================================================================================================
+
+void TestHpiFitData::compareReferenceFit()
+{
+    QList<const MatrixXd*> lProjectors;
+    lProjectors << &m_matIdentity << &m_matProjector;
+
+    for(const MatrixXd* pProjector : lProjectors) {
+        for(int c = 0; c < m_matCoils.rows(); ++c) {
+            Vector3d vecTrue = m_matCoils.row(c).transpose();
+            Vector3d vecStart = vecTrue + m_dStartOffset * randomDirection();
+            VectorXd vecData = simulate(vecTrue, 1e-8 * randomDirection(), *pProjector, m_dNoise);
+
+            HPIFitData coil;
+            fit(vecStart, vecData, *pProjector, coil);
+
+            int iRefIter = 0;
+            Vector3d vecRefMoment;
+            Vector3d vecRefPos = referenceFit(vecStart, vecData, *pProjector, iRefIter);
+            double dRefError = referenceError(vecRefPos, vecData, *pProjector, vecRefMoment);
+
+            // Both minimize the same objective. The simplex often stops on the flat bottom of it, some tenths of a
+            // millimeter away from the minimum, so the new fit has to agree within a millimeter and be at least as good.
+            QVERIFY((coil.coilPos.transpose() - vecRefPos).norm() < 1e-3);
+            QVERIFY(qAbs((1.0 - coil.errorInfo.error) - (1.0 - dRefError)) < 1e-3);
+            QVERIFY(coil.errorInfo.error <= dRefError * (1.0 + 1e-6));
+            QVERIFY(coil.errorInfo.numIterations < iRefIter);
+        }
+    }
+}
+
+//=============================================================================================================
+
+void TestHpiFitData::compareNoiseFree()
+{
+    for(int c = 0; c < m_matCoils.rows(); ++c) {
+        Vector3d vecTrue = m_matCoils.row(c).transpose();
+        Vector3d vecMoment = 1e-8 * randomDirection();
+        VectorXd vecData = simulate(vecTrue, vecMoment, m_matIdentity, 0.0);
+
+        HPIFitData coil;
+        fit(vecTrue + m_dStartOffset * randomDirection(), vecData, m_matIdentity, coil);
+
+        QVERIFY((coil.coilPos.transpose() - vecTrue).norm() < 1e-6);
+        QVERIFY(coil.errorInfo.error < 1e-10);
+        QVERIFY((coil.errorInfo.moment - vecMoment).norm() < 1e-4 * vecMoment.norm());
+    }
+}
+
+//=============================================================================================================
+
+void TestHpiFitData::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+VectorXd TestHpiFitData::simulate(const Vector3d& vecPos,
+                                  const Vector3d& vecMoment,
+                                  const MatrixXd& matProjector,
+                                  double dNoise)
+{
+    VectorXd vecData = matProjector * referenceLeadfield(vecPos) * vecMoment;
+
+    // White noise relative to the rms of the field
+    double dNoiseStd = dNoise * std::sqrt(vecData.squaredNorm() / vecData.size());
+    for(int i = 0; i < vecData.size(); ++i) {
+        vecData(i) += dNoiseStd * randomNormal();
+    }
+
+    return vecData;
+}
+
+//=============================================================================================================
+
+void TestHpiFitData::fit(const Vector3d& vecStart,
+                         const VectorXd& vecData,
+                         const MatrixXd& matProjector,
+                         HPIFitData& coil) const
+{
+    coil.coilPos = vecStart.transpose();
+    coil.sensorData = vecData;
+    coil.pSensors = &m_sensors;
+    coil.pMatProjector = &matProjector;
+    coil.doDipfitConcurrent();
+}
+
+//=============================================================================================================
+
+MatrixX3d TestHpiFitData::referenceLeadfield(const Vector3d& vecPos) const
+{
+    // Magnetic dipole in an infinite medium, averaged over the integration points of each sensor
+    MatrixX3d matLf = MatrixX3d::Zero(m_iNumSensors, 3);
+
+    for(int p = 0; p < m_sensors.rmag.rows(); ++p) {
+        Vector3d vecDiff = m_sensors.rmag.row(p).transpose() - vecPos;
+        Vector3d vecOri = m_sensors.cosmag.row(p).transpose();
+        double dR = vecDiff.norm();
+
+        Matrix3d matT = 3.0 * vecDiff * vecDiff.transpose() - dR * dR * Matrix3d::Identity();
+        RowVector3d vecLf = 1e-7 * (matT * vecOri).transpose() / (4.0 * M_PI * std::pow(dR, 5));
+
+        matLf.row(p / m_iNumPoints) += m_sensors.w(p) * vecLf;
+    }
+
+    return matLf;
+}
+
+//=============================================================================================================
+
+double TestHpiFitData::referenceError(const Vector3d& vecPos,
+                                      const VectorXd& vecData,
+                                      const MatrixXd& matProjector,
+                                      Vector3d& vecMoment) const
+{
+    // The objective of the previous implementation, with the moment from the pseudo inverse
+    MatrixXd matLf = referenceLeadfield(vecPos);
+    vecMoment = MNEMath::pinv(matLf) * vecData;
+
+    VectorXd vecDiff = vecData - matProjector * matLf * vecMoment;
+
+    return vecDiff.squaredNorm() / vecData.squaredNorm();
+}
+
+//=============================================================================================================
+
+Vector3d TestHpiFitData::referenceFit(const Vector3d& vecStart,
+                                      const VectorXd& vecData,
+                                      const MatrixXd& matProjector,
+                                      int& iNumIter) const
+{
+    // The Nelder-Mead simplex of the previous implementation, with its parameters and tolerances
+    const double dTolX = 1e-5;
+    const double dTolF = 1e-5;
+    const double dRho = 1.0;
+    const double dChi = 2.0;
+    const double dPsi = 0.5;
+    const double dSigma = 0.5;
+    const int iMaxIter = 200;
+    const int iMaxFun = 2 * iMaxIter * 3;
+
+    Vector3d vecMoment;
+    Matrix<double, 3, 4> matV;
+    Vector4d vecF;
+
+    matV.col(0) = vecStart;
+    vecF(0) = referenceError(vecStart, vecData, matProjector, vecMoment);
+
+    for(int j = 0; j < 3; ++j) {
+        Vector3d vecY = vecStart;
+        vecY(j) = vecY(j) != 0.0 ? 1.05 * vecY(j) : 0.00025;
+        matV.col(j + 1) = vecY;
+        vecF(j + 1) = referenceError(vecY, vecData, matProjector, vecMoment);
+    }
+
+    auto sortSimplex = [&matV, &vecF]() {
+        Vector4i vecIdx(0, 1, 2, 3);
+        std::sort(vecIdx.data(), vecIdx.data() + 4, [&vecF](int a, int b) { return vecF(a) < vecF(b); });
+
+        Matrix<double, 3, 4> matSorted;
+        Vector4d vecSorted;
+        for(int i = 0; i < 4; ++i) {
+            matSorted.col(i) = matV.col(vecIdx(i));
+            vecSorted(i) = vecF(vecIdx(i));
+        }
+        matV = matSorted;
+        vecF = vecSorted;
+    };
+
+    sortSimplex();
+    int iFunEvals = 4;
+    iNumIter = 1;
+
+    while(iFunEvals < iMaxFun && iNumIter < iMaxIter) {
+        if((vecF.tail<3>().array() - vecF(0)).abs().maxCoeff() <= dTolF
+           && (matV.rightCols<3>().colwise() - matV.col(0)).cwiseAbs().maxCoeff() <= dTolX) {
+            break;
+        }
+
+        Vector3d vecBar = matV.leftCols<3>().rowwise().mean();
+        Vector3d vecR = (1.0 + dRho) * vecBar - dRho * matV.col(3);
+        double dFr = referenceError(vecR, vecData, matProjector, vecMoment);
+        ++iFunEvals;
+
+        bool bShrink = false;
+
+        if(dFr < vecF(0)) {
+            Vector3d vecE = (1.0 + dRho * dChi) * vecBar - dRho * dChi * matV.col(3);
+            double dFe = referenceError(vecE, vecData, matProjector, vecMoment);
+            ++iFunEvals;
+
+            matV.col(3) = dFe < dFr ? vecE : vecR;
+            vecF(3) = qMin(dFe, dFr);
+        } else if(dFr < vecF(2)) {
+            matV.col(3) = vecR;
+            vecF(3) = dFr;
+        } else if(dFr < vecF(3)) {
+            Vector3d vecC = (1.0 + dPsi * dRho) * vecBar - dPsi * dRho * matV.col(3);
+            double dFc = referenceError(vecC, vecData, matProjector, vecMoment);
+            ++iFunEvals;
+
+            if(dFc <= dFr) {
+                matV.col(3) = vecC;
+                vecF(3) = dFc;
+            } else {
+                bShrink = true;
+            }
+        } else {
+            Vector3d vecCC = (1.0 - dPsi) * vecBar + dPsi * matV.col(3);
+            double dFcc = referenceError(vecCC, vecData, matProjector, vecMoment);
+            ++iFunEvals;
+
+            if(dFcc < vecF(3)) {
+                matV.col(3) = vecCC;
+                vecF(3) = dFcc;
+            } else {
+                bShrink = true;
+            }
+        }
+
+        if(bShrink) {
+            for(int j = 1; j < 4; ++j) {
+                matV.col(j) = matV.col(0) + dSigma * (matV.col(j) - matV.col(0));
+                vecF(j) = referenceError(matV.col(j), vecData, matProjector, vecMoment);
+            }
+        }
+
+        sortSimplex();
+        ++iNumIter;
+    }
+
+    return matV.col(0);
+}
+
+//=============================================================================================================
+
+Vector3d TestHpiFitData::randomDirection()
+{
+    Vector3d vecDir(randomNormal(), randomNormal(), randomNormal());
+    return vecDir.normalized();
+}
+
+//=============================================================================================================
+
+double TestHpiFitData::randomNormal()
+{
+    // Box-Muller transform
+    double dU1 = 1.0 - m_generator.generateDouble();
+    double dU2 = m_generator.generateDouble();
+
+    return std::sqrt(-2.0 * std::log(dU1)) * std::cos(2.0 * M_PI * dU2);
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestHpiFitData)
+#include "test_hpi_fit_data.moc"
@@ -47,15 +47,18 @@
 
 #include <disp3D/helpers/geometryinfo/geometryinfo.h>
 #include <disp3D/helpers/interpolation/interpolation.h>
+#include <disp3D/helpers/interpolation/interpolationcache.h>
 #include <mne/mne_bem.h>
 #include <mne/mne_bem_surface.h>
 #include <string>
+#include <cstring>
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QtTest>
+#include <QTemporaryDir>
 
 //=============================================================================================================
 // USED NAMESPACES
@@ -85,6 +88,7 @@ private slots:
     void testDimensionsForInterpolation();
     void testSumOfRow();
     void testEmptyInputsForWeightMatrix();
+    void testCacheCorruptFiles();
     void cleanupTestCase();
 
 private:
@@ -248,6 +252,72 @@ void TestInterpolation::testEmptyInputsForWeightMatrix()
 
 //=============================================================================================================
 
+void TestInterpolation::testCacheCorruptFiles()
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    InterpolationCache cache(tempDir.path());
+
+    // 5 x 4 matrix with the outer indices 0, 2, 3, 3, 5
+    QVector<Triplet<float> > vecTriplets;
+    vecTriplets << Triplet<float>(0, 0, 0.5f) << Triplet<float>(3, 0, 0.5f)
+                << Triplet<float>(4, 1, 1.0f)
+                << Triplet<float>(1, 3, 0.25f) << Triplet<float>(2, 3, 0.75f);
+    SparseMatrix<float> matInterpolation(5, 4);
+    matInterpolation.setFromTriplets(vecTriplets.constBegin(), vecTriplets.constEnd());
+    matInterpolation.makeCompressed();
+
+    const QByteArray key = InterpolationCache::computeKey(smallSurface.rr,
+                                                          smallSurface.neighbor_vert,
+                                                          vSmallSubset,
+                                                          QVector<int>(),
+                                                          0.03,
+                                                          "Linear");
+    QVERIFY(cache.store(key, matInterpolation));
+
+    QSharedPointer<SparseMatrix<float> > pLoaded = cache.load(key);
+    QVERIFY(pLoaded);
+    QVERIFY(pLoaded->isApprox(matInterpolation));
+
+    QFile file(tempDir.path() + "/" + QString::fromLatin1(key) + ".imat");
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray validBytes = file.readAll();
+    file.close();
+
+    // The arrays are stored raw at the end of the file: outer indices, inner indices and values
+    const int iNonZeros = int(matInterpolation.nonZeros());
+    const int iOuterPos = validBytes.size() - (int(matInterpolation.cols()) + 1 + 2 * iNonZeros) * 4;
+    const int iInnerPos = iOuterPos + (int(matInterpolation.cols()) + 1) * 4;
+
+    QList<QPair<int, qint32> > lCorruptions;
+    lCorruptions << qMakePair(iOuterPos + 4, qint32(iNonZeros))     // decreasing outer indices
+                 << qMakePair(iInnerPos, qint32(5))                 // inner index equal to the number of rows
+                 << qMakePair(iInnerPos, qint32(-1))                // negative inner index
+                 << qMakePair(iInnerPos + 4, qint32(0))             // inner indices of a column not increasing
+                 << qMakePair(iOuterPos - 4, qint32(0x7F7F7F7F))    // number of non zeros beyond the file size, same in any byte order
+                 << qMakePair(iOuterPos - 8, qint32(0x7F7F7F7F));   // number of columns beyond the file size
+
+    for(const QPair<int, qint32>& corruption : lCorruptions) {
+        QByteArray corruptBytes = validBytes;
+        std::memcpy(corruptBytes.data() + corruption.first, &corruption.second, sizeof(qint32));
+
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(corruptBytes);
+        file.close();
+
+        QVERIFY(!cache.load(key));
+    }
+
+    // Truncated file
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(validBytes.left(validBytes.size() - 4));
+    file.close();
+    QVERIFY(!cache.load(key));
+}
+
+//=============================================================================================================
+
 void TestInterpolation::cleanupTestCase()
 {
 }
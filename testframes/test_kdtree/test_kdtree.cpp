@@ -0,0 +1,304 @@
+//=============================================================================================================
+/**
+ * @file     test_kdtree.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of the k-d tree queries against a brute force search.
+ *
+ */
+
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/kdtree.h>
+
+#include <Eigen/Core>
+
+#include <algorithm>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QRandomGenerator>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestKdTree
+ *
+ * @brief The TestKdTree class compares the nearest, k-nearest and radius queries of the KdTree with a brute force
+ *        search on random point clouds.
+ *
+ */
+class TestKdTree: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestKdTree();
+
+private slots:
+    void initTestCase();
+    void compareNearest();
+    void compareNearestBatch();
+    void compareKNearest();
+    void compareRadius();
+    void compareEmpty();
+    void cleanupTestCase();
+
+private:
+    MatrixX3f randomPoints(int iNumPoints);
+    QVector<float> bruteForceDistances(const Vector3f& vecQuery) const;
+
+    int                 m_iNumPoints;
+    int                 m_iNumQueries;
+    float               m_fEpsilon;
+    MatrixX3f           m_matPoints;
+    MatrixX3f           m_matQueries;
+    QRandomGenerator    m_generator;
+};
+
+//=============================================================================================================
+
+TestKdTree::TestKdTree()
+: m_iNumPoints(2000)
+, m_iNumQueries(500)
+, m_fEpsilon(1e-5f)
+, m_generator(1)
+{
+}
+
+//=============================================================================================================
+
+void TestKdTree::initTestCase()
+{
+    // Random cloud with duplicated points and a cluster of identical points, which is larger than a leaf
+    MatrixX3f matRandom = randomPoints(m_iNumPoints);
+    int iNumDuplicates = 100;
+    int iClusterSize = 40;
+
+    m_matPoints.resize(m_iNumPoints + iNumDuplicates + iClusterSize, 3);
+    m_matPoints.topRows(m_iNumPoints) = matRandom;
+    m_matPoints.middleRows(m_iNumPoints, iNumDuplicates) = matRandom.topRows(iNumDuplicates);
+    m_matPoints.bottomRows(iClusterSize) = matRandom.row(m_iNumPoints - 1).replicate(iClusterSize, 1);
+
+    // Random queries, queries which hit the points exactly and queries far outside of the cloud
+    m_matQueries.resize(m_iNumQueries + 20 + 10, 3);
+    m_matQueries.topRows(m_iNumQueries) = randomPoints(m_iNumQueries);
+    m_matQueries.middleRows(m_iNumQueries, 20) = m_matPoints.bottomRows(20);
+    m_matQueries.bottomRows(10) = (10.0f * randomPoints(10).array() + 5.0f).matrix();
+}
+
+//=============================================================================================================
+
+void TestKdTree::compareNearest()
+{
+    KdTree tree(m_matPoints);
+    QCOMPARE(tree.size(), int(m_matPoints.rows()));
+
+    for(int i = 0; i < m_matQueries.rows(); ++i) {
+        Vector3f vecQuery = m_matQueries.row(i).transpose();
+        QVector<float> vecDistances = bruteForceDistances(vecQuery);
+        float fMinDist = *std::min_element(vecDistances.constBegin(), vecDistances.constEnd());
+
+        // Duplicates have the same distance, so any of them is a valid result
+        float fDist = -1.0f;
+        int iNearest = tree.nearest(vecQuery, &fDist);
+        QVERIFY(iNearest >= 0 && iNearest < m_matPoints.rows());
+        QVERIFY(qAbs(vecDistances.at(iNearest) - fMinDist) <= m_fEpsilon);
+        QVERIFY(qAbs(fDist - fMinDist) <= m_fEpsilon);
+    }
+}
+
+//=============================================================================================================
+
+void TestKdTree::compareNearestBatch()
+{
+    // Large batches run in parallel, small ones sequentially
+    KdTree tree(m_matPoints, 4);
+
+    QList<int> lBatchSizes;
+    lBatchSizes << 10 << int(m_matQueries.rows());
+
+    for(int iBatchSize : lBatchSizes) {
+        QVector<int> vecNearest = tree.nearestBatch(m_matQueries.topRows(iBatchSize));
+        QCOMPARE(vecNearest.size(), iBatchSize);
+
+        for(int i = 0; i < iBatchSize; ++i) {
+            QVector<float> vecDistances = bruteForceDistances(m_matQueries.row(i).transpose());
+            float fMinDist = *std::min_element(vecDistances.constBegin(), vecDistances.constEnd());
+
+            QVERIFY(vecNearest.at(i) >= 0 && vecNearest.at(i) < m_matPoints.rows());
+            QVERIFY(qAbs(vecDistances.at(vecNearest.at(i)) - fMinDist) <= m_fEpsilon);
+        }
+    }
+}
+
+//=============================================================================================================
+
+void TestKdTree::compareKNearest()
+{
+    KdTree tree(m_matPoints);
+
+    // k larger than the number of points returns all points
+    QList<int> lK;
+    lK << 1 << 7 << 45 << int(m_matPoints.rows()) + 5;
+
+    for(int k : lK) {
+        for(int i = 0; i < m_matQueries.rows(); i += 7) {
+            Vector3f vecQuery = m_matQueries.row(i).transpose();
+            QVector<float> vecDistances = bruteForceDistances(vecQuery);
+            QVector<float> vecSorted = vecDistances;
+            std::sort(vecSorted.begin(), vecSorted.end());
+
+            QVector<float> vecTreeDistances;
+            QVector<int> vecKNearest = tree.kNearest(vecQuery, k, &vecTreeDistances);
+
+            int iExpected = qMin(k, int(m_matPoints.rows()));
+            QCOMPARE(vecKNearest.size(), iExpected);
+            QCOMPARE(vecTreeDistances.size(), iExpected);
+
+            // The indices are unique and sorted by increasing distance, ties between duplicates in any order
+            QVector<int> vecUnique = vecKNearest;
+            std::sort(vecUnique.begin(), vecUnique.end());
+            QVERIFY(std::adjacent_find(vecUnique.constBegin(), vecUnique.constEnd()) == vecUnique.constEnd());
+
+            for(int j = 0; j < iExpected; ++j) {
+                QVERIFY(qAbs(vecDistances.at(vecKNearest.at(j)) - vecSorted.at(j)) <= m_fEpsilon);
+                QVERIFY(qAbs(vecTreeDistances.at(j) - vecSorted.at(j)) <= m_fEpsilon);
+            }
+        }
+    }
+
+    QVERIFY(tree.kNearest(Vector3f::Zero(), 0).isEmpty());
+}
+
+//=============================================================================================================
+
+void TestKdTree::compareRadius()
+{
+    KdTree tree(m_matPoints);
+
+    QList<float> lRadii;
+    lRadii << 0.0f << 0.05f << 0.2f << 10.0f;
+
+    for(float fRadius : lRadii) {
+        for(int i = 0; i < m_matQueries.rows(); i += 5) {
+            Vector3f vecQuery = m_matQueries.row(i).transpose();
+            QVector<float> vecDistances = bruteForceDistances(vecQuery);
+
+            QVector<int> vecFound = tree.radiusSearch(vecQuery, fRadius);
+            std::sort(vecFound.begin(), vecFound.end());
+            QVERIFY(std::adjacent_find(vecFound.constBegin(), vecFound.constEnd()) == vecFound.constEnd());
+
+            // Points close to the sphere may end up on either side due to rounding
+            for(int j = 0; j < vecDistances.size(); ++j) {
+                bool bFound = std::binary_search(vecFound.constBegin(), vecFound.constEnd(), j);
+
+                if(vecDistances.at(j) < fRadius - m_fEpsilon || vecDistances.at(j) == 0.0f) {
+                    QVERIFY(bFound);
+                } else if(vecDistances.at(j) > fRadius + m_fEpsilon) {
+                    QVERIFY(!bFound);
+                }
+            }
+        }
+    }
+
+    QVERIFY(tree.radiusSearch(Vector3f::Zero(), -1.0f).isEmpty());
+}
+
+//=============================================================================================================
+
+void TestKdTree::compareEmpty()
+{
+    KdTree tree(MatrixX3f(0, 3));
+    QCOMPARE(tree.size(), 0);
+
+    float fDist = 0.0f;
+    QCOMPARE(tree.nearest(Vector3f::Zero(), &fDist), -1);
+    QVERIFY(qIsInf(fDist));
+    QVERIFY(tree.kNearest(Vector3f::Zero(), 3).isEmpty());
+    QVERIFY(tree.radiusSearch(Vector3f::Zero(), 1.0f).isEmpty());
+    QVERIFY(tree.nearestBatch(MatrixX3f(0, 3)).isEmpty());
+
+    // A single point
+    MatrixX3f matSingle(1, 3);
+    matSingle << 0.1f, 0.2f, 0.3f;
+    KdTree treeSingle(matSingle);
+    QCOMPARE(treeSingle.nearest(Vector3f::Zero()), 0);
+    QCOMPARE(treeSingle.kNearest(Vector3f::Zero(), 4).size(), 1);
+}
+
+//=============================================================================================================
+
+void TestKdTree::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+MatrixX3f TestKdTree::randomPoints(int iNumPoints)
+{
+    MatrixX3f matPoints(iNumPoints, 3);
+    for(int i = 0; i < iNumPoints; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            matPoints(i,j) = float(m_generator.generateDouble());
+        }
+    }
+
+    return matPoints;
+}
+
+//=============================================================================================================
+
+QVector<float> TestKdTree::bruteForceDistances(const Vector3f& vecQuery) const
+{
+    QVector<float> vecDistances(int(m_matPoints.rows()));
+    for(int i = 0; i < m_matPoints.rows(); ++i) {
+        vecDistances[i] = (m_matPoints.row(i).transpose() - vecQuery).norm();
+    }
+
+    return vecDistances;
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestKdTree)
+#include "test_kdtree.moc"
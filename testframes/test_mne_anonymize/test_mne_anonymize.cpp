@@ -77,6 +77,8 @@ private slots:
     void testDefaultOutput();
     void testDeleteInputFile();
     void testInPlace();
+    void testInPlaceAnonymization();
+    void testInPlaceInvalidFile();
 
     //test anonymization
     void testDefaultAnonymizationOfTags();
@@ -89,6 +91,10 @@ private:
 
     void verifyTags(FIFFLIB::FiffStream::SPtr &outStream,
                     QString testArg="blank");
+
+    bool isDefaultString(const QString& sValue,
+                         const QString& sDefault,
+                         const QString& testArg) const;
 };
 
 //=============================================================================================================
@@ -197,6 +203,78 @@ void TestMneAnonymize::testInPlace()
 
 //=============================================================================================================
 
+void TestMneAnonymize::testInPlaceAnonymization()
+{
+    // Init testing arguments
+    QString sFileIn(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif");
+    QString sFileInTest(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/testing2.fif");
+
+    qInfo() << "\n\n-------------------------testInPlaceAnonymization-------------------------------------";
+    qInfo() << "sFileIn" << sFileIn;
+
+    QFile::remove(sFileInTest);
+    QFile::copy(sFileIn,sFileInTest);
+    QVERIFY(QFile::exists(sFileInTest));
+
+    qint64 iSizeIn = QFileInfo(sFileInTest).size();
+
+    QStringList arguments;
+    arguments << QCoreApplication::applicationDirPath() + "/mne_anonymize";
+    arguments << "--in" << sFileInTest;
+    arguments << "--in_place";
+
+    qInfo() << "arguments" << arguments;
+
+    MNEANONYMIZE::SettingsControllerCl controller(arguments);
+
+    // The tags are patched without changing their size
+    QCOMPARE(QFileInfo(sFileInTest).size(), iSizeIn);
+
+    QFile fFileTest(sFileInTest);
+    FiffStream::SPtr testStream(new FiffStream(&fFileTest));
+    if(testStream->open(QIODevice::ReadOnly)) {
+        qInfo() << "anonymized file opened correctly " << sFileInTest;
+    } else {
+        QFAIL("Anonymized file could not be loaded.");
+    }
+
+    verifyTags(testStream, "InPlace");
+
+    testStream->close();
+    QFile::remove(sFileInTest);
+}
+
+//=============================================================================================================
+
+void TestMneAnonymize::testInPlaceInvalidFile()
+{
+    QString sFileInTest(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/testing3.fif");
+
+    qInfo() << "\n\n-------------------------testInPlaceInvalidFile-------------------------------------";
+
+    // A file which does not start with a file id tag must not be touched
+    QByteArray invalidData(1024, '\x5a');
+
+    QFile fFileTest(sFileInTest);
+    QVERIFY(fFileTest.open(QIODevice::WriteOnly));
+    fFileTest.write(invalidData);
+    fFileTest.close();
+
+    FiffAnonymizer anonymizer;
+    anonymizer.setInFile(sFileInTest);
+    anonymizer.setInPlaceMode(true);
+
+    QVERIFY(anonymizer.anonymizeFile() != 0);
+
+    QVERIFY(fFileTest.open(QIODevice::ReadOnly));
+    QCOMPARE(fFileTest.readAll(), invalidData);
+    fFileTest.close();
+
+    QFile::remove(sFileInTest);
+}
+
+//=============================================================================================================
+
 void TestMneAnonymize::testDefaultAnonymizationOfTags()
 {
     QString sFileIn(QCoreApplication::applicationDirPath() + "/mne-cpp-test-data/MEG/sample/sample_audvis_trunc_raw.fif");
@@ -350,7 +428,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
             if(m_pBlockTypeList->first() == FIFFB_MEAS_INFO) {
                 QString defaultComment("mne_anonymize");
                 QString anonFiffInfoComment(pTag->data());
-                QVERIFY(anonFiffInfoComment == defaultComment);
+                QVERIFY(isDefaultString(anonFiffInfoComment, defaultComment, testArg));
             }
 
             break;
@@ -359,7 +437,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString anonFiffExperimenter(pTag->data());
-            QVERIFY(anonFiffExperimenter == defaultComment);
+            QVERIFY(isDefaultString(anonFiffExperimenter, defaultComment, testArg));
 
            break;
         }
@@ -374,7 +452,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString anonSubjFirstName(pTag->data());
-            QVERIFY(anonSubjFirstName == defaultComment);
+            QVERIFY(isDefaultString(anonSubjFirstName, defaultComment, testArg));
 
             break;
         }
@@ -382,7 +460,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString anonSubjMiddleName(pTag->data());
-            QVERIFY(anonSubjMiddleName == defaultComment);
+            QVERIFY(isDefaultString(anonSubjMiddleName, defaultComment, testArg));
 
             break;
         }
@@ -390,7 +468,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString anonSubjLastName(pTag->data());
-            QVERIFY(anonSubjLastName == defaultComment);
+            QVERIFY(isDefaultString(anonSubjLastName, defaultComment, testArg));
 
             break;
         }
@@ -444,7 +522,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString anonSubjComment(pTag->data());
-            QVERIFY(anonSubjComment == defaultComment);
+            QVERIFY(isDefaultString(anonSubjComment, defaultComment, testArg));
 
             break;
         }
@@ -452,7 +530,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString anonSubjHis(pTag->data());
-            QVERIFY(anonSubjHis == defaultComment);
+            QVERIFY(isDefaultString(anonSubjHis, defaultComment, testArg));
             break;
         }
         case FIFF_PROJ_ID:
@@ -470,7 +548,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
             {
                 QString defaultComment("mne_anonymize");
                 QString intAnonProjName(pTag->data());
-                QVERIFY(intAnonProjName == defaultComment);
+                QVERIFY(isDefaultString(intAnonProjName, defaultComment, testArg));
             }
             break;
         }
@@ -480,7 +558,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
             {
                 QString defaultComment("mne_anonymize");
                 QString intAnonProjAim(pTag->data());
-                QVERIFY(intAnonProjAim == defaultComment);
+                QVERIFY(isDefaultString(intAnonProjAim, defaultComment, testArg));
             }
             break;
         }
@@ -488,7 +566,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
         {
             QString defaultComment("mne_anonymize");
             QString intAnonProjPersons(pTag->data());
-            QVERIFY(intAnonProjPersons == defaultComment);
+            QVERIFY(isDefaultString(intAnonProjPersons, defaultComment, testArg));
 
             break;
         }
@@ -498,7 +576,7 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
             {
                 QString defaultComment("mne_anonymize");
                 QString intAnonProjComment(pTag.data()->toString());
-                QVERIFY(intAnonProjComment == defaultComment);
+                QVERIFY(isDefaultString(intAnonProjComment, defaultComment, testArg));
             }
             break;
         }
@@ -522,6 +600,20 @@ void TestMneAnonymize::verifyTags(FIFFLIB::FiffStream::SPtr &stream,
 
 //=============================================================================================================
 
+bool TestMneAnonymize::isDefaultString(const QString& sValue,
+                                       const QString& sDefault,
+                                       const QString& testArg) const
+{
+    // In-place anonymization keeps the tag size, so the default string is truncated to fit into shorter tags
+    if(testArg == "InPlace") {
+        return !sValue.isEmpty() && sDefault.startsWith(sValue);
+    }
+
+    return sValue == sDefault;
+}
+
+//=============================================================================================================
+
 void TestMneAnonymize::cleanupTestCase()
 {
 }
@@ -0,0 +1,445 @@
+//=============================================================================================================
+/**
+ * @file     test_mne_sourceestimate_io.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of reading, writing and appending stc files.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <mne/mne_sourceestimate.h>
+
+#include <Eigen/Dense>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include <QtEndian>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNELIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS SequentialBuffer
+ *
+ * @brief The SequentialBuffer class is a QBuffer which reports itself as sequential, like a socket or a pipe.
+ *
+ */
+class SequentialBuffer: public QBuffer
+{
+public:
+    SequentialBuffer(QByteArray* pBytes)
+    : QBuffer(pBytes)
+    {
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+};
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestMneSourceEstimateIO
+ *
+ * @brief The TestMneSourceEstimateIO class writes, reads and appends a small stc file and compares the bytes with
+ *        a reference written by QDataStream.
+ *
+ */
+class TestMneSourceEstimateIO: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMneSourceEstimateIO();
+
+private slots:
+    void initTestCase();
+    void compareWrite();
+    void compareRead();
+    void compareReadWindow();
+    void compareReadSequential();
+    void compareReadCorruptHeader();
+    void compareAppend();
+    void compareAppendMismatch();
+    void cleanupTestCase();
+
+private:
+    QByteArray writeReference(const MatrixXd& matData) const;
+    void compareStc(const MNESourceEstimate& stc,
+                    const VectorXi& vecVertices,
+                    const MatrixXd& matData,
+                    float fTmin) const;
+
+    int             m_iNumVertices;
+    int             m_iNumSamples;
+    float           m_fTmin;
+    float           m_fTstep;
+    VectorXi        m_vecVertices;
+    MatrixXd        m_matData;
+    QByteArray      m_refBytes;
+    QTemporaryDir   m_tempDir;
+};
+
+//=============================================================================================================
+
+TestMneSourceEstimateIO::TestMneSourceEstimateIO()
+: m_iNumVertices(7)
+, m_iNumSamples(20)
+, m_fTmin(-0.1f)
+, m_fTstep(0.001f)
+{
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::initTestCase()
+{
+    QVERIFY(m_tempDir.isValid());
+
+    QRandomGenerator generator(1);
+
+    m_vecVertices.resize(m_iNumVertices);
+    for(int i = 0; i < m_iNumVertices; ++i) {
+        m_vecVertices[i] = 3 * i + generator.bounded(3);
+    }
+
+    // Source amplitudes in the nAm range, stored as floats in the file
+    m_matData.resize(m_iNumVertices, m_iNumSamples);
+    for(int r = 0; r < m_iNumVertices; ++r) {
+        for(int s = 0; s < m_iNumSamples; ++s) {
+            m_matData(r,s) = double(float(1e-9 * (2.0 * generator.generateDouble() - 1.0)));
+        }
+    }
+
+    m_refBytes = writeReference(m_matData);
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareWrite()
+{
+    MNESourceEstimate stc(m_matData, m_vecVertices, m_fTmin, m_fTstep);
+
+    QBuffer buffer;
+    QVERIFY(stc.write(buffer));
+    QCOMPARE(buffer.data(), m_refBytes);
+
+    QFile file(m_tempDir.filePath("write.stc"));
+    QVERIFY(stc.write(file));
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), m_refBytes);
+    file.close();
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareRead()
+{
+    // A buffer is read block by block, a file is memory mapped
+    QBuffer buffer(&m_refBytes);
+    MNESourceEstimate stc;
+    QVERIFY(MNESourceEstimate::read(buffer, stc));
+    compareStc(stc, m_vecVertices, m_matData, m_fTmin);
+
+    QFile file(m_tempDir.filePath("read.stc"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(m_refBytes), qint64(m_refBytes.size()));
+    file.close();
+
+    MNESourceEstimate stcFile;
+    QVERIFY(MNESourceEstimate::read(file, stcFile));
+    compareStc(stcFile, m_vecVertices, m_matData, m_fTmin);
+
+    MNESourceEstimate stcHeader;
+    qint32 iNumSamples = 0;
+    QVERIFY(MNESourceEstimate::readHeader(file, stcHeader, iNumSamples));
+    QCOMPARE(iNumSamples, m_iNumSamples);
+    QCOMPARE(stcHeader.vertices.size(), m_vecVertices.size());
+    QVERIFY(stcHeader.vertices == m_vecVertices);
+    QCOMPARE(stcHeader.data.size(), Index(0));
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareReadWindow()
+{
+    qint32 iStart = 5;
+    qint32 iNum = 9;
+
+    VectorXi vecSel(3);
+    vecSel << 4, 0, 6;
+
+    VectorXi vecVertSel(vecSel.size());
+    MatrixXd matDataSel(vecSel.size(), iNum);
+    for(int i = 0; i < vecSel.size(); ++i) {
+        vecVertSel[i] = m_vecVertices[vecSel[i]];
+        matDataSel.row(i) = m_matData.row(vecSel[i]).segment(iStart, iNum);
+    }
+
+    QFile file(m_tempDir.filePath("window.stc"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(m_refBytes);
+    file.close();
+
+    QBuffer buffer(&m_refBytes);
+    QList<QIODevice*> lDevices;
+    lDevices << &buffer << &file;
+
+    for(int i = 0; i < lDevices.size(); ++i) {
+        // Time window of all sources
+        MNESourceEstimate stc;
+        QVERIFY(MNESourceEstimate::read(*lDevices.at(i), stc, iStart, iNum));
+        compareStc(stc, m_vecVertices, m_matData.middleCols(iStart, iNum), m_fTmin + iStart * m_fTstep);
+
+        // Time window of selected sources
+        MNESourceEstimate stcSel;
+        QVERIFY(MNESourceEstimate::read(*lDevices.at(i), stcSel, iStart, iNum, vecSel));
+        compareStc(stcSel, vecVertSel, matDataSel, m_fTmin + iStart * m_fTstep);
+
+        // Up to the last sample
+        MNESourceEstimate stcEnd;
+        QVERIFY(MNESourceEstimate::read(*lDevices.at(i), stcEnd, iStart));
+        compareStc(stcEnd, m_vecVertices, m_matData.rightCols(m_iNumSamples - iStart), m_fTmin + iStart * m_fTstep);
+
+        // Out of range
+        MNESourceEstimate stcInvalid;
+        QVERIFY(!MNESourceEstimate::read(*lDevices.at(i), stcInvalid, m_iNumSamples - 2, 3));
+        QVERIFY(!MNESourceEstimate::read(*lDevices.at(i), stcInvalid, 0, -1, VectorXi::Constant(1, m_iNumVertices)));
+    }
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareReadSequential()
+{
+    // Sequential devices can not seek, the samples before the time window are skipped
+    qint32 iStart = 5;
+    qint32 iNum = 9;
+
+    QByteArray refBytes = m_refBytes;
+    SequentialBuffer buffer(&refBytes);
+
+    MNESourceEstimate stc;
+    QVERIFY(MNESourceEstimate::read(buffer, stc));
+    compareStc(stc, m_vecVertices, m_matData, m_fTmin);
+
+    MNESourceEstimate stcWindow;
+    QVERIFY(MNESourceEstimate::read(buffer, stcWindow, iStart, iNum));
+    compareStc(stcWindow, m_vecVertices, m_matData.middleCols(iStart, iNum), m_fTmin + iStart * m_fTstep);
+
+    MNESourceEstimate stcEnd;
+    QVERIFY(MNESourceEstimate::read(buffer, stcEnd, iStart));
+    compareStc(stcEnd, m_vecVertices, m_matData.rightCols(m_iNumSamples - iStart), m_fTmin + iStart * m_fTstep);
+
+    // A truncated stream fails while reading the samples
+    QByteArray truncBytes = m_refBytes.left(m_refBytes.size() - 4);
+    SequentialBuffer truncBuffer(&truncBytes);
+    MNESourceEstimate stcTrunc;
+    QVERIFY(!MNESourceEstimate::read(truncBuffer, stcTrunc, iStart));
+
+    // Appending needs to seek
+    MNESourceEstimate stcAppend(m_matData, m_vecVertices, m_fTmin, m_fTstep);
+    QVERIFY(!stcAppend.append(buffer));
+    QCOMPARE(refBytes, m_refBytes);
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareReadCorruptHeader()
+{
+    // A vertex count far beyond the size of the data must be rejected before anything is allocated for it
+    QList<quint32> lNumVertices;
+    lNumVertices << quint32(m_iNumVertices + 1) << 0x10000000u << 0xFFFFFFFFu;
+
+    for(int i = 0; i < lNumVertices.size(); ++i) {
+        QByteArray corruptBytes = m_refBytes;
+        qToBigEndian<quint32>(lNumVertices.at(i), reinterpret_cast<uchar*>(corruptBytes.data()) + 8);
+
+        QBuffer buffer(&corruptBytes);
+        SequentialBuffer seqBuffer(&corruptBytes);
+
+        MNESourceEstimate stc;
+        QVERIFY(!MNESourceEstimate::read(buffer, stc));
+        QVERIFY(!MNESourceEstimate::read(seqBuffer, stc));
+
+        // One vertex too many still fits into the device, only the samples which follow do not
+        if(i > 0) {
+            qint32 iNumSamples = 0;
+            QVERIFY(!MNESourceEstimate::readHeader(buffer, stc, iNumSamples));
+        }
+
+        MNESourceEstimate stcAppend(m_matData, m_vecVertices, m_fTmin, m_fTstep);
+        QVERIFY(!stcAppend.append(buffer));
+    }
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareAppend()
+{
+    // Stream the data in blocks, the file has to be the same as the one written at once
+    int iSplit = 8;
+
+    MNESourceEstimate stcFirst(m_matData.leftCols(iSplit), m_vecVertices, m_fTmin, m_fTstep);
+    MNESourceEstimate stcSecond(m_matData.rightCols(m_iNumSamples - iSplit), m_vecVertices, m_fTmin + iSplit * m_fTstep, m_fTstep);
+
+    QBuffer buffer;
+    QVERIFY(stcFirst.append(buffer));
+    QCOMPARE(buffer.data(), writeReference(m_matData.leftCols(iSplit)));
+
+    MNESourceEstimate stc;
+    QVERIFY(MNESourceEstimate::read(buffer, stc));
+    compareStc(stc, m_vecVertices, m_matData.leftCols(iSplit), m_fTmin);
+
+    QVERIFY(stcSecond.append(buffer));
+    QCOMPARE(buffer.data(), m_refBytes);
+
+    QVERIFY(MNESourceEstimate::read(buffer, stc));
+    compareStc(stc, m_vecVertices, m_matData, m_fTmin);
+
+    QFile file(m_tempDir.filePath("append.stc"));
+    QVERIFY(stcFirst.append(file));
+    QVERIFY(stcSecond.append(file));
+
+    QVERIFY(MNESourceEstimate::read(file, stc, iSplit - 2, 4));
+    compareStc(stc, m_vecVertices, m_matData.middleCols(iSplit - 2, 4), m_fTmin + (iSplit - 2) * m_fTstep);
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), m_refBytes);
+    file.close();
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareAppendMismatch()
+{
+    QByteArray refBytes = m_refBytes;
+    QBuffer buffer(&refBytes);
+
+    // Different time step
+    MNESourceEstimate stcTstep(m_matData, m_vecVertices, m_fTmin, 2 * m_fTstep);
+    QVERIFY(!stcTstep.append(buffer));
+    QCOMPARE(refBytes, m_refBytes);
+
+    // Different vertices
+    VectorXi vecVertices = m_vecVertices;
+    vecVertices[0] += 1;
+    MNESourceEstimate stcVertices(m_matData, vecVertices, m_fTmin, m_fTstep);
+    QVERIFY(!stcVertices.append(buffer));
+    QCOMPARE(refBytes, m_refBytes);
+
+    // Data rows which do not match the vertices, on an existing and on an empty device
+    MNESourceEstimate stcRows(m_matData.topRows(m_iNumVertices - 1), m_vecVertices, m_fTmin, m_fTstep);
+    QVERIFY(!stcRows.append(buffer));
+    QCOMPARE(refBytes, m_refBytes);
+
+    QBuffer emptyBuffer;
+    QVERIFY(!stcRows.append(emptyBuffer));
+    QCOMPARE(emptyBuffer.size(), qint64(0));
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+QByteArray TestMneSourceEstimateIO::writeReference(const MatrixXd& matData) const
+{
+    // The stc format: tmin and tstep in ms, the vertices and the samples, all big endian
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    stream << float(1000 * m_fTmin);
+    stream << float(1000 * m_fTstep);
+    stream << quint32(m_vecVertices.size());
+
+    for(int i = 0; i < m_vecVertices.size(); ++i) {
+        stream << quint32(m_vecVertices[i]);
+    }
+
+    stream << quint32(matData.cols());
+
+    for(int s = 0; s < matData.cols(); ++s) {
+        for(int r = 0; r < matData.rows(); ++r) {
+            stream << float(matData(r,s));
+        }
+    }
+
+    return bytes;
+}
+
+//=============================================================================================================
+
+void TestMneSourceEstimateIO::compareStc(const MNESourceEstimate& stc,
+                                         const VectorXi& vecVertices,
+                                         const MatrixXd& matData,
+                                         float fTmin) const
+{
+    QCOMPARE(stc.vertices.size(), vecVertices.size());
+    QVERIFY(stc.vertices == vecVertices);
+    QCOMPARE(stc.data.rows(), matData.rows());
+    QCOMPARE(stc.data.cols(), matData.cols());
+
+    // The data was stored as floats, so it is read back exactly
+    QVERIFY(stc.data == matData);
+
+    QVERIFY(qAbs(stc.tmin - fTmin) < 1e-6f);
+    QVERIFY(qAbs(stc.tstep - m_fTstep) < 1e-9f);
+    QCOMPARE(int(stc.times.size()), int(matData.cols()));
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestMneSourceEstimateIO)
+#include "test_mne_sourceestimate_io.moc"
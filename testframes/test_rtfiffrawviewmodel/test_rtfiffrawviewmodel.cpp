@@ -0,0 +1,209 @@
+//=============================================================================================================
+/**
+ * @file     test_rtfiffrawviewmodel.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of the min/max pyramids of the RtFiffRawViewModel.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <disp/viewers/helpers/rtfiffrawviewmodel.h>
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_constants.h>
+
+#include <Eigen/Core>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace DISPLIB;
+using namespace FIFFLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestRtFiffRawViewModel
+ *
+ * @brief The TestRtFiffRawViewModel class checks that the min/max envelopes drawn by the delegate follow the data
+ *        of the RtFiffRawViewModel.
+ *
+ */
+class TestRtFiffRawViewModel: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtFiffRawViewModel();
+
+private slots:
+    void initTestCase();
+    void testClearModel();
+    void testClearModelFreeze();
+    void cleanupTestCase();
+
+private:
+    void setupModel(RtFiffRawViewModel& model);
+    bool isFlat(const MinMaxPyramid& pyramid) const;
+
+    int                         m_iNumChannels;
+    float                       m_fSFreq;
+    QSharedPointer<FiffInfo>    m_pFiffInfo;
+};
+
+//=============================================================================================================
+
+TestRtFiffRawViewModel::TestRtFiffRawViewModel()
+: m_iNumChannels(4)
+, m_fSFreq(1000.0f)
+{
+}
+
+//=============================================================================================================
+
+void TestRtFiffRawViewModel::initTestCase()
+{
+    m_pFiffInfo = QSharedPointer<FiffInfo>(new FiffInfo());
+    m_pFiffInfo->sfreq = m_fSFreq;
+    m_pFiffInfo->nchan = m_iNumChannels;
+
+    for(int i = 0; i < m_iNumChannels; ++i) {
+        FiffChInfo chInfo;
+        chInfo.kind = FIFFV_MISC_CH;
+        chInfo.range = 1.0f;
+        chInfo.cal = 1.0f;
+        chInfo.ch_name = QString("MISC %1").arg(i + 1);
+
+        m_pFiffInfo->chs.append(chInfo);
+        m_pFiffInfo->ch_names.append(chInfo.ch_name);
+    }
+}
+
+//=============================================================================================================
+
+void TestRtFiffRawViewModel::testClearModel()
+{
+    RtFiffRawViewModel model;
+    setupModel(model);
+
+    QVERIFY(!isFlat(model.getPyramid()));
+
+    // The envelopes of the cleared data have to be flat, otherwise the old data is still drawn
+    model.clearModel();
+    QVERIFY(isFlat(model.getPyramid()));
+}
+
+//=============================================================================================================
+
+void TestRtFiffRawViewModel::testClearModelFreeze()
+{
+    RtFiffRawViewModel model;
+    setupModel(model);
+
+    model.toggleFreeze(QModelIndex());
+    QVERIFY(model.isFreezed());
+    QVERIFY(!isFlat(model.getPyramid()));
+
+    // Clearing also zeroes the frozen data
+    model.clearModel();
+    QVERIFY(isFlat(model.getPyramid()));
+
+    model.toggleFreeze(QModelIndex());
+    QVERIFY(!model.isFreezed());
+    QVERIFY(isFlat(model.getPyramid()));
+}
+
+//=============================================================================================================
+
+void TestRtFiffRawViewModel::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+void TestRtFiffRawViewModel::setupModel(RtFiffRawViewModel& model)
+{
+    model.setFiffInfo(m_pFiffInfo);
+    model.setSamplingInfo(m_fSFreq, 1, true);
+
+    // Two blocks of a ramp, which is not flat in any bin
+    QList<MatrixXd> lData;
+    for(int b = 0; b < 2; ++b) {
+        MatrixXd matBlock(m_iNumChannels, 300);
+        for(int c = 0; c < m_iNumChannels; ++c) {
+            for(int s = 0; s < matBlock.cols(); ++s) {
+                matBlock(c,s) = (c + 1) * 1e-3 * (b * matBlock.cols() + s + 1);
+            }
+        }
+        lData << matBlock;
+    }
+
+    model.addData(lData);
+}
+
+//=============================================================================================================
+
+bool TestRtFiffRawViewModel::isFlat(const MinMaxPyramid& pyramid) const
+{
+    if(pyramid.numLevels() == 0 || pyramid.numRows() != m_iNumChannels) {
+        return false;
+    }
+
+    for(int l = 0; l < pyramid.numLevels(); ++l) {
+        for(int r = 0; r < pyramid.numRows(); ++r) {
+            const float* pMin = pyramid.minRow(l, r);
+            const float* pMax = pyramid.maxRow(l, r);
+
+            for(int b = 0; b < pyramid.numBins(l); ++b) {
+                if(pMin[b] != 0.0f || pMax[b] != 0.0f) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestRtFiffRawViewModel)
+#include "test_rtfiffrawviewmodel.moc"
@@ -50,14 +50,20 @@
 #include <connectivity/metrics/weightedphaselagindex.h>
 #include <connectivity/metrics/debiasedsquaredweightedphaselagindex.h>
 #include <connectivity/metrics/crosscorrelation.h>
+#include <connectivity/metrics/abstractmetric.h>
 #include <connectivity/connectivitysettings.h>
+#include <connectivity/connectivity.h>
 #include <connectivity/network/network.h>
+#include <connectivity/network/networkedge.h>
+#include <connectivity/network/networknode.h>
 
 //=============================================================================================================
 // QT INCLUDES
 //=============================================================================================================
 
 #include <QtTest>
+#include <QRandomGenerator>
+#include <QtConcurrent>
 
 //=============================================================================================================
 // EIGEN INCLUDES
@@ -97,15 +103,49 @@ private slots:
     void spectralConnectivityCoherence();
     void spectralConnectivityImagCoherence();
     void spectralConnectivityXCOR();
+    void spectralConnectivityStreaming();
+    void spectralConnectivityStreamingBatches();
+    void spectralConnectivityDecayFactor();
+    void spectralConnectivityMultiMethods();
+    void spectralConnectivityMultiMethodsStorageMode();
+    void spectralConnectivityNodePairs();
+    void spectralConnectivitySeedNodes();
+    void spectralConnectivityFrequencyBands();
+    void networkBandWeights();
+    void networkConcurrentAccess();
     void cleanupTestCase();
 
 private:
     void compareConnectivity();
     QList<MatrixXd> readConnectivityData();
+    QList<Network> calculateStreaming(const QStringList& lMethods,
+                                      const QVector<int>& vecBatchSizes,
+                                      double dDecayFactor,
+                                      ConnectivitySettings::IntermediateSumData& sumData) const;
+    void compareMultiMethods();
+    void compareNetworks(const Network& network,
+                         const Network& refNetwork) const;
+    template<typename T>
+    void compareSums(const QVector<QPair<int,T> >& vecSum,
+                     const QVector<QPair<int,T> >& vecRefSum) const;
+    Network calculatePlan(const QString& sMethod,
+                          const QList<QPair<int,int> >& lNodePairs,
+                          const QVector<int>& vecSeedNodes,
+                          const QList<QPair<float,float> >& lFrequencyBands) const;
+    void comparePlan(const QList<QPair<int,int> >& lNodePairs,
+                     const QVector<int>& vecSeedNodes,
+                     const MatrixXi& matPlanned) const;
+    Network randomNetwork(int iNumberNodes,
+                          int iNumberBins,
+                          QList<VectorXd>& lBinWeights) const;
+
     double dEpsilon;
     double m_dConnectivityOutput;
     double m_dRefConnectivityOutput;
     ConnectivitySettings m_connectivitySettings;
+    QList<MatrixXd> m_lTrials;
+    QList<MatrixXd> m_lPlanTrials;
+    QStringList m_lPlanMethods;
 };
 
 //=============================================================================================================
@@ -124,10 +164,33 @@ void TestSpectralConnectivity::initTestCase()
     // Load and Setup Testing Data
     //*********************************************************************************************************
 
-    QList<MatrixXd> matDataList = readConnectivityData();
-    m_connectivitySettings.setFFTSize(matDataList.at(0).cols());
+    m_lTrials = readConnectivityData();
+    m_connectivitySettings.setFFTSize(m_lTrials.at(0).cols());
     m_connectivitySettings.setWindowType("hanning");
-    m_connectivitySettings.append(matDataList);
+    m_connectivitySettings.append(m_lTrials);
+
+    // Trials with more nodes for the computation plan. The nodes share a common source with node dependent lags.
+    QRandomGenerator generator(1);
+    int iNumberNodes = 6;
+    int iNumberSamples = 128;
+
+    for(int t = 0; t < 10; ++t) {
+        VectorXd vecSource(iNumberSamples + iNumberNodes);
+        for(int s = 0; s < vecSource.size(); ++s) {
+            vecSource[s] = generator.generateDouble() - 0.5;
+        }
+
+        MatrixXd matTrial(iNumberNodes, iNumberSamples);
+        for(int n = 0; n < iNumberNodes; ++n) {
+            for(int s = 0; s < iNumberSamples; ++s) {
+                matTrial(n,s) = vecSource[s + n] + 0.5 * (generator.generateDouble() - 0.5);
+            }
+        }
+
+        m_lPlanTrials << matTrial;
+    }
+
+    m_lPlanMethods << "COH" << "IMAGCOH" << "PLV" << "PLI" << "WPLI" << "USPLI" << "DSWPLI";
 }
 
 //=============================================================================================================
@@ -348,6 +411,322 @@ void TestSpectralConnectivity::spectralConnectivityXCOR()
 
 //=============================================================================================================
 
+void TestSpectralConnectivity::spectralConnectivityStreaming()
+{
+    //*********************************************************************************************************
+    // Without decay the running sums of the streaming mode equal the sums over all trials
+    //*********************************************************************************************************
+
+    QStringList lMethods = QStringList() << "COH" << "IMAGCOH" << "PLV" << "PLI" << "WPLI" << "USPLI" << "DSWPLI";
+
+    for(int i = 0; i < lMethods.size(); ++i) {
+        ConnectivitySettings settings;
+        settings.setFFTSize(m_lTrials.at(0).cols());
+        settings.setWindowType("hanning");
+        settings.setConnectivityMethods(QStringList() << lMethods.at(i));
+        settings.append(m_lTrials);
+
+        QList<Network> lRefNetworks = Connectivity::calculate(settings);
+
+        ConnectivitySettings::IntermediateSumData sumData;
+        QList<Network> lNetworks = calculateStreaming(QStringList() << lMethods.at(i),
+                                                      QVector<int>() << 3,
+                                                      1.0,
+                                                      sumData);
+
+        QCOMPARE(lNetworks.size(), 1);
+        QCOMPARE(lRefNetworks.size(), 1);
+        compareNetworks(lNetworks.first(), lRefNetworks.first());
+    }
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivityStreamingBatches()
+{
+    //*********************************************************************************************************
+    // The running sums must not depend on how the trials are split into batches, with and without decay
+    //*********************************************************************************************************
+
+    QStringList lMethods = QStringList() << "COH" << "IMAGCOH" << "PLV" << "PLI" << "WPLI" << "USPLI" << "DSWPLI";
+
+    QList<QVector<int> > lBatchSizes;
+    lBatchSizes << (QVector<int>() << 1)
+                << (QVector<int>() << 2 << 5)
+                << (QVector<int>() << m_lTrials.size());
+
+    QVector<double> vecDecayFactors;
+    vecDecayFactors << 1.0 << 0.9;
+
+    for(int d = 0; d < vecDecayFactors.size(); ++d) {
+        ConnectivitySettings::IntermediateSumData refSumData;
+        QList<Network> lRefNetworks = calculateStreaming(lMethods,
+                                                         lBatchSizes.first(),
+                                                         vecDecayFactors.at(d),
+                                                         refSumData);
+
+        for(int i = 1; i < lBatchSizes.size(); ++i) {
+            ConnectivitySettings::IntermediateSumData sumData;
+            QList<Network> lNetworks = calculateStreaming(lMethods,
+                                                          lBatchSizes.at(i),
+                                                          vecDecayFactors.at(d),
+                                                          sumData);
+
+            QVERIFY(fabs(sumData.dWeightSum - refSumData.dWeightSum) < dEpsilon);
+            QVERIFY(fabs(sumData.dSquaredWeightSum - refSumData.dSquaredWeightSum) < dEpsilon);
+            QCOMPARE(sumData.matPsdSum.rows(), refSumData.matPsdSum.rows());
+            QCOMPARE(sumData.matPsdSum.cols(), refSumData.matPsdSum.cols());
+            QVERIFY((sumData.matPsdSum - refSumData.matPsdSum).cwiseAbs().maxCoeff() <= dEpsilon * refSumData.matPsdSum.cwiseAbs().maxCoeff());
+
+            compareSums(sumData.vecPairCsdSum, refSumData.vecPairCsdSum);
+            compareSums(sumData.vecPairCsdNormalizedSum, refSumData.vecPairCsdNormalizedSum);
+            compareSums(sumData.vecPairCsdImagSignSum, refSumData.vecPairCsdImagSignSum);
+            compareSums(sumData.vecPairCsdImagAbsSum, refSumData.vecPairCsdImagAbsSum);
+            compareSums(sumData.vecPairCsdImagSqrdSum, refSumData.vecPairCsdImagSqrdSum);
+
+            QCOMPARE(lNetworks.size(), lRefNetworks.size());
+            for(int j = 0; j < lNetworks.size(); ++j) {
+                compareNetworks(lNetworks.at(j), lRefNetworks.at(j));
+            }
+        }
+    }
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivityDecayFactor()
+{
+    //*********************************************************************************************************
+    // Decay factors outside of (0,1] are rejected
+    //*********************************************************************************************************
+
+    ConnectivitySettings settings;
+    settings.setDecayFactor(0.5);
+    QCOMPARE(settings.getDecayFactor(), 0.5);
+
+    settings.setDecayFactor(0.0);
+    QCOMPARE(settings.getDecayFactor(), 0.5);
+
+    settings.setDecayFactor(-0.1);
+    QCOMPARE(settings.getDecayFactor(), 0.5);
+
+    settings.setDecayFactor(1.5);
+    QCOMPARE(settings.getDecayFactor(), 0.5);
+
+    settings.setDecayFactor(1.0);
+    QCOMPARE(settings.getDecayFactor(), 1.0);
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivityMultiMethods()
+{
+    compareMultiMethods();
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivityMultiMethodsStorageMode()
+{
+    //*********************************************************************************************************
+    // In storage mode the per trial data is kept and the metrics only add trials which were not computed yet
+    //*********************************************************************************************************
+
+    bool bStorageModeIsActive = AbstractMetric::m_bStorageModeIsActive;
+    AbstractMetric::m_bStorageModeIsActive = true;
+
+    compareMultiMethods();
+
+    AbstractMetric::m_bStorageModeIsActive = bStorageModeIsActive;
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivityNodePairs()
+{
+    //*********************************************************************************************************
+    // Only the requested pairs are computed, in either node order
+    //*********************************************************************************************************
+
+    QList<QPair<int,int> > lNodePairs;
+    lNodePairs << QPair<int,int>(0,3) << QPair<int,int>(4,2) << QPair<int,int>(5,1);
+
+    MatrixXi matPlanned = MatrixXi::Zero(6,6);
+    matPlanned(0,3) = matPlanned(3,0) = 1;
+    matPlanned(2,4) = matPlanned(4,2) = 1;
+    matPlanned(1,5) = matPlanned(5,1) = 1;
+
+    comparePlan(lNodePairs, QVector<int>(), matPlanned);
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivitySeedNodes()
+{
+    //*********************************************************************************************************
+    // The seed nodes are paired with all other nodes, explicit pairs are added on top
+    //*********************************************************************************************************
+
+    QVector<int> vecSeedNodes;
+    vecSeedNodes << 2;
+
+    MatrixXi matPlanned = MatrixXi::Zero(6,6);
+    matPlanned.row(2).setOnes();
+    matPlanned.col(2).setOnes();
+    matPlanned(2,2) = 0;
+
+    comparePlan(QList<QPair<int,int> >(), vecSeedNodes, matPlanned);
+
+    QList<QPair<int,int> > lNodePairs;
+    lNodePairs << QPair<int,int>(0,5);
+    matPlanned(0,5) = matPlanned(5,0) = 1;
+
+    comparePlan(lNodePairs, vecSeedNodes, matPlanned);
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::spectralConnectivityFrequencyBands()
+{
+    //*********************************************************************************************************
+    // The bands are merged into the bins from the lowest to the highest band edge. The weights are the average
+    // over these bins of the network computed for all bins.
+    //*********************************************************************************************************
+
+    QList<QPair<float,float> > lFrequencyBands;
+    lFrequencyBands << QPair<float,float>(30.0f,40.0f) << QPair<float,float>(8.0f,12.0f);
+
+    int iNfft = m_lPlanTrials.at(0).cols();
+    double dFreqResolution = 1000.0 / iNfft;
+    int iLowerBin = int(floor(8.0 / dFreqResolution));
+    int iUpperBin = int(ceil(40.0 / dFreqResolution));
+
+    for(int i = 0; i < m_lPlanMethods.size(); ++i) {
+        Network network = calculatePlan(m_lPlanMethods.at(i), QList<QPair<int,int> >(), QVector<int>(), lFrequencyBands);
+        Network refNetwork = calculatePlan(m_lPlanMethods.at(i), QList<QPair<int,int> >(), QVector<int>(), QList<QPair<float,float> >());
+
+        QCOMPARE(network.getFirstFreqBin(), iLowerBin);
+        QCOMPARE(network.getUsedFreqBins(), iUpperBin - iLowerBin + 1);
+
+        refNetwork.setFrequencyBinRange(iLowerBin, iUpperBin);
+
+        compareNetworks(network, refNetwork);
+    }
+
+    // Without a sampling frequency the bands are ignored
+    ConnectivitySettings settings;
+    settings.setSamplingFrequency(0);
+    settings.setFFTSize(iNfft);
+    settings.setFrequencyBands(lFrequencyBands);
+
+    QPair<int,int> pairBins = settings.getFrequencyBins();
+    QCOMPARE(pairBins.first, 0);
+    QCOMPARE(pairBins.second, iNfft / 2 + 1);
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::networkBandWeights()
+{
+    //*********************************************************************************************************
+    // The band weights are computed from running sums over the bins. Compare them with the direct average.
+    //*********************************************************************************************************
+
+    int iNumberNodes = 6;
+    int iNumberBins = 40;
+    int iFirstFreqBin = 5;
+
+    QList<VectorXd> lBinWeights;
+    Network network = randomNetwork(iNumberNodes, iNumberBins, lBinWeights);
+    network.setFirstFreqBin(iFirstFreqBin);
+
+    // The bin ranges are given in bins of the half spectrum and are clipped to the stored bins
+    QList<QPair<int,int> > lBinRanges;
+    lBinRanges << QPair<int,int>(-1,-1)
+               << QPair<int,int>(iFirstFreqBin, iFirstFreqBin)
+               << QPair<int,int>(iFirstFreqBin + 3, iFirstFreqBin + 17)
+               << QPair<int,int>(0, iFirstFreqBin + 10)
+               << QPair<int,int>(iFirstFreqBin + 30, 1000);
+
+    for(const QPair<int,int>& pairBins : lBinRanges) {
+        network.setFrequencyBinRange(pairBins.first, pairBins.second);
+
+        int iLowerBin = 0;
+        int iUpperBin = iNumberBins - 1;
+        if(pairBins.first != -1) {
+            iLowerBin = qMax(pairBins.first - iFirstFreqBin, 0);
+            iUpperBin = qMin(pairBins.second - iFirstFreqBin, iNumberBins - 1);
+        }
+
+        MatrixXd matConnectivity = network.getFullConnectivityMatrix();
+        int iPair = 0;
+
+        for(int i = 0; i < iNumberNodes; ++i) {
+            for(int j = i + 1; j < iNumberNodes; ++j, ++iPair) {
+                double dAverage = lBinWeights.at(iPair).segment(iLowerBin, iUpperBin - iLowerBin + 1).mean();
+
+                QVERIFY(qAbs(matConnectivity(i,j) - dAverage) <= dEpsilon);
+                QVERIFY(qAbs(matConnectivity(j,i) - dAverage) <= dEpsilon);
+            }
+        }
+
+        // The thresholded network is built from the same weights
+        network.setThreshold(0.2);
+        MatrixXd matThresholded = network.getThresholdedConnectivityMatrix();
+        for(int i = 0; i < iNumberNodes; ++i) {
+            for(int j = 0; j < iNumberNodes; ++j) {
+                QCOMPARE(matThresholded(i,j), qAbs(matConnectivity(i,j)) >= 0.2 ? matConnectivity(i,j) : 0.0);
+            }
+        }
+        network.setThreshold(0.0);
+    }
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::networkConcurrentAccess()
+{
+    //*********************************************************************************************************
+    // The adjacency matrix and the node and edge objects are built on first use by the const getters. Many
+    // threads reading the same network at once have to see the same result as a single thread.
+    //*********************************************************************************************************
+
+    int iNumberNodes = 40;
+    int iNumberPairs = iNumberNodes * (iNumberNodes - 1) / 2;
+
+    QList<VectorXd> lBinWeights;
+    Network network = randomNetwork(iNumberNodes, 4, lBinWeights);
+    network.setThreshold(0.3);
+
+    for(int i = 0; i < iNumberNodes; ++i) {
+        network.append(NetworkNode::SPtr(new NetworkNode(i, RowVectorXf::Zero(3))));
+    }
+
+    // The copy builds its own caches
+    Network refNetwork = network;
+    MatrixXd matRefAdjacency = MatrixXd(refNetwork.getThresholdedAdjacency());
+    VectorXi vecRefDegrees = refNetwork.getThresholdedDegrees();
+    int iRefThresholdedEdges = refNetwork.getThresholdedEdges().size();
+
+    QVector<bool> vecResults(64, false);
+    const Network& constNetwork = network;
+
+    QtConcurrent::blockingMap(vecResults, [&](bool& bResult) {
+        bResult = MatrixXd(constNetwork.getThresholdedAdjacency()) == matRefAdjacency
+                  && constNetwork.getThresholdedDegrees() == vecRefDegrees
+                  && constNetwork.getFullEdges().size() == iNumberPairs
+                  && constNetwork.getThresholdedEdges().size() == iRefThresholdedEdges
+                  && constNetwork.getNodes().size() == iNumberNodes
+                  && constNetwork.getNodes().last()->getFullEdges().size() == iNumberNodes - 1;
+    });
+
+    for(bool bResult : vecResults) {
+        QVERIFY(bResult);
+    }
+}
+
+//=============================================================================================================
+
 QList<MatrixXd> TestSpectralConnectivity::readConnectivityData()
 {
     MatrixXd inputTrials;
@@ -385,6 +764,195 @@ void TestSpectralConnectivity::compareConnectivity()
 
 //=============================================================================================================
 
+void TestSpectralConnectivity::compareMultiMethods()
+{
+    //*********************************************************************************************************
+    // Several metrics at once share the spectra and the CSD, the results have to match the single metric path
+    //*********************************************************************************************************
+
+    QStringList lMethods = QStringList() << "WPLI" << "USPLI" << "COR" << "XCOR" << "PLI" << "COH" << "IMAGCOH" << "PLV" << "DSWPLI";
+
+    ConnectivitySettings settings;
+    settings.setFFTSize(m_lTrials.at(0).cols());
+    settings.setWindowType("hanning");
+    settings.setConnectivityMethods(lMethods);
+    settings.append(m_lTrials);
+
+    QList<Network> lNetworks = Connectivity::calculate(settings);
+
+    QCOMPARE(lNetworks.size(), lMethods.size());
+
+    for(int i = 0; i < lNetworks.size(); ++i) {
+        QString sMethod = lNetworks.at(i).getConnectivityMethod();
+        QVERIFY(lMethods.contains(sMethod));
+
+        ConnectivitySettings refSettings;
+        refSettings.setFFTSize(m_lTrials.at(0).cols());
+        refSettings.setWindowType("hanning");
+        refSettings.setConnectivityMethods(QStringList() << sMethod);
+        refSettings.append(m_lTrials);
+
+        QList<Network> lRefNetworks = Connectivity::calculate(refSettings);
+
+        QCOMPARE(lRefNetworks.size(), 1);
+        QCOMPARE(lRefNetworks.first().getConnectivityMethod(), sMethod);
+        compareNetworks(lNetworks.at(i), lRefNetworks.first());
+    }
+}
+
+//=============================================================================================================
+
+QList<Network> TestSpectralConnectivity::calculateStreaming(const QStringList& lMethods,
+                                                            const QVector<int>& vecBatchSizes,
+                                                            double dDecayFactor,
+                                                            ConnectivitySettings::IntermediateSumData& sumData) const
+{
+    //*********************************************************************************************************
+    // Hand the trials over in batches like RtConnectivityWorker::doWork, keeping the running sums in between
+    //*********************************************************************************************************
+
+    QList<Network> lNetworks;
+    int iFrom = 0;
+
+    for(int iBatch = 0; iFrom < m_lTrials.size(); ++iBatch) {
+        int iSize = qMin(vecBatchSizes.at(iBatch % vecBatchSizes.size()), m_lTrials.size() - iFrom);
+
+        ConnectivitySettings settings;
+        settings.setFFTSize(m_lTrials.at(0).cols());
+        settings.setWindowType("hanning");
+        settings.setConnectivityMethods(lMethods);
+        settings.setStreamingModeActive(true);
+        settings.setDecayFactor(dDecayFactor);
+        settings.append(m_lTrials.mid(iFrom, iSize));
+
+        std::swap(settings.getIntermediateSumData(), sumData);
+        lNetworks = Connectivity::calculate(settings);
+        std::swap(settings.getIntermediateSumData(), sumData);
+
+        iFrom += iSize;
+    }
+
+    return lNetworks;
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::compareNetworks(const Network& network,
+                                               const Network& refNetwork) const
+{
+    MatrixXd matConnectivity = network.getFullConnectivityMatrix();
+    MatrixXd matRefConnectivity = refNetwork.getFullConnectivityMatrix();
+
+    QCOMPARE(matConnectivity.rows(), matRefConnectivity.rows());
+    QCOMPARE(matConnectivity.cols(), matRefConnectivity.cols());
+    // Relative to the magnitude of the reference, the correlation based metrics are not normalized
+    QVERIFY((matConnectivity - matRefConnectivity).cwiseAbs().maxCoeff() <= dEpsilon * qMax(1.0, matRefConnectivity.cwiseAbs().maxCoeff()));
+}
+
+//=============================================================================================================
+
+template<typename T>
+void TestSpectralConnectivity::compareSums(const QVector<QPair<int,T> >& vecSum,
+                                           const QVector<QPair<int,T> >& vecRefSum) const
+{
+    QCOMPARE(vecSum.size(), vecRefSum.size());
+
+    for(int i = 0; i < vecRefSum.size(); ++i) {
+        QCOMPARE(vecSum.at(i).first, vecRefSum.at(i).first);
+        QCOMPARE(vecSum.at(i).second.rows(), vecRefSum.at(i).second.rows());
+        QCOMPARE(vecSum.at(i).second.cols(), vecRefSum.at(i).second.cols());
+
+        if(vecRefSum.at(i).second.size() > 0) {
+            QVERIFY((vecSum.at(i).second - vecRefSum.at(i).second).cwiseAbs().maxCoeff() <= dEpsilon * vecRefSum.at(i).second.cwiseAbs().maxCoeff());
+        }
+    }
+}
+
+//=============================================================================================================
+
+Network TestSpectralConnectivity::calculatePlan(const QString& sMethod,
+                                                const QList<QPair<int,int> >& lNodePairs,
+                                                const QVector<int>& vecSeedNodes,
+                                                const QList<QPair<float,float> >& lFrequencyBands) const
+{
+    ConnectivitySettings settings;
+    settings.setSamplingFrequency(1000);
+    settings.setFFTSize(m_lPlanTrials.at(0).cols());
+    settings.setWindowType("hanning");
+    settings.setConnectivityMethods(QStringList() << sMethod);
+    settings.setNodePairs(lNodePairs);
+    settings.setSeedNodes(vecSeedNodes);
+    settings.setFrequencyBands(lFrequencyBands);
+    settings.append(m_lPlanTrials);
+
+    QList<Network> lNetworks = Connectivity::calculate(settings);
+
+    return lNetworks.isEmpty() ? Network() : lNetworks.first();
+}
+
+//=============================================================================================================
+
+void TestSpectralConnectivity::comparePlan(const QList<QPair<int,int> >& lNodePairs,
+                                           const QVector<int>& vecSeedNodes,
+                                           const MatrixXi& matPlanned) const
+{
+    for(int i = 0; i < m_lPlanMethods.size(); ++i) {
+        Network network = calculatePlan(m_lPlanMethods.at(i), lNodePairs, vecSeedNodes, QList<QPair<float,float> >());
+        Network refNetwork = calculatePlan(m_lPlanMethods.at(i), QList<QPair<int,int> >(), QVector<int>(), QList<QPair<float,float> >());
+
+        MatrixXd matConnectivity = network.getFullConnectivityMatrix();
+        MatrixXd matRefConnectivity = refNetwork.getFullConnectivityMatrix();
+
+        QCOMPARE(matConnectivity.rows(), matPlanned.rows());
+        QCOMPARE(matConnectivity.cols(), matPlanned.cols());
+        QCOMPARE(matRefConnectivity.rows(), matPlanned.rows());
+
+        for(int r = 0; r < matPlanned.rows(); ++r) {
+            for(int c = 0; c < matPlanned.cols(); ++c) {
+                if(matPlanned(r,c) != 0) {
+                    QVERIFY(fabs(matConnectivity(r,c) - matRefConnectivity(r,c)) < dEpsilon);
+                } else {
+                    QCOMPARE(matConnectivity(r,c), 0.0);
+                }
+            }
+        }
+
+        // The all pairs network is not trivially zero
+        QVERIFY(matRefConnectivity.cwiseAbs().maxCoeff() > 0.0);
+    }
+}
+
+//=============================================================================================================
+
+Network TestSpectralConnectivity::randomNetwork(int iNumberNodes,
+                                                int iNumberBins,
+                                                QList<VectorXd>& lBinWeights) const
+{
+    QRandomGenerator generator(3);
+
+    Network network("Random");
+    network.initWeights(iNumberNodes, iNumberBins);
+    lBinWeights.clear();
+
+    for(int i = 0; i < iNumberNodes; ++i) {
+        for(int j = i + 1; j < iNumberNodes; ++j) {
+            VectorXd vecWeights(iNumberBins);
+            for(int k = 0; k < iNumberBins; ++k) {
+                vecWeights[k] = 2.0 * generator.generateDouble() - 1.0;
+            }
+
+            network.setWeights(i, j, vecWeights);
+            lBinWeights << vecWeights;
+        }
+    }
+
+    network.updateWeights();
+
+    return network;
+}
+
+//=============================================================================================================
+
 void TestSpectralConnectivity::cleanupTestCase()
 {
 }
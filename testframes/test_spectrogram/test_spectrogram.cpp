@@ -0,0 +1,252 @@
+//=============================================================================================================
+/**
+ * @file     test_spectrogram.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of the truncated window spectrogram against a full signal length reference.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/spectrogram.h>
+
+#include <cmath>
+
+#include <Eigen/Dense>
+#include <unsupported/Eigen/FFT>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestSpectrogram
+ *
+ * @brief The TestSpectrogram class compares Spectrogram::makeSpectrogram with the former implementation, which
+ *        evaluated the Gaussian window over the whole signal and ran one signal length fft per sample.
+ *
+ */
+class TestSpectrogram: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestSpectrogram();
+
+private slots:
+    void initTestCase();
+    void compareFullLengthFft();
+    void compareDefaultFft();
+    void compareHopSize();
+    void compareMultiChannel();
+    void cleanupTestCase();
+
+private:
+    MatrixXd computeReference(const VectorXd& vecSignal,
+                              qint32 iWindowSize) const;
+    double relativeError(const MatrixXd& matResult,
+                         const MatrixXd& matReference) const;
+
+    double      m_dEpsilon;
+    int         m_iNumSamples;
+    qint32      m_iWindowSize;
+    VectorXd    m_vecChirp;
+    VectorXd    m_vecSine;
+    MatrixXd    m_matRefChirp;
+};
+
+//=============================================================================================================
+
+TestSpectrogram::TestSpectrogram()
+: m_dEpsilon(1e-6)
+, m_iNumSamples(1024)
+, m_iWindowSize(64)
+{
+}
+
+//=============================================================================================================
+
+void TestSpectrogram::initTestCase()
+{
+    // Linear chirp from 0.02 to 0.3 of the sampling frequency and a sine at 0.125 of the sampling frequency
+    m_vecChirp.resize(m_iNumSamples);
+    m_vecSine.resize(m_iNumSamples);
+
+    for(int n = 0; n < m_iNumSamples; ++n) {
+        double t = double(n) / m_iNumSamples;
+        m_vecChirp[n] = std::sin(2.0 * M_PI * m_iNumSamples * (0.02 * t + 0.14 * t * t)) + 0.5;
+        m_vecSine[n] = 2.0 * std::sin(2.0 * M_PI * 0.125 * n);
+    }
+
+    m_matRefChirp = computeReference(m_vecChirp, m_iWindowSize);
+}
+
+//=============================================================================================================
+
+void TestSpectrogram::compareFullLengthFft()
+{
+    // With the fft length set to the signal length the bins are the same as the ones of the reference
+    MatrixXd matResult = Spectrogram::makeSpectrogram(m_vecChirp, m_iWindowSize, 1, m_iNumSamples);
+
+    QCOMPARE(matResult.rows(), m_matRefChirp.rows());
+    QCOMPARE(matResult.cols(), m_matRefChirp.cols());
+    QVERIFY(relativeError(matResult, m_matRefChirp) < m_dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestSpectrogram::compareDefaultFft()
+{
+    // The default fft length only covers the window support. Zero padding samples the same spectrum more densely,
+    // so every bin of the short fft matches every (signal length / fft length)th bin of the reference.
+    MatrixXd matResult = Spectrogram::makeSpectrogram(m_vecChirp, m_iWindowSize);
+
+    QVERIFY(matResult.rows() < m_matRefChirp.rows());
+    QCOMPARE(m_matRefChirp.rows() % matResult.rows(), Index(0));
+    QCOMPARE(matResult.cols(), m_matRefChirp.cols());
+
+    int iStep = m_matRefChirp.rows() / matResult.rows();
+    MatrixXd matRefSubsampled(matResult.rows(), matResult.cols());
+    for(int k = 0; k < matResult.rows(); ++k) {
+        matRefSubsampled.row(k) = m_matRefChirp.row(k * iStep);
+    }
+
+    QVERIFY(relativeError(matResult, matRefSubsampled) < m_dEpsilon);
+
+    // The same holds for a pure sine, whose power peaks at the sine frequency in every frame away from the borders
+    MatrixXd matRefSine = computeReference(m_vecSine, m_iWindowSize);
+    MatrixXd matSine = Spectrogram::makeSpectrogram(m_vecSine, m_iWindowSize);
+
+    for(int k = 0; k < matSine.rows(); ++k) {
+        matRefSubsampled.row(k) = matRefSine.row(k * iStep);
+    }
+
+    QVERIFY(relativeError(matSine, matRefSubsampled) < m_dEpsilon);
+
+    Index iMaxRow;
+    matSine.col(m_iNumSamples / 2).maxCoeff(&iMaxRow);
+    QCOMPARE(int(iMaxRow), int(0.125 * 2 * matSine.rows()));
+}
+
+//=============================================================================================================
+
+void TestSpectrogram::compareHopSize()
+{
+    // A hop size only skips frames, the remaining frames are the same as with a hop size of one
+    int iHopSize = 16;
+    MatrixXd matResult = Spectrogram::makeSpectrogram(m_vecChirp, m_iWindowSize, iHopSize, m_iNumSamples);
+
+    QCOMPARE(int(matResult.cols()), (m_iNumSamples + iHopSize - 1) / iHopSize);
+
+    MatrixXd matRefHop(m_matRefChirp.rows(), matResult.cols());
+    for(int i = 0; i < matResult.cols(); ++i) {
+        matRefHop.col(i) = m_matRefChirp.col(i * iHopSize);
+    }
+
+    QVERIFY(relativeError(matResult, matRefHop) < m_dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestSpectrogram::compareMultiChannel()
+{
+    MatrixXd matData(2, m_iNumSamples);
+    matData.row(0) = m_vecSine.transpose();
+    matData.row(1) = m_vecChirp.transpose();
+
+    QVector<MatrixXd> lResult = Spectrogram::makeSpectrograms(matData, m_iWindowSize, 1, m_iNumSamples);
+
+    QCOMPARE(lResult.size(), 2);
+    QVERIFY(relativeError(lResult.at(0), computeReference(m_vecSine, m_iWindowSize)) < m_dEpsilon);
+    QVERIFY(relativeError(lResult.at(1), m_matRefChirp) < m_dEpsilon);
+}
+
+//=============================================================================================================
+
+void TestSpectrogram::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+MatrixXd TestSpectrogram::computeReference(const VectorXd& vecSignal,
+                                           qint32 iWindowSize) const
+{
+    VectorXd vecCentered = vecSignal.array() - vecSignal.mean();
+    int iNumSamples = vecCentered.rows();
+
+    Eigen::FFT<double> fft;
+    MatrixXd matTf = MatrixXd::Zero(iNumSamples / 2, iNumSamples);
+    VectorXd vecWindowed(iNumSamples);
+    VectorXcd vecFft(iNumSamples);
+
+    // The former implementation: the window is evaluated over the whole signal for every translation
+    for(int translate = 0; translate < iNumSamples; ++translate) {
+        for(int n = 0; n < iNumSamples; ++n) {
+            double t = (double(n) - translate) / iWindowSize;
+            vecWindowed[n] = vecCentered[n] * exp(-3.14 * pow(t, 2)) * pow(sqrt(double(iWindowSize)), -1) * pow(2.0, 0.25);
+        }
+
+        fft.fwd(vecFft, vecWindowed);
+        matTf.col(translate) = vecFft.segment(0, iNumSamples / 2).array().abs2();
+    }
+
+    return matTf;
+}
+
+//=============================================================================================================
+
+double TestSpectrogram::relativeError(const MatrixXd& matResult,
+                                      const MatrixXd& matReference) const
+{
+    if(matResult.rows() != matReference.rows() || matResult.cols() != matReference.cols()) {
+        return std::numeric_limits<double>::max();
+    }
+
+    return (matResult - matReference).cwiseAbs().maxCoeff() / matReference.cwiseAbs().maxCoeff();
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestSpectrogram)
+#include "test_spectrogram.moc"
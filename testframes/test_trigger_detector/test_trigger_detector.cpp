@@ -0,0 +1,273 @@
+//=============================================================================================================
+/**
+ * @file     test_trigger_detector.cpp
+ * @author   MNE-CPP Authors
+ * @since    0.1.7
+ * @date     October, 2020
+ *
+ * @section  LICENSE
+ *
+ * Copyright (C) 2020, MNE-CPP Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+ * the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ *       following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+ *       the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+ *       to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * @brief    Test of the block wise TriggerDetector against detectTriggerFlanksMax.
+ *
+ */
+
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <rtprocessing/detecttrigger.h>
+
+#include <cmath>
+
+#include <Eigen/Dense>
+
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QRandomGenerator>
+
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTPROCESSINGLIB;
+using namespace Eigen;
+
+//=============================================================================================================
+/**
+ * DECLARE CLASS TestTriggerDetector
+ *
+ * @brief The TestTriggerDetector class streams a pulse train block wise through the TriggerDetector and compares
+ *        the events with detectTriggerFlanksMax applied to the whole data at once.
+ *
+ */
+class TestTriggerDetector: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestTriggerDetector();
+
+private slots:
+    void initTestCase();
+    void compareFixedBlockSizes();
+    void compareRandomBlockSizes();
+    void compareRemoveOffset();
+    void cleanupTestCase();
+
+private:
+    MatrixXd generatePulseTrain(double dOffset,
+                                quint32 uSeed) const;
+    QMap<int,QList<QPair<int,double> > > detectBlockWise(const MatrixXd& matData,
+                                                          const QVector<int>& vecBlockSizes,
+                                                          bool bRemoveOffset) const;
+    void compareWithReference(const MatrixXd& matData,
+                              const QVector<int>& vecBlockSizes,
+                              bool bRemoveOffset) const;
+
+    QList<int>  m_lTriggerChannels;
+    int         m_iNumChannels;
+    int         m_iNumSamples;
+    int         m_iBurstLengthSamp;
+    double      m_dThreshold;
+};
+
+//=============================================================================================================
+
+TestTriggerDetector::TestTriggerDetector()
+: m_iNumChannels(5)
+, m_iNumSamples(20000)
+, m_iBurstLengthSamp(50)
+, m_dThreshold(0.5)
+{
+    m_lTriggerChannels << 1 << 3 << 4;
+}
+
+//=============================================================================================================
+
+void TestTriggerDetector::initTestCase()
+{
+}
+
+//=============================================================================================================
+
+void TestTriggerDetector::compareFixedBlockSizes()
+{
+    MatrixXd matData = generatePulseTrain(0.0, 1);
+
+    // Block sizes around the 64 sample words of the detector and the burst length
+    QVector<int> vecSizes;
+    vecSizes << 1 << 3 << 50 << 51 << 63 << 64 << 65 << 100 << 1000 << m_iNumSamples;
+
+    for(int i = 0; i < vecSizes.size(); ++i) {
+        compareWithReference(matData, QVector<int>() << vecSizes.at(i), false);
+    }
+}
+
+//=============================================================================================================
+
+void TestTriggerDetector::compareRandomBlockSizes()
+{
+    MatrixXd matData = generatePulseTrain(0.0, 2);
+
+    QRandomGenerator generator(3);
+    for(int iRun = 0; iRun < 20; ++iRun) {
+        QVector<int> vecSizes;
+        for(int i = 0; i < 200; ++i) {
+            vecSizes << generator.bounded(1, 300);
+        }
+
+        compareWithReference(matData, vecSizes, false);
+    }
+}
+
+//=============================================================================================================
+
+void TestTriggerDetector::compareRemoveOffset()
+{
+    // The first sample of the stream is removed as offset from every block
+    MatrixXd matData = generatePulseTrain(0.25, 4);
+
+    QVector<int> vecSizes;
+    vecSizes << 1 << 64 << 77 << m_iNumSamples;
+
+    for(int i = 0; i < vecSizes.size(); ++i) {
+        compareWithReference(matData, QVector<int>() << vecSizes.at(i), true);
+    }
+}
+
+//=============================================================================================================
+
+void TestTriggerDetector::cleanupTestCase()
+{
+}
+
+//=============================================================================================================
+
+MatrixXd TestTriggerDetector::generatePulseTrain(double dOffset,
+                                                 quint32 uSeed) const
+{
+    QRandomGenerator generator(uSeed);
+
+    // Noise on the non trigger channels stays below the threshold
+    MatrixXd matData = MatrixXd::Constant(m_iNumChannels, m_iNumSamples, dOffset);
+    for(int c = 0; c < m_iNumChannels; ++c) {
+        if(!m_lTriggerChannels.contains(c)) {
+            for(int s = 0; s < m_iNumSamples; ++s) {
+                matData(c, s) += 0.4 * generator.generateDouble();
+            }
+        }
+    }
+
+    // Pulses shorter than the burst length, their onsets are further apart than the burst length.
+    // Under these conditions both detection schemes report the pulse onsets.
+    for(int i = 0; i < m_lTriggerChannels.size(); ++i) {
+        int iChIdx = m_lTriggerChannels.at(i);
+        int iOnset = 1 + generator.bounded(m_iBurstLengthSamp);
+
+        while(iOnset < m_iNumSamples) {
+            int iWidth = 1 + generator.bounded(m_iBurstLengthSamp);
+            double dValue = 1 + generator.bounded(5);
+
+            for(int s = iOnset; s < std::min(iOnset + iWidth, m_iNumSamples); ++s) {
+                matData(iChIdx, s) = dOffset + dValue;
+            }
+
+            iOnset += m_iBurstLengthSamp + 2 + generator.bounded(3 * m_iBurstLengthSamp);
+        }
+    }
+
+    return matData;
+}
+
+//=============================================================================================================
+
+QMap<int,QList<QPair<int,double> > > TestTriggerDetector::detectBlockWise(const MatrixXd& matData,
+                                                                          const QVector<int>& vecBlockSizes,
+                                                                          bool bRemoveOffset) const
+{
+    TriggerDetector detector(m_lTriggerChannels, m_dThreshold, bRemoveOffset, m_iBurstLengthSamp);
+
+    // The block sizes are used in turn until the data is consumed
+    int iFrom = 0;
+    for(int iBlock = 0; iFrom < matData.cols(); ++iBlock) {
+        int iSize = std::min(vecBlockSizes.at(iBlock % vecBlockSizes.size()), int(matData.cols()) - iFrom);
+        detector.detect(matData.middleCols(iFrom, iSize), iFrom);
+        iFrom += iSize;
+    }
+
+    QMap<int,QList<QPair<int,double> > > mapDetected;
+    for(int i = 0; i < m_lTriggerChannels.size(); ++i) {
+        mapDetected.insert(m_lTriggerChannels.at(i), QList<QPair<int,double> >());
+    }
+
+    // The events of one channel are ordered by sample, since the blocks are passed in stream order
+    Ref<const MatrixXi> matEvents = detector.events();
+    for(int i = 0; i < matEvents.rows(); ++i) {
+        mapDetected[matEvents(i,1)].append(qMakePair(matEvents(i,0), double(matEvents(i,2))));
+    }
+
+    return mapDetected;
+}
+
+//=============================================================================================================
+
+void TestTriggerDetector::compareWithReference(const MatrixXd& matData,
+                                               const QVector<int>& vecBlockSizes,
+                                               bool bRemoveOffset) const
+{
+    QMap<int,QList<QPair<int,double> > > mapReference = detectTriggerFlanksMax(matData,
+                                                                               m_lTriggerChannels,
+                                                                               0,
+                                                                               m_dThreshold,
+                                                                               bRemoveOffset,
+                                                                               m_iBurstLengthSamp);
+    QMap<int,QList<QPair<int,double> > > mapDetected = detectBlockWise(matData,
+                                                                       vecBlockSizes,
+                                                                       bRemoveOffset);
+
+    QCOMPARE(mapDetected.keys(), mapReference.keys());
+
+    for(int i = 0; i < m_lTriggerChannels.size(); ++i) {
+        const QList<QPair<int,double> >& lReference = mapReference[m_lTriggerChannels.at(i)];
+        const QList<QPair<int,double> >& lDetected = mapDetected[m_lTriggerChannels.at(i)];
+
+        QVERIFY(!lReference.isEmpty());
+        QCOMPARE(lDetected.size(), lReference.size());
+
+        for(int j = 0; j < lReference.size(); ++j) {
+            QCOMPARE(lDetected.at(j).first, lReference.at(j).first);
+            QCOMPARE(lDetected.at(j).second, double(std::lround(lReference.at(j).second)));
+        }
+    }
+}
+
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_GUILESS_MAIN(TestTriggerDetector)
+#include "test_trigger_detector.moc"
@@ -53,11 +53,18 @@ SUBDIRS += \
     test_fiff_mne_types_io \
     test_filtering \
     test_hpiFit \
+    test_hpi_demodulator \
     test_mne_forward_solution \
     test_fiff_cov \
     test_fiff_digitizer \
     test_mne_msh_display_surface_set \
-    test_mne_project_to_surface
+    test_mne_project_to_surface \
+    test_spectrogram \
+    test_trigger_detector \
+    test_mne_sourceestimate_io \
+    test_rtfiffrawviewmodel \
+    test_kdtree \
+    test_hpi_fit_data
 
     qtHaveModule(charts) {
         SUBDIRS += \
@@ -65,4 +72,9 @@ SUBDIRS += \
             test_geometryinfo \
             test_spectral_connectivity \
             test_mne_anonymize
+
+        !contains(MNECPP_CONFIG, noApplications) {
+            SUBDIRS += \
+                test_annotation_model
+        }
     }